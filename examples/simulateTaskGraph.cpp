@@ -0,0 +1,156 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithm.hpp"
+#include "algorithms/tbftaskgraph.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <string>
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] Simulates the execution of a task graph (see TbfTaskGraph) on 1, 2, 4... cores" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -f, --file: the task graph to load (written by TbfTaskGraph::save)," << std::endl;
+        std::cout << "[HELP]               otherwise the graph of a random tree is generated with the estimated costs" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree (when no file is given)" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles (when no file is given)" << std::endl;
+        std::cout << "[HELP]   -bs, --block-size: the number of cells/leaves per group (when no file is given)" << std::endl;
+        std::cout << "[HELP]   -cp, --critical-path: use the critical path priorities (when no file is given)" << std::endl;
+        std::cout << "[HELP]   -o, --output: save the task graph in this file" << std::endl;
+        std::cout << "[HELP]   -e, --estimated: use the estimated costs only (and not the measured ones)" << std::endl;
+        std::cout << "[HELP]   -mc, --max-cores: the maximum number of cores" << std::endl;
+        std::cout << "[HELP]   -p, --policy: fifo, priority, critical-path or all" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<TbfTaskGraph> taskGraph;
+    bool useEstimatedCosts = TbfParams::ExistParameter(argc, argv, {"-e", "--estimated"});
+
+    if(TbfParams::ExistParameter(argc, argv, {"-f", "--file"})){
+        const std::string filename = TbfParams::GetStr(argc, argv, {"-f", "--file"}, "");
+        taskGraph = TbfTaskGraph::Load(filename);
+        if(!taskGraph){
+            std::cout << "[ERROR] Cannot load the task graph from " << filename << std::endl;
+            return 1;
+        }
+        std::cout << "Load the task graph from " << filename << std::endl;
+    }
+    else{
+        using RealType = double;
+        const int Dim = 3;
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 6);
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+
+        const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 100000);
+        const long int BlockSize = TbfParams::GetValue<long int>(argc, argv, {"-bs", "--block-size"}, 100);
+
+        std::cout << "Particles info" << std::endl;
+        std::cout << " - Tree height = " << TreeHeight << std::endl;
+        std::cout << " - Number of particles = " << NbParticles << std::endl;
+        std::cout << " - Block size = " << BlockSize << std::endl;
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                                  std::array<long int,1>, std::array<long int,1>>;
+        using AlgorithmClass = TbfThreadPoolAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+        TreeClass tree(configuration, particlePositions, BlockSize);
+
+        AlgorithmClass algorithm(configuration);
+        algorithm.setUseCriticalPathPriorities(TbfParams::ExistParameter(argc, argv, {"-cp", "--critical-path"}));
+        algorithm.getTaskGraph().setEnabled(true);
+        algorithm.execute(tree);
+
+        // Move the graph out of the algorithm
+        taskGraph.reset(new TbfTaskGraph);
+        std::swap(*taskGraph, algorithm.getTaskGraph());
+
+        // The durations of the test kernel are not representative
+        useEstimatedCosts = true;
+    }
+
+    std::cout << "Task graph" << std::endl;
+    std::cout << " - Number of tasks = " << taskGraph->getNbNodes() << std::endl;
+    std::cout << " - Number of dependencies = " << taskGraph->getNbEdges() << std::endl;
+
+    if(TbfParams::ExistParameter(argc, argv, {"-o", "--output"})){
+        const std::string filename = TbfParams::GetStr(argc, argv, {"-o", "--output"}, "");
+        if(!taskGraph->save(filename)){
+            std::cout << "[ERROR] Cannot save the task graph in " << filename << std::endl;
+            return 1;
+        }
+        std::cout << "Save the task graph in " << filename << std::endl;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    std::vector<double> costs;
+    if(useEstimatedCosts){
+        for(long int idxNode = 0 ; idxNode < taskGraph->getNbNodes() ; ++idxNode){
+            costs.push_back(taskGraph->getEstimatedCost(taskGraph->getNode(idxNode)));
+        }
+    }
+    else{
+        costs = taskGraph->getCosts();
+    }
+
+    const long int MaxNbCores = TbfParams::GetValue<long int>(argc, argv, {"-mc", "--max-cores"}, 512);
+    const std::string policyName = TbfParams::GetStr(argc, argv, {"-p", "--policy"}, "all");
+
+    std::vector<TbfTaskGraph::SchedulingPolicy> policies;
+    for(int idxPolicy = 0 ; idxPolicy < TbfTaskGraph::NbPolicies ; ++idxPolicy){
+        const auto policy = static_cast<TbfTaskGraph::SchedulingPolicy>(idxPolicy);
+        if(policyName == "all" || policyName == TbfTaskGraph::GetPolicyName(policy)){
+            policies.push_back(policy);
+        }
+    }
+    if(policies.empty()){
+        std::cout << "[ERROR] Unknown policy " << policyName << std::endl;
+        return 1;
+    }
+
+    for(const auto policy : policies){
+        std::cout << "Policy " << TbfTaskGraph::GetPolicyName(policy) << std::endl;
+        double sequentialMakespan = 0;
+        for(long int nbCores = 1 ; nbCores <= MaxNbCores ; nbCores *= 2){
+            const auto result = taskGraph->simulate(nbCores, policy, costs);
+            if(nbCores == 1){
+                std::cout << " - Total cost = " << result.totalCost << std::endl;
+                std::cout << " - Critical path = " << result.criticalPath << std::endl;
+                sequentialMakespan = result.makespan;
+            }
+            std::cout << " - " << std::setw(5) << nbCores << " cores: makespan = " << result.makespan
+                      << " speedup = " << (result.makespan != 0 ? sequentialMakespan/result.makespan : 1)
+                      << " efficiency = " << result.efficiency << std::endl;
+        }
+    }
+
+    return 0;
+}
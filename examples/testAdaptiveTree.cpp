@@ -0,0 +1,178 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "core/tbfadaptivetree.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+#include "algorithms/sequential/tbfadaptivealgorithm.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <memory>
+
+
+template <class RealType, class TreeClass, class AlgorithmClass, long int NbRhsValuesPerParticle>
+void ExecuteAndCheck(const char* inName, TreeClass& inTree, AlgorithmClass& inAlgorithm,
+                     const std::array<RealType*, NbRhsValuesPerParticle>& inDirectRhs){
+    TbfTimer timerExecute;
+
+    inAlgorithm.execute(inTree);
+
+    timerExecute.stop();
+    std::cout << inName << " execute in " << timerExecute.getElapsed() << "s" << std::endl;
+
+    std::array<TbfAccuracyChecker<RealType>, NbRhsValuesPerParticle> partcilesRhsAccuracy;
+
+    inTree.applyToAllLeaves([&](auto&& leafHeader, const long int* particleIndexes,
+                                const auto& /*particleDataPtr*/, const auto& particleRhsPtr){
+        for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+            for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+               partcilesRhsAccuracy[idxValue].addValues(inDirectRhs[idxValue][particleIndexes[idxPart]],
+                                                        particleRhsPtr[idxValue][idxPart]);
+            }
+        }
+    });
+
+    std::cout << "Relative differences:" << std::endl;
+    for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+       std::cout << " - Rhs " << idxValue << " = " << partcilesRhsAccuracy[idxValue] << std::endl;
+    }
+}
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree (maximum height for the adaptive tree)" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -mpl, --max-particles-per-leaf: the capacity of the leaves of the adaptive tree" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 6);
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 20000);
+    const long int MaxParticlesPerLeaf = TbfParams::GetValue<long int>(argc, argv, {"-mpl", "--max-particles-per-leaf"}, 64);
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    std::cout << configuration << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    // Half of the particles are in a small cluster, such that a uniform
+    // tree has a few overloaded leaves and many almost empty ones
+    TbfRandom<RealType, Dim> randomGenerator(BoxWidths);
+
+    std::vector<std::array<RealType, Dim+1>> particlePositions(NbParticles);
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        auto position = randomGenerator.getNewItem();
+        for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            particlePositions[idxPart][idxDim] = (idxPart%2 ? position[idxDim] : RealType(0.3) + position[idxDim]*RealType(0.02));
+        }
+        particlePositions[idxPart][Dim] = 0.1;
+    }
+
+    std::cout << "Particles info" << std::endl;
+    std::cout << " - Tree height = " << TreeHeight << std::endl;
+    std::cout << " - Number of particles = " << NbParticles << std::endl;
+    std::cout << " - Max particles per leaf = " << MaxParticlesPerLeaf << std::endl;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const unsigned int P = 12;
+    constexpr long int NbDataValuesPerParticle = Dim+1;
+    constexpr long int NbRhsValuesPerParticle = 4;
+    constexpr long int VectorSize = ((P+2)*(P+1))/2;
+
+    using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+    using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+    using KernelClass = FRotationKernel<RealType, P>;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    std::array<RealType*, NbDataValuesPerParticle> particles;
+    for(auto& vec : particles){
+        vec = new RealType[NbParticles]();
+    }
+    std::array<RealType*, NbRhsValuesPerParticle> particlesRhs;
+    for(auto& vec : particlesRhs){
+        vec = new RealType[NbParticles]();
+    }
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        for(int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
+            particles[idxValue][idxPart] = particlePositions[idxPart][idxValue];
+        }
+    }
+
+    {
+        TbfTimer timerDirect;
+
+        FP2PR::template GenericInner<RealType>(particles, particlesRhs, NbParticles);
+
+        timerDirect.stop();
+        std::cout << "Direct execute in " << timerDirect.getElapsed() << "s" << std::endl;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    {
+        using AlgorithmClass = TbfAlgorithm<RealType, KernelClass>;
+        using TreeClass = TbfTree<RealType, RealType, NbDataValuesPerParticle, RealType, NbRhsValuesPerParticle,
+                                  MultipoleClass, LocalClass>;
+
+        TbfTimer timerBuildTree;
+
+        TreeClass tree(configuration, TbfUtils::make_const(particlePositions));
+
+        timerBuildTree.stop();
+        std::cout << "[Uniform] Build the tree in " << timerBuildTree.getElapsed() << "s" << std::endl;
+
+        std::unique_ptr<AlgorithmClass> algorithm(new AlgorithmClass(configuration));
+        ExecuteAndCheck<RealType, TreeClass, AlgorithmClass, NbRhsValuesPerParticle>("[Uniform]", tree, *algorithm, particlesRhs);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    {
+        using AlgorithmClass = TbfAdaptiveAlgorithm<RealType, KernelClass>;
+        using TreeClass = TbfAdaptiveTree<RealType, RealType, NbDataValuesPerParticle, RealType, NbRhsValuesPerParticle,
+                                          MultipoleClass, LocalClass>;
+
+        TbfTimer timerBuildTree;
+
+        TreeClass tree(configuration, TbfUtils::make_const(particlePositions), MaxParticlesPerLeaf);
+
+        timerBuildTree.stop();
+        std::cout << "[Adaptive] Build the tree in " << timerBuildTree.getElapsed() << "s" << std::endl;
+        std::cout << tree << std::endl;
+
+        std::unique_ptr<AlgorithmClass> algorithm(new AlgorithmClass(configuration));
+        ExecuteAndCheck<RealType, TreeClass, AlgorithmClass, NbRhsValuesPerParticle>("[Adaptive]", tree, *algorithm, particlesRhs);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    for(auto& vec : particles){
+        delete[] vec;
+    }
+    for(auto& vec : particlesRhs){
+        delete[] vec;
+    }
+
+    return 0;
+}
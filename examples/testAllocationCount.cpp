@@ -0,0 +1,214 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/tbfalgorithmselecter.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+// Count the calls to the global operator new (for all the threads),
+// all the replaceable allocation functions are replaced (aligned and nothrow)
+namespace {
+std::atomic<long int> NbAllocations{0};
+
+// Not inlined, such that the compiler does not pair the malloc/free
+// with the new/delete expressions of the callers
+[[gnu::noinline]] void* CountedAllocate(std::size_t inSize, std::size_t inAlignement) noexcept{
+    NbAllocations += 1;
+    if(inSize == 0){
+        inSize = 1;
+    }
+    if(inAlignement <= alignof(std::max_align_t)){
+        return std::malloc(inSize);
+    }
+    // The size must be a multiple of the alignement for aligned_alloc
+    return std::aligned_alloc(inAlignement, ((inSize + inAlignement - 1)/inAlignement)*inAlignement);
+}
+
+[[gnu::noinline]] void CountedRelease(void* inPtr) noexcept{
+    std::free(inPtr);
+}
+
+void* CountedAllocateOrThrow(const std::size_t inSize, const std::size_t inAlignement){
+    if(void* ptr = CountedAllocate(inSize, inAlignement)){
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+}
+
+void* operator new(std::size_t inSize){
+    return CountedAllocateOrThrow(inSize, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t inSize){
+    return CountedAllocateOrThrow(inSize, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t inSize, std::align_val_t inAlignement){
+    return CountedAllocateOrThrow(inSize, static_cast<std::size_t>(inAlignement));
+}
+
+void* operator new[](std::size_t inSize, std::align_val_t inAlignement){
+    return CountedAllocateOrThrow(inSize, static_cast<std::size_t>(inAlignement));
+}
+
+void* operator new(std::size_t inSize, const std::nothrow_t&) noexcept{
+    return CountedAllocate(inSize, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t inSize, const std::nothrow_t&) noexcept{
+    return CountedAllocate(inSize, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t inSize, std::align_val_t inAlignement, const std::nothrow_t&) noexcept{
+    return CountedAllocate(inSize, static_cast<std::size_t>(inAlignement));
+}
+
+void* operator new[](std::size_t inSize, std::align_val_t inAlignement, const std::nothrow_t&) noexcept{
+    return CountedAllocate(inSize, static_cast<std::size_t>(inAlignement));
+}
+
+void operator delete(void* inPtr) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete[](void* inPtr) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete(void* inPtr, std::size_t) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete[](void* inPtr, std::size_t) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete(void* inPtr, std::align_val_t) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete[](void* inPtr, std::align_val_t) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete(void* inPtr, std::size_t, std::align_val_t) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete[](void* inPtr, std::size_t, std::align_val_t) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete(void* inPtr, const std::nothrow_t&) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete[](void* inPtr, const std::nothrow_t&) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete(void* inPtr, std::align_val_t, const std::nothrow_t&) noexcept{
+    CountedRelease(inPtr);
+}
+
+void operator delete[](void* inPtr, std::align_val_t, const std::nothrow_t&) noexcept{
+    CountedRelease(inPtr);
+}
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -nbl, --nb-loops: the number of times the FMM is executed" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 6);
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 100000);
+    const long int NbLoops = TbfParams::GetValue<long int>(argc, argv, {"-nbl", "--nb-loops"}, 5);
+
+    std::cout << "Particles info" << std::endl;
+    std::cout << " - Tree height = " << TreeHeight << std::endl;
+    std::cout << " - Number of particles = " << NbParticles << std::endl;
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+    std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        particlePositions[idxPart] = randomGenerator.getNewItem();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    using ParticleDataType = RealType;
+    constexpr long int NbDataValuesPerParticle = Dim;
+    using ParticleRhsType = long int;
+    constexpr long int NbRhsValuesPerParticle = 1;
+    using MultipoleClass = std::array<long int,1>;
+    using LocalClass = std::array<long int,1>;
+    using TreeClass = TbfTree<RealType,
+                              ParticleDataType,
+                              NbDataValuesPerParticle,
+                              ParticleRhsType,
+                              NbRhsValuesPerParticle,
+                              MultipoleClass,
+                              LocalClass>;
+
+    TreeClass tree(configuration, particlePositions);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    using KernelClass = TbfTestKernel<RealType>;
+    using AlgorithmClass = TbfAlgorithmSelecter::type<RealType, KernelClass>;
+
+    for(const bool useInteractionPlan : {false, true}){
+        AlgorithmClass algorithm(configuration);
+        algorithm.setUseInteractionPlan(useInteractionPlan);
+
+        // The first execution builds the interaction plan (if used)
+        algorithm.execute(tree);
+
+        TbfTimer timerExecute;
+        const long int nbAllocationsBefore = NbAllocations;
+
+        for(long int idxLoop = 0 ; idxLoop < NbLoops ; ++idxLoop){
+            algorithm.execute(tree);
+        }
+
+        const long int nbAllocations = NbAllocations - nbAllocationsBefore;
+        timerExecute.stop();
+
+        std::cout << (useInteractionPlan ? "With" : "Without") << " the interaction plan:" << std::endl;
+        std::cout << " - Execute in " << timerExecute.getElapsed()/double(NbLoops) << "s" << std::endl;
+        std::cout << " - Allocations per execute = " << double(nbAllocations)/double(NbLoops) << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfmortoncoder.hpp"
+#include "spacial/tbfhilbertspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbftimer.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <vector>
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -nbl, --nb-loops: the number of times each method is performed" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 10);
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 1000000);
+    const long int NbLoops = TbfParams::GetValue<long int>(argc, argv, {"-nbl", "--nb-loops"}, 5);
+
+    using SpaceIndexType = TbfDefaultSpaceIndexType<RealType>;
+    using IndexType = typename SpaceIndexType::IndexType;
+    using CoderType = TbfMortonCoder<Dim, IndexType>;
+
+    std::cout << "Particles info" << std::endl;
+    std::cout << " - Tree height = " << TreeHeight << std::endl;
+    std::cout << " - Number of particles = " << NbParticles << std::endl;
+    std::cout << " - Best method = " << CoderType::GetMethodName(CoderType::GetBestMethod()) << std::endl;
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+    std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        particlePositions[idxPart] = randomGenerator.getNewItem();
+    }
+
+    const SpaceIndexType spaceSystem(configuration);
+
+    std::vector<std::array<long int, Dim>> boxPositions(NbParticles);
+    std::vector<IndexType> referenceIndexes(NbParticles);
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        referenceIndexes[idxPart] = spaceSystem.getIndexFromPosition(particlePositions[idxPart]);
+        boxPositions[idxPart] = CoderType::DecodeLoop(referenceIndexes[idxPart]);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    auto benchmark = [&](const char* inName, auto&& inFunc){
+        std::vector<IndexType> indexes(NbParticles);
+        TbfTimer timer;
+        timer.stop();
+        for(long int idxLoop = 0 ; idxLoop < NbLoops ; ++idxLoop){
+            timer.start();
+            inFunc(indexes);
+            timer.stop();
+        }
+        std::cout << " - " << inName << " " << timer.getCumulated()/double(NbLoops) << "s" << std::endl;
+        if(indexes != referenceIndexes){
+            std::cout << "[ERROR] " << inName << " does not give the correct indexes" << std::endl;
+        }
+    };
+
+    std::cout << "Encode box positions:" << std::endl;
+    benchmark("loop     ", [&](std::vector<IndexType>& outIndexes){
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            outIndexes[idxPart] = CoderType::EncodeLoop(boxPositions[idxPart]);
+        }
+    });
+    benchmark("table    ", [&](std::vector<IndexType>& outIndexes){
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            outIndexes[idxPart] = CoderType::EncodeTable(boxPositions[idxPart]);
+        }
+    });
+    if(CoderType::HasBmi2()){
+        benchmark("bmi2     ", [&](std::vector<IndexType>& outIndexes){
+            for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                outIndexes[idxPart] = CoderType::EncodeBmi2(boxPositions[idxPart]);
+            }
+        });
+    }
+
+    std::cout << "Decode indexes:" << std::endl;
+    {
+        TbfTimer timerLoop;
+        timerLoop.stop();
+        TbfTimer timerBest;
+        timerBest.stop();
+        long int nbErrors = 0;
+        for(long int idxLoop = 0 ; idxLoop < NbLoops ; ++idxLoop){
+            std::vector<std::array<long int, Dim>> decoded(NbParticles);
+            timerLoop.start();
+            for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                decoded[idxPart] = CoderType::DecodeLoop(referenceIndexes[idxPart]);
+            }
+            timerLoop.stop();
+
+            timerBest.start();
+            for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                decoded[idxPart] = CoderType::Decode(referenceIndexes[idxPart]);
+            }
+            timerBest.stop();
+            nbErrors += (decoded != boxPositions ? 1 : 0);
+        }
+        std::cout << " - loop      " << timerLoop.getCumulated()/double(NbLoops) << "s" << std::endl;
+        std::cout << " - best      " << timerBest.getCumulated()/double(NbLoops) << "s" << std::endl;
+        if(nbErrors){
+            std::cout << "[ERROR] the decoding is not correct" << std::endl;
+        }
+    }
+
+    std::cout << "Positions to indexes:" << std::endl;
+    benchmark("one by one", [&](std::vector<IndexType>& outIndexes){
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            outIndexes[idxPart] = spaceSystem.getIndexFromPosition(particlePositions[idxPart]);
+        }
+    });
+    benchmark("batched   ", [&](std::vector<IndexType>& outIndexes){
+        spaceSystem.getIndexesFromPositions(particlePositions, 0, NbParticles, outIndexes.data());
+    });
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const TbfHilbertSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim>> hilbertSystem(configuration);
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        referenceIndexes[idxPart] = hilbertSystem.getIndexFromPosition(particlePositions[idxPart]);
+    }
+
+    std::cout << "Hilbert:" << std::endl;
+    benchmark("positions to indexes", [&](std::vector<IndexType>& outIndexes){
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            outIndexes[idxPart] = hilbertSystem.getIndexFromPosition(particlePositions[idxPart]);
+        }
+    });
+    benchmark("box positions to indexes", [&](std::vector<IndexType>& outIndexes){
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            outIndexes[idxPart] = hilbertSystem.getIndexFromBoxPos(hilbertSystem.getBoxPosFromIndex(referenceIndexes[idxPart]));
+        }
+    });
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbfparticlesorter.hpp"
+#include "utils/tbftimer.hpp"
+#include "utils/tbfparallel.hpp"
+
+#include "utils/tbfparams.hpp"
+
+#include <iostream>
+#include <algorithm>
+
+
+int main(int argc, char** argv){
+    if(TbfParams::ExistParameter(argc, argv, {"-h", "--help"})){
+        std::cout << "[HELP] Command " << argv[0] << " [params]" << std::endl;
+        std::cout << "[HELP] where params are:" << std::endl;
+        std::cout << "[HELP]   -h, --help: to get the current text" << std::endl;
+        std::cout << "[HELP]   -th, --tree-height: the height of the tree" << std::endl;
+        std::cout << "[HELP]   -nb, --nb-particles: specify the number of particles" << std::endl;
+        std::cout << "[HELP]   -nbl, --nb-loops: the number of times each sort is performed" << std::endl;
+        return 1;
+    }
+
+    using RealType = double;
+    const int Dim = 3;
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+    const long int TreeHeight = TbfParams::GetValue<long int>(argc, argv, {"-th", "--tree-height"}, 8);
+    const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+    const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const long int NbParticles = TbfParams::GetValue<long int>(argc, argv, {"-nb", "--nb-particles"}, 1000000);
+    const long int NbLoops = TbfParams::GetValue<long int>(argc, argv, {"-nbl", "--nb-loops"}, 5);
+    const int NbThreads = TbfParallel::GetNbThreads();
+
+    std::cout << "Particles info" << std::endl;
+    std::cout << " - Tree height = " << TreeHeight << std::endl;
+    std::cout << " - Number of particles = " << NbParticles << std::endl;
+    std::cout << " - Number of threads = " << NbThreads << std::endl;
+
+    TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+    std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        particlePositions[idxPart] = randomGenerator.getNewItem();
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    using SpaceIndexType = TbfDefaultSpaceIndexType<RealType>;
+    using SorterClass = TbfParticleSorter<RealType, SpaceIndexType>;
+    using IndexType = typename SpaceIndexType::IndexType;
+
+    const SpaceIndexType spaceSystem(configuration);
+
+    std::vector<std::pair<IndexType, long int>> randomKeys(NbParticles);
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        randomKeys[idxPart].first = spaceSystem.getIndexFromPosition(particlePositions[idxPart]);
+        randomKeys[idxPart].second = idxPart;
+    }
+
+    std::vector<std::pair<IndexType, long int>> sortedKeys = randomKeys;
+    std::sort(sortedKeys.begin(), sortedKeys.end());
+    for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+        sortedKeys[idxPart].second = idxPart;
+    }
+
+    // Simulate a time step: 1% of the particles move to a neighbor leaf
+    std::vector<std::pair<IndexType, long int>> nearlySortedKeys = sortedKeys;
+    for(long int idxPart = 0 ; idxPart < NbParticles ; idxPart += 100){
+        const IndexType shift = static_cast<IndexType>(randomGenerator.getNewItem()[0]*8) - 4;
+        nearlySortedKeys[idxPart].first = std::max(IndexType(0), std::min(spaceSystem.getUpperBoundAtLeafLevel()-1,
+                                                                          nearlySortedKeys[idxPart].first + shift));
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    const std::vector<std::pair<const char*, const std::vector<std::pair<IndexType, long int>>*>> inputs{
+        {"random", &randomKeys}, {"sorted", &sortedKeys}, {"nearly sorted", &nearlySortedKeys}};
+
+    for(const auto& input : inputs){
+        std::cout << "Input: " << input.first << std::endl;
+
+        TbfTimer timerStdSort;
+        TbfTimer timerComparison;
+        TbfTimer timerRadix;
+        TbfTimer timerAdaptive;
+
+        for(long int idxLoop = 0 ; idxLoop < NbLoops ; ++idxLoop){
+            auto keys = *input.second;
+            timerStdSort.start();
+            std::sort(keys.begin(), keys.end(), [](const auto& p1, const auto& p2){
+                return p1.first < p2.first;
+            });
+            timerStdSort.stop();
+
+            keys = *input.second;
+            timerComparison.start();
+            SorterClass::SortParticleIndexes(keys, spaceSystem.getUpperBoundAtLeafLevel(), NbThreads, SorterClass::SortComparison);
+            timerComparison.stop();
+
+            auto radixKeys = *input.second;
+            timerRadix.start();
+            SorterClass::SortParticleIndexes(radixKeys, spaceSystem.getUpperBoundAtLeafLevel(), NbThreads, SorterClass::SortRadix);
+            timerRadix.stop();
+
+            auto adaptiveKeys = *input.second;
+            timerAdaptive.start();
+            SorterClass::SortParticleIndexes(adaptiveKeys, spaceSystem.getUpperBoundAtLeafLevel(), NbThreads, SorterClass::SortAdaptive);
+            timerAdaptive.stop();
+
+            if(radixKeys != keys || adaptiveKeys != keys){
+                std::cout << "[ERROR] The sorts do not give the same result" << std::endl;
+                return -1;
+            }
+        }
+
+        std::cout << " - std::sort         " << timerStdSort.getCumulated()/double(NbLoops) << "s" << std::endl;
+        std::cout << " - parallel sort     " << timerComparison.getCumulated()/double(NbLoops) << "s" << std::endl;
+        std::cout << " - radix sort        " << timerRadix.getCumulated()/double(NbLoops) << "s" << std::endl;
+        std::cout << " - adaptive sort     " << timerAdaptive.getCumulated()/double(NbLoops) << "s" << std::endl;
+    }
+
+    return 0;
+}
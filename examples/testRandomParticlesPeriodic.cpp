@@ -100,10 +100,10 @@ int main(int argc, char** argv){
 
         // Bottom to top
         algorithm.execute(tree, TbfAlgorithmUtils::TbfBottomToTopStages);
-        // Periodic at the top (could be done in parallel with TbfTransferStages)
-        topAlgorithm.execute(tree);
-        // Transfer (could be done in parallel with topAlgorithm.execute)
-        algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+        // Periodic at the top in parallel with the transfer
+        topAlgorithm.executeConcurrently(tree, [&](){
+            algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+        });
         // Top to bottom
         algorithm.execute(tree, TbfAlgorithmUtils::TbfTopToBottomStages);
 
@@ -138,10 +138,10 @@ int main(int argc, char** argv){
 
         // Bottom to top
         algorithm.execute(tree, TbfAlgorithmUtils::TbfBottomToTopStages);
-        // Periodic at the top (could be done in parallel with TbfTransferStages)
-        topAlgorithm.execute(tree);
-        // Transfer (could be done in parallel with topAlgorithm.execute)
-        algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+        // Periodic at the top in parallel with the transfer
+        topAlgorithm.executeConcurrently(tree, [&](){
+            algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+        });
         // Top to bottom
         algorithm.execute(tree, TbfAlgorithmUtils::TbfTopToBottomStages);
 
@@ -0,0 +1,18 @@
+#ifndef TBFOPENMPAFFINITY_HPP
+#define TBFOPENMPAFFINITY_HPP
+
+#include "tbfglobal.hpp"
+
+// The tasks of the OpenMP algorithms give the data they write in an affinity
+// clause (OpenMP 5.0), which is the NUMA node of the group when it has been
+// placed (see TbfNumaAllocator). This is only a hint: the runtime may ignore it,
+// a task is never pinned to a node, and the clause is removed for older runtimes.
+#ifndef TBF_OMP_AFFINITY
+#if _OPENMP >= 201811
+#define TBF_OMP_AFFINITY(X) affinity(X)
+#else
+#define TBF_OMP_AFFINITY(X)
+#endif
+#endif
+
+#endif
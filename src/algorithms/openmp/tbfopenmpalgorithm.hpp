@@ -6,6 +6,14 @@
 #include "../sequential/tbfgroupkernelinterface.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/tbfcriticalpathpriorities.hpp"
+#include "algorithms/tbftasktracer.hpp"
+#include "algorithms/tbftaskgraph.hpp"
+#include "core/tbfinteractionplan.hpp"
+#include "core/tbfinteraction.hpp"
+#include "utils/tbfparallel.hpp"
+#include "algorithms/openmp/tbfopenmpcommute.hpp"
+#include "algorithms/openmp/tbfopenmpaffinity.hpp"
 
 #include <omp.h>
 
@@ -13,14 +21,6 @@
 #include <cassert>
 #include <iterator>
 
-#if _OPENMP >= 201811
-#ifndef mutexinout
-#define commute mutexinout
-#endif
-#else
-#define commute inout
-#endif
-
 template <class RealType_T, class KernelClass_T, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
 class TbfOpenmpAlgorithm {
 public:
@@ -38,7 +38,26 @@ protected:
     TbfGroupKernelInterface<SpaceIndexType> kernelWrapper;
     std::vector<KernelClass> kernels;
 
-    TbfAlgorithmUtils::TbfOperationsPriorities priorities;
+    // The fixed priorities, or the ones of the critical path if enabled
+    TbfCriticalPathPriorities priorities;
+
+    // Records the tasks if enabled
+    TbfTaskTracer tracer;
+
+    // Records the task graph of the last execution if enabled
+    TbfTaskGraph taskGraph;
+
+    // The commutative accesses without OpenMP 5.0
+    TbfOpenmpCommuteEmulator commuteEmulator;
+
+    // If true, the M2L and P2P use the interaction plan of the tree
+    bool useInteractionPlan;
+
+    // The interaction lists used by the tasks (the tasks have a view on them)
+    TbfAlgorithmUtils::TbfTaskDataPool<std::vector<TbfXtoXInteraction<typename SpaceIndexType::IndexType>>> interactionsPool;
+
+    // The interaction lists computed in parallel before the M2L/P2P tasks are created
+    TbfAlgorithmUtils::TbfInteractionListsCache<typename SpaceIndexType::IndexType> interactionLists;
 
     template <class TreeClass>
     void P2M(TreeClass& inTree){
@@ -67,11 +86,30 @@ protected:
                 const unsigned char* ptr_particleGroupObjGetDataPtr = reinterpret_cast<const unsigned char*>(&particleGroupObjGetDataPtr[0]);
                 const unsigned char* ptr_leafGroupObjGetMultipolePtr = reinterpret_cast<const unsigned char*>(&leafGroupObjGetMultipolePtr[0]);
 
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
+
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_leafGroupObjGetMultipolePtr[0]) default(shared) firstprivate(particleGroupObj, leafGroupObj) priority(priorities.getP2MPriority())
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_particleGroupObjGetDataPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_leafGroupObjGetMultipolePtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  particleGroupObj->getNbParticles(), leafGroupObj->getNbCells(),
+                                                                  0, priorities.getP2MPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(ptr_particleGroupObjGetDataPtr[0]), TbfTaskGraph::CommuteWrite(ptr_leafGroupObjGetMultipolePtr[0])});
+
+#pragma omp task depend(in:ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_leafGroupObjGetMultipolePtr[0]) TBF_OMP_AFFINITY(ptr_leafGroupObjGetMultipolePtr[0]) default(shared) firstprivate(particleGroupObj, leafGroupObj, idxGroup, kernelsPtr, commuteLocks, traceSubmitTime, graphNode) priority(priorities.getP2MPriority(idxGroup))
                 {
-                    kernelWrapper.P2M(kernelsPtr[omp_get_thread_num()], *particleGroupObj, *leafGroupObj);
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         particleGroupObj->getNbParticles(), leafGroupObj->getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageP2M, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.P2M(kernelsPtr[omp_get_thread_num()], *particleGroupObj, *leafGroupObj);
+                    });
+                    commuteLocks.release();
                 }
                 ++currentParticleGroup;
                 ++currentLeafGroup;
@@ -104,11 +142,31 @@ protected:
                 const unsigned char* ptr_lowerGroupGetMultipolePtr = reinterpret_cast<const unsigned char*>(&lowerGroupGetMultipolePtr[0]);
                 const unsigned char* ptr_upperGroupGetMultipolePtr = reinterpret_cast<const unsigned char*>(&upperGroupGetMultipolePtr[0]);
 
+                const long int idxUpperGroup = std::distance(upperCellGroup.begin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.cbegin(), currentLowerGroup);
+
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_lowerGroupGetMultipolePtr[0]) depend(commute:ptr_upperGroupGetMultipolePtr[0]) default(shared) firstprivate(upperGroup, lowerGroup)  priority(priorities.getM2MPriority(idxLevel))
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_lowerGroupGetMultipolePtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_upperGroupGetMultipolePtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                                  lowerGroup->getNbCells(), upperGroup->getNbCells(),
+                                                                  0, priorities.getM2MPriority(idxLevel, idxUpperGroup),
+                                                                  {TbfTaskGraph::Read(ptr_lowerGroupGetMultipolePtr[0]), TbfTaskGraph::CommuteWrite(ptr_upperGroupGetMultipolePtr[0])});
+
+#pragma omp task depend(in:ptr_lowerGroupGetMultipolePtr[0]) depend(commute:ptr_upperGroupGetMultipolePtr[0]) TBF_OMP_AFFINITY(ptr_upperGroupGetMultipolePtr[0]) default(shared) firstprivate(idxLevel, upperGroup, lowerGroup, idxUpperGroup, idxLowerGroup, kernelsPtr, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getM2MPriority(idxLevel, idxUpperGroup))
                 {
-                    kernelWrapper.M2M(idxLevel, kernelsPtr[omp_get_thread_num()], *lowerGroup, *upperGroup);
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                         lowerGroup->getNbCells(), upperGroup->getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageM2M, idxLevel, idxUpperGroup, [&](){
+                        kernelWrapper.M2M(idxLevel, kernelsPtr[omp_get_thread_num()], *lowerGroup, *upperGroup);
+                    });
+                    commuteLocks.release();
                 }
 
                 if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
@@ -126,8 +184,6 @@ protected:
 
     template <class TreeClass>
     void M2L(TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
-
         for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
             auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
 
@@ -135,13 +191,14 @@ protected:
             const auto endCellGroup = cellGroups.end();
 
             while(currentCellGroup != endCellGroup){
-                auto indexesForGroup = spacialSystem.getInteractionListForBlock(*currentCellGroup, idxLevel);
-                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), cellGroups, std::distance(cellGroups.begin(),currentCellGroup),
+                const long int idxGroup = std::distance(cellGroups.begin(), currentCellGroup);
+                auto& indexesForGroup = interactionLists.getM2LLists(idxLevel, idxGroup);
+                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), cellGroups, idxGroup,
                                                [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
                     const auto groupSrcPtr = &groupSrc;
                     auto groupTargetPtr = &groupTarget;
                     assert(&groupTarget == &*currentCellGroup);
-                    auto indexesVec = TbfUtils::CreateNew(indexes.toStdVector());
+                    const auto indexesView = indexes;
 
                     auto groupTargetGetLocalPtr = groupTarget.getLocalPtr();
                     const auto groupSrcGetMultipolePtr = groupSrc.getMultipolePtr();
@@ -150,16 +207,37 @@ protected:
                     const unsigned char* ptr_groupTargetGetLocalPtr = reinterpret_cast<const unsigned char*>(&groupTargetGetLocalPtr[0]);
 
                     auto* kernelsPtr = kernels.data();
-
-#pragma omp task depend(in:ptr_groupSrcGetMultipolePtr[0]) depend(commute:ptr_groupTargetGetLocalPtr[0]) default(shared) firstprivate(idxLevel, indexesVec, groupSrcPtr, groupTargetPtr)  priority(priorities.getM2LPriority(idxLevel))
+                    // The task is created in a lambda, "this" must not be used inside
+                    auto* kernelWrapperPtr = &kernelWrapper;
+                    auto* prioritiesPtr = &priorities;
+                    auto* tracerPtr = &tracer;
+                    const long int idxSrcGroup = static_cast<long int>(groupSrcPtr - cellGroups.data());
+
+                    TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                    commuteEmulator.readAccess(ptr_groupSrcGetMultipolePtr);
+                    commuteEmulator.commuteAccess(commuteLocks, ptr_groupTargetGetLocalPtr);
+
+                    const long int traceSubmitTime = tracer.now();
+                    TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, idxSrcGroup, idxGroup,
+                                                                      groupSrcPtr->getNbCells(), groupTargetPtr->getNbCells(),
+                                                                      static_cast<long int>(indexesView.size()), priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                      {TbfTaskGraph::Read(ptr_groupSrcGetMultipolePtr[0]), TbfTaskGraph::CommuteWrite(ptr_groupTargetGetLocalPtr[0])});
+
+#pragma omp task depend(in:ptr_groupSrcGetMultipolePtr[0]) depend(commute:ptr_groupTargetGetLocalPtr[0]) TBF_OMP_AFFINITY(ptr_groupTargetGetLocalPtr[0]) default(shared) firstprivate(idxLevel, idxGroup, idxSrcGroup, indexesView, groupSrcPtr, groupTargetPtr, kernelsPtr, kernelWrapperPtr, prioritiesPtr, tracerPtr, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getM2LPriority(idxLevel, idxGroup))
                     {
-                        kernelWrapper.M2LBetweenGroups(idxLevel, kernelsPtr[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, std::move(*indexesVec));
-                        delete indexesVec;
+                        commuteLocks.acquire();
+                        const auto traceGuard = tracerPtr->trace(TbfTaskTracer::OperationM2L, idxLevel, idxSrcGroup, idxGroup,
+                                                                 groupSrcPtr->getNbCells(), groupTargetPtr->getNbCells(), traceSubmitTime);
+                        const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                        prioritiesPtr->measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                            kernelWrapperPtr->M2LBetweenGroups(idxLevel, kernelsPtr[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, indexesView);
+                        });
+                        commuteLocks.release();
                     }
                 });
 
                 auto currentGroup = &(*currentCellGroup);
-                auto indexesForGroup_first = TbfUtils::CreateNew(std::move(indexesForGroup.first));
+                const auto indexesForGroup_first = &interactionsPool.store(std::move(indexesForGroup.first));
 
                 const auto currentGroupGetMultipolePtr = currentGroup->getMultipolePtr();
                 auto currentGroupGetLocalPtr = currentGroup->getLocalPtr();
@@ -169,10 +247,26 @@ protected:
 
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_currentGroupGetMultipolePtr[0]) depend(commute:ptr_currentGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, indexesForGroup_first, currentGroup)  priority(priorities.getM2LPriority(idxLevel))
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_currentGroupGetMultipolePtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_currentGroupGetLocalPtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                                  currentGroup->getNbCells(), currentGroup->getNbCells(),
+                                                                  static_cast<long int>(indexesForGroup_first->size()), priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                  {TbfTaskGraph::Read(ptr_currentGroupGetMultipolePtr[0]), TbfTaskGraph::CommuteWrite(ptr_currentGroupGetLocalPtr[0])});
+
+#pragma omp task depend(in:ptr_currentGroupGetMultipolePtr[0]) depend(commute:ptr_currentGroupGetLocalPtr[0]) TBF_OMP_AFFINITY(ptr_currentGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, idxGroup, indexesForGroup_first, currentGroup, kernelsPtr, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getM2LPriority(idxLevel, idxGroup))
                 {
-                    kernelWrapper.M2LInGroup(idxLevel, kernelsPtr[omp_get_thread_num()], *currentGroup, std::move(*indexesForGroup_first));
-                    delete indexesForGroup_first;
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                         currentGroup->getNbCells(), currentGroup->getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                        kernelWrapper.M2LInGroup(idxLevel, kernelsPtr[omp_get_thread_num()], *currentGroup, *indexesForGroup_first);
+                    });
+                    commuteLocks.release();
                 }
 
                 ++currentCellGroup;
@@ -180,6 +274,82 @@ protected:
         }
     }
 
+    template <class TreeClass>
+    void M2LWithPlan(TreeClass& inTree, const TbfInteractionPlan& inInteractionPlan){
+        const TbfInteractionPlan* interactionPlanPtr = &inInteractionPlan;
+
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
+            auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(cellGroups)) ; ++idxGroup){
+                auto currentGroup = &cellGroups[idxGroup];
+
+                auto currentGroupGetLocalPtr = currentGroup->getLocalPtr();
+                const unsigned char* ptr_currentGroupGetLocalPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetLocalPtr[0]);
+
+                auto* kernelsPtr = kernels.data();
+
+                const auto blocks = inInteractionPlan.getM2LBlocksBetweenGroups(idxLevel, idxGroup);
+                for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                    const auto block = blocks[idxBlock];
+                    const auto groupSrcPtr = &TbfUtils::make_const(cellGroups[block.idxSrcGroup]);
+
+                    const auto groupSrcGetMultipolePtr = groupSrcPtr->getMultipolePtr();
+                    const unsigned char* ptr_groupSrcGetMultipolePtr = reinterpret_cast<const unsigned char*>(&groupSrcGetMultipolePtr[0]);
+
+                    TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                    commuteEmulator.readAccess(ptr_groupSrcGetMultipolePtr);
+                    commuteEmulator.commuteAccess(commuteLocks, ptr_currentGroupGetLocalPtr);
+
+                    const long int traceSubmitTime = tracer.now();
+                    TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, block.idxSrcGroup, idxGroup,
+                                                                      groupSrcPtr->getNbCells(), currentGroup->getNbCells(),
+                                                                      block.nbInteractions, priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                      {TbfTaskGraph::Read(ptr_groupSrcGetMultipolePtr[0]), TbfTaskGraph::CommuteWrite(ptr_currentGroupGetLocalPtr[0])});
+
+#pragma omp task depend(in:ptr_groupSrcGetMultipolePtr[0]) depend(commute:ptr_currentGroupGetLocalPtr[0]) TBF_OMP_AFFINITY(ptr_currentGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, idxGroup, block, groupSrcPtr, currentGroup, interactionPlanPtr, kernelsPtr, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getM2LPriority(idxLevel, idxGroup))
+                    {
+                        commuteLocks.acquire();
+                        const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, block.idxSrcGroup, idxGroup,
+                                                             groupSrcPtr->getNbCells(), currentGroup->getNbCells(), traceSubmitTime);
+                        const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                        priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                            kernelWrapper.M2LFromPlan(idxLevel, kernelsPtr[omp_get_thread_num()], *currentGroup, *groupSrcPtr,
+                                                      interactionPlanPtr->getM2LInteractions(idxLevel, block));
+                        });
+                        commuteLocks.release();
+                    }
+                }
+
+                const auto currentGroupGetMultipolePtr = currentGroup->getMultipolePtr();
+                const unsigned char* ptr_currentGroupGetMultipolePtr = reinterpret_cast<const unsigned char*>(&currentGroupGetMultipolePtr[0]);
+
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_currentGroupGetMultipolePtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_currentGroupGetLocalPtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                                  currentGroup->getNbCells(), currentGroup->getNbCells(),
+                                                                  interactionPlanPtr->getM2LInteractionsInGroup(idxLevel, idxGroup).size(), priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                  {TbfTaskGraph::Read(ptr_currentGroupGetMultipolePtr[0]), TbfTaskGraph::CommuteWrite(ptr_currentGroupGetLocalPtr[0])});
+
+#pragma omp task depend(in:ptr_currentGroupGetMultipolePtr[0]) depend(commute:ptr_currentGroupGetLocalPtr[0]) TBF_OMP_AFFINITY(ptr_currentGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, idxGroup, currentGroup, interactionPlanPtr, kernelsPtr, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getM2LPriority(idxLevel, idxGroup))
+                {
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                         currentGroup->getNbCells(), currentGroup->getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                        kernelWrapper.M2LFromPlan(idxLevel, kernelsPtr[omp_get_thread_num()], *currentGroup, TbfUtils::make_const(*currentGroup),
+                                                  interactionPlanPtr->getM2LInteractionsInGroup(idxLevel, idxGroup));
+                    });
+                    commuteLocks.release();
+                }
+            }
+        }
+    }
+
     template <class TreeClass>
     void L2L(TreeClass& inTree){
         for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
@@ -205,11 +375,31 @@ protected:
                 const unsigned char* ptr_upperGroupGetLocalPtr = reinterpret_cast<const unsigned char*>(&upperGroupGetLocalPtr[0]);
                 const unsigned char* ptr_lowerGroupGetLocalPtr = reinterpret_cast<const unsigned char*>(&lowerGroupGetLocalPtr[0]);
 
+                const long int idxLowerGroup = std::distance(lowerCellGroup.begin(), currentLowerGroup);
+                const long int idxUpperGroup = std::distance(upperCellGroup.cbegin(), currentUpperGroup);
+
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_upperGroupGetLocalPtr[0]) depend(commute:ptr_lowerGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, upperGroup, lowerGroup)  priority(priorities.getL2LPriority(idxLevel))
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_upperGroupGetLocalPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_lowerGroupGetLocalPtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                                  upperGroup->getNbCells(), lowerGroup->getNbCells(),
+                                                                  0, priorities.getL2LPriority(idxLevel, idxLowerGroup),
+                                                                  {TbfTaskGraph::Read(ptr_upperGroupGetLocalPtr[0]), TbfTaskGraph::CommuteWrite(ptr_lowerGroupGetLocalPtr[0])});
+
+#pragma omp task depend(in:ptr_upperGroupGetLocalPtr[0]) depend(commute:ptr_lowerGroupGetLocalPtr[0]) TBF_OMP_AFFINITY(ptr_lowerGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, upperGroup, lowerGroup, idxLowerGroup, idxUpperGroup, kernelsPtr, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getL2LPriority(idxLevel, idxLowerGroup))
                 {
-                    kernelWrapper.L2L(idxLevel, kernelsPtr[omp_get_thread_num()], *upperGroup, *lowerGroup);
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                         upperGroup->getNbCells(), lowerGroup->getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageL2L, idxLevel, idxLowerGroup, [&](){
+                        kernelWrapper.L2L(idxLevel, kernelsPtr[omp_get_thread_num()], *upperGroup, *lowerGroup);
+                    });
+                    commuteLocks.release();
                 }
 
                 if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
@@ -255,11 +445,31 @@ protected:
                 const unsigned char* ptr_particleGroupObjGetDataPtr = reinterpret_cast<const unsigned char*>(&particleGroupObjGetDataPtr[0]);
                 const unsigned char* ptr_particleGroupObjGetRhsPtr = reinterpret_cast<const unsigned char*>(&particleGroupObjGetRhsPtr[0]);
 
+                const long int idxGroup = std::distance(particleGroups.begin(), currentParticleGroup);
+
                 auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_leafGroupObjGetLocalPtr[0],ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_particleGroupObjGetRhsPtr[0]) default(shared) firstprivate(leafGroupObj, particleGroupObj)  priority(priorities.getL2PPriority())
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_leafGroupObjGetLocalPtr);
+                commuteEmulator.readAccess(ptr_particleGroupObjGetDataPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_particleGroupObjGetRhsPtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  leafGroupObj->getNbCells(), particleGroupObj->getNbParticles(),
+                                                                  0, priorities.getL2PPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(ptr_leafGroupObjGetLocalPtr[0]), TbfTaskGraph::Read(ptr_particleGroupObjGetDataPtr[0]), TbfTaskGraph::CommuteWrite(ptr_particleGroupObjGetRhsPtr[0])});
+
+#pragma omp task depend(in:ptr_leafGroupObjGetLocalPtr[0],ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_particleGroupObjGetRhsPtr[0]) TBF_OMP_AFFINITY(ptr_particleGroupObjGetRhsPtr[0]) default(shared) firstprivate(leafGroupObj, particleGroupObj, idxGroup, kernelsPtr, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getL2PPriority(idxGroup))
                 {
-                    kernelWrapper.L2P(kernelsPtr[omp_get_thread_num()], *leafGroupObj, *particleGroupObj);
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         leafGroupObj->getNbCells(), particleGroupObj->getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageL2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.L2P(kernelsPtr[omp_get_thread_num()], *leafGroupObj, *particleGroupObj);
+                    });
+                    commuteLocks.release();
                 }
 
                 ++currentParticleGroup;
@@ -270,17 +480,16 @@ protected:
 
     template <class TreeClass>
     void P2P(TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
-
         auto& particleGroups = inTree.getParticleGroups();
 
         auto currentParticleGroup = particleGroups.begin();
         const auto endParticleGroup = particleGroups.end();
 
         while(currentParticleGroup != endParticleGroup){
+            const long int idxGroup = std::distance(particleGroups.begin(), currentParticleGroup);
 
-            auto indexesForGroup = spacialSystem.getNeighborListForBlock(*currentParticleGroup, configuration.getTreeHeight()-1, true);
-            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), particleGroups, std::distance(particleGroups.begin(), currentParticleGroup),
+            auto& indexesForGroup = interactionLists.getP2PLists(idxGroup);
+            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), particleGroups, idxGroup,
                                            [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
                 assert(&groupTarget == &*currentParticleGroup);
 
@@ -292,7 +501,7 @@ protected:
                 auto groupTargetGetRhsPtr = groupTarget.getRhsPtr();
                 auto groupTargetGetDataPtr = groupTarget.getDataPtr();
 
-                auto indexesVec = TbfUtils::CreateNew(indexes.toStdVector());
+                const auto indexesView = indexes;
 
                 const unsigned char* ptr_groupSrcGetDataPtr = reinterpret_cast<const unsigned char*>(&groupSrcGetDataPtr[0]);
                 const unsigned char* ptr_groupSrcGetRhsPtr = reinterpret_cast<const unsigned char*>(&groupSrcGetRhsPtr[0]);
@@ -300,11 +509,35 @@ protected:
                 const unsigned char* ptr_groupTargetGetRhsPtr = reinterpret_cast<const unsigned char*>(&groupTargetGetRhsPtr[0]);
 
                 auto* kernelsPtr = kernels.data();
-
-#pragma omp task depend(in:ptr_groupSrcGetDataPtr[0],ptr_groupTargetGetDataPtr[0]) depend(commute:ptr_groupSrcGetRhsPtr[0],ptr_groupTargetGetRhsPtr[0]) default(shared) firstprivate(indexesVec, groupSrcPtr, groupTargetPtr) priority(priorities.getP2PPriority())
+                // The task is created in a lambda, "this" must not be used inside
+                auto* kernelWrapperPtr = &kernelWrapper;
+                auto* prioritiesPtr = &priorities;
+                auto* tracerPtr = &tracer;
+                const long int idxLeafLevel = configuration.getTreeHeight()-1;
+                const long int idxSrcGroup = static_cast<long int>(groupSrcPtr - particleGroups.data());
+
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_groupSrcGetDataPtr);
+                commuteEmulator.readAccess(ptr_groupTargetGetDataPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_groupSrcGetRhsPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_groupTargetGetRhsPtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, idxLeafLevel, idxSrcGroup, idxGroup,
+                                                                  groupSrcPtr->getNbParticles(), groupTargetPtr->getNbParticles(),
+                                                                  static_cast<long int>(indexesView.size()), priorities.getP2PPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(ptr_groupSrcGetDataPtr[0]), TbfTaskGraph::Read(ptr_groupTargetGetDataPtr[0]), TbfTaskGraph::CommuteWrite(ptr_groupSrcGetRhsPtr[0]), TbfTaskGraph::CommuteWrite(ptr_groupTargetGetRhsPtr[0])});
+
+#pragma omp task depend(in:ptr_groupSrcGetDataPtr[0],ptr_groupTargetGetDataPtr[0]) depend(commute:ptr_groupSrcGetRhsPtr[0],ptr_groupTargetGetRhsPtr[0]) TBF_OMP_AFFINITY(ptr_groupTargetGetRhsPtr[0]) default(shared) firstprivate(idxGroup, idxSrcGroup, indexesView, groupSrcPtr, groupTargetPtr, kernelsPtr, kernelWrapperPtr, prioritiesPtr, tracerPtr, idxLeafLevel, commuteLocks, traceSubmitTime, graphNode) priority(priorities.getP2PPriority(idxGroup))
                 {
-                    kernelWrapper.P2PBetweenGroups(kernelsPtr[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, std::move(*indexesVec));
-                    delete indexesVec;
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracerPtr->trace(TbfTaskTracer::OperationP2P, idxLeafLevel, idxSrcGroup, idxGroup,
+                                                             groupSrcPtr->getNbParticles(), groupTargetPtr->getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    prioritiesPtr->measure(TbfCriticalPathPriorities::StageP2P, idxLeafLevel, idxGroup, [&](){
+                        kernelWrapperPtr->P2PBetweenGroups(kernelsPtr[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, indexesView);
+                    });
+                    commuteLocks.release();
                 }
             });
 
@@ -313,25 +546,144 @@ protected:
             const auto currentGroupGetDataPtr = currentGroup->getDataPtr();
             auto currentGroupGetRhsPtr = currentGroup->getRhsPtr();
 
-            auto indexesForGroup_first = TbfUtils::CreateNew(std::move(indexesForGroup.first));
+            const auto indexesForGroup_first = &interactionsPool.store(std::move(indexesForGroup.first));
 
             const unsigned char* ptr_currentGroupGetDataPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetDataPtr[0]);
             const unsigned char* ptr_currentGroupGetRhsPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetRhsPtr[0]);
 
             auto* kernelsPtr = kernels.data();
 
-#pragma omp task depend(in:ptr_currentGroupGetDataPtr[0]) depend(commute:ptr_currentGroupGetRhsPtr[0]) default(shared) firstprivate(currentGroup, indexesForGroup_first) priority(priorities.getP2PPriority())
-            {
-                kernelWrapper.P2PInGroup(kernelsPtr[omp_get_thread_num()], *currentGroup, std::move(*indexesForGroup_first));
-                delete indexesForGroup_first;
+            TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+            commuteEmulator.readAccess(ptr_currentGroupGetDataPtr);
+            commuteEmulator.commuteAccess(commuteLocks, ptr_currentGroupGetRhsPtr);
+
+            const long int traceSubmitTime = tracer.now();
+            TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                              currentGroup->getNbParticles(), currentGroup->getNbParticles(),
+                                                              static_cast<long int>(indexesForGroup_first->size()) + currentGroup->getNbLeaves(), priorities.getP2PPriority(idxGroup),
+                                                              {TbfTaskGraph::Read(ptr_currentGroupGetDataPtr[0]), TbfTaskGraph::CommuteWrite(ptr_currentGroupGetRhsPtr[0])});
 
-                kernelWrapper.P2PInner(kernelsPtr[omp_get_thread_num()], *currentGroup);
+#pragma omp task depend(in:ptr_currentGroupGetDataPtr[0]) depend(commute:ptr_currentGroupGetRhsPtr[0]) TBF_OMP_AFFINITY(ptr_currentGroupGetRhsPtr[0]) default(shared) firstprivate(idxGroup, currentGroup, indexesForGroup_first, kernelsPtr, commuteLocks, traceSubmitTime, graphNode) priority(priorities.getP2PPriority(idxGroup))
+            {
+                commuteLocks.acquire();
+                const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                     currentGroup->getNbParticles(), currentGroup->getNbParticles(), traceSubmitTime);
+                const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                    kernelWrapper.P2PInGroup(kernelsPtr[omp_get_thread_num()], *currentGroup, *indexesForGroup_first);
+
+                    kernelWrapper.P2PInner(kernelsPtr[omp_get_thread_num()], *currentGroup);
+                });
+                commuteLocks.release();
             }
 
             ++currentParticleGroup;
         }
     }
 
+    template <class TreeClass>
+    void P2PWithPlan(TreeClass& inTree, const TbfInteractionPlan& inInteractionPlan){
+        const TbfInteractionPlan* interactionPlanPtr = &inInteractionPlan;
+
+        auto& particleGroups = inTree.getParticleGroups();
+
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            auto currentGroup = &particleGroups[idxGroup];
+
+            const auto currentGroupGetDataPtr = currentGroup->getDataPtr();
+            auto currentGroupGetRhsPtr = currentGroup->getRhsPtr();
+
+            const unsigned char* ptr_currentGroupGetDataPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetDataPtr[0]);
+            const unsigned char* ptr_currentGroupGetRhsPtr = reinterpret_cast<const unsigned char*>(&currentGroupGetRhsPtr[0]);
+
+            auto* kernelsPtr = kernels.data();
+
+            const auto blocks = inInteractionPlan.getP2PBlocksBetweenGroups(idxGroup);
+            for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                const auto block = blocks[idxBlock];
+                auto groupSrcPtr = &particleGroups[block.idxSrcGroup];
+
+                auto groupSrcGetDataPtr = groupSrcPtr->getDataPtr();
+                auto groupSrcGetRhsPtr = groupSrcPtr->getRhsPtr();
+
+                const unsigned char* ptr_groupSrcGetDataPtr = reinterpret_cast<const unsigned char*>(&groupSrcGetDataPtr[0]);
+                const unsigned char* ptr_groupSrcGetRhsPtr = reinterpret_cast<const unsigned char*>(&groupSrcGetRhsPtr[0]);
+
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_groupSrcGetDataPtr);
+                commuteEmulator.readAccess(ptr_currentGroupGetDataPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_groupSrcGetRhsPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_currentGroupGetRhsPtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, block.idxSrcGroup, idxGroup,
+                                                                  groupSrcPtr->getNbParticles(), currentGroup->getNbParticles(),
+                                                                  block.nbInteractions, priorities.getP2PPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(ptr_groupSrcGetDataPtr[0]), TbfTaskGraph::Read(ptr_currentGroupGetDataPtr[0]), TbfTaskGraph::CommuteWrite(ptr_groupSrcGetRhsPtr[0]), TbfTaskGraph::CommuteWrite(ptr_currentGroupGetRhsPtr[0])});
+
+#pragma omp task depend(in:ptr_groupSrcGetDataPtr[0],ptr_currentGroupGetDataPtr[0]) depend(commute:ptr_groupSrcGetRhsPtr[0],ptr_currentGroupGetRhsPtr[0]) TBF_OMP_AFFINITY(ptr_currentGroupGetRhsPtr[0]) default(shared) firstprivate(idxGroup, block, groupSrcPtr, currentGroup, interactionPlanPtr, kernelsPtr, commuteLocks, traceSubmitTime, graphNode) priority(priorities.getP2PPriority(idxGroup))
+                {
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, block.idxSrcGroup, idxGroup,
+                                                         groupSrcPtr->getNbParticles(), currentGroup->getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.P2PFromPlan(kernelsPtr[omp_get_thread_num()], *currentGroup, *groupSrcPtr,
+                                                  interactionPlanPtr->getP2PInteractions(block));
+                    });
+                    commuteLocks.release();
+                }
+            }
+
+            TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+            commuteEmulator.readAccess(ptr_currentGroupGetDataPtr);
+            commuteEmulator.commuteAccess(commuteLocks, ptr_currentGroupGetRhsPtr);
+
+            const long int traceSubmitTime = tracer.now();
+            TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                              currentGroup->getNbParticles(), currentGroup->getNbParticles(),
+                                                              interactionPlanPtr->getP2PInteractionsInGroup(idxGroup).size() + currentGroup->getNbLeaves(), priorities.getP2PPriority(idxGroup),
+                                                              {TbfTaskGraph::Read(ptr_currentGroupGetDataPtr[0]), TbfTaskGraph::CommuteWrite(ptr_currentGroupGetRhsPtr[0])});
+
+#pragma omp task depend(in:ptr_currentGroupGetDataPtr[0]) depend(commute:ptr_currentGroupGetRhsPtr[0]) TBF_OMP_AFFINITY(ptr_currentGroupGetRhsPtr[0]) default(shared) firstprivate(idxGroup, currentGroup, interactionPlanPtr, kernelsPtr, commuteLocks, traceSubmitTime, graphNode) priority(priorities.getP2PPriority(idxGroup))
+            {
+                commuteLocks.acquire();
+                const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                     currentGroup->getNbParticles(), currentGroup->getNbParticles(), traceSubmitTime);
+                const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                    kernelWrapper.P2PFromPlan(kernelsPtr[omp_get_thread_num()], *currentGroup, *currentGroup,
+                                              interactionPlanPtr->getP2PInteractionsInGroup(idxGroup));
+
+                    kernelWrapper.P2PInner(kernelsPtr[omp_get_thread_num()], *currentGroup);
+                });
+                commuteLocks.release();
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void computeInteractionLists(TreeClass& inTree, const int inOperationToProceed){
+        // Called by the master thread, the lists are computed by tasks (the other threads can also
+        // execute the P2M/M2M tasks), and the taskgroup only waits for these tasks
+        interactionLists.compute(inTree, stopUpperLevel, inOperationToProceed & TbfAlgorithmUtils::TbfM2L, inOperationToProceed & TbfAlgorithmUtils::TbfP2P,
+                                 [](const long int inNbJobs, auto&& inFunc){
+            const long int nbChunks = TbfParallel::GetNbChunks(inNbJobs, 4*omp_get_num_threads());
+#pragma omp taskgroup
+{
+            for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+#pragma omp task default(shared) firstprivate(idxChunk)
+                {
+                    const auto interval = TbfParallel::GetChunkInterval(inNbJobs, nbChunks, idxChunk);
+                    for(long int idxJob = interval.first ; idxJob < interval.second ; ++idxJob){
+                        inFunc(idxJob);
+                    }
+                }
+            }
+}// taskgroup
+        });
+    }
+
     void increaseNumberOfKernels(){
         kernels.reserve(omp_get_max_threads());
         for(long int idxThread = kernels.size() ; idxThread < omp_get_max_threads() ; ++idxThread){
@@ -343,7 +695,7 @@ public:
     explicit TbfOpenmpAlgorithm(const SpacialConfiguration& inConfiguration, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), useInteractionPlan(false){
         kernels.emplace_back(configuration);
         increaseNumberOfKernels();
     }
@@ -354,17 +706,59 @@ public:
     TbfOpenmpAlgorithm(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), useInteractionPlan(false){
         kernels.emplace_back(std::forward<SourceKernelClass>(inKernel));
         increaseNumberOfKernels();
     }
 
+    // The interaction lists of the M2L/P2P are computed once and kept in the tree (see TbfTree::getInteractionPlan),
+    // the tasks then use the plan directly instead of a copy of their interactions
+    void setUseInteractionPlan(const bool inUseInteractionPlan){
+        useInteractionPlan = inUseInteractionPlan;
+    }
+
+    bool getUseInteractionPlan() const{
+        return useInteractionPlan;
+    }
+
+    // The priorities of the tasks are computed from the critical path of the task graph
+    // (see TbfCriticalPathPriorities), instead of the type of the operators and the level
+    void setUseCriticalPathPriorities(const bool inUseCriticalPathPriorities){
+        priorities.setEnabled(inUseCriticalPathPriorities);
+    }
+
+    bool getUseCriticalPathPriorities() const{
+        return priorities.getEnabled();
+    }
+
+    TbfCriticalPathPriorities& getCriticalPathPriorities(){
+        return priorities;
+    }
+
+    // The tasks are recorded when the tracer is enabled (see TbfTaskTracer)
+    TbfTaskTracer& getTaskTracer(){
+        return tracer;
+    }
+
+    // The task graph of the last execution is recorded when it is enabled (see TbfTaskGraph)
+    TbfTaskGraph& getTaskGraph(){
+        return taskGraph;
+    }
+
     template <class TreeClass>
     void execute(TreeClass& inTree, const int inOperationToProceed = TbfAlgorithmUtils::TbfOperations::TbfNearAndFarFields){
         assert(configuration == inTree.getSpacialConfiguration());
 
         increaseNumberOfKernels();
 
+        const TbfInteractionPlan* interactionPlan = (useInteractionPlan ? &inTree.getInteractionPlan() : nullptr);
+
+        priorities.update(inTree, stopUpperLevel, inOperationToProceed);
+
+        if(taskGraph.getEnabled()){
+            taskGraph.clear();
+        }
+
 #pragma omp parallel
 #pragma omp master
 {
@@ -375,20 +769,37 @@ public:
         if(inOperationToProceed & TbfAlgorithmUtils::TbfM2M){
             M2M(inTree);
         }
+        if(interactionPlan == nullptr && (inOperationToProceed & (TbfAlgorithmUtils::TbfM2L | TbfAlgorithmUtils::TbfP2P))){
+            computeInteractionLists(inTree, inOperationToProceed);
+        }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
-            M2L(inTree);
+            if(interactionPlan){
+                M2LWithPlan(inTree, *interactionPlan);
+            }
+            else{
+                M2L(inTree);
+            }
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfL2L){
             L2L(inTree);
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfP2P){
-            P2P(inTree);
+            if(interactionPlan){
+                P2PWithPlan(inTree, *interactionPlan);
+            }
+            else{
+                P2P(inTree);
+            }
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfL2P){
             L2P(inTree);
         }
 #pragma omp taskwait
 }// master
+
+        commuteEmulator.reset();
+
+        interactionsPool.reset();
     }    
 
     template <class FuncType>
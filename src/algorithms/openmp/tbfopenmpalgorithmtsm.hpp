@@ -6,6 +6,11 @@
 #include "../sequential/tbfgroupkernelinterface.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/tbftasktracer.hpp"
+#include "algorithms/tbftaskgraph.hpp"
+#include "core/tbfinteraction.hpp"
+#include "algorithms/openmp/tbfopenmpcommute.hpp"
+#include "algorithms/openmp/tbfopenmpaffinity.hpp"
 
 #include <omp.h>
 
@@ -13,14 +18,6 @@
 #include <cassert>
 #include <iterator>
 
-#if _OPENMP >= 201811
-#ifndef mutexinout
-#define commute mutexinout
-#endif
-#else
-#define commute inout
-#endif
-
 template <class RealType_T, class KernelClass_T, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
 class TbfOpenmpAlgorithmTsm {
 public:
@@ -40,6 +37,18 @@ protected:
 
     TbfAlgorithmUtils::TbfOperationsPriorities priorities;
 
+    // Records the tasks if enabled
+    TbfTaskTracer tracer;
+
+    // Records the task graph of the last execution if enabled
+    TbfTaskGraph taskGraph;
+
+    // The commutative accesses without OpenMP 5.0
+    TbfOpenmpCommuteEmulator commuteEmulator;
+
+    // The interaction lists used by the tasks (the tasks have a view on them)
+    TbfAlgorithmUtils::TbfTaskDataPool<std::vector<TbfXtoXInteraction<typename SpaceIndexType::IndexType>>> interactionsPool;
+
     template <class TreeClass>
     void P2M(TreeClass& inTree){
         if(configuration.getTreeHeight() > stopUpperLevel){
@@ -67,9 +76,26 @@ protected:
                 const unsigned char* ptr_particleGroupObjGetDataPtr = reinterpret_cast<const unsigned char*>(&particleGroupObjGetDataPtr[0]);
                 const unsigned char* ptr_leafGroupObjGetMultipolePtr = reinterpret_cast<const unsigned char*>(&leafGroupObjGetMultipolePtr[0]);
 
-#pragma omp task depend(in:ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_leafGroupObjGetMultipolePtr[0]) default(shared) firstprivate(particleGroupObj, leafGroupObj) priority(priorities.getP2MPriority())
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
+
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_particleGroupObjGetDataPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_leafGroupObjGetMultipolePtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  particleGroupObj->getNbParticles(), leafGroupObj->getNbCells(),
+                                                                  0, priorities.getP2MPriority(),
+                                                                  {TbfTaskGraph::Read(ptr_particleGroupObjGetDataPtr[0]), TbfTaskGraph::CommuteWrite(ptr_leafGroupObjGetMultipolePtr[0])});
+
+#pragma omp task depend(in:ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_leafGroupObjGetMultipolePtr[0]) TBF_OMP_AFFINITY(ptr_leafGroupObjGetMultipolePtr[0]) default(shared) firstprivate(particleGroupObj, leafGroupObj, idxGroup, commuteLocks, traceSubmitTime, graphNode) priority(priorities.getP2MPriority())
                 {
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         particleGroupObj->getNbParticles(), leafGroupObj->getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
                     kernelWrapper.P2M(kernels[omp_get_thread_num()], *particleGroupObj, *leafGroupObj);
+                    commuteLocks.release();
                 }
                 ++currentParticleGroup;
                 ++currentLeafGroup;
@@ -102,9 +128,27 @@ protected:
                 const unsigned char* ptr_lowerGroupGetMultipolePtr = reinterpret_cast<const unsigned char*>(&lowerGroupGetMultipolePtr[0]);
                 const unsigned char* ptr_upperGroupGetMultipolePtr = reinterpret_cast<const unsigned char*>(&upperGroupGetMultipolePtr[0]);
 
-#pragma omp task depend(in:ptr_lowerGroupGetMultipolePtr[0]) depend(commute:ptr_upperGroupGetMultipolePtr[0]) default(shared) firstprivate(upperGroup, lowerGroup)  priority(priorities.getM2MPriority(idxLevel))
+                const long int idxUpperGroup = std::distance(upperCellGroup.begin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.cbegin(), currentLowerGroup);
+
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_lowerGroupGetMultipolePtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_upperGroupGetMultipolePtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                                  lowerGroup->getNbCells(), upperGroup->getNbCells(),
+                                                                  0, priorities.getM2MPriority(idxLevel),
+                                                                  {TbfTaskGraph::Read(ptr_lowerGroupGetMultipolePtr[0]), TbfTaskGraph::CommuteWrite(ptr_upperGroupGetMultipolePtr[0])});
+
+#pragma omp task depend(in:ptr_lowerGroupGetMultipolePtr[0]) depend(commute:ptr_upperGroupGetMultipolePtr[0]) TBF_OMP_AFFINITY(ptr_upperGroupGetMultipolePtr[0]) default(shared) firstprivate(idxLevel, upperGroup, lowerGroup, idxUpperGroup, idxLowerGroup, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getM2MPriority(idxLevel))
                 {
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                         lowerGroup->getNbCells(), upperGroup->getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
                     kernelWrapper.M2M(idxLevel, kernels[omp_get_thread_num()], *lowerGroup, *upperGroup);
+                    commuteLocks.release();
                 }
 
                 if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
@@ -137,13 +181,13 @@ protected:
                 indexesForGroup.second.reserve(std::size(indexesForGroup.first) + std::size(indexesForGroup.first));
                 indexesForGroup.second.insert(indexesForGroup.second.end(), indexesForGroup.first.begin(), indexesForGroup.first.end());
 
-                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), cellGroupsSource,
+                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), cellGroupsSource,
                                                           std::distance(cellGroupsTarget.begin(),currentCellGroup), cellGroupsTarget,
                                                [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
                     const auto groupSrcPtr = &groupSrc;
                     auto groupTargetPtr = &groupTarget;
                     assert(&groupTarget == &*currentCellGroup);
-                    auto indexesVec = TbfUtils::CreateNew(indexes.toStdVector());
+                    const auto indexesView = indexes;
 
                     auto groupTargetGetLocalPtr = groupTarget.getLocalPtr();
                     const auto groupSrcGetMultipolePtr = groupSrc.getMultipolePtr();
@@ -151,10 +195,31 @@ protected:
                     const unsigned char* ptr_groupSrcGetMultipolePtr = reinterpret_cast<const unsigned char*>(&groupSrcGetMultipolePtr[0]);
                     const unsigned char* ptr_groupTargetGetLocalPtr = reinterpret_cast<const unsigned char*>(&groupTargetGetLocalPtr[0]);
 
-#pragma omp task depend(in:ptr_groupSrcGetMultipolePtr[0]) depend(commute:ptr_groupTargetGetLocalPtr[0]) default(shared) firstprivate(idxLevel, indexesVec, groupSrcPtr, groupTargetPtr)  priority(priorities.getM2LPriority(idxLevel))
+                    // The task is created in a lambda, "this" must not be used inside
+                    auto* kernelsPtr = kernels.data();
+                    auto* kernelWrapperPtr = &kernelWrapper;
+                    auto* tracerPtr = &tracer;
+                    const long int idxSrcGroup = static_cast<long int>(groupSrcPtr - cellGroupsSource.data());
+                    const long int idxTargetGroup = static_cast<long int>(groupTargetPtr - cellGroupsTarget.data());
+
+                    TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                    commuteEmulator.readAccess(ptr_groupSrcGetMultipolePtr);
+                    commuteEmulator.commuteAccess(commuteLocks, ptr_groupTargetGetLocalPtr);
+
+                    const long int traceSubmitTime = tracer.now();
+                    TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, idxSrcGroup, idxTargetGroup,
+                                                                      groupSrcPtr->getNbCells(), groupTargetPtr->getNbCells(),
+                                                                      static_cast<long int>(indexesView.size()), priorities.getM2LPriority(idxLevel),
+                                                                      {TbfTaskGraph::Read(ptr_groupSrcGetMultipolePtr[0]), TbfTaskGraph::CommuteWrite(ptr_groupTargetGetLocalPtr[0])});
+
+#pragma omp task depend(in:ptr_groupSrcGetMultipolePtr[0]) depend(commute:ptr_groupTargetGetLocalPtr[0]) TBF_OMP_AFFINITY(ptr_groupTargetGetLocalPtr[0]) default(shared) firstprivate(idxLevel, idxSrcGroup, idxTargetGroup, indexesView, groupSrcPtr, groupTargetPtr, kernelsPtr, kernelWrapperPtr, tracerPtr, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getM2LPriority(idxLevel))
                     {
-                        kernelWrapper.M2LBetweenGroups(idxLevel, kernels[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, std::move(*indexesVec));
-                        delete indexesVec;
+                        commuteLocks.acquire();
+                        const auto traceGuard = tracerPtr->trace(TbfTaskTracer::OperationM2L, idxLevel, idxSrcGroup, idxTargetGroup,
+                                                                 groupSrcPtr->getNbCells(), groupTargetPtr->getNbCells(), traceSubmitTime);
+                        const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                        kernelWrapperPtr->M2LBetweenGroups(idxLevel, kernelsPtr[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, indexesView);
+                        commuteLocks.release();
                     }
                 });
 
@@ -188,9 +253,27 @@ protected:
                 const unsigned char* ptr_upperGroupGetLocalPtr = reinterpret_cast<const unsigned char*>(&upperGroupGetLocalPtr[0]);
                 const unsigned char* ptr_lowerGroupGetLocalPtr = reinterpret_cast<const unsigned char*>(&lowerGroupGetLocalPtr[0]);
 
-#pragma omp task depend(in:ptr_upperGroupGetLocalPtr[0]) depend(commute:ptr_lowerGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, upperGroup, lowerGroup)  priority(priorities.getL2LPriority(idxLevel))
+                const long int idxUpperGroup = std::distance(upperCellGroup.cbegin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.begin(), currentLowerGroup);
+
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_upperGroupGetLocalPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_lowerGroupGetLocalPtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                                  upperGroup->getNbCells(), lowerGroup->getNbCells(),
+                                                                  0, priorities.getL2LPriority(idxLevel),
+                                                                  {TbfTaskGraph::Read(ptr_upperGroupGetLocalPtr[0]), TbfTaskGraph::CommuteWrite(ptr_lowerGroupGetLocalPtr[0])});
+
+#pragma omp task depend(in:ptr_upperGroupGetLocalPtr[0]) depend(commute:ptr_lowerGroupGetLocalPtr[0]) TBF_OMP_AFFINITY(ptr_lowerGroupGetLocalPtr[0]) default(shared) firstprivate(idxLevel, upperGroup, lowerGroup, idxUpperGroup, idxLowerGroup, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getL2LPriority(idxLevel))
                 {
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                         upperGroup->getNbCells(), lowerGroup->getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
                     kernelWrapper.L2L(idxLevel, kernels[omp_get_thread_num()], *upperGroup, *lowerGroup);
+                    commuteLocks.release();
                 }
 
                 if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
@@ -236,9 +319,27 @@ protected:
                 const unsigned char* ptr_particleGroupObjGetDataPtr = reinterpret_cast<const unsigned char*>(&particleGroupObjGetDataPtr[0]);
                 const unsigned char* ptr_particleGroupObjGetRhsPtr = reinterpret_cast<const unsigned char*>(&particleGroupObjGetRhsPtr[0]);
 
-#pragma omp task depend(in:ptr_leafGroupObjGetLocalPtr[0], ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_particleGroupObjGetRhsPtr[0]) default(shared) firstprivate(leafGroupObj, particleGroupObj)  priority(priorities.getL2PPriority())
+                const long int idxGroup = std::distance(particleGroups.begin(), currentParticleGroup);
+
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_leafGroupObjGetLocalPtr);
+                commuteEmulator.readAccess(ptr_particleGroupObjGetDataPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_particleGroupObjGetRhsPtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  leafGroupObj->getNbCells(), particleGroupObj->getNbParticles(),
+                                                                  0, priorities.getL2PPriority(),
+                                                                  {TbfTaskGraph::Read(ptr_leafGroupObjGetLocalPtr[0]), TbfTaskGraph::Read(ptr_particleGroupObjGetDataPtr[0]), TbfTaskGraph::CommuteWrite(ptr_particleGroupObjGetRhsPtr[0])});
+
+#pragma omp task depend(in:ptr_leafGroupObjGetLocalPtr[0], ptr_particleGroupObjGetDataPtr[0]) depend(commute:ptr_particleGroupObjGetRhsPtr[0]) TBF_OMP_AFFINITY(ptr_particleGroupObjGetRhsPtr[0]) default(shared) firstprivate(leafGroupObj, particleGroupObj, idxGroup, commuteLocks, traceSubmitTime, graphNode)  priority(priorities.getL2PPriority())
                 {
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         leafGroupObj->getNbCells(), particleGroupObj->getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
                     kernelWrapper.L2P(kernels[omp_get_thread_num()], *leafGroupObj, *particleGroupObj);
+                    commuteLocks.release();
                 }
 
                 ++currentParticleGroup;
@@ -266,7 +367,7 @@ protected:
             auto indexesForSelfGroup = spacialSystem.getSelfListForBlock(*currentParticleGroupTarget);
             indexesForGroup.second.insert(indexesForGroup.second.end(), indexesForSelfGroup.begin(), indexesForSelfGroup.end());
 
-            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), particleGroupsSource,
+            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), particleGroupsSource,
                                                       std::distance(particleGroupsTarget.begin(), currentParticleGroupTarget), particleGroupsTarget,
                                            [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
                 assert(&groupTarget == &*currentParticleGroupTarget);
@@ -278,16 +379,39 @@ protected:
                 auto groupTargetGetDataPtr = groupTarget.getDataPtr();
                 auto groupTargetGetRhsPtr = groupTarget.getRhsPtr();
 
-                auto indexesVec = TbfUtils::CreateNew(indexes.toStdVector());
+                const auto indexesView = indexes;
 
                 const unsigned char* ptr_groupSrcGetDataPtr = reinterpret_cast<const unsigned char*>(&groupSrcGetDataPtr[0]);
                 const unsigned char* ptr_groupTargetGetDataPtr = reinterpret_cast<const unsigned char*>(&groupTargetGetDataPtr[0]);
                 const unsigned char* ptr_groupTargetGetRhsPtr = reinterpret_cast<const unsigned char*>(&groupTargetGetRhsPtr[0]);
 
-#pragma omp task depend(in:ptr_groupSrcGetDataPtr[0],ptr_groupTargetGetDataPtr[0]) depend(commute:ptr_groupTargetGetRhsPtr[0]) default(shared) firstprivate(indexesVec, groupSrcPtr, groupTargetPtr) priority(priorities.getP2PPriority())
+                // The task is created in a lambda, "this" must not be used inside
+                auto* kernelsPtr = kernels.data();
+                auto* kernelWrapperPtr = &kernelWrapper;
+                auto* tracerPtr = &tracer;
+                const long int idxLeafLevel = configuration.getTreeHeight()-1;
+                const long int idxSrcGroup = static_cast<long int>(groupSrcPtr - particleGroupsSource.data());
+                const long int idxTargetGroup = static_cast<long int>(groupTargetPtr - particleGroupsTarget.data());
+
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.readAccess(ptr_groupSrcGetDataPtr);
+                commuteEmulator.readAccess(ptr_groupTargetGetDataPtr);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_groupTargetGetRhsPtr);
+
+                const long int traceSubmitTime = tracer.now();
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, idxLeafLevel, idxSrcGroup, idxTargetGroup,
+                                                                  groupSrcPtr->getNbParticles(), groupTargetPtr->getNbParticles(),
+                                                                  static_cast<long int>(indexesView.size()), priorities.getP2PPriority(),
+                                                                  {TbfTaskGraph::Read(ptr_groupSrcGetDataPtr[0]), TbfTaskGraph::Read(ptr_groupTargetGetDataPtr[0]), TbfTaskGraph::CommuteWrite(ptr_groupTargetGetRhsPtr[0])});
+
+#pragma omp task depend(in:ptr_groupSrcGetDataPtr[0],ptr_groupTargetGetDataPtr[0]) depend(commute:ptr_groupTargetGetRhsPtr[0]) TBF_OMP_AFFINITY(ptr_groupTargetGetRhsPtr[0]) default(shared) firstprivate(idxLeafLevel, idxSrcGroup, idxTargetGroup, indexesView, groupSrcPtr, groupTargetPtr, kernelsPtr, kernelWrapperPtr, tracerPtr, commuteLocks, traceSubmitTime, graphNode) priority(priorities.getP2PPriority())
                 {
-                    kernelWrapper.P2PBetweenGroupsTsm(kernels[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, std::move(*indexesVec));
-                    delete indexesVec;
+                    commuteLocks.acquire();
+                    const auto traceGuard = tracerPtr->trace(TbfTaskTracer::OperationP2P, idxLeafLevel, idxSrcGroup, idxTargetGroup,
+                                                             groupSrcPtr->getNbParticles(), groupTargetPtr->getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    kernelWrapperPtr->P2PBetweenGroupsTsm(kernelsPtr[omp_get_thread_num()], *groupTargetPtr, *groupSrcPtr, indexesView);
+                    commuteLocks.release();
                 }
             });
 
@@ -321,12 +445,26 @@ public:
         increaseNumberOfKernels();
     }
 
+    // The tasks are recorded when the tracer is enabled (see TbfTaskTracer)
+    TbfTaskTracer& getTaskTracer(){
+        return tracer;
+    }
+
+    // The task graph of the last execution is recorded when it is enabled (see TbfTaskGraph)
+    TbfTaskGraph& getTaskGraph(){
+        return taskGraph;
+    }
+
     template <class TreeClass>
     void execute(TreeClass& inTree, const int inOperationToProceed = TbfAlgorithmUtils::TbfOperations::TbfNearAndFarFields){
         assert(configuration == inTree.getSpacialConfiguration());
 
         increaseNumberOfKernels();
 
+        if(taskGraph.getEnabled()){
+            taskGraph.clear();
+        }
+
 #pragma omp parallel
 #pragma omp master
 {
@@ -351,6 +489,10 @@ public:
         }
 #pragma omp taskwait
 }// master
+
+        commuteEmulator.reset();
+
+        interactionsPool.reset();
     }
 
     template <class FuncType>
@@ -0,0 +1,162 @@
+#ifndef TBFOPENMPCOMMUTE_HPP
+#define TBFOPENMPCOMMUTE_HPP
+
+#include "tbfglobal.hpp"
+
+#include <omp.h>
+
+#include <array>
+#include <unordered_map>
+#include <cassert>
+
+// The commutative writes need mutexinoutset (OpenMP 5.0).
+// Before, a "commute" access is declared as "in" such that the tasks are not ordered,
+// and TbfOpenmpCommuteEmulator provides the mutual exclusion (one lock per data) and
+// the ordering with the other accesses (an empty "inout" task between the phases).
+// The emulation can also be forced with TBF_OMP_EMULATE_COMMUTE.
+#if _OPENMP >= 201811 && !defined(TBF_OMP_EMULATE_COMMUTE)
+#define TBF_OMP_HAS_COMMUTE
+#define commute mutexinoutset
+#else
+#define commute in
+#endif
+
+class TbfOpenmpCommuteEmulator {
+public:
+#ifdef TBF_OMP_HAS_COMMUTE
+    static constexpr bool IsEnabled = false;
+#else
+    static constexpr bool IsEnabled = true;
+#endif
+
+    static constexpr long int MaxLocksPerTask = 4;
+
+    // The locks of a task (copied in the task)
+    class LockSet {
+        std::array<omp_lock_t*, MaxLocksPerTask> locks;
+        long int nbLocks;
+
+    public:
+        LockSet() : locks{}, nbLocks(0){}
+
+        void add(omp_lock_t* inLock){
+            assert(nbLocks < MaxLocksPerTask);
+            locks[nbLocks] = inLock;
+            nbLocks += 1;
+        }
+
+        // All the locks or none are taken, such that a task that waits does not block the others
+        void acquire(){
+            if constexpr(IsEnabled){
+                while(true){
+                    long int nbAcquired = 0;
+                    while(nbAcquired < nbLocks && omp_test_lock(locks[nbAcquired])){
+                        nbAcquired += 1;
+                    }
+                    if(nbAcquired == nbLocks){
+                        break;
+                    }
+                    while(nbAcquired != 0){
+                        nbAcquired -= 1;
+                        omp_unset_lock(locks[nbAcquired]);
+                    }
+#pragma omp taskyield
+                }
+            }
+        }
+
+        void release(){
+            if constexpr(IsEnabled){
+                for(long int idxLock = nbLocks-1 ; idxLock >= 0 ; --idxLock){
+                    omp_unset_lock(locks[idxLock]);
+                }
+            }
+        }
+    };
+
+private:
+    enum class AccessMode {
+        Read,
+        CommuteWrite
+    };
+
+    struct DataState {
+        omp_lock_t lock;
+        AccessMode lastMode;
+        bool isUsed;
+
+        DataState() : lastMode(AccessMode::Read), isUsed(false){
+            omp_init_lock(&lock);
+        }
+
+        ~DataState(){
+            omp_destroy_lock(&lock);
+        }
+
+        DataState(const DataState&) = delete;
+        DataState& operator=(const DataState&) = delete;
+    };
+
+    // Used by the thread that creates the tasks only
+    std::unordered_map<const void*, DataState> states;
+    long int nbUsedStates;
+
+    DataState& access(const unsigned char* inData, const AccessMode inMode){
+        DataState& state = states[inData];
+        if(state.isUsed == false){
+            state.isUsed = true;
+            state.lastMode = inMode;
+            nbUsedStates += 1;
+        }
+        else if(state.lastMode != inMode){
+            // Wait for all the tasks of the previous phase (they all have an "in" dependency on the data)
+#pragma omp task depend(inout:inData[0]) default(none) firstprivate(inData)
+            {}
+            state.lastMode = inMode;
+        }
+        return state;
+    }
+
+public:
+    TbfOpenmpCommuteEmulator() : nbUsedStates(0){}
+
+    TbfOpenmpCommuteEmulator(const TbfOpenmpCommuteEmulator&) = delete;
+    TbfOpenmpCommuteEmulator& operator=(const TbfOpenmpCommuteEmulator&) = delete;
+
+    // Must be called before creating a task that reads inData
+    void readAccess(const unsigned char* inData){
+        if constexpr(IsEnabled){
+            access(inData, AccessMode::Read);
+        }
+    }
+
+    // Must be called before creating a task that has a commute access on inData
+    void commuteAccess(LockSet& inLocks, const unsigned char* inData){
+        if constexpr(IsEnabled){
+            inLocks.add(&access(inData, AccessMode::CommuteWrite).lock);
+        }
+    }
+
+    // Must be called after the taskwait
+    void reset(){
+        if constexpr(IsEnabled){
+            // The data of the previous trees are removed (if the tree has been rebuilt)
+            if(static_cast<long int>(states.size()) > 2*nbUsedStates){
+                for(auto iter = states.begin() ; iter != states.end() ;){
+                    if(iter->second.isUsed == false){
+                        iter = states.erase(iter);
+                    }
+                    else{
+                        ++iter;
+                    }
+                }
+            }
+            for(auto& state : states){
+                state.second.isUsed = false;
+            }
+            nbUsedStates = 0;
+        }
+    }
+};
+
+#endif
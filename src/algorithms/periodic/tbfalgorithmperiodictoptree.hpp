@@ -5,9 +5,21 @@
 
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/periodic/tbfperiodicfarfieldoperator.hpp"
+#include "algorithms/periodic/tbfperiodictoptreeutils.hpp"
+#include "utils/tbfparallel.hpp"
 
 #include <cassert>
 #include <iterator>
+#include <vector>
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <typeinfo>
 
 template <class RealType_T, class KernelClass_T, class CellMultipoleType_t,
           class CellLocalType_t, class SpaceIndexType_T = TbfDefaultSpaceIndexTypePeriodic<RealType_T>>
@@ -23,6 +35,12 @@ public:
 
     static constexpr long int Dim = SpaceIndexType::Dim;
 
+    // Adds the second local to the first one
+    using LocalReducerType = std::function<void(CellLocalType&, const CellLocalType&)>;
+
+    using FarFieldValueType = TbfPeriodicFarFieldUtils::ValueType<CellMultipoleType, RealType>;
+    using FarFieldOperatorType = TbfPeriodicFarFieldOperator<FarFieldValueType>;
+
 protected:
     const SpacialConfiguration originalConfiguration;
     const SpacialConfiguration configuration;
@@ -31,17 +49,22 @@ protected:
 
     const long int nbLevelsAbove0;
 
-    KernelClass kernel;
+    std::vector<KernelClass> kernels;
+    LocalReducerType localReducer;
 
     std::vector<CellMultipoleType> multipoles;
     std::vector<CellLocalType> locals;
 
+    // If set, replaces the M2M/M2L/L2L above the root of the real tree
+    std::unique_ptr<const FarFieldOperatorType> farFieldOperator;
+
+    // The M2M from the level 1 of the real tree to the top tree
     template <class TreeClass>
-    void M2M(TreeClass& inTree){
+    void M2MFromTree(TreeClass& inTree){
         {
             assert(inTree.getHeight() > 1);
             std::vector<std::reference_wrapper<const CellMultipoleType>> children;
-            long int positionsOfChildren[spaceSystem.getNbChildrenPerCell()];
+            std::array<long int, SpaceIndexType::getNbChildrenPerCell()> positionsOfChildren;
             long int nbChildren = 0;
 
             const long int idxLevelBase = 0;
@@ -70,14 +93,17 @@ protected:
             assert(std::size(inTree.getCellGroupsAtLevel(idxLevelBase)));
             assert(std::size(inTree.getCellGroupsAtLevel(0)));
 
-            kernel.M2M(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
+            kernels[0].M2M(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
                          configuration.getTreeHeight()-2, TbfUtils::make_const(children), multipoles[configuration.getTreeHeight()-2],
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
         }
+    }
 
+    template <class TreeClass>
+    void M2M(TreeClass& inTree){
         for(long int idxLevel = configuration.getTreeHeight()-3 ; idxLevel >= 3 ; --idxLevel){
             std::vector<std::reference_wrapper<const CellMultipoleType>> children;
-            long int positionsOfChildren[spaceSystem.getNbChildrenPerCell()];
+            std::array<long int, SpaceIndexType::getNbChildrenPerCell()> positionsOfChildren;
             long int nbChildren = 0;
 
             for(long int idxCell = 0 ; idxCell < spaceSystem.getNbChildrenPerCell() ; ++idxCell){
@@ -88,147 +114,42 @@ protected:
             }
 
             assert(std::size(inTree.getCellGroupsAtLevel(0)));
-            kernel.M2M(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
+            kernels[0].M2M(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
                          idxLevel, TbfUtils::make_const(children), multipoles[idxLevel],
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
         }
     }
 
     template <class TreeClass>
     void M2L(TreeClass& inTree){
-        if(nbLevelsAbove0 == 0){
-            const long int idxLevel = configuration.getTreeHeight()-2;
-            assert(idxLevel == 3);
-            std::vector<std::reference_wrapper<const CellMultipoleType>> neighbors;
-            static_assert (Dim != 3 || 316 == (TbfUtils::lipow(7, Dim) - TbfUtils::lipow(3, Dim)), "Simple check");
-            long int positionsOfNeighbors[TbfUtils::lipow(7, Dim) - TbfUtils::lipow(3, Dim)];
-            long int nbNeighbors = 0;
-
-            std::array<long int, Dim> minLimits = TbfUtils::make_array<long int, Dim>(-3);
-            std::array<long int, Dim> maxLimits = TbfUtils::make_array<long int, Dim>(3);
-            std::array<long int, Dim> currentCellTest = minLimits;
-
-            while(true){
-                {
-                    long int currentIdx = Dim-1;
-
-                    while(currentIdx >= 0 && currentCellTest[currentIdx] > maxLimits[currentIdx]){
-                        currentCellTest[currentIdx] = minLimits[currentIdx];
-                        currentIdx -= 1;
-                        if(currentIdx >= 0){
-                            currentCellTest[currentIdx] += 1;
-                        }
-                    }
-                    if(currentIdx < 0){
-                        break;
-                    }
-                }
-
-                bool isTooClose = true;
-                for(int idxDim = 0 ; isTooClose && idxDim < Dim ; ++idxDim){
-                    if(std::abs(currentCellTest[idxDim]) > 1){
-                        isTooClose = false;
-                    }
-                }
-                if(isTooClose == false){
-                    auto childPos = currentCellTest;
-                    const IndexType childIndex = spaceSystem.getInteractionIndexFromRelativePos(childPos);
-
-                    assert(nbNeighbors < TbfUtils::lipow(7, Dim) - TbfUtils::lipow(3, Dim));
-                    neighbors.emplace_back(multipoles[idxLevel]);
-                    positionsOfNeighbors[nbNeighbors] = (childIndex);
-                    nbNeighbors += 1;
-                }
-
-                currentCellTest[Dim-1] += 1;
-            }
-
-
-            assert(std::size(inTree.getCellGroupsAtLevel(0)));
-
-            kernel.M2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
-                         idxLevel, TbfUtils::make_const(neighbors), positionsOfNeighbors, nbNeighbors, locals[idxLevel]);
-        }
-        else{
-            for(long int idxLevel = 3 ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
-                std::vector<std::reference_wrapper<const CellMultipoleType>> neighbors;
-                long int positionsOfNeighbors[spaceSystem.getNbInteractionsPerCell()];
-                long int nbNeighbors = 0;
-
-                std::array<long int, Dim> minLimits;
-                std::array<long int, Dim> maxLimits;
-                // First -3/2
-                if(idxLevel == 3){
-                    minLimits.fill(-3);
-                    maxLimits.fill(2);
-                }
-                // Then -2/3
-                else{
-                    minLimits.fill(-2);
-                    maxLimits.fill(3);
-                }
-                std::array<long int, Dim> currentCellTest = minLimits;
-
-                while(true){
-                    {
-                        long int currentIdx = Dim-1;
-
-                        while(currentIdx >= 0 && currentCellTest[currentIdx] > maxLimits[currentIdx]){
-                            currentCellTest[currentIdx] = minLimits[currentIdx];
-                            currentIdx -= 1;
-                            if(currentIdx >= 0){
-                                currentCellTest[currentIdx] += 1;
-                            }
-                        }
-                        if(currentIdx < 0){
-                            break;
-                        }
-                    }
-
-                    bool isTooClose = true;
-                    for(int idxDim = 0 ; isTooClose && idxDim < Dim ; ++idxDim){
-                        if(std::abs(currentCellTest[idxDim]) > 1){
-                            isTooClose = false;
-                        }
-                    }
-                    if(isTooClose == false){
-                        auto childPos = currentCellTest;
-                        const IndexType childIndex = spaceSystem.getInteractionIndexFromRelativePos(childPos);
-
-                        assert(nbNeighbors < spaceSystem.getNbInteractionsPerCell());
-                        neighbors.emplace_back(multipoles[idxLevel]);
-                        positionsOfNeighbors[nbNeighbors] = (childIndex);
-                        nbNeighbors += 1;
-                    }
-
-                    currentCellTest[Dim-1] += 1;
-                }
-
-                assert(std::size(inTree.getCellGroupsAtLevel(0)));
-                kernel.M2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
-                             idxLevel, TbfUtils::make_const(neighbors), positionsOfNeighbors, nbNeighbors, locals[idxLevel]);
-            }
-        }
+        assert(std::size(inTree.getCellGroupsAtLevel(0)));
+        TbfPeriodicTopTreeUtils::M2L(kernels, localReducer, inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
+                                     spaceSystem, nbLevelsAbove0, configuration.getTreeHeight(), multipoles, locals);
     }
 
     template <class TreeClass>
-    void L2L(TreeClass& inTree){        
+    void L2L(TreeClass& inTree){
         for(long int idxLevel = 3 ; idxLevel <= configuration.getTreeHeight()-3 ; ++idxLevel){
             std::vector<std::reference_wrapper<CellLocalType>> children;
-            long int positionsOfChildren[spaceSystem.getNbChildrenPerCell()];
+            std::array<long int, SpaceIndexType::getNbChildrenPerCell()> positionsOfChildren;
 
             children.emplace_back(locals[idxLevel+1]);
             positionsOfChildren[0] = (0);
             long int nbChildren = 1;
 
-            kernel.L2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
+            kernels[0].L2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
                          idxLevel, TbfUtils::make_const(locals[idxLevel]), children,
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
         }
+    }
+
+    // The L2L from the top tree to the level 1 of the real tree
+    template <class TreeClass>
+    void L2LToTree(TreeClass& inTree){
         {
             assert(inTree.getHeight() > 1);
             std::vector<std::reference_wrapper<CellLocalType>> children;
-            long int positionsOfChildren[spaceSystem.getNbChildrenPerCell()];
+            std::array<long int, SpaceIndexType::getNbChildrenPerCell()> positionsOfChildren;
             long int nbChildren = 0;
 
             const long int idxLevelBase = 0;
@@ -255,12 +176,33 @@ protected:
 
             assert(std::size(inTree.getCellGroupsAtLevel(idxLevelBase)));
 
-            kernel.L2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
+            kernels[0].L2L(inTree.getCellGroupsAtLevel(0).front().getCellSymbData(0),
                          configuration.getTreeHeight()-2, TbfUtils::make_const(locals[configuration.getTreeHeight()-2]), children,
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
+        }
+    }
+
+
+    // From the multipole to the local of the root of the real tree
+    template <class TreeClass>
+    void proceedTopLevels(TreeClass& inTree){
+        if(farFieldOperator){
+            farFieldOperator->apply(multipoles[configuration.getTreeHeight()-2], locals[configuration.getTreeHeight()-2]);
+        }
+        else{
+            M2M(inTree);
+            M2L(inTree);
+            L2L(inTree);
         }
     }
 
+    void increaseNumberOfKernels(){
+        const long int nbThreads = TbfParallel::GetNbThreads();
+        kernels.reserve(nbThreads);
+        for(long int idxThread = kernels.size() ; idxThread < nbThreads ; ++idxThread){
+            kernels.emplace_back(kernels[0]);
+        }
+    }
 
     ////////////////////////////////////////////////////////////////////////////////////
 
@@ -363,7 +305,10 @@ public:
 
     explicit TbfAlgorithmPeriodicTopTree(const SpacialConfiguration& inConfiguration, const long int inNbLevelsAbove0)
         : originalConfiguration(inConfiguration), configuration(GenerateAboveTreeConfiguration(inConfiguration, inNbLevelsAbove0)),
-          originalSpaceSystem(originalConfiguration), spaceSystem(configuration), nbLevelsAbove0(inNbLevelsAbove0), kernel(configuration){
+          originalSpaceSystem(originalConfiguration), spaceSystem(configuration), nbLevelsAbove0(inNbLevelsAbove0),
+          localReducer(TbfPeriodicTopTreeUtils::GetDefaultLocalReducer<LocalReducerType, CellLocalType>()){
+        kernels.emplace_back(configuration);
+        increaseNumberOfKernels();
 
         multipoles.resize(configuration.getTreeHeight());
         locals.resize(configuration.getTreeHeight());
@@ -374,7 +319,10 @@ public:
                                                  && !std::is_same<int, typename std::remove_const<typename std::remove_reference<SourceKernelClass>::type>::type>::value, void>::type>
     TbfAlgorithmPeriodicTopTree(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inNbLevelsAbove0)
         : originalConfiguration(inConfiguration), configuration(GenerateAboveTreeConfiguration(inConfiguration, inNbLevelsAbove0)),
-          originalSpaceSystem(originalConfiguration), spaceSystem(configuration), nbLevelsAbove0(inNbLevelsAbove0), kernel(std::forward<SourceKernelClass>(inKernel)){
+          originalSpaceSystem(originalConfiguration), spaceSystem(configuration), nbLevelsAbove0(inNbLevelsAbove0),
+          localReducer(TbfPeriodicTopTreeUtils::GetDefaultLocalReducer<LocalReducerType, CellLocalType>()){
+        kernels.emplace_back(std::forward<SourceKernelClass>(inKernel));
+        increaseNumberOfKernels();
 
         multipoles.resize(configuration.getTreeHeight());
         locals.resize(configuration.getTreeHeight());
@@ -390,19 +338,150 @@ public:
         assert(originalConfiguration == inTree.getSpacialConfiguration());
 
         if(inOperationToProceed & TbfAlgorithmUtils::TbfM2M){
-            M2M(inTree);
+            M2MFromTree(inTree);
+            if(!farFieldOperator){
+                M2M(inTree);
+            }
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
-            M2L(inTree);
+            if(farFieldOperator){
+                farFieldOperator->apply(multipoles[configuration.getTreeHeight()-2], locals[configuration.getTreeHeight()-2]);
+            }
+            else{
+                M2L(inTree);
+            }
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfL2L){
-            L2L(inTree);
+            if(!farFieldOperator){
+                L2L(inTree);
+            }
+            L2LToTree(inTree);
+        }
+    }
+
+    // Proceeds the top tree in a separate thread while the current thread calls inFunc,
+    // which is typically the TbfTransferStages of the main algorithm.
+    // inFunc must not modify the multipoles of the level 1 of the tree,
+    // the L2L to the level 1 is done after inFunc has returned.
+    template <class TreeClass, class FuncType>
+    void executeConcurrently(TreeClass& inTree, FuncType&& inFunc){
+        if(nbLevelsAbove0 < 0 || inTree.getHeight() == 0){
+            inFunc();
+            return;
         }
+
+        assert(originalConfiguration == inTree.getSpacialConfiguration());
+
+        TbfParallel::RunConcurrently([this, &inTree](){
+            M2MFromTree(inTree);
+            proceedTopLevels(inTree);
+        }, std::forward<FuncType>(inFunc));
+
+        L2LToTree(inTree);
+    }
+
+    // Without a reducer, the M2L of a level is not cut and only the levels
+    // are proceeded in parallel
+    void setLocalReducer(LocalReducerType inLocalReducer){
+        localReducer = std::move(inLocalReducer);
+    }
+
+    const LocalReducerType& getLocalReducer() const{
+        return localReducer;
+    }
+
+    // Identifies the kernel type, the cell types, the box and the number of levels,
+    // the parameters of the kernel that are not part of its type are not included
+    std::string getFarFieldOperatorKey() const{
+        std::ostringstream key;
+        key << std::setprecision(std::numeric_limits<RealType>::max_digits10);
+        key << typeid(KernelClass).name() << " " << sizeof(CellMultipoleType) << " " << sizeof(CellLocalType);
+        key << " " << Dim << " " << nbLevelsAbove0;
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            key << " " << originalConfiguration.getBoxWidths()[idxDim] << " " << originalConfiguration.getBoxCenter()[idxDim];
+        }
+        return key.str();
+    }
+
+    // Computes the operator by applying the M2M/M2L/L2L above the root
+    // to each unit multipole (the tree is only used for its symbolic data)
+    template <class TreeClass>
+    void computeFarFieldOperator(TreeClass& inTree){
+        static_assert(FarFieldOperatorType::template IsCompatible<CellMultipoleType>()
+                      && FarFieldOperatorType::template IsCompatible<CellLocalType>(),
+                      "The multipole and the local must be composed of FarFieldValueType");
+        assert(nbLevelsAbove0 >= 0 && inTree.getHeight() > 1);
+
+        const long int rootLevel = configuration.getTreeHeight()-2;
+        const long int nbInputs = FarFieldOperatorType::template GetNbValues<CellMultipoleType>();
+        const long int nbOutputs = FarFieldOperatorType::template GetNbValues<CellLocalType>();
+
+        std::unique_ptr<FarFieldOperatorType> newOperator(new FarFieldOperatorType(nbOutputs, nbInputs, getFarFieldOperatorKey()));
+        farFieldOperator.reset();
+
+        std::vector<CellMultipoleType> savedMultipoles(configuration.getTreeHeight());
+        std::vector<CellLocalType> savedLocals(configuration.getTreeHeight());
+        std::swap(savedMultipoles, multipoles);
+        std::swap(savedLocals, locals);
+
+        std::vector<FarFieldValueType> unitValues(nbInputs);
+        for(long int idxInput = 0 ; idxInput < nbInputs ; ++idxInput){
+            multipoles.assign(configuration.getTreeHeight(), CellMultipoleType());
+            locals.assign(configuration.getTreeHeight(), CellLocalType());
+
+            unitValues[idxInput] = FarFieldValueType(1);
+            FarFieldOperatorType::FromValues(unitValues, multipoles[rootLevel]);
+            unitValues[idxInput] = FarFieldValueType();
+
+            proceedTopLevels(inTree);
+
+            newOperator->setColumn(idxInput, FarFieldOperatorType::ToValues(locals[rootLevel]));
+        }
+
+        std::swap(savedMultipoles, multipoles);
+        std::swap(savedLocals, locals);
+        farFieldOperator = std::move(newOperator);
+    }
+
+    bool saveFarFieldOperator(const std::string& inFilename) const{
+        return farFieldOperator && farFieldOperator->save(inFilename);
+    }
+
+    // Returns false if the file does not exist or does not match getFarFieldOperatorKey()
+    bool loadFarFieldOperator(const std::string& inFilename){
+        std::unique_ptr<FarFieldOperatorType> loadedOperator = FarFieldOperatorType::Load(inFilename, getFarFieldOperatorKey());
+        if(!loadedOperator
+                || loadedOperator->getNbInputs() != FarFieldOperatorType::template GetNbValues<CellMultipoleType>()
+                || loadedOperator->getNbOutputs() != FarFieldOperatorType::template GetNbValues<CellLocalType>()){
+            return false;
+        }
+        farFieldOperator = std::move(loadedOperator);
+        return true;
+    }
+
+    // Loads the operator from the cache file, or computes it and saves it in the file
+    template <class TreeClass>
+    bool loadOrComputeFarFieldOperator(TreeClass& inTree, const std::string& inFilename){
+        if(loadFarFieldOperator(inFilename)){
+            return true;
+        }
+        computeFarFieldOperator(inTree);
+        return saveFarFieldOperator(inFilename);
+    }
+
+    bool hasFarFieldOperator() const{
+        return static_cast<bool>(farFieldOperator);
+    }
+
+    void clearFarFieldOperator(){
+        farFieldOperator.reset();
     }
 
     template <class FuncType>
     auto applyToAllKernels(FuncType&& inFunc) const {
-        inFunc(kernel);
+        for(const auto& kernel : kernels){
+            inFunc(kernel);
+        }
     }
 
     ////////////////////////////////////////////////////////////////////////
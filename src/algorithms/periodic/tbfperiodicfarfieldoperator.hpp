@@ -0,0 +1,200 @@
+#ifndef TBFPERIODICFARFIELDOPERATOR_HPP
+#define TBFPERIODICFARFIELDOPERATOR_HPP
+
+#include "tbfglobal.hpp"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <complex>
+#include <cstring>
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+// The effect of all the periodic images on the local of the root cell
+// is a linear function of the multipole of the root cell.
+// This class stores this function as a dense matrix of values, where the
+// multipole and the local are seen as arrays of ValueType.
+template <class ValueType_T>
+class TbfPeriodicFarFieldOperator {
+public:
+    using ValueType = ValueType_T;
+
+private:
+    struct FileHeader{
+        char magic[8];
+        long int version;
+        long int sizeOfValue;
+        long int nbInputs;
+        long int nbOutputs;
+        long int keyLength;
+    };
+
+    static constexpr char FileMagic[8] = "TBFFARF";
+    static constexpr long int FileVersion = 1;
+
+    long int nbInputs;
+    long int nbOutputs;
+    // The operator is stored by column (one column per input value)
+    std::vector<ValueType> values;
+    // Identifies the kernel/box/levels used to compute the operator
+    std::string key;
+
+public:
+    // A multipole/local can be used if it is composed of values only
+    template <class CellType>
+    static constexpr bool IsCompatible(){
+        return std::is_trivially_copyable<CellType>::value && sizeof(CellType) % sizeof(ValueType) == 0;
+    }
+
+    template <class CellType>
+    static constexpr long int GetNbValues(){
+        return static_cast<long int>(sizeof(CellType)/sizeof(ValueType));
+    }
+
+    template <class CellType>
+    static std::vector<ValueType> ToValues(const CellType& inCell){
+        static_assert(IsCompatible<CellType>(), "The cell must be composed of ValueType");
+        std::vector<ValueType> cellValues(GetNbValues<CellType>());
+        memcpy(cellValues.data(), &inCell, sizeof(CellType));
+        return cellValues;
+    }
+
+    template <class CellType>
+    static void FromValues(const std::vector<ValueType>& inValues, CellType& outCell){
+        static_assert(IsCompatible<CellType>(), "The cell must be composed of ValueType");
+        assert(static_cast<long int>(inValues.size()) == GetNbValues<CellType>());
+        memcpy(static_cast<void*>(&outCell), inValues.data(), sizeof(CellType));
+    }
+
+    TbfPeriodicFarFieldOperator(const long int inNbOutputs, const long int inNbInputs, std::string inKey)
+        : nbInputs(inNbInputs), nbOutputs(inNbOutputs), values(inNbInputs*inNbOutputs), key(std::move(inKey)){
+        assert(nbInputs >= 0 && nbOutputs >= 0);
+    }
+
+    long int getNbInputs() const{
+        return nbInputs;
+    }
+
+    long int getNbOutputs() const{
+        return nbOutputs;
+    }
+
+    const std::string& getKey() const{
+        return key;
+    }
+
+    const ValueType& getValue(const long int inIdxOutput, const long int inIdxInput) const{
+        assert(0 <= inIdxOutput && inIdxOutput < nbOutputs);
+        assert(0 <= inIdxInput && inIdxInput < nbInputs);
+        return values[inIdxInput*nbOutputs + inIdxOutput];
+    }
+
+    void setColumn(const long int inIdxInput, const std::vector<ValueType>& inColumn){
+        assert(0 <= inIdxInput && inIdxInput < nbInputs);
+        assert(static_cast<long int>(inColumn.size()) == nbOutputs);
+        std::copy(inColumn.begin(), inColumn.end(), values.begin() + inIdxInput*nbOutputs);
+    }
+
+    // inOutLocal += Operator x inMultipole
+    template <class MultipoleType, class LocalType>
+    void apply(const MultipoleType& inMultipole, LocalType& inOutLocal) const{
+        assert(GetNbValues<MultipoleType>() == nbInputs);
+        assert(GetNbValues<LocalType>() == nbOutputs);
+
+        const std::vector<ValueType> multipoleValues = ToValues(inMultipole);
+        std::vector<ValueType> localValues = ToValues(inOutLocal);
+
+        for(long int idxInput = 0 ; idxInput < nbInputs ; ++idxInput){
+            if(multipoleValues[idxInput] != ValueType()){
+                const ValueType* column = &values[idxInput*nbOutputs];
+                for(long int idxOutput = 0 ; idxOutput < nbOutputs ; ++idxOutput){
+                    localValues[idxOutput] += column[idxOutput] * multipoleValues[idxInput];
+                }
+            }
+        }
+
+        FromValues(localValues, inOutLocal);
+    }
+
+    bool save(const std::string& inFilename) const{
+        FileHeader header;
+        memset(&header, 0, sizeof(FileHeader));
+        memcpy(header.magic, FileMagic, sizeof(header.magic));
+        header.version = FileVersion;
+        header.sizeOfValue = sizeof(ValueType);
+        header.nbInputs = nbInputs;
+        header.nbOutputs = nbOutputs;
+        header.keyLength = static_cast<long int>(key.size());
+
+        std::ofstream file(inFilename, std::ios::binary | std::ios::trunc);
+        if(!file.is_open()){
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        file.write(key.data(), key.size());
+        file.write(reinterpret_cast<const char*>(values.data()), sizeof(ValueType) * values.size());
+
+        return static_cast<bool>(file);
+    }
+
+    // Returns nullptr if the file cannot be read, or if it has been
+    // computed with a different key (when inExpectedKey is not empty)
+    static std::unique_ptr<TbfPeriodicFarFieldOperator> Load(const std::string& inFilename, const std::string& inExpectedKey = ""){
+        std::ifstream file(inFilename, std::ios::binary);
+        if(!file.is_open()){
+            return nullptr;
+        }
+
+        FileHeader header;
+        if(!file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader))
+                || memcmp(header.magic, FileMagic, sizeof(header.magic)) != 0
+                || header.version != FileVersion || header.sizeOfValue != static_cast<long int>(sizeof(ValueType))
+                || header.nbInputs < 0 || header.nbOutputs < 0 || header.keyLength < 0){
+            return nullptr;
+        }
+
+        std::string fileKey(header.keyLength, '\0');
+        if(!file.read(&fileKey[0], header.keyLength)
+                || (!inExpectedKey.empty() && fileKey != inExpectedKey)){
+            return nullptr;
+        }
+
+        std::unique_ptr<TbfPeriodicFarFieldOperator> farFieldOperator(new TbfPeriodicFarFieldOperator(header.nbOutputs, header.nbInputs, std::move(fileKey)));
+        if(!file.read(reinterpret_cast<char*>(farFieldOperator->values.data()), sizeof(ValueType) * farFieldOperator->values.size())){
+            return nullptr;
+        }
+
+        return farFieldOperator;
+    }
+};
+
+namespace TbfPeriodicFarFieldUtils{
+
+template <class ValueType>
+struct RealPart{
+    using type = ValueType;
+};
+
+template <class ValueType>
+struct RealPart<std::complex<ValueType>>{
+    using type = ValueType;
+};
+
+template <class CellType, class DefaultType>
+inline auto GetValueTypeCore(int) -> typename RealPart<typename std::decay<decltype(std::declval<CellType&>()[0])>::type>::type;
+
+template <class CellType, class DefaultType>
+inline DefaultType GetValueTypeCore(long);
+
+// The type of the values that compose a cell: the type of the elements
+// if the cell is an array (the real type for complex), DefaultType otherwise
+template <class CellType, class DefaultType>
+using ValueType = decltype(GetValueTypeCore<CellType, DefaultType>(0));
+
+}
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef TBFPERIODICTOPTREEUTILS_HPP
+#define TBFPERIODICTOPTREEUTILS_HPP
+
+#include "tbfglobal.hpp"
+
+#include "utils/tbfutils.hpp"
+#include "utils/tbfparallel.hpp"
+
+#include <cassert>
+#include <iterator>
+#include <vector>
+#include <array>
+#include <functional>
+#include <algorithm>
+
+// The parts of the periodic top tree that do not depend on the tree type
+// (used by TbfAlgorithmPeriodicTopTree and TbfAlgorithmPeriodicTopTreeTsm)
+namespace TbfPeriodicTopTreeUtils{
+
+// The M2L of a level is cut in chunks of at least this number of neighbors
+constexpr long int MinNeighborsPerChunk = 32;
+
+// The interaction indexes of the neighbors of the single cell of a level of the top tree
+template <class SpaceIndexType>
+inline std::vector<long int> GetM2LNeighborPositions(const SpaceIndexType& inSpaceSystem, const long int inNbLevelsAbove0,
+                                                     const long int inIdxLevel){
+    constexpr long int Dim = SpaceIndexType::Dim;
+    std::vector<long int> positionsOfNeighbors;
+
+    std::array<long int, Dim> minLimits;
+    std::array<long int, Dim> maxLimits;
+    // Single level -3/3
+    if(inNbLevelsAbove0 == 0){
+        minLimits.fill(-3);
+        maxLimits.fill(3);
+    }
+    // First -3/2
+    else if(inIdxLevel == 3){
+        minLimits.fill(-3);
+        maxLimits.fill(2);
+    }
+    // Then -2/3
+    else{
+        minLimits.fill(-2);
+        maxLimits.fill(3);
+    }
+    std::array<long int, Dim> currentCellTest = minLimits;
+
+    while(true){
+        {
+            long int currentIdx = Dim-1;
+
+            while(currentIdx >= 0 && currentCellTest[currentIdx] > maxLimits[currentIdx]){
+                currentCellTest[currentIdx] = minLimits[currentIdx];
+                currentIdx -= 1;
+                if(currentIdx >= 0){
+                    currentCellTest[currentIdx] += 1;
+                }
+            }
+            if(currentIdx < 0){
+                break;
+            }
+        }
+
+        bool isTooClose = true;
+        for(int idxDim = 0 ; isTooClose && idxDim < Dim ; ++idxDim){
+            if(std::abs(currentCellTest[idxDim]) > 1){
+                isTooClose = false;
+            }
+        }
+        if(isTooClose == false){
+            auto childPos = currentCellTest;
+            const auto childIndex = inSpaceSystem.getInteractionIndexFromRelativePos(childPos);
+            positionsOfNeighbors.emplace_back(childIndex);
+        }
+
+        currentCellTest[Dim-1] += 1;
+    }
+
+    static_assert (Dim != 3 || 316 == (TbfUtils::lipow(7, Dim) - TbfUtils::lipow(3, Dim)), "Simple check");
+    assert(inNbLevelsAbove0 != 0 || static_cast<long int>(positionsOfNeighbors.size()) == TbfUtils::lipow(7, Dim) - TbfUtils::lipow(3, Dim));
+    assert(inNbLevelsAbove0 == 0 || static_cast<long int>(positionsOfNeighbors.size()) <= inSpaceSystem.getNbInteractionsPerCell());
+    return positionsOfNeighbors;
+}
+
+// The M2L of all the levels of the top tree, there is one kernel per thread.
+// A job is a chunk of the neighbors of a level, the levels are independent
+// and the chunks of a level are summed if the locals can be reduced
+// (inLocalReducer is not empty). The cut does not depend on the number of threads.
+template <class KernelClass, class SymbDataType, class SpaceIndexType,
+          class CellMultipoleType, class CellLocalType, class LocalReducerType>
+inline void M2L(std::vector<KernelClass>& inKernels, const LocalReducerType& inLocalReducer,
+                const SymbDataType& inSymbData, const SpaceIndexType& inSpaceSystem,
+                const long int inNbLevelsAbove0, const long int inTreeHeight,
+                const std::vector<CellMultipoleType>& inMultipoles, std::vector<CellLocalType>& inOutLocals){
+    const long int lastLevel = inTreeHeight-2;
+    const long int firstLevel = (inNbLevelsAbove0 == 0 ? lastLevel : 3);
+    assert(inNbLevelsAbove0 != 0 || lastLevel == 3);
+
+    struct Job {
+        long int idxLevel;
+        long int idxChunk;
+        long int neighborBegin;
+        long int neighborEnd;
+    };
+
+    std::vector<std::vector<long int>> positionsOfNeighbors(lastLevel - firstLevel + 1);
+    std::vector<Job> jobs;
+
+    for(long int idxLevel = firstLevel ; idxLevel <= lastLevel ; ++idxLevel){
+        auto& positions = positionsOfNeighbors[idxLevel - firstLevel];
+        positions = GetM2LNeighborPositions(inSpaceSystem, inNbLevelsAbove0, idxLevel);
+
+        const long int nbNeighbors = static_cast<long int>(positions.size());
+        const long int nbChunks = (inLocalReducer ? std::max(1L, nbNeighbors/MinNeighborsPerChunk) : 1);
+        for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+            const auto interval = TbfParallel::GetChunkInterval(nbNeighbors, nbChunks, idxChunk);
+            jobs.emplace_back(Job{idxLevel, idxChunk, interval.first, interval.second});
+        }
+    }
+
+    const long int nbJobs = static_cast<long int>(jobs.size());
+    // The first chunk of a level goes directly in the local
+    std::vector<CellLocalType> partialLocals(nbJobs);
+
+    const long int nbWorkers = TbfParallel::GetNbChunks(nbJobs, static_cast<int>(inKernels.size()));
+    TbfParallel::ForEachChunk(nbJobs, nbWorkers, [&](const long int inIdxWorker, const long int inJobBegin, const long int inJobEnd){
+        auto& kernel = inKernels[inIdxWorker];
+        for(long int idxJob = inJobBegin ; idxJob < inJobEnd ; ++idxJob){
+            const Job& job = jobs[idxJob];
+
+            std::vector<std::reference_wrapper<const CellMultipoleType>> neighbors;
+            for(long int idxNeighbor = job.neighborBegin ; idxNeighbor < job.neighborEnd ; ++idxNeighbor){
+                neighbors.emplace_back(inMultipoles[job.idxLevel]);
+            }
+
+            kernel.M2L(inSymbData, job.idxLevel, TbfUtils::make_const(neighbors),
+                       positionsOfNeighbors[job.idxLevel - firstLevel].data() + job.neighborBegin,
+                       job.neighborEnd - job.neighborBegin,
+                       (job.idxChunk == 0 ? inOutLocals[job.idxLevel] : partialLocals[idxJob]));
+        }
+    });
+
+    for(long int idxJob = 0 ; idxJob < nbJobs ; ++idxJob){
+        if(jobs[idxJob].idxChunk != 0){
+            inLocalReducer(inOutLocals[jobs[idxJob].idxLevel], TbfUtils::make_const(partialLocals[idxJob]));
+        }
+    }
+}
+
+// The locals that support std::size and operator[] are summed element by element
+template <class LocalReducerType, class LocalType>
+inline auto GetDefaultLocalReducerCore(int)
+        -> decltype(std::size(std::declval<LocalType&>()), std::declval<LocalType&>()[0] += std::declval<const LocalType&>()[0], LocalReducerType()){
+    return [](LocalType& inOutLocal, const LocalType& inOther){
+        for(long int idx = 0 ; idx < static_cast<long int>(std::size(inOutLocal)) ; ++idx){
+            inOutLocal[idx] += inOther[idx];
+        }
+    };
+}
+
+template <class LocalReducerType, class LocalType>
+inline LocalReducerType GetDefaultLocalReducerCore(long){
+    return LocalReducerType();
+}
+
+template <class LocalReducerType, class LocalType>
+inline LocalReducerType GetDefaultLocalReducer(){
+    return GetDefaultLocalReducerCore<LocalReducerType, LocalType>(0);
+}
+
+}
+
+#endif
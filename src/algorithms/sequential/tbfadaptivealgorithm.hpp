@@ -0,0 +1,274 @@
+#ifndef TBFADAPTIVEALGORITHM_HPP
+#define TBFADAPTIVEALGORITHM_HPP
+
+#include "tbfglobal.hpp"
+
+#include "tbfgroupkernelinterface.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "core/tbfinteraction.hpp"
+#include "spacial/tbfadaptivelists.hpp"
+
+#include <cassert>
+#include <vector>
+#include <utility>
+
+// Sequential algorithm for the adaptive trees (TbfAdaptiveTree).
+// The far field uses the V lists (M2L) and the W/X lists (M2P/P2L),
+// the near field uses the U lists (P2P).
+// If the kernel does not provide M2P and P2L, the W/X interactions are
+// computed directly with P2P between the leaf and the leaves below the cell.
+template <class RealType_T, class KernelClass_T, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
+class TbfAdaptiveAlgorithm {
+public:
+    using RealType = RealType_T;
+    using KernelClass = KernelClass_T;
+    using SpaceIndexType = SpaceIndexType_T;
+    using SpacialConfiguration = TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>;
+
+protected:
+    const SpacialConfiguration configuration;
+    const SpaceIndexType spaceSystem;
+
+    const long int stopUpperLevel;
+
+    TbfGroupKernelInterface<SpaceIndexType> kernelWrapper;
+    KernelClass kernel;
+
+    template <class TreeClass>
+    auto findChildren(TreeClass& inTree, const long int inLevel, const typename TreeClass::IndexType inCellIndex) const {
+        using CellGroupClass = typename TreeClass::CellGroupClass;
+        std::vector<std::pair<CellGroupClass*, long int>> children;
+        if(inLevel+1 < configuration.getTreeHeight()){
+            for(long int idxChild = 0 ; idxChild < spaceSystem.getNbChildrenPerCell() ; ++idxChild){
+                auto foundChild = inTree.findGroupWithCell(inLevel+1, spaceSystem.getChildIndexFromParent(inCellIndex, idxChild));
+                if(foundChild){
+                    children.emplace_back(&(*foundChild).first.get(), (*foundChild).second);
+                }
+            }
+        }
+        return children;
+    }
+
+    template <class TreeClass, class FuncClass>
+    void applyToLeavesBelow(TreeClass& inTree, const long int inLevel, const typename TreeClass::IndexType inCellIndex,
+                            FuncClass&& inFunc) const {
+        auto foundLeaf = inTree.findGroupWithLeaf(inLevel, inCellIndex);
+        if(foundLeaf){
+            inFunc((*foundLeaf).first.get(), (*foundLeaf).second);
+        }
+        else{
+            for(const auto& child : findChildren(inTree, inLevel, inCellIndex)){
+                applyToLeavesBelow(inTree, inLevel+1, child.first->getCellSpacialIndex(child.second), inFunc);
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void P2M(TreeClass& inTree){
+        for(long int idxLevel = stopUpperLevel ; idxLevel < configuration.getTreeHeight() ; ++idxLevel){
+            for(const auto& particleGroup : inTree.getParticleGroupsAtLevel(idxLevel)){
+                for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                    auto foundCell = inTree.findGroupWithCell(idxLevel, particleGroup.getLeafSpacialIndex(idxLeaf));
+                    assert(foundCell);
+                    kernelWrapper.P2MForLeaf(idxLevel, kernel, particleGroup, idxLeaf, (*foundCell).first.get(), (*foundCell).second);
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void M2M(TreeClass& inTree){
+        using CellGroupClass = typename TreeClass::CellGroupClass;
+
+        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= stopUpperLevel ; --idxLevel){
+            for(auto& cellGroup : inTree.getCellGroupsAtLevel(idxLevel)){
+                for(long int idxCell = 0 ; idxCell < cellGroup.getNbCells() ; ++idxCell){
+                    const auto children = findChildren(inTree, idxLevel, cellGroup.getCellSpacialIndex(idxCell));
+                    const std::vector<std::pair<const CellGroupClass*, long int>> constChildren(children.begin(), children.end());
+                    kernelWrapper.M2MForCell(idxLevel, kernel, constChildren, cellGroup, idxCell);
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void M2L(TreeClass& inTree){
+        using CellGroupClass = typename TreeClass::CellGroupClass;
+
+        for(long int idxLevel = stopUpperLevel ; idxLevel < configuration.getTreeHeight() ; ++idxLevel){
+            for(auto& cellGroup : inTree.getCellGroupsAtLevel(idxLevel)){
+                for(long int idxCell = 0 ; idxCell < cellGroup.getNbCells() ; ++idxCell){
+                    std::vector<std::pair<const CellGroupClass*, long int>> sources;
+                    for(const auto index : spaceSystem.getInteractionListForIndex(cellGroup.getCellSpacialIndex(idxCell), idxLevel)){
+                        auto foundSrc = inTree.findGroupWithCell(idxLevel, index);
+                        if(foundSrc){
+                            sources.emplace_back(&(*foundSrc).first.get(), (*foundSrc).second);
+                        }
+                    }
+                    kernelWrapper.M2LForCell(idxLevel, kernel, sources, cellGroup, idxCell);
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void M2PAndP2L(TreeClass& inTree){
+        using CellGroupClass = typename TreeClass::CellGroupClass;
+        using LeafGroupClass = typename TreeClass::LeafGroupClass;
+
+        for(long int idxLevel = 0 ; idxLevel < configuration.getTreeHeight() ; ++idxLevel){
+            for(auto& particleGroup : inTree.getParticleGroupsAtLevel(idxLevel)){
+                for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                    const auto lists = TbfAdaptiveLists::GetListsForLeaf(spaceSystem, particleGroup.getLeafSpacialIndex(idxLeaf), idxLevel,
+                                                                         [&inTree](const long int inLevel, const auto inIndex){
+                        return inTree.getCellType(inLevel, inIndex);
+                    });
+
+                    for(const auto& cell : lists.second){
+                        if constexpr(TbfGroupKernelInterface<SpaceIndexType>::template KernelHasM2PAndP2L<KernelClass, CellGroupClass, LeafGroupClass>()){
+                            if(stopUpperLevel <= cell.level){
+                                auto foundCell = inTree.findGroupWithCell(cell.level, cell.index);
+                                assert(foundCell);
+                                kernelWrapper.M2P(cell.level, kernel, TbfUtils::make_const((*foundCell).first.get()), (*foundCell).second,
+                                                  particleGroup, idxLeaf);
+                                kernelWrapper.P2L(cell.level, kernel, TbfUtils::make_const(particleGroup), idxLeaf,
+                                                  (*foundCell).first.get(), (*foundCell).second);
+                                continue;
+                            }
+                        }
+                        // No multipole/local for this cell, the interactions are computed directly
+                        applyToLeavesBelow(inTree, cell.level, cell.index, [&](auto& inSrcGroup, const long int inIdxSrcLeaf){
+                            kernelWrapper.P2PBetweenLeaves(kernel, inSrcGroup, inIdxSrcLeaf, particleGroup, idxLeaf, -1);
+                        });
+                    }
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void L2L(TreeClass& inTree){
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
+            for(const auto& cellGroup : inTree.getCellGroupsAtLevel(idxLevel)){
+                for(long int idxCell = 0 ; idxCell < cellGroup.getNbCells() ; ++idxCell){
+                    const auto children = findChildren(inTree, idxLevel, cellGroup.getCellSpacialIndex(idxCell));
+                    kernelWrapper.L2LForCell(idxLevel, kernel, cellGroup, idxCell, children);
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void L2P(TreeClass& inTree){
+        for(long int idxLevel = stopUpperLevel ; idxLevel < configuration.getTreeHeight() ; ++idxLevel){
+            for(auto& particleGroup : inTree.getParticleGroupsAtLevel(idxLevel)){
+                for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                    auto foundCell = inTree.findGroupWithCell(idxLevel, particleGroup.getLeafSpacialIndex(idxLeaf));
+                    assert(foundCell);
+                    kernelWrapper.L2PForLeaf(idxLevel, kernel, TbfUtils::make_const((*foundCell).first.get()), (*foundCell).second, particleGroup, idxLeaf);
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void P2P(TreeClass& inTree){
+        for(long int idxLevel = 0 ; idxLevel < configuration.getTreeHeight() ; ++idxLevel){
+            for(auto& particleGroup : inTree.getParticleGroupsAtLevel(idxLevel)){
+                for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                    const auto leafIndex = particleGroup.getLeafSpacialIndex(idxLeaf);
+                    const auto lists = TbfAdaptiveLists::GetListsForLeaf(spaceSystem, leafIndex, idxLevel,
+                                                                         [&inTree](const long int inLevel, const auto inIndex){
+                        return inTree.getCellType(inLevel, inIndex);
+                    });
+
+                    const auto leafPos = spaceSystem.getBoxPosFromIndex(leafIndex);
+
+                    for(const auto& leaf : lists.first){
+                        auto foundSrc = inTree.findGroupWithLeaf(leaf.level, leaf.index);
+                        assert(foundSrc);
+
+                        long int arrayIndexSrc = -1;
+                        if(leaf.level == idxLevel){
+                            const auto srcPos = spaceSystem.getBoxPosFromIndex(leaf.index);
+                            std::array<long int, SpaceIndexType::Dim> relativePos;
+                            for(long int idxDim = 0 ; idxDim < SpaceIndexType::Dim ; ++idxDim){
+                                relativePos[idxDim] = srcPos[idxDim] - leafPos[idxDim];
+                            }
+                            arrayIndexSrc = spaceSystem.getNeighborIndexFromRelativePos(relativePos);
+                        }
+
+                        kernelWrapper.P2PBetweenLeaves(kernel, (*foundSrc).first.get(), (*foundSrc).second,
+                                                       particleGroup, idxLeaf, arrayIndexSrc);
+                    }
+                }
+
+                kernelWrapper.P2PInner(kernel, particleGroup);
+            }
+        }
+    }
+
+public:
+    explicit TbfAdaptiveAlgorithm(const SpacialConfiguration& inConfiguration, const long int inStopUpperLevel = TbfDefaultLastLevel)
+        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)), kernelWrapper(configuration), kernel(configuration){
+    }
+
+    template <class SourceKernelClass,
+              typename = typename std::enable_if<!std::is_same<long int, typename std::remove_const<typename std::remove_reference<SourceKernelClass>::type>::type>::value
+                                                 && !std::is_same<int, typename std::remove_const<typename std::remove_reference<SourceKernelClass>::type>::type>::value, void>::type>
+    TbfAdaptiveAlgorithm(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inStopUpperLevel = TbfDefaultLastLevel)
+        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)), kernelWrapper(configuration), kernel(std::forward<SourceKernelClass>(inKernel)){
+    }
+
+    // The W/X interactions are part of the M2L
+    template <class TreeClass>
+    void execute(TreeClass& inTree, const int inOperationToProceed = TbfAlgorithmUtils::TbfOperations::TbfNearAndFarFields){
+        assert(configuration == inTree.getSpacialConfiguration());
+
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfP2M){
+            P2M(inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfM2M){
+            M2M(inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
+            M2L(inTree);
+            M2PAndP2L(inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfL2L){
+            L2L(inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfL2P){
+            L2P(inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfP2P){
+            P2P(inTree);
+        }
+    }
+
+    template <class FuncType>
+    auto applyToAllKernels(FuncType&& inFunc) const {
+        inFunc(kernel);
+    }
+
+    template <class StreamClass>
+    friend  StreamClass& operator<<(StreamClass& inStream, const TbfAdaptiveAlgorithm& inAlgo) {
+        inStream << "TbfAdaptiveAlgorithm @ " << &inAlgo << "\n";
+        inStream << " - Configuration: " << "\n";
+        inStream << inAlgo.configuration << "\n";
+        inStream << " - Space system: " << "\n";
+        inStream << inAlgo.spaceSystem << "\n";
+        return inStream;
+    }
+
+    static int GetNbThreads(){
+        return 1;
+    }
+
+    static const char* GetName(){
+        return "TbfAdaptiveAlgorithm";
+    }
+};
+
+#endif
@@ -27,6 +27,12 @@ protected:
     TbfGroupKernelInterface<SpaceIndexType> kernelWrapper;
     KernelClass kernel;
 
+    // The number of groups prefetched ahead (for out-of-core trees), 0 to disable
+    long int outOfCoreWindow;
+
+    // If true, the M2L and P2P use the interaction plan of the tree
+    bool useInteractionPlan;
+
     template <class TreeClass>
     void P2M(TreeClass& inTree){
         if(configuration.getTreeHeight() > stopUpperLevel){
@@ -41,10 +47,15 @@ protected:
             const auto endLeafGroup = leafGroups.end();
             const auto endParticleGroup = particleGroups.cend();
 
+            TbfAlgorithmUtils::TbfGroupsWindow leafWindow(leafGroups, outOfCoreWindow);
+            TbfAlgorithmUtils::TbfGroupsWindow particleWindow(particleGroups, outOfCoreWindow);
+
             while(currentLeafGroup != endLeafGroup && currentParticleGroup != endParticleGroup){
                 assert((*currentParticleGroup).getStartingSpacialIndex() == (*currentLeafGroup).getStartingSpacialIndex()
                        && (*currentParticleGroup).getEndingSpacialIndex() == (*currentLeafGroup).getEndingSpacialIndex()
                        && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
+                leafWindow.moveTo(std::distance(leafGroups.begin(), currentLeafGroup));
+                particleWindow.moveTo(std::distance(particleGroups.cbegin(), currentParticleGroup));
                 kernelWrapper.P2M(kernel, *currentParticleGroup, *currentLeafGroup);
                 ++currentParticleGroup;
                 ++currentLeafGroup;
@@ -64,9 +75,14 @@ protected:
             const auto endUpperGroup = upperCellGroup.end();
             const auto endLowerGroup = lowerCellGroup.cend();
 
+            TbfAlgorithmUtils::TbfGroupsWindow upperWindow(upperCellGroup, outOfCoreWindow);
+            TbfAlgorithmUtils::TbfGroupsWindow lowerWindow(lowerCellGroup, outOfCoreWindow);
+
             while(currentUpperGroup != endUpperGroup && currentLowerGroup != endLowerGroup){
                 assert(spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()
                        || currentUpperGroup->getStartingSpacialIndex() <= spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()));
+                upperWindow.moveTo(std::distance(upperCellGroup.begin(), currentUpperGroup));
+                lowerWindow.moveTo(std::distance(lowerCellGroup.cbegin(), currentLowerGroup));
                 kernelWrapper.M2M(idxLevel, kernel, *currentLowerGroup, *currentUpperGroup);
                 if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
                     ++currentLowerGroup;
@@ -91,13 +107,17 @@ protected:
             auto currentCellGroup = cellGroups.begin();
             const auto endCellGroup = cellGroups.end();
 
+            TbfAlgorithmUtils::TbfGroupsWindow cellWindow(cellGroups, outOfCoreWindow);
+
             while(currentCellGroup != endCellGroup){
+                cellWindow.moveTo(std::distance(cellGroups.begin(), currentCellGroup));
 
                 auto indexesForGroup = spacialSystem.getInteractionListForBlock(*currentCellGroup, idxLevel);
                 TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), cellGroups, std::distance(cellGroups.begin(),currentCellGroup),
                                                [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
                     assert(&groupTarget == &*currentCellGroup);
                     kernelWrapper.M2LBetweenGroups(idxLevel, kernel, groupTarget, groupSrc, indexes);
+                    cellWindow.releaseUsedGroup(&groupSrc - cellGroups.data());
                 });
 
                 kernelWrapper.M2LInGroup(idxLevel, kernel, *currentCellGroup, indexesForGroup.first);
@@ -108,6 +128,31 @@ protected:
         }
     }
 
+    template <class TreeClass>
+    void M2LWithPlan(TreeClass& inTree){
+        const auto& interactionPlan = inTree.getInteractionPlan();
+
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
+            auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+
+            TbfAlgorithmUtils::TbfGroupsWindow cellWindow(cellGroups, outOfCoreWindow);
+
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(cellGroups)) ; ++idxGroup){
+                cellWindow.moveTo(idxGroup);
+
+                const auto blocks = interactionPlan.getM2LBlocksBetweenGroups(idxLevel, idxGroup);
+                for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                    kernelWrapper.M2LFromPlan(idxLevel, kernel, cellGroups[idxGroup], TbfUtils::make_const(cellGroups[blocks[idxBlock].idxSrcGroup]),
+                                              interactionPlan.getM2LInteractions(idxLevel, blocks[idxBlock]));
+                    cellWindow.releaseUsedGroup(blocks[idxBlock].idxSrcGroup);
+                }
+
+                kernelWrapper.M2LFromPlan(idxLevel, kernel, cellGroups[idxGroup], TbfUtils::make_const(cellGroups[idxGroup]),
+                                          interactionPlan.getM2LInteractionsInGroup(idxLevel, idxGroup));
+            }
+        }
+    }
+
     template <class TreeClass>
     void L2L(TreeClass& inTree){
         for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
@@ -120,9 +165,14 @@ protected:
             const auto endUpperGroup = upperCellGroup.cend();
             const auto endLowerGroup = lowerCellGroup.end();
 
+            TbfAlgorithmUtils::TbfGroupsWindow upperWindow(upperCellGroup, outOfCoreWindow);
+            TbfAlgorithmUtils::TbfGroupsWindow lowerWindow(lowerCellGroup, outOfCoreWindow);
+
             while(currentUpperGroup != endUpperGroup && currentLowerGroup != endLowerGroup){
                 assert(spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()
                        || currentUpperGroup->getStartingSpacialIndex() <= spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()));
+                upperWindow.moveTo(std::distance(upperCellGroup.cbegin(), currentUpperGroup));
+                lowerWindow.moveTo(std::distance(lowerCellGroup.begin(), currentLowerGroup));
                 kernelWrapper.L2L(idxLevel, kernel, *currentUpperGroup, *currentLowerGroup);
                 if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
                     ++currentLowerGroup;
@@ -151,10 +201,15 @@ protected:
             const auto endLeafGroup = leafGroups.cend();
             const auto endParticleGroup = particleGroups.end();
 
+            TbfAlgorithmUtils::TbfGroupsWindow leafWindow(leafGroups, outOfCoreWindow);
+            TbfAlgorithmUtils::TbfGroupsWindow particleWindow(particleGroups, outOfCoreWindow);
+
             while(currentLeafGroup != endLeafGroup && currentParticleGroup != endParticleGroup){
                 assert((*currentParticleGroup).getStartingSpacialIndex() == (*currentLeafGroup).getStartingSpacialIndex()
                        && (*currentParticleGroup).getEndingSpacialIndex() == (*currentLeafGroup).getEndingSpacialIndex()
                        && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
+                leafWindow.moveTo(std::distance(leafGroups.cbegin(), currentLeafGroup));
+                particleWindow.moveTo(std::distance(particleGroups.begin(), currentParticleGroup));
                 kernelWrapper.L2P(kernel, *currentLeafGroup, *currentParticleGroup);
                 ++currentParticleGroup;
                 ++currentLeafGroup;
@@ -171,13 +226,17 @@ protected:
         auto currentParticleGroup = particleGroups.begin();
         const auto endParticleGroup = particleGroups.end();
 
+        TbfAlgorithmUtils::TbfGroupsWindow particleWindow(particleGroups, outOfCoreWindow);
+
         while(currentParticleGroup != endParticleGroup){
+            particleWindow.moveTo(std::distance(particleGroups.begin(), currentParticleGroup));
 
             auto indexesForGroup = spacialSystem.getNeighborListForBlock(*currentParticleGroup, configuration.getTreeHeight()-1, true);
             TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), particleGroups, std::distance(particleGroups.begin(), currentParticleGroup),
                                            [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
                 assert(&groupTarget == &*currentParticleGroup);
                 kernelWrapper.P2PBetweenGroups(kernel, groupTarget, groupSrc, indexes);
+                particleWindow.releaseUsedGroup(&groupSrc - particleGroups.data());
             });
 
             kernelWrapper.P2PInGroup(kernel, *currentParticleGroup, indexesForGroup.first);
@@ -188,16 +247,63 @@ protected:
         }
     }
 
+    template <class TreeClass>
+    void P2PWithPlan(TreeClass& inTree){
+        const auto& interactionPlan = inTree.getInteractionPlan();
+
+        auto& particleGroups = inTree.getParticleGroups();
+
+        TbfAlgorithmUtils::TbfGroupsWindow particleWindow(particleGroups, outOfCoreWindow);
+
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            particleWindow.moveTo(idxGroup);
+
+            const auto blocks = interactionPlan.getP2PBlocksBetweenGroups(idxGroup);
+            for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                kernelWrapper.P2PFromPlan(kernel, particleGroups[idxGroup], particleGroups[blocks[idxBlock].idxSrcGroup],
+                                          interactionPlan.getP2PInteractions(blocks[idxBlock]));
+                particleWindow.releaseUsedGroup(blocks[idxBlock].idxSrcGroup);
+            }
+
+            kernelWrapper.P2PFromPlan(kernel, particleGroups[idxGroup], particleGroups[idxGroup],
+                                      interactionPlan.getP2PInteractionsInGroup(idxGroup));
+
+            kernelWrapper.P2PInner(kernel, particleGroups[idxGroup]);
+        }
+    }
+
 public:
     explicit TbfAlgorithm(const SpacialConfiguration& inConfiguration, const long int inStopUpperLevel = TbfDefaultLastLevel)
-        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)), kernelWrapper(configuration), kernel(configuration){
+        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)), kernelWrapper(configuration), kernel(configuration),
+          outOfCoreWindow(0), useInteractionPlan(false){
     }
 
     template <class SourceKernelClass,
               typename = typename std::enable_if<!std::is_same<long int, typename std::remove_const<typename std::remove_reference<SourceKernelClass>::type>::type>::value
                                                  && !std::is_same<int, typename std::remove_const<typename std::remove_reference<SourceKernelClass>::type>::type>::value, void>::type>
     TbfAlgorithm(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inStopUpperLevel = TbfDefaultLastLevel)
-        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)), kernelWrapper(configuration), kernel(std::forward<SourceKernelClass>(inKernel)){
+        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)), kernelWrapper(configuration), kernel(std::forward<SourceKernelClass>(inKernel)),
+          outOfCoreWindow(0), useInteractionPlan(false){
+    }
+
+    // When the tree uses an out-of-core allocator (TbfMappedFileAllocator), the groups are
+    // processed in order with inNbGroups groups prefetched ahead and released behind
+    void setOutOfCoreWindow(const long int inNbGroups){
+        outOfCoreWindow = inNbGroups;
+    }
+
+    long int getOutOfCoreWindow() const{
+        return outOfCoreWindow;
+    }
+
+    // The interaction lists of the M2L/P2P are computed once and kept in the tree (see TbfTree::getInteractionPlan),
+    // which is faster when the same tree is used for several executions but needs memory
+    void setUseInteractionPlan(const bool inUseInteractionPlan){
+        useInteractionPlan = inUseInteractionPlan;
+    }
+
+    bool getUseInteractionPlan() const{
+        return useInteractionPlan;
     }
 
     template <class TreeClass>
@@ -211,7 +317,12 @@ public:
             M2M(inTree);
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
-            M2L(inTree);
+            if(useInteractionPlan){
+                M2LWithPlan(inTree);
+            }
+            else{
+                M2L(inTree);
+            }
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfL2L){
             L2L(inTree);
@@ -220,7 +331,12 @@ public:
             L2P(inTree);
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfP2P){
-            P2P(inTree);
+            if(useInteractionPlan){
+                P2PWithPlan(inTree);
+            }
+            else{
+                P2P(inTree);
+            }
         }
     }
 
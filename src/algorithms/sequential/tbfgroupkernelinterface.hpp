@@ -3,8 +3,23 @@
 
 #include "tbfglobal.hpp"
 #include "utils/tbfutils.hpp"
+#include "containers/tbffixedcapacityvector.hpp"
 
 #include <cassert>
+#include <vector>
+#include <array>
+#include <utility>
+#include <type_traits>
+
+// The leaves of an adaptive tree can be at any level, so the level is
+// given to P2M/L2P together with the symbolic data of the leaf
+template <class SymbolicDataType>
+struct TbfAdaptiveLeafSymbData : public SymbolicDataType {
+    long int level;
+
+    TbfAdaptiveLeafSymbData(const SymbolicDataType& inSymbData, const long int inLevel)
+        : SymbolicDataType(inSymbData), level(inLevel){}
+};
 
 template <class SpaceIndexType>
 class TbfGroupKernelInterface{
@@ -31,8 +46,8 @@ public:
     void M2M(const long int inLevel, KernelClass& inKernel, const CellGroupClass& inLowerGroup,
              CellGroupClass& inUpperGroup) const {
         using CellMultipoleType = typename std::remove_reference<decltype(inLowerGroup.getCellMultipole(0))>::type;
-        std::vector<std::reference_wrapper<const CellMultipoleType>> children;
-        long int positionsOfChildren[spaceSystem.getNbChildrenPerCell()];
+        TbfFixedCapacityVector<std::reference_wrapper<const CellMultipoleType>, SpaceIndexType::getNbChildrenPerCell()> children;
+        std::array<long int, SpaceIndexType::getNbChildrenPerCell()> positionsOfChildren;
         long int nbChildren = 0;
 
         const auto startingIndex = std::max(spaceSystem.getParentIndex(inLowerGroup.getStartingSpacialIndex()),
@@ -62,7 +77,7 @@ public:
 
                 inKernel.M2M(inUpperGroup.getCellSymbData(idxParent),
                              inLevel, TbfUtils::make_const(children), inUpperGroup.getCellMultipole(idxParent),
-                             positionsOfChildren, nbChildren);
+                             positionsOfChildren.data(), nbChildren);
 
                 idxParent += 1;
                 assert(idxParent == inUpperGroup.getNbCells()
@@ -76,7 +91,7 @@ public:
         if(nbChildren){
             inKernel.M2M(inUpperGroup.getCellSymbData(idxParent),
                          inLevel, TbfUtils::make_const(children), inUpperGroup.getCellMultipole(idxParent),
-                     positionsOfChildren, nbChildren);
+                     positionsOfChildren.data(), nbChildren);
         }
     }
 
@@ -85,8 +100,8 @@ public:
         using CellMultipoleType = typename std::remove_reference<decltype(inCellGroup.getCellMultipole(0))>::type;
         //using CellLocalType = typename std::remove_reference<decltype(inCellGroup.getCellLocal(0))>::type;
 
-        std::vector<std::reference_wrapper<const CellMultipoleType>> neighbors;
-        long int positionsOfNeighbors[spaceSystem.getNbInteractionsPerCell()];
+        TbfFixedCapacityVector<std::reference_wrapper<const CellMultipoleType>, SpaceIndexType::getNbInteractionsPerCell()> neighbors;
+        std::array<long int, SpaceIndexType::getNbInteractionsPerCell()> positionsOfNeighbors;
         long int nbNeighbors = 0;
 
         long int idxInteraction = 0;
@@ -114,7 +129,7 @@ public:
             inKernel.M2L(inCellGroup.getCellSymbData(interaction.globalTargetPos),
                          inLevel,
                          TbfUtils::make_const(neighbors),
-                         positionsOfNeighbors,
+                         positionsOfNeighbors.data(),
                          nbNeighbors,
                          targetCell);
             neighbors.clear();
@@ -128,8 +143,8 @@ public:
         using CellMultipoleType = typename std::remove_reference<decltype(inOtherCellGroup.getCellMultipole(0))>::type;
         //using CellLocalType = typename std::remove_reference<decltype(inCellGroup.getCellLocal(0))>::type;
 
-        std::vector<std::reference_wrapper<const CellMultipoleType>> neighbors;
-        long int positionsOfNeighbors[spaceSystem.getNbInteractionsPerCell()];
+        TbfFixedCapacityVector<std::reference_wrapper<const CellMultipoleType>, SpaceIndexType::getNbInteractionsPerCell()> neighbors;
+        std::array<long int, SpaceIndexType::getNbInteractionsPerCell()> positionsOfNeighbors;
         long int nbNeighbors = 0;
 
         long int idxInteraction = 0;
@@ -159,7 +174,7 @@ public:
                 inKernel.M2L(inCellGroup.getCellSymbData(interaction.globalTargetPos),
                             inLevel,
                          TbfUtils::make_const(neighbors),
-                         positionsOfNeighbors,
+                         positionsOfNeighbors.data(),
                          nbNeighbors,
                          targetCell);
                 neighbors.clear();
@@ -172,8 +187,8 @@ public:
     void L2L(const long int inLevel, KernelClass& inKernel, const CellGroupClass& inUpperGroup,
              CellGroupClass& inLowerGroup) const {
         using CellLocalType = typename std::remove_reference<decltype(inLowerGroup.getCellLocal(0))>::type;
-        std::vector<std::reference_wrapper<CellLocalType>> children;
-        long int positionsOfChildren[spaceSystem.getNbChildrenPerCell()];
+        TbfFixedCapacityVector<std::reference_wrapper<CellLocalType>, SpaceIndexType::getNbChildrenPerCell()> children;
+        std::array<long int, SpaceIndexType::getNbChildrenPerCell()> positionsOfChildren;
         long int nbChildren = 0;
 
         const auto startingIndex = std::max(spaceSystem.getParentIndex(inLowerGroup.getStartingSpacialIndex()),
@@ -203,7 +218,7 @@ public:
 
                 inKernel.L2L(inUpperGroup.getCellSymbData(idxParent),
                              inLevel, inUpperGroup.getCellLocal(idxParent), children,
-                             positionsOfChildren, nbChildren);
+                             positionsOfChildren.data(), nbChildren);
 
                 idxParent += 1;
                 assert(idxParent == inUpperGroup.getNbCells()
@@ -217,7 +232,7 @@ public:
         if(nbChildren){
             inKernel.L2L(inUpperGroup.getCellSymbData(idxParent),
                          inLevel, inUpperGroup.getCellLocal(idxParent), children,
-                         positionsOfChildren, nbChildren);
+                         positionsOfChildren.data(), nbChildren);
         }
     }
 
@@ -336,6 +351,249 @@ public:
             }
         }
     }
+    ///////////////////////////////////////////////////////////////////////////
+    /// Interactions from a TbfInteractionPlan: the positions of the cells/leaves
+    /// in the groups are already resolved, the source and the target groups are
+    /// the same object for the interactions inside a group.
+    ///////////////////////////////////////////////////////////////////////////
+
+    template <class KernelClass, class CellGroupClassTarget, class CellGroupClassSource, class PlanInteractionsClass>
+    void M2LFromPlan(const long int inLevel, KernelClass& inKernel, CellGroupClassTarget& inCellGroup,
+                     const CellGroupClassSource& inSrcCellGroup, const PlanInteractionsClass& inInteractions) const {
+        using CellMultipoleType = typename std::remove_reference<decltype(inSrcCellGroup.getCellMultipole(0))>::type;
+
+        TbfFixedCapacityVector<std::reference_wrapper<const CellMultipoleType>, SpaceIndexType::getNbInteractionsPerCell()> neighbors;
+        std::array<long int, SpaceIndexType::getNbInteractionsPerCell()> positionsOfNeighbors;
+        long int nbNeighbors = 0;
+
+        long int idxInteraction = 0;
+
+        while(idxInteraction < static_cast<long int>(inInteractions.size())){
+            const long int idxTarget = inInteractions[idxInteraction].idxTarget;
+
+            do{
+                assert(nbNeighbors < spaceSystem.getNbInteractionsPerCell());
+                neighbors.emplace_back(inSrcCellGroup.getCellMultipole(inInteractions[idxInteraction].idxSrc));
+                positionsOfNeighbors[nbNeighbors] = inInteractions[idxInteraction].arrayIndexSrc;
+                nbNeighbors += 1;
+
+                idxInteraction += 1;
+            } while(idxInteraction < static_cast<long int>(inInteractions.size())
+                    && idxTarget == inInteractions[idxInteraction].idxTarget);
+
+            inKernel.M2L(inCellGroup.getCellSymbData(idxTarget),
+                         inLevel,
+                         TbfUtils::make_const(neighbors),
+                         positionsOfNeighbors.data(),
+                         nbNeighbors,
+                         inCellGroup.getCellLocal(idxTarget));
+            neighbors.clear();
+            nbNeighbors = 0;
+        }
+    }
+
+    template <class KernelClass, class ParticleGroupClass, class PlanInteractionsClass>
+    void P2PFromPlan(KernelClass& inKernel, ParticleGroupClass& inParticleGroup,
+                     ParticleGroupClass& inSrcParticleGroup, const PlanInteractionsClass& inInteractions) const {
+        for(long int idxInteraction = 0 ; idxInteraction < static_cast<long int>(inInteractions.size()) ; ++idxInteraction){
+            const long int idxSrc = inInteractions[idxInteraction].idxSrc;
+            const long int idxTarget = inInteractions[idxInteraction].idxTarget;
+
+            const auto& srcData = TbfUtils::make_const(inSrcParticleGroup).getParticleData(idxSrc);
+            auto&& srcRhs = inSrcParticleGroup.getParticleRhs(idxSrc);
+            auto&& targetRhs = inParticleGroup.getParticleRhs(idxTarget);
+            const auto& targetData = TbfUtils::make_const(inParticleGroup).getParticleData(idxTarget);
+
+            inKernel.P2P(inSrcParticleGroup.getLeafSymbData(idxSrc),
+                         inSrcParticleGroup.getParticleIndexes(idxSrc),
+                         srcData, srcRhs,
+                         inSrcParticleGroup.getNbParticlesInLeaf(idxSrc),
+                         inParticleGroup.getLeafSymbData(idxTarget),
+                         inParticleGroup.getParticleIndexes(idxTarget), targetData,
+                         targetRhs, inParticleGroup.getNbParticlesInLeaf(idxTarget),
+                         inInteractions[idxInteraction].arrayIndexSrc);
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    /// Adaptive trees: a cell can be a leaf at any level, therefore the
+    /// operators are applied per cell with the interacting cells/leaves given
+    /// as pairs (group, position in the group).
+    ///////////////////////////////////////////////////////////////////////////
+
+    template <class KernelClass, class ParticleGroupClass, class CellGroupClass>
+    void P2MForLeaf(const long int inLevel, KernelClass& inKernel, const ParticleGroupClass& inParticleGroup, const long int inIdxLeaf,
+                    CellGroupClass& inCellGroup, const long int inIdxCell) const {
+        assert(inParticleGroup.getLeafSpacialIndex(inIdxLeaf) == inCellGroup.getCellSpacialIndex(inIdxCell));
+        using SymbDataType = typename std::decay<decltype(inCellGroup.getCellSymbData(inIdxCell))>::type;
+        const TbfAdaptiveLeafSymbData<SymbDataType> symbData(TbfUtils::make_const(inCellGroup).getCellSymbData(inIdxCell), inLevel);
+        const auto& particlesData = inParticleGroup.getParticleData(inIdxLeaf);
+        auto&& leafData = inCellGroup.getCellMultipole(inIdxCell);
+        inKernel.P2M(symbData, inParticleGroup.getParticleIndexes(inIdxLeaf), particlesData, inParticleGroup.getNbParticlesInLeaf(inIdxLeaf),
+                     leafData);
+    }
+
+    template <class KernelClass, class CellGroupClass>
+    void M2MForCell(const long int inLevel, KernelClass& inKernel,
+                    const std::vector<std::pair<const CellGroupClass*, long int>>& inChildren,
+                    CellGroupClass& inUpperGroup, const long int inIdxParent) const {
+        using CellMultipoleType = typename std::remove_reference<decltype(inUpperGroup.getCellMultipole(0))>::type;
+        TbfFixedCapacityVector<std::reference_wrapper<const CellMultipoleType>, SpaceIndexType::getNbChildrenPerCell()> children;
+        std::array<long int, SpaceIndexType::getNbChildrenPerCell()> positionsOfChildren;
+        const long int nbChildren = static_cast<long int>(inChildren.size());
+        assert(nbChildren <= spaceSystem.getNbChildrenPerCell());
+
+        for(long int idxChild = 0 ; idxChild < nbChildren ; ++idxChild){
+            const auto& child = inChildren[idxChild];
+            assert(spaceSystem.getParentIndex(child.first->getCellSpacialIndex(child.second)) == inUpperGroup.getCellSpacialIndex(inIdxParent));
+            children.emplace_back(child.first->getCellMultipole(child.second));
+            positionsOfChildren[idxChild] = spaceSystem.childPositionFromParent(child.first->getCellSpacialIndex(child.second));
+        }
+
+        if(nbChildren){
+            inKernel.M2M(inUpperGroup.getCellSymbData(inIdxParent),
+                         inLevel, TbfUtils::make_const(children), inUpperGroup.getCellMultipole(inIdxParent),
+                         positionsOfChildren.data(), nbChildren);
+        }
+    }
+
+    template <class KernelClass, class CellGroupClass>
+    void M2LForCell(const long int inLevel, KernelClass& inKernel,
+                    const std::vector<std::pair<const CellGroupClass*, long int>>& inSources,
+                    CellGroupClass& inTargetGroup, const long int inIdxTarget) const {
+        using CellMultipoleType = typename std::remove_reference<decltype(inTargetGroup.getCellMultipole(0))>::type;
+        TbfFixedCapacityVector<std::reference_wrapper<const CellMultipoleType>, SpaceIndexType::getNbInteractionsPerCell()> neighbors;
+        std::array<long int, SpaceIndexType::getNbInteractionsPerCell()> positionsOfNeighbors;
+        const long int nbNeighbors = static_cast<long int>(inSources.size());
+        assert(nbNeighbors <= spaceSystem.getNbInteractionsPerCell());
+
+        const auto targetPos = spaceSystem.getBoxPosFromIndex(inTargetGroup.getCellSpacialIndex(inIdxTarget));
+
+        for(long int idxNeighbor = 0 ; idxNeighbor < nbNeighbors ; ++idxNeighbor){
+            const auto& source = inSources[idxNeighbor];
+            const auto sourcePos = spaceSystem.getBoxPosFromIndex(source.first->getCellSpacialIndex(source.second));
+            std::array<long int, SpaceIndexType::Dim> relativePos;
+            for(long int idxDim = 0 ; idxDim < SpaceIndexType::Dim ; ++idxDim){
+                relativePos[idxDim] = sourcePos[idxDim] - targetPos[idxDim];
+            }
+            neighbors.emplace_back(source.first->getCellMultipole(source.second));
+            positionsOfNeighbors[idxNeighbor] = spaceSystem.getInteractionIndexFromRelativePos(relativePos);
+        }
+
+        if(nbNeighbors){
+            inKernel.M2L(inTargetGroup.getCellSymbData(inIdxTarget),
+                         inLevel,
+                         TbfUtils::make_const(neighbors),
+                         positionsOfNeighbors.data(),
+                         nbNeighbors,
+                         inTargetGroup.getCellLocal(inIdxTarget));
+        }
+    }
+
+    template <class KernelClass, class CellGroupClass>
+    void L2LForCell(const long int inLevel, KernelClass& inKernel,
+                    const CellGroupClass& inUpperGroup, const long int inIdxParent,
+                    const std::vector<std::pair<CellGroupClass*, long int>>& inChildren) const {
+        using CellLocalType = typename std::remove_reference<decltype(inChildren.front().first->getCellLocal(0))>::type;
+        TbfFixedCapacityVector<std::reference_wrapper<CellLocalType>, SpaceIndexType::getNbChildrenPerCell()> children;
+        std::array<long int, SpaceIndexType::getNbChildrenPerCell()> positionsOfChildren;
+        const long int nbChildren = static_cast<long int>(inChildren.size());
+        assert(nbChildren <= spaceSystem.getNbChildrenPerCell());
+
+        for(long int idxChild = 0 ; idxChild < nbChildren ; ++idxChild){
+            const auto& child = inChildren[idxChild];
+            assert(spaceSystem.getParentIndex(child.first->getCellSpacialIndex(child.second)) == inUpperGroup.getCellSpacialIndex(inIdxParent));
+            children.emplace_back(child.first->getCellLocal(child.second));
+            positionsOfChildren[idxChild] = spaceSystem.childPositionFromParent(child.first->getCellSpacialIndex(child.second));
+        }
+
+        if(nbChildren){
+            inKernel.L2L(inUpperGroup.getCellSymbData(inIdxParent),
+                         inLevel, inUpperGroup.getCellLocal(inIdxParent), children,
+                         positionsOfChildren.data(), nbChildren);
+        }
+    }
+
+    template <class KernelClass, class CellGroupClass, class ParticleGroupClass>
+    void L2PForLeaf(const long int inLevel, KernelClass& inKernel, const CellGroupClass& inCellGroup, const long int inIdxCell,
+                    ParticleGroupClass& inParticleGroup, const long int inIdxLeaf) const {
+        assert(inParticleGroup.getLeafSpacialIndex(inIdxLeaf) == inCellGroup.getCellSpacialIndex(inIdxCell));
+        using SymbDataType = typename std::decay<decltype(inCellGroup.getCellSymbData(inIdxCell))>::type;
+        const TbfAdaptiveLeafSymbData<SymbDataType> symbData(inCellGroup.getCellSymbData(inIdxCell), inLevel);
+        const auto& particlesData = TbfUtils::make_const(inParticleGroup).getParticleData(inIdxLeaf);
+        auto&& particlesRhs = inParticleGroup.getParticleRhs(inIdxLeaf);
+        inKernel.L2P(symbData, inCellGroup.getCellLocal(inIdxCell),
+                     inParticleGroup.getParticleIndexes(inIdxLeaf),
+                     particlesData, particlesRhs,
+                     inParticleGroup.getNbParticlesInLeaf(inIdxLeaf));
+    }
+
+    // The leaves can be at different levels, in this case inArrayIndexSrc is -1
+    template <class KernelClass, class ParticleGroupClass>
+    void P2PBetweenLeaves(KernelClass& inKernel, ParticleGroupClass& inSrcGroup, const long int inIdxSrcLeaf,
+                          ParticleGroupClass& inTargetGroup, const long int inIdxTargetLeaf,
+                          const long int inArrayIndexSrc) const {
+        const auto& srcData = TbfUtils::make_const(inSrcGroup).getParticleData(inIdxSrcLeaf);
+        auto&& srcRhs = inSrcGroup.getParticleRhs(inIdxSrcLeaf);
+        auto&& targetRhs = inTargetGroup.getParticleRhs(inIdxTargetLeaf);
+        const auto& targetData = TbfUtils::make_const(inTargetGroup).getParticleData(inIdxTargetLeaf);
+
+        inKernel.P2P(inSrcGroup.getLeafSymbData(inIdxSrcLeaf),
+                     inSrcGroup.getParticleIndexes(inIdxSrcLeaf),
+                     srcData, srcRhs,
+                     inSrcGroup.getNbParticlesInLeaf(inIdxSrcLeaf),
+                     inTargetGroup.getLeafSymbData(inIdxTargetLeaf),
+                     inTargetGroup.getParticleIndexes(inIdxTargetLeaf), targetData,
+                     targetRhs, inTargetGroup.getNbParticlesInLeaf(inIdxTargetLeaf),
+                     inArrayIndexSrc);
+    }
+
+    // Multipole of a cell (from the W list of a leaf) applied to the particles of the leaf
+    template <class KernelClass, class CellGroupClass, class ParticleGroupClass>
+    void M2P(const long int inLevel, KernelClass& inKernel, const CellGroupClass& inCellGroup, const long int inIdxCell,
+             ParticleGroupClass& inParticleGroup, const long int inIdxLeaf) const {
+        const auto& particlesData = TbfUtils::make_const(inParticleGroup).getParticleData(inIdxLeaf);
+        auto&& particlesRhs = inParticleGroup.getParticleRhs(inIdxLeaf);
+        inKernel.M2P(inCellGroup.getCellSymbData(inIdxCell), inLevel, inCellGroup.getCellMultipole(inIdxCell),
+                     inParticleGroup.getLeafSymbData(inIdxLeaf), inParticleGroup.getParticleIndexes(inIdxLeaf),
+                     particlesData, particlesRhs, inParticleGroup.getNbParticlesInLeaf(inIdxLeaf));
+    }
+
+    // Particles of a leaf applied to the local of a cell (from the X list of the cell)
+    template <class KernelClass, class ParticleGroupClass, class CellGroupClass>
+    void P2L(const long int inLevel, KernelClass& inKernel, const ParticleGroupClass& inParticleGroup, const long int inIdxLeaf,
+             CellGroupClass& inCellGroup, const long int inIdxCell) const {
+        const auto& particlesData = inParticleGroup.getParticleData(inIdxLeaf);
+        inKernel.P2L(inParticleGroup.getLeafSymbData(inIdxLeaf), inParticleGroup.getParticleIndexes(inIdxLeaf),
+                     particlesData, inParticleGroup.getNbParticlesInLeaf(inIdxLeaf),
+                     TbfUtils::make_const(inCellGroup).getCellSymbData(inIdxCell), inLevel, inCellGroup.getCellLocal(inIdxCell));
+    }
+
+private:
+    template <class KernelClass, class CellGroupClass, class ParticleGroupClass,
+              class ParticleRhsType = decltype(std::declval<ParticleGroupClass&>().getParticleRhs(0))>
+    static auto TestM2PAndP2L(int) -> decltype(std::declval<KernelClass&>().M2P(std::declval<const CellGroupClass&>().getCellSymbData(0), 0L,
+                                                                                std::declval<const CellGroupClass&>().getCellMultipole(0),
+                                                                                std::declval<const ParticleGroupClass&>().getLeafSymbData(0),
+                                                                                std::declval<const ParticleGroupClass&>().getParticleIndexes(0),
+                                                                                std::declval<const ParticleGroupClass&>().getParticleData(0),
+                                                                                std::declval<ParticleRhsType&>(), 0L),
+                                               std::declval<KernelClass&>().P2L(std::declval<const ParticleGroupClass&>().getLeafSymbData(0),
+                                                                                std::declval<const ParticleGroupClass&>().getParticleIndexes(0),
+                                                                                std::declval<const ParticleGroupClass&>().getParticleData(0), 0L,
+                                                                                std::declval<const CellGroupClass&>().getCellSymbData(0), 0L,
+                                                                                std::declval<CellGroupClass&>().getCellLocal(0)),
+                                               std::true_type());
+
+    template <class KernelClass, class CellGroupClass, class ParticleGroupClass>
+    static std::false_type TestM2PAndP2L(...);
+
+public:
+    // The M2P and P2L are optional in the kernels
+    template <class KernelClass, class CellGroupClass, class ParticleGroupClass>
+    static constexpr bool KernelHasM2PAndP2L(){
+        return decltype(TestM2PAndP2L<KernelClass, CellGroupClass, ParticleGroupClass>(0))::value;
+    }
 };
 
 #endif
@@ -6,6 +6,12 @@
 #include "../sequential/tbfgroupkernelinterface.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/tbfcriticalpathpriorities.hpp"
+#include "algorithms/tbftasktracer.hpp"
+#include "algorithms/tbftaskgraph.hpp"
+#include "core/tbfinteraction.hpp"
+#include "utils/tbfparallel.hpp"
+#include "core/tbfinteractionplan.hpp"
 
 #include <Runtimes/SpRuntime.hpp>
 
@@ -30,7 +36,23 @@ protected:
     TbfGroupKernelInterface<SpaceIndexType> kernelWrapper;
     std::vector<KernelClass> kernels;
 
-    TbfAlgorithmUtils::TbfOperationsPriorities priorities;
+    // The fixed priorities, or the ones of the critical path if enabled
+    TbfCriticalPathPriorities priorities;
+
+    // Records the tasks if enabled
+    TbfTaskTracer tracer;
+
+    // Records the task graph of the last execution if enabled
+    TbfTaskGraph taskGraph;
+
+    // The interaction lists used by the tasks (the tasks have a view on them)
+    TbfAlgorithmUtils::TbfTaskDataPool<std::vector<TbfXtoXInteraction<typename SpaceIndexType::IndexType>>> interactionsPool;
+
+    // The interaction lists computed in parallel before the M2L/P2P tasks are created
+    TbfAlgorithmUtils::TbfInteractionListsCache<typename SpaceIndexType::IndexType> interactionLists;
+
+    // If true, the M2L and P2P use the interaction plan of the tree
+    bool useInteractionPlan;
 
     template <class TreeClass>
     void P2M(SpRuntime<>& runtime, TreeClass& inTree){
@@ -52,9 +74,19 @@ protected:
                        && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
                 auto& leafGroupObj = *currentLeafGroup;
                 const auto& particleGroupObj = *currentParticleGroup;
-                runtime.task(SpPriority(priorities.getP2MPriority()), SpRead(*particleGroupObj.getDataPtr()), SpCommuteWrite(*leafGroupObj.getMultipolePtr()),
-                                   [this, &leafGroupObj, &particleGroupObj](const unsigned char&, unsigned char&){
-                    kernelWrapper.P2M(kernels[SpUtils::GetThreadId()-1], particleGroupObj, leafGroupObj);
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  particleGroupObj.getNbParticles(), leafGroupObj.getNbCells(), 0,
+                                                                  priorities.getP2MPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(*particleGroupObj.getDataPtr()), TbfTaskGraph::CommuteWrite(*leafGroupObj.getMultipolePtr())});
+                runtime.task(SpPriority(priorities.getP2MPriority(idxGroup)), SpRead(*particleGroupObj.getDataPtr()), SpCommuteWrite(*leafGroupObj.getMultipolePtr()),
+                                   [this, graphNode, idxGroup, &leafGroupObj, &particleGroupObj, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         particleGroupObj.getNbParticles(), leafGroupObj.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageP2M, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.P2M(kernels[SpUtils::GetThreadId()-1], particleGroupObj, leafGroupObj);
+                    });
                 });
                 ++currentParticleGroup;
                 ++currentLeafGroup;
@@ -80,9 +112,20 @@ protected:
 
                 auto& upperGroup = *currentUpperGroup;
                 const auto& lowerGroup = *currentLowerGroup;
-                runtime.task(SpPriority(priorities.getM2MPriority(idxLevel)), SpRead(*lowerGroup.getMultipolePtr()), SpCommuteWrite(*upperGroup.getMultipolePtr()),
-                                   [this, idxLevel, &upperGroup, &lowerGroup](const unsigned char&, unsigned char&){
-                    kernelWrapper.M2M(idxLevel, kernels[SpUtils::GetThreadId()-1], lowerGroup, upperGroup);
+                const long int idxUpperGroup = std::distance(upperCellGroup.begin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.cbegin(), currentLowerGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                                  lowerGroup.getNbCells(), upperGroup.getNbCells(), 0,
+                                                                  priorities.getM2MPriority(idxLevel, idxUpperGroup),
+                                                                  {TbfTaskGraph::Read(*lowerGroup.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*upperGroup.getMultipolePtr())});
+                runtime.task(SpPriority(priorities.getM2MPriority(idxLevel, idxUpperGroup)), SpRead(*lowerGroup.getMultipolePtr()), SpCommuteWrite(*upperGroup.getMultipolePtr()),
+                                   [this, graphNode, idxLevel, idxUpperGroup, idxLowerGroup, &upperGroup, &lowerGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                         lowerGroup.getNbCells(), upperGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageM2M, idxLevel, idxUpperGroup, [&](){
+                        kernelWrapper.M2M(idxLevel, kernels[SpUtils::GetThreadId()-1], lowerGroup, upperGroup);
+                    });
                 });
 
                 if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
@@ -100,8 +143,6 @@ protected:
 
     template <class TreeClass>
     void M2L(SpRuntime<>& runtime, TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
-
         for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
             auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
 
@@ -109,21 +150,41 @@ protected:
             const auto endCellGroup = cellGroups.end();
 
             while(currentCellGroup != endCellGroup){
-                auto indexesForGroup = spacialSystem.getInteractionListForBlock(*currentCellGroup, idxLevel);
-                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), cellGroups, std::distance(cellGroups.begin(),currentCellGroup),
+                const long int idxGroup = std::distance(cellGroups.begin(), currentCellGroup);
+                auto& indexesForGroup = interactionLists.getM2LLists(idxLevel, idxGroup);
+                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), cellGroups, idxGroup,
                                                [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
                     assert(&groupTarget == &*currentCellGroup);
 
-                    runtime.task(SpPriority(priorities.getM2LPriority(idxLevel)), SpRead(*groupSrc.getMultipolePtr()), SpCommuteWrite(*groupTarget.getLocalPtr()),
-                                       [this, idxLevel, indexesVec = indexes.toStdVector(), &groupSrc, &groupTarget](const unsigned char&, unsigned char&){
-                        kernelWrapper.M2LBetweenGroups(idxLevel, kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, std::move(indexesVec));
+                    TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, static_cast<long int>(&groupSrc - cellGroups.data()), idxGroup,
+                                                                      groupSrc.getNbCells(), groupTarget.getNbCells(), static_cast<long int>(indexes.size()),
+                                                                      priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                      {TbfTaskGraph::Read(*groupSrc.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*groupTarget.getLocalPtr())});
+                    runtime.task(SpPriority(priorities.getM2LPriority(idxLevel, idxGroup)), SpRead(*groupSrc.getMultipolePtr()), SpCommuteWrite(*groupTarget.getLocalPtr()),
+                                       [this, graphNode, idxLevel, idxGroup, idxSrcGroup = static_cast<long int>(&groupSrc - cellGroups.data()),
+                                        indexesView = indexes, &groupSrc, &groupTarget, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                        const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxSrcGroup, idxGroup,
+                                                             groupSrc.getNbCells(), groupTarget.getNbCells(), traceSubmitTime);
+                        const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                        priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                            kernelWrapper.M2LBetweenGroups(idxLevel, kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, indexesView);
+                        });
                     });
                 });
 
                 auto& currentGroup = *currentCellGroup;
-                runtime.task(SpPriority(priorities.getM2LPriority(idxLevel)), SpRead(*currentGroup.getMultipolePtr()), SpCommuteWrite(*currentGroup.getLocalPtr()),
-                                   [this, idxLevel, indexesForGroup_first = std::move(indexesForGroup.first), &currentGroup](const unsigned char&, unsigned char&){
-                    kernelWrapper.M2LInGroup(idxLevel, kernels[SpUtils::GetThreadId()-1], currentGroup, indexesForGroup_first);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                                  currentGroup.getNbCells(), currentGroup.getNbCells(), static_cast<long int>(indexesForGroup.first.size()),
+                                                                  priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                  {TbfTaskGraph::Read(*currentGroup.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getLocalPtr())});
+                runtime.task(SpPriority(priorities.getM2LPriority(idxLevel, idxGroup)), SpRead(*currentGroup.getMultipolePtr()), SpCommuteWrite(*currentGroup.getLocalPtr()),
+                                   [this, graphNode, idxLevel, idxGroup, indexesForGroup_first = &interactionsPool.store(std::move(indexesForGroup.first)), &currentGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                         currentGroup.getNbCells(), currentGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                        kernelWrapper.M2LInGroup(idxLevel, kernels[SpUtils::GetThreadId()-1], currentGroup, *indexesForGroup_first);
+                    });
                 });
 
                 ++currentCellGroup;
@@ -131,6 +192,53 @@ protected:
         }
     }
 
+    template <class TreeClass>
+    void M2LWithPlan(SpRuntime<>& runtime, TreeClass& inTree, const TbfInteractionPlan& inInteractionPlan){
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
+            auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(cellGroups)) ; ++idxGroup){
+                auto& currentGroup = cellGroups[idxGroup];
+
+                const auto blocks = inInteractionPlan.getM2LBlocksBetweenGroups(idxLevel, idxGroup);
+                for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                    const auto block = blocks[idxBlock];
+                    const auto& groupSrc = cellGroups[block.idxSrcGroup];
+
+                    TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, block.idxSrcGroup, idxGroup,
+                                                                      groupSrc.getNbCells(), currentGroup.getNbCells(), block.nbInteractions,
+                                                                      priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                      {TbfTaskGraph::Read(*groupSrc.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getLocalPtr())});
+                    runtime.task(SpPriority(priorities.getM2LPriority(idxLevel, idxGroup)), SpRead(*groupSrc.getMultipolePtr()), SpCommuteWrite(*currentGroup.getLocalPtr()),
+                                       [this, graphNode, idxLevel, idxGroup, block, &inInteractionPlan, &groupSrc, &currentGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                        const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, block.idxSrcGroup, idxGroup,
+                                                             groupSrc.getNbCells(), currentGroup.getNbCells(), traceSubmitTime);
+                        const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                        priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                            kernelWrapper.M2LFromPlan(idxLevel, kernels[SpUtils::GetThreadId()-1], currentGroup, groupSrc,
+                                                      inInteractionPlan.getM2LInteractions(idxLevel, block));
+                        });
+                    });
+                }
+
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                                  currentGroup.getNbCells(), currentGroup.getNbCells(), inInteractionPlan.getM2LInteractionsInGroup(idxLevel, idxGroup).size(),
+                                                                  priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                  {TbfTaskGraph::Read(*currentGroup.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getLocalPtr())});
+                runtime.task(SpPriority(priorities.getM2LPriority(idxLevel, idxGroup)), SpRead(*currentGroup.getMultipolePtr()), SpCommuteWrite(*currentGroup.getLocalPtr()),
+                                   [this, graphNode, idxLevel, idxGroup, &inInteractionPlan, &currentGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                         currentGroup.getNbCells(), currentGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                        kernelWrapper.M2LFromPlan(idxLevel, kernels[SpUtils::GetThreadId()-1], currentGroup, TbfUtils::make_const(currentGroup),
+                                                  inInteractionPlan.getM2LInteractionsInGroup(idxLevel, idxGroup));
+                    });
+                });
+            }
+        }
+    }
+
     template <class TreeClass>
     void L2L(SpRuntime<>& runtime, TreeClass& inTree){
         for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
@@ -149,9 +257,20 @@ protected:
 
                 const auto& upperGroup = *currentUpperGroup;
                 auto& lowerGroup = *currentLowerGroup;
-                runtime.task(SpPriority(priorities.getL2LPriority(idxLevel)), SpRead(*upperGroup.getLocalPtr()), SpCommuteWrite(*lowerGroup.getLocalPtr()),
-                                   [this, idxLevel, &upperGroup, &lowerGroup](const unsigned char&, unsigned char&){
-                    kernelWrapper.L2L(idxLevel, kernels[SpUtils::GetThreadId()-1], upperGroup, lowerGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.begin(), currentLowerGroup);
+                const long int idxUpperGroup = std::distance(upperCellGroup.cbegin(), currentUpperGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                                  upperGroup.getNbCells(), lowerGroup.getNbCells(), 0,
+                                                                  priorities.getL2LPriority(idxLevel, idxLowerGroup),
+                                                                  {TbfTaskGraph::Read(*upperGroup.getLocalPtr()), TbfTaskGraph::CommuteWrite(*lowerGroup.getLocalPtr())});
+                runtime.task(SpPriority(priorities.getL2LPriority(idxLevel, idxLowerGroup)), SpRead(*upperGroup.getLocalPtr()), SpCommuteWrite(*lowerGroup.getLocalPtr()),
+                                   [this, graphNode, idxLevel, idxLowerGroup, idxUpperGroup, &upperGroup, &lowerGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                         upperGroup.getNbCells(), lowerGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageL2L, idxLevel, idxLowerGroup, [&](){
+                        kernelWrapper.L2L(idxLevel, kernels[SpUtils::GetThreadId()-1], upperGroup, lowerGroup);
+                    });
                 });
 
                 if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
@@ -188,10 +307,20 @@ protected:
 
                 const auto& leafGroupObj = *currentLeafGroup;
                 auto& particleGroupObj = *currentParticleGroup;
-                runtime.task(SpPriority(priorities.getL2PPriority()), SpRead(*leafGroupObj.getLocalPtr()),
+                const long int idxGroup = std::distance(particleGroups.begin(), currentParticleGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  leafGroupObj.getNbCells(), particleGroupObj.getNbParticles(), 0,
+                                                                  priorities.getL2PPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(*leafGroupObj.getLocalPtr()), TbfTaskGraph::Read(*particleGroupObj.getDataPtr()), TbfTaskGraph::CommuteWrite(*particleGroupObj.getRhsPtr())});
+                runtime.task(SpPriority(priorities.getL2PPriority(idxGroup)), SpRead(*leafGroupObj.getLocalPtr()),
                              SpRead(*particleGroupObj.getDataPtr()), SpCommuteWrite(*particleGroupObj.getRhsPtr()),
-                                   [this, &leafGroupObj, &particleGroupObj](const unsigned char&, const unsigned char&, unsigned char&){
-                    kernelWrapper.L2P(kernels[SpUtils::GetThreadId()-1], leafGroupObj, particleGroupObj);
+                                   [this, graphNode, idxGroup, &leafGroupObj, &particleGroupObj, traceSubmitTime = tracer.now()](const unsigned char&, const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         leafGroupObj.getNbCells(), particleGroupObj.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageL2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.L2P(kernels[SpUtils::GetThreadId()-1], leafGroupObj, particleGroupObj);
+                    });
                 });
 
                 ++currentParticleGroup;
@@ -202,40 +331,113 @@ protected:
 
     template <class TreeClass>
     void P2P(SpRuntime<>& runtime, TreeClass& inTree){
-        const auto& spacialSystem = inTree.getSpacialSystem();
-
         auto& particleGroups = inTree.getParticleGroups();
 
         auto currentParticleGroup = particleGroups.begin();
         const auto endParticleGroup = particleGroups.end();
 
         while(currentParticleGroup != endParticleGroup){
+            const long int idxGroup = std::distance(particleGroups.begin(), currentParticleGroup);
 
-            auto indexesForGroup = spacialSystem.getNeighborListForBlock(*currentParticleGroup, configuration.getTreeHeight()-1, true);
-            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), particleGroups, std::distance(particleGroups.begin(), currentParticleGroup),
+            auto& indexesForGroup = interactionLists.getP2PLists(idxGroup);
+            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), particleGroups, idxGroup,
                                            [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
                 assert(&groupTarget == &*currentParticleGroup);
 
-                runtime.task(SpPriority(priorities.getP2PPriority()), SpRead(*groupSrc.getDataPtr()), SpCommuteWrite(*groupSrc.getRhsPtr()),
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, static_cast<long int>(&groupSrc - particleGroups.data()), idxGroup,
+                                                                  groupSrc.getNbParticles(), groupTarget.getNbParticles(), static_cast<long int>(indexes.size()),
+                                                                  priorities.getP2PPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(*groupSrc.getDataPtr()), TbfTaskGraph::CommuteWrite(*groupSrc.getRhsPtr()), TbfTaskGraph::Read(*groupTarget.getDataPtr()), TbfTaskGraph::CommuteWrite(*groupTarget.getRhsPtr())});
+                runtime.task(SpPriority(priorities.getP2PPriority(idxGroup)), SpRead(*groupSrc.getDataPtr()), SpCommuteWrite(*groupSrc.getRhsPtr()),
                              SpRead(*groupTarget.getDataPtr()), SpCommuteWrite(*groupTarget.getRhsPtr()),
-                                   [this, indexesVec = indexes.toStdVector(), &groupSrc, &groupTarget](const unsigned char&, unsigned char&, const unsigned char&, unsigned char&){
-                    kernelWrapper.P2PBetweenGroups(kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, std::move(indexesVec));
+                                   [this, graphNode, idxGroup, idxSrcGroup = static_cast<long int>(&groupSrc - particleGroups.data()),
+                                    indexesView = indexes, &groupSrc, &groupTarget, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&, const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxSrcGroup, idxGroup,
+                                                         groupSrc.getNbParticles(), groupTarget.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.P2PBetweenGroups(kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, indexesView);
+                    });
                 });
 
             });
 
             auto& currentGroup = *currentParticleGroup;
-            runtime.task(SpPriority(priorities.getP2PPriority()), SpRead(*currentGroup.getDataPtr()),SpCommuteWrite(*currentGroup.getRhsPtr()),
-                               [this, indexesForGroup_first = std::move(indexesForGroup.first), &currentGroup](const unsigned char&, unsigned char&){
-                kernelWrapper.P2PInGroup(kernels[SpUtils::GetThreadId()-1], currentGroup, indexesForGroup_first);
-
-                kernelWrapper.P2PInner(kernels[SpUtils::GetThreadId()-1], currentGroup);
+            TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                              currentGroup.getNbParticles(), currentGroup.getNbParticles(), static_cast<long int>(indexesForGroup.first.size()) + currentGroup.getNbLeaves(),
+                                                              priorities.getP2PPriority(idxGroup),
+                                                              {TbfTaskGraph::Read(*currentGroup.getDataPtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getRhsPtr())});
+            runtime.task(SpPriority(priorities.getP2PPriority(idxGroup)), SpRead(*currentGroup.getDataPtr()),SpCommuteWrite(*currentGroup.getRhsPtr()),
+                               [this, graphNode, idxGroup, indexesForGroup_first = &interactionsPool.store(std::move(indexesForGroup.first)), &currentGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                     currentGroup.getNbParticles(), currentGroup.getNbParticles(), traceSubmitTime);
+                const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                    kernelWrapper.P2PInGroup(kernels[SpUtils::GetThreadId()-1], currentGroup, *indexesForGroup_first);
+
+                    kernelWrapper.P2PInner(kernels[SpUtils::GetThreadId()-1], currentGroup);
+                });
             });
 
             ++currentParticleGroup;
         }
     }
 
+    template <class TreeClass>
+    void P2PWithPlan(SpRuntime<>& runtime, TreeClass& inTree, const TbfInteractionPlan& inInteractionPlan){
+        auto& particleGroups = inTree.getParticleGroups();
+
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            auto& currentGroup = particleGroups[idxGroup];
+
+            const auto blocks = inInteractionPlan.getP2PBlocksBetweenGroups(idxGroup);
+            for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                const auto block = blocks[idxBlock];
+                auto& groupSrc = particleGroups[block.idxSrcGroup];
+
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, block.idxSrcGroup, idxGroup,
+                                                                  groupSrc.getNbParticles(), currentGroup.getNbParticles(), block.nbInteractions,
+                                                                  priorities.getP2PPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(*groupSrc.getDataPtr()), TbfTaskGraph::CommuteWrite(*groupSrc.getRhsPtr()), TbfTaskGraph::Read(*currentGroup.getDataPtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getRhsPtr())});
+                runtime.task(SpPriority(priorities.getP2PPriority(idxGroup)), SpRead(*groupSrc.getDataPtr()), SpCommuteWrite(*groupSrc.getRhsPtr()),
+                             SpRead(*currentGroup.getDataPtr()), SpCommuteWrite(*currentGroup.getRhsPtr()),
+                                   [this, graphNode, idxGroup, block, &inInteractionPlan, &groupSrc, &currentGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&, const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, block.idxSrcGroup, idxGroup,
+                                                         groupSrc.getNbParticles(), currentGroup.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.P2PFromPlan(kernels[SpUtils::GetThreadId()-1], currentGroup, groupSrc, inInteractionPlan.getP2PInteractions(block));
+                    });
+                });
+            }
+
+            TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                              currentGroup.getNbParticles(), currentGroup.getNbParticles(), inInteractionPlan.getP2PInteractionsInGroup(idxGroup).size() + currentGroup.getNbLeaves(),
+                                                              priorities.getP2PPriority(idxGroup),
+                                                              {TbfTaskGraph::Read(*currentGroup.getDataPtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getRhsPtr())});
+            runtime.task(SpPriority(priorities.getP2PPriority(idxGroup)), SpRead(*currentGroup.getDataPtr()),SpCommuteWrite(*currentGroup.getRhsPtr()),
+                               [this, graphNode, idxGroup, &inInteractionPlan, &currentGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                     currentGroup.getNbParticles(), currentGroup.getNbParticles(), traceSubmitTime);
+                const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                    kernelWrapper.P2PFromPlan(kernels[SpUtils::GetThreadId()-1], currentGroup, currentGroup, inInteractionPlan.getP2PInteractionsInGroup(idxGroup));
+
+                    kernelWrapper.P2PInner(kernels[SpUtils::GetThreadId()-1], currentGroup);
+                });
+            });
+        }
+    }
+
+    template <class TreeClass>
+    void computeInteractionLists(TreeClass& inTree, const int inOperationToProceed){
+        // The P2M/M2M tasks are executed by the runtime in the meantime
+        interactionLists.compute(inTree, stopUpperLevel, inOperationToProceed & TbfAlgorithmUtils::TbfM2L, inOperationToProceed & TbfAlgorithmUtils::TbfP2P,
+                                 [](const long int inNbJobs, auto&& inFunc){
+            TbfParallel::ParallelFor(0, inNbJobs, TbfParallel::GetNbThreads(), inFunc);
+        });
+    }
+
     void increaseNumberOfKernels(const int inNbThreads){
         for(long int idxThread = kernels.size() ; idxThread < inNbThreads ; ++idxThread){
             kernels.emplace_back(kernels[0]);
@@ -246,7 +448,7 @@ public:
     explicit TbfSmSpetabaruAlgorithm(const SpacialConfiguration& inConfiguration, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), useInteractionPlan(false){
         kernels.emplace_back(configuration);
     }
 
@@ -256,38 +458,95 @@ public:
     TbfSmSpetabaruAlgorithm(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inStopUpperLevel = TbfDefaultLastLevel)
         : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
           kernelWrapper(configuration),
-          priorities(configuration.getTreeHeight()){
+          priorities(configuration.getTreeHeight()), useInteractionPlan(false){
         kernels.emplace_back(std::forward<SourceKernelClass>(inKernel));
     }
 
+    // The interaction lists of the M2L/P2P are computed once and kept in the tree (see TbfTree::getInteractionPlan),
+    // the tasks then use the plan directly instead of a copy of their interactions
+    void setUseInteractionPlan(const bool inUseInteractionPlan){
+        useInteractionPlan = inUseInteractionPlan;
+    }
+
+    bool getUseInteractionPlan() const{
+        return useInteractionPlan;
+    }
+
+    // The priorities of the tasks are computed from the critical path of the task graph
+    // (see TbfCriticalPathPriorities), instead of the type of the operators and the level
+    void setUseCriticalPathPriorities(const bool inUseCriticalPathPriorities){
+        priorities.setEnabled(inUseCriticalPathPriorities);
+    }
+
+    bool getUseCriticalPathPriorities() const{
+        return priorities.getEnabled();
+    }
+
+    TbfCriticalPathPriorities& getCriticalPathPriorities(){
+        return priorities;
+    }
+
+    // The tasks are recorded when the tracer is enabled (see TbfTaskTracer)
+    TbfTaskTracer& getTaskTracer(){
+        return tracer;
+    }
+
+    // The task graph of the last execution is recorded when it is enabled (see TbfTaskGraph)
+    TbfTaskGraph& getTaskGraph(){
+        return taskGraph;
+    }
+
     template <class TreeClass>
     void execute(TreeClass& inTree, const int inOperationToProceed = TbfAlgorithmUtils::TbfOperations::TbfNearAndFarFields){
         assert(configuration == inTree.getSpacialConfiguration());
 
+        const TbfInteractionPlan* interactionPlan = (useInteractionPlan ? &inTree.getInteractionPlan() : nullptr);
+
         SpRuntime runtime;
 
         increaseNumberOfKernels(runtime.getNbThreads());
 
+        if(taskGraph.getEnabled()){
+            taskGraph.clear();
+        }
+
+        priorities.update(inTree, stopUpperLevel, inOperationToProceed);
+
         if(inOperationToProceed & TbfAlgorithmUtils::TbfP2M){
             P2M(runtime, inTree);
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfM2M){
             M2M(runtime, inTree);
         }
+        if(interactionPlan == nullptr && (inOperationToProceed & (TbfAlgorithmUtils::TbfM2L | TbfAlgorithmUtils::TbfP2P))){
+            computeInteractionLists(inTree, inOperationToProceed);
+        }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
-            M2L(runtime, inTree);
+            if(interactionPlan){
+                M2LWithPlan(runtime, inTree, *interactionPlan);
+            }
+            else{
+                M2L(runtime, inTree);
+            }
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfL2L){
             L2L(runtime, inTree);
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfP2P){
-            P2P(runtime, inTree);
+            if(interactionPlan){
+                P2PWithPlan(runtime, inTree, *interactionPlan);
+            }
+            else{
+                P2P(runtime, inTree);
+            }
         }
         if(inOperationToProceed & TbfAlgorithmUtils::TbfL2P){
             L2P(runtime, inTree);
         }
 
         runtime.waitAllTasks();
+
+        interactionsPool.reset();
     }
 
     template <class FuncType>
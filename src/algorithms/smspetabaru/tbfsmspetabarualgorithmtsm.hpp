@@ -6,6 +6,9 @@
 #include "../sequential/tbfgroupkernelinterface.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
 #include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/tbftasktracer.hpp"
+#include "algorithms/tbftaskgraph.hpp"
+#include "core/tbfinteraction.hpp"
 
 #include <Runtimes/SpRuntime.hpp>
 
@@ -32,6 +35,15 @@ protected:
 
     TbfAlgorithmUtils::TbfOperationsPriorities priorities;
 
+    // Records the tasks if enabled
+    TbfTaskTracer tracer;
+
+    // Records the task graph of the last execution if enabled
+    TbfTaskGraph taskGraph;
+
+    // The interaction lists used by the tasks (the tasks have a view on them)
+    TbfAlgorithmUtils::TbfTaskDataPool<std::vector<TbfXtoXInteraction<typename SpaceIndexType::IndexType>>> interactionsPool;
+
     template <class TreeClass>
     void P2M(SpRuntime<>& runtime, TreeClass& inTree){
         if(configuration.getTreeHeight() > 2){
@@ -52,8 +64,16 @@ protected:
                        && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
                 auto& leafGroupObj = *currentLeafGroup;
                 const auto& particleGroupObj = *currentParticleGroup;
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  particleGroupObj.getNbParticles(), leafGroupObj.getNbCells(), 0,
+                                                                  priorities.getP2MPriority(),
+                                                                  {TbfTaskGraph::Read(*particleGroupObj.getDataPtr()), TbfTaskGraph::CommuteWrite(*leafGroupObj.getMultipolePtr())});
                 runtime.task(SpPriority(priorities.getP2MPriority()), SpRead(*particleGroupObj.getDataPtr()), SpCommuteWrite(*leafGroupObj.getMultipolePtr()),
-                                   [this, &leafGroupObj, &particleGroupObj](const unsigned char&, unsigned char&){
+                                   [this, graphNode, idxGroup, &leafGroupObj, &particleGroupObj, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         particleGroupObj.getNbParticles(), leafGroupObj.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
                     kernelWrapper.P2M(kernels[SpUtils::GetThreadId()-1], particleGroupObj, leafGroupObj);
                 });
                 ++currentParticleGroup;
@@ -80,8 +100,17 @@ protected:
 
                 auto& upperGroup = *currentUpperGroup;
                 const auto& lowerGroup = *currentLowerGroup;
+                const long int idxUpperGroup = std::distance(upperCellGroup.begin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.cbegin(), currentLowerGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                                  lowerGroup.getNbCells(), upperGroup.getNbCells(), 0,
+                                                                  priorities.getM2MPriority(idxLevel),
+                                                                  {TbfTaskGraph::Read(*lowerGroup.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*upperGroup.getMultipolePtr())});
                 runtime.task(SpPriority(priorities.getM2MPriority(idxLevel)), SpRead(*lowerGroup.getMultipolePtr()), SpCommuteWrite(*upperGroup.getMultipolePtr()),
-                                   [this, idxLevel, &upperGroup, &lowerGroup](const unsigned char&, unsigned char&){
+                                   [this, graphNode, idxLevel, idxUpperGroup, idxLowerGroup, &upperGroup, &lowerGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                         lowerGroup.getNbCells(), upperGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
                     kernelWrapper.M2M(idxLevel, kernels[SpUtils::GetThreadId()-1], lowerGroup, upperGroup);
                 });
 
@@ -115,14 +144,23 @@ protected:
                 indexesForGroup.second.reserve(std::size(indexesForGroup.first) + std::size(indexesForGroup.first));
                 indexesForGroup.second.insert(indexesForGroup.second.end(), indexesForGroup.first.begin(), indexesForGroup.first.end());
 
-                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), cellGroupsSource,
+                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), cellGroupsSource,
                                                           std::distance(cellGroupsTarget.begin(),currentCellGroup), cellGroupsTarget,
                                                [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
                     assert(&groupTarget == &*currentCellGroup);
 
+                    TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, static_cast<long int>(&groupSrc - cellGroupsSource.data()), static_cast<long int>(&groupTarget - cellGroupsTarget.data()),
+                                                                      groupSrc.getNbCells(), groupTarget.getNbCells(), static_cast<long int>(indexes.size()),
+                                                                      priorities.getM2LPriority(idxLevel),
+                                                                      {TbfTaskGraph::Read(*groupSrc.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*groupTarget.getLocalPtr())});
                     runtime.task(SpPriority(priorities.getM2LPriority(idxLevel)), SpRead(*groupSrc.getMultipolePtr()), SpCommuteWrite(*groupTarget.getLocalPtr()),
-                                       [this, idxLevel, indexesVec = indexes.toStdVector(), &groupSrc, &groupTarget](const unsigned char&, unsigned char&){
-                        kernelWrapper.M2LBetweenGroups(idxLevel, kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, std::move(indexesVec));
+                                       [this, graphNode, idxLevel, idxSrcGroup = static_cast<long int>(&groupSrc - cellGroupsSource.data()),
+                                        idxTargetGroup = static_cast<long int>(&groupTarget - cellGroupsTarget.data()),
+                                        indexesView = indexes, &groupSrc, &groupTarget, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                        const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxSrcGroup, idxTargetGroup,
+                                                             groupSrc.getNbCells(), groupTarget.getNbCells(), traceSubmitTime);
+                        const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                        kernelWrapper.M2LBetweenGroups(idxLevel, kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, indexesView);
                     });
                 });
 
@@ -149,8 +187,17 @@ protected:
 
                 const auto& upperGroup = *currentUpperGroup;
                 auto& lowerGroup = *currentLowerGroup;
+                const long int idxUpperGroup = std::distance(upperCellGroup.cbegin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.begin(), currentLowerGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                                  upperGroup.getNbCells(), lowerGroup.getNbCells(), 0,
+                                                                  priorities.getL2LPriority(idxLevel),
+                                                                  {TbfTaskGraph::Read(*upperGroup.getLocalPtr()), TbfTaskGraph::CommuteWrite(*lowerGroup.getLocalPtr())});
                 runtime.task(SpPriority(priorities.getL2LPriority(idxLevel)), SpRead(*upperGroup.getLocalPtr()), SpCommuteWrite(*lowerGroup.getLocalPtr()),
-                                   [this, idxLevel, &upperGroup, &lowerGroup](const unsigned char&, unsigned char&){
+                                   [this, graphNode, idxLevel, idxUpperGroup, idxLowerGroup, &upperGroup, &lowerGroup, traceSubmitTime = tracer.now()](const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                         upperGroup.getNbCells(), lowerGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
                     kernelWrapper.L2L(idxLevel, kernels[SpUtils::GetThreadId()-1], upperGroup, lowerGroup);
                 });
 
@@ -188,9 +235,17 @@ protected:
 
                 const auto& leafGroupObj = *currentLeafGroup;
                 auto& particleGroupObj = *currentParticleGroup;
+                const long int idxGroup = std::distance(particleGroups.begin(), currentParticleGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  leafGroupObj.getNbCells(), particleGroupObj.getNbParticles(), 0,
+                                                                  priorities.getL2PPriority(),
+                                                                  {TbfTaskGraph::Read(*leafGroupObj.getLocalPtr()), TbfTaskGraph::Read(*particleGroupObj.getDataPtr()), TbfTaskGraph::CommuteWrite(*particleGroupObj.getRhsPtr())});
                 runtime.task(SpPriority(priorities.getL2PPriority()), SpRead(*leafGroupObj.getLocalPtr()), SpRead(*particleGroupObj.getDataPtr()),
                              SpCommuteWrite(*particleGroupObj.getRhsPtr()),
-                                   [this, &leafGroupObj, &particleGroupObj](const unsigned char&, const unsigned char&, unsigned char&){
+                                   [this, graphNode, idxGroup, &leafGroupObj, &particleGroupObj, traceSubmitTime = tracer.now()](const unsigned char&, const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         leafGroupObj.getNbCells(), particleGroupObj.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
                     kernelWrapper.L2P(kernels[SpUtils::GetThreadId()-1], leafGroupObj, particleGroupObj);
                 });
 
@@ -219,15 +274,24 @@ protected:
             auto indexesForSelfGroup = spacialSystem.getSelfListForBlock(*currentParticleGroupTarget);
             indexesForGroup.second.insert(indexesForGroup.second.end(), indexesForSelfGroup.begin(), indexesForSelfGroup.end());
 
-            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), particleGroupsSource,
+            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), particleGroupsSource,
                                                       std::distance(particleGroupsTarget.begin(), currentParticleGroupTarget), particleGroupsTarget,
                                            [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
                 assert(&groupTarget == &*currentParticleGroupTarget);
 
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, static_cast<long int>(&groupSrc - particleGroupsSource.data()), static_cast<long int>(&groupTarget - particleGroupsTarget.data()),
+                                                                  groupSrc.getNbParticles(), groupTarget.getNbParticles(), static_cast<long int>(indexes.size()),
+                                                                  priorities.getP2PPriority(),
+                                                                  {TbfTaskGraph::Read(*groupSrc.getDataPtr()), TbfTaskGraph::Read(*groupTarget.getDataPtr()), TbfTaskGraph::CommuteWrite(*groupTarget.getRhsPtr())});
                 runtime.task(SpPriority(priorities.getP2PPriority()), SpRead(*groupSrc.getDataPtr()), SpRead(*groupTarget.getDataPtr()),
                              SpCommuteWrite(*groupTarget.getRhsPtr()),
-                                   [this, indexesVec = indexes.toStdVector(), &groupSrc, &groupTarget](const unsigned char&, const unsigned char&, unsigned char&){
-                    kernelWrapper.P2PBetweenGroupsTsm(kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, std::move(indexesVec));
+                                   [this, graphNode, idxSrcGroup = static_cast<long int>(&groupSrc - particleGroupsSource.data()),
+                                    idxTargetGroup = static_cast<long int>(&groupTarget - particleGroupsTarget.data()),
+                                    indexesView = indexes, &groupSrc, &groupTarget, traceSubmitTime = tracer.now()](const unsigned char&, const unsigned char&, unsigned char&){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxSrcGroup, idxTargetGroup,
+                                                         groupSrc.getNbParticles(), groupTarget.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    kernelWrapper.P2PBetweenGroupsTsm(kernels[SpUtils::GetThreadId()-1], groupTarget, groupSrc, indexesView);
                 });
 
             });
@@ -260,6 +324,16 @@ public:
         kernels.emplace_back(std::forward<SourceKernelClass>(inKernel));
     }
 
+    // The tasks are recorded when the tracer is enabled (see TbfTaskTracer)
+    TbfTaskTracer& getTaskTracer(){
+        return tracer;
+    }
+
+    // The task graph of the last execution is recorded when it is enabled (see TbfTaskGraph)
+    TbfTaskGraph& getTaskGraph(){
+        return taskGraph;
+    }
+
     template <class TreeClass>
     void execute(TreeClass& inTree, const int inOperationToProceed = TbfAlgorithmUtils::TbfOperations::TbfNearAndFarFields){
         assert(configuration == inTree.getSpacialConfiguration());
@@ -268,6 +342,10 @@ public:
 
         increaseNumberOfKernels(runtime.getNbThreads());
 
+        if(taskGraph.getEnabled()){
+            taskGraph.clear();
+        }
+
         if(inOperationToProceed & TbfAlgorithmUtils::TbfP2M){
             P2M(runtime, inTree);
         }
@@ -288,6 +366,8 @@ public:
         }
 
         runtime.waitAllTasks();
+
+        interactionsPool.reset();
     }
 
     template <class FuncType>
@@ -5,6 +5,8 @@
 
 #include "algorithms/sequential/tbfalgorithm.hpp"
 #include "algorithms/sequential/tbfalgorithmtsm.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithm.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithmtsm.hpp"
 #ifdef TBF_USE_SPETABARU
 #include "algorithms/smspetabaru/tbfsmspetabarualgorithm.hpp"
 #include "algorithms/smspetabaru/tbfsmspetabarualgorithmtsm.hpp"
@@ -14,25 +16,31 @@
 #include "algorithms/openmp/tbfopenmpalgorithmtsm.hpp"
 #endif
 
+// The std::thread runtime is used if no other parallel runtime is available,
+// or first if TBF_PREFER_THREADPOOL is defined
 struct TbfAlgorithmSelecter{
     template<typename RealType, class KernelClass, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
-#ifdef TBF_USE_SPETABARU
+#if defined(TBF_PREFER_THREADPOOL)
+    using type = TbfThreadPoolAlgorithm<RealType, KernelClass, SpaceIndexType>;
+#elif defined(TBF_USE_SPETABARU)
     using type = TbfSmSpetabaruAlgorithm<RealType, KernelClass, SpaceIndexType>;
 #elif defined(TBF_USE_OPENMP)
     using type = TbfOpenmpAlgorithm<RealType, KernelClass, SpaceIndexType>;
 #else
-    using type = TbfAlgorithm<RealType, KernelClass, SpaceIndexType>;
+    using type = TbfThreadPoolAlgorithm<RealType, KernelClass, SpaceIndexType>;
 #endif
 };
 
 struct TbfAlgorithmSelecterTsm{
     template<typename RealType, class KernelClass, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
-#ifdef TBF_USE_SPETABARU
+#if defined(TBF_PREFER_THREADPOOL)
+    using type = TbfThreadPoolAlgorithmTsm<RealType, KernelClass, SpaceIndexType>;
+#elif defined(TBF_USE_SPETABARU)
     using type = TbfSmSpetabaruAlgorithmTsm<RealType, KernelClass, SpaceIndexType>;
 #elif defined(TBF_USE_OPENMP)
     using type = TbfOpenmpAlgorithmTsm<RealType, KernelClass, SpaceIndexType>;
 #else
-    using type = TbfAlgorithmTsm<RealType, KernelClass, SpaceIndexType>;
+    using type = TbfThreadPoolAlgorithmTsm<RealType, KernelClass, SpaceIndexType>;
 #endif
 };
 
@@ -4,20 +4,29 @@
 #include "tbfglobal.hpp"
 
 #include "containers/tbfvectorview.hpp"
+#include "core/tbfinteraction.hpp"
 
 #include <cassert>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <utility>
 
 namespace TbfAlgorithmUtils{
 
 
+// The indexes are sorted in place, and the views given to inFunc refer to inIndexes
 template <class IndexContainerClass, class GroupContainerClassSource, class GroupContainerClassTarget, class FuncType>
-inline void TbfMapIndexesAndBlocks(IndexContainerClass inIndexes, GroupContainerClassSource& inGroups, const long int idxWorkingGroup,
+inline void TbfMapIndexesAndBlocks(IndexContainerClass&& inIndexes, GroupContainerClassSource& inGroups, const long int idxWorkingGroup,
                                     GroupContainerClassTarget& inGroupsTarget, FuncType&& inFunc){
     if(std::size(inIndexes) == 0 || std::size(inGroups) == 0){
         return;
     }
 
-    std::sort(std::begin(inIndexes), std::end(inIndexes), TbfXtoXInteraction<decltype (inIndexes[0].indexSrc)>::SrcFirst);
+    // The lists may have been sorted already (see TbfInteractionListsCache)
+    if(!std::is_sorted(std::begin(inIndexes), std::end(inIndexes), TbfXtoXInteraction<decltype (inIndexes[0].indexSrc)>::SrcFirst)){
+        std::sort(std::begin(inIndexes), std::end(inIndexes), TbfXtoXInteraction<decltype (inIndexes[0].indexSrc)>::SrcFirst);
+    }
 
     long int idxCurrentIndex = 0;
     long int idxCurrentGroup = 0;// TODO (idxWorkingGroup == 0 ? 1 : 0);
@@ -71,6 +80,147 @@ inline void TbfMapIndexesAndBlocks(IndexContainerClass&& inIndexes, GroupContain
                            std::forward<FuncType>(inFunc));
 }
 
+// The M2L/P2P interaction lists of all the groups (in the group, between groups), computed in parallel
+// before the creation of the tasks, such that the thread that creates the tasks only has to map them
+// to the groups. inParallelFor(nbJobs, func) must call func(idxJob) for all idxJob in [0, nbJobs[.
+template <class IndexType>
+class TbfInteractionListsCache {
+public:
+    using ListType = std::vector<TbfXtoXInteraction<IndexType>>;
+    using ListPairType = std::pair<ListType, ListType>;
+
+private:
+    std::vector<std::vector<ListPairType>> m2lLists;
+    std::vector<ListPairType> p2pLists;
+    // A job is (level, index of the group), the level is -1 for the P2P
+    std::vector<std::pair<long int, long int>> jobs;
+
+public:
+    template <class TreeClass, class ParallelForType>
+    void compute(const TreeClass& inTree, const long int inStopUpperLevel, const bool inComputeM2L, const bool inComputeP2P,
+                 ParallelForType&& inParallelFor){
+        const long int treeHeight = inTree.getSpacialConfiguration().getTreeHeight();
+
+        jobs.clear();
+        if(inComputeM2L){
+            m2lLists.resize(treeHeight);
+            for(long int idxLevel = inStopUpperLevel ; idxLevel <= treeHeight-1 ; ++idxLevel){
+                const long int nbGroups = static_cast<long int>(std::size(inTree.getCellGroupsAtLevel(idxLevel)));
+                m2lLists[idxLevel].resize(nbGroups);
+                for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                    jobs.emplace_back(idxLevel, idxGroup);
+                }
+            }
+        }
+        if(inComputeP2P){
+            const long int nbGroups = static_cast<long int>(std::size(inTree.getParticleGroups()));
+            p2pLists.resize(nbGroups);
+            for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                jobs.emplace_back(-1, idxGroup);
+            }
+        }
+
+        const auto& spacialSystem = inTree.getSpacialSystem();
+        inParallelFor(static_cast<long int>(jobs.size()), [&](const long int inIdxJob){
+            const long int idxLevel = jobs[inIdxJob].first;
+            const long int idxGroup = jobs[inIdxJob].second;
+            ListPairType& lists = (idxLevel == -1 ? p2pLists[idxGroup] : m2lLists[idxLevel][idxGroup]);
+            if(idxLevel == -1){
+                lists = spacialSystem.getNeighborListForBlock(inTree.getParticleGroups()[idxGroup], treeHeight-1, true);
+            }
+            else{
+                lists = spacialSystem.getInteractionListForBlock(inTree.getCellGroupsAtLevel(idxLevel)[idxGroup], idxLevel);
+            }
+            std::sort(lists.second.begin(), lists.second.end(), TbfXtoXInteraction<IndexType>::SrcFirst);
+        });
+    }
+
+    // The lists can be moved out
+    ListPairType& getM2LLists(const long int inLevel, const long int inIdxGroup){
+        assert(inLevel < static_cast<long int>(m2lLists.size()) && inIdxGroup < static_cast<long int>(m2lLists[inLevel].size()));
+        return m2lLists[inLevel][inIdxGroup];
+    }
+
+    ListPairType& getP2PLists(const long int inIdxGroup){
+        assert(inIdxGroup < static_cast<long int>(p2pLists.size()));
+        return p2pLists[inIdxGroup];
+    }
+};
+
+// Used with out-of-core allocators when the groups are processed in order: the inWindow groups after
+// the current one are prefetched, and the groups that are more than inWindow groups behind are released.
+// The groups that are used out of order (the sources of the M2L/P2P) must be given to releaseUsedGroup
+// after their use, such that they are released if they are not in the window of the current group.
+// Nothing is done if inWindow <= 0.
+template <class GroupContainerClass>
+class TbfGroupsWindow {
+    GroupContainerClass& groups;
+    const long int window;
+    long int idxCurrentGroup;
+    long int idxLastPrefetchedGroup;
+    long int idxLastReleasedGroup;
+
+public:
+    TbfGroupsWindow(GroupContainerClass& inGroups, const long int inWindow)
+        : groups(inGroups), window(inWindow), idxCurrentGroup(0), idxLastPrefetchedGroup(-1), idxLastReleasedGroup(-1){
+    }
+
+    void moveTo(const long int inIdxGroup){
+        if(window <= 0){
+            return;
+        }
+        idxCurrentGroup = inIdxGroup;
+        const long int idxLastGroupToPrefetch = std::min(static_cast<long int>(std::size(groups)) - 1, inIdxGroup + window);
+        while(idxLastPrefetchedGroup < idxLastGroupToPrefetch){
+            idxLastPrefetchedGroup += 1;
+            groups[idxLastPrefetchedGroup].adviseWillNeed();
+        }
+        while(idxLastReleasedGroup < inIdxGroup - window - 1){
+            idxLastReleasedGroup += 1;
+            groups[idxLastReleasedGroup].adviseDoNotNeed();
+        }
+    }
+
+    void releaseUsedGroup(const long int inIdxGroup){
+        if(window <= 0){
+            return;
+        }
+        if(inIdxGroup < idxCurrentGroup - window || idxCurrentGroup + window < inIdxGroup){
+            groups[inIdxGroup].adviseDoNotNeed();
+        }
+    }
+};
+
+// Keeps the data of the tasks (the interaction lists) alive until the tasks are executed.
+// The references to the stored items remain valid until reset() is called, which must be
+// done when all the tasks are over, and the storage is kept for the next execution.
+template <class ItemType>
+class TbfTaskDataPool {
+    std::deque<ItemType> items;
+    long int nbUsedItems;
+
+public:
+    TbfTaskDataPool() : nbUsedItems(0){}
+
+    ItemType& store(ItemType&& inItem){
+        if(nbUsedItems == static_cast<long int>(items.size())){
+            items.emplace_back(std::move(inItem));
+        }
+        else{
+            items[nbUsedItems] = std::move(inItem);
+        }
+        nbUsedItems += 1;
+        return items[nbUsedItems-1];
+    }
+
+    void reset(){
+        nbUsedItems = 0;
+    }
+
+    long int getNbUsedItems() const{
+        return nbUsedItems;
+    }
+};
 
 enum TbfOperations {
     TbfP2P  = (1 << 0),
@@ -133,6 +283,11 @@ public:
     int getL2PPriority() const{
         return prioL2P;
     }
+
+    // The priorities are in [0, getNbPriorities()[
+    int getNbPriorities() const{
+        return prioP2M+1;
+    }
 };
 
 }
@@ -3,35 +3,125 @@
 
 #include "tbfglobal.hpp"
 
+#include "utils/tbfparallel.hpp"
+#include "utils/tbftimer.hpp"
+
 #include <thread>
-#include <set>
 #include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <iomanip>
+#include <typeinfo>
+#include <type_traits>
 
 namespace TbfBlockSizeFinder{
 
-template <class RealType, class ParticleContainer, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
-int Estimate(const ParticleContainer& inParticlePositions,
-             const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration,
-             const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency())){
+// Only this number of particles is used to estimate the number of leaves
+constexpr long int DefaultMaxSampleSize = (1L << 16);
+
+inline bool GetBlockSizeFromEnv(int* outBlockSize){
     if(getenv("TBFMM_BLOCK_SIZE")){
         std::istringstream iss(getenv("TBFMM_BLOCK_SIZE"),std::istringstream::in);
         int blockSize = -1;
         iss >> blockSize;
-        if( /*iss.tellg()*/ iss.eof() ) return blockSize;
+        if( /*iss.tellg()*/ iss.eof() ){
+            *outBlockSize = blockSize;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Estimate the number of distinct keys of a population of size inPopulationSize
+// from a uniform sample with the Shlosser estimator (Haas et al. 1995), with
+// q = sample/population and f_i the number of keys that appear i times in the sample:
+// D = d + f_1 * sum((1-q)^i f_i) / sum(i q (1-q)^(i-1) f_i)
+template <class IndexType>
+inline long int EstimateNbDistinct(std::vector<IndexType> inSampleKeys, const long int inPopulationSize){
+    const long int sampleSize = static_cast<long int>(inSampleKeys.size());
+    if(sampleSize == 0){
+        return 0;
     }
 
-    using IndexType = typename SpaceIndexType::IndexType;
+    std::sort(inSampleKeys.begin(), inSampleKeys.end());
 
-    SpaceIndexType spaceSystem(inConfiguration);
+    // frequencies[i] is the number of keys that appear i+1 times
+    std::vector<long int> frequencies;
+    long int nbDistinct = 0;
+    long int idxKey = 0;
+    while(idxKey < sampleSize){
+        long int idxNext = idxKey + 1;
+        while(idxNext < sampleSize && inSampleKeys[idxNext] == inSampleKeys[idxKey]){
+            idxNext += 1;
+        }
+        if(static_cast<long int>(frequencies.size()) < idxNext - idxKey){
+            frequencies.resize(idxNext - idxKey, 0);
+        }
+        frequencies[idxNext - idxKey - 1] += 1;
+        nbDistinct += 1;
+        idxKey = idxNext;
+    }
 
-    std::set<IndexType> allIndexes;
+    if(sampleSize >= inPopulationSize || frequencies[0] == 0){
+        return nbDistinct;
+    }
 
-    for(long int idxPart = 0 ; idxPart < static_cast<long int>(std::size(inParticlePositions)) ; ++idxPart){
-        const auto index = spaceSystem.getIndexFromPosition(inParticlePositions[idxPart]);
-        allIndexes.insert(index);
+    const double q = double(sampleSize)/double(inPopulationSize);
+    double numerator = 0;
+    double denominator = 0;
+    for(long int idxFrequency = 0 ; idxFrequency < static_cast<long int>(frequencies.size()) ; ++idxFrequency){
+        const long int i = idxFrequency + 1;
+        numerator += std::pow(1-q, double(i)) * double(frequencies[idxFrequency]);
+        denominator += double(i) * q * std::pow(1-q, double(i-1)) * double(frequencies[idxFrequency]);
     }
 
-    return std::max(1, static_cast<int>(allIndexes.size()/(inNbThreads*2)));
+    const long int estimation = nbDistinct + std::lround(double(frequencies[0]) * numerator / denominator);
+    return std::min(inPopulationSize - (sampleSize - nbDistinct), estimation);
+}
+
+// Evenly spaced sample of the keys of the particles
+template <class SpaceIndexType, class ParticleContainer>
+inline void AddSampleKeys(std::vector<typename SpaceIndexType::IndexType>& inOutKeys, const SpaceIndexType& inSpaceSystem,
+                          const ParticleContainer& inParticlePositions, const long int inSampleSize){
+    const long int nbParticles = static_cast<long int>(std::size(inParticlePositions));
+    const long int sampleSize = std::min(nbParticles, inSampleSize);
+    const long int offset = static_cast<long int>(inOutKeys.size());
+    inOutKeys.resize(offset + sampleSize);
+
+    TbfParallel::ParallelFor(0, sampleSize, TbfParallel::GetNbThreads(), [&](const long int idxSample){
+        const long int idxPart = static_cast<long int>((static_cast<double>(idxSample)*double(nbParticles))/double(sampleSize));
+        inOutKeys[offset + idxSample] = inSpaceSystem.getIndexFromPosition(inParticlePositions[idxPart]);
+    });
+}
+
+template <class RealType, class ParticleContainer, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
+long int EstimateNbLeaves(const ParticleContainer& inParticlePositions,
+                          const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration,
+                          const long int inMaxSampleSize = DefaultMaxSampleSize){
+    const SpaceIndexType spaceSystem(inConfiguration);
+    std::vector<typename SpaceIndexType::IndexType> sampleKeys;
+    AddSampleKeys(sampleKeys, spaceSystem, inParticlePositions, inMaxSampleSize);
+    const long int nbLeaves = EstimateNbDistinct(std::move(sampleKeys), static_cast<long int>(std::size(inParticlePositions)));
+    return std::min(nbLeaves, static_cast<long int>(std::min(spaceSystem.getUpperBoundAtLeafLevel(),
+                                                            typename SpaceIndexType::IndexType(std::numeric_limits<long int>::max()))));
+}
+
+template <class RealType, class ParticleContainer, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
+int Estimate(const ParticleContainer& inParticlePositions,
+             const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration,
+             const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency())){
+    int blockSize = -1;
+    if(GetBlockSizeFromEnv(&blockSize)){
+        return blockSize;
+    }
+
+    const long int nbLeaves = EstimateNbLeaves<RealType, ParticleContainer, SpaceIndexType>(inParticlePositions, inConfiguration);
+    return std::max(1, static_cast<int>(nbLeaves/(std::max(1, inNbThreads)*2)));
 }
 
 template <class RealType, class ParticleContainerSource, class ParticleContainerTarget, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
@@ -39,30 +129,176 @@ int EstimateTsm(const ParticleContainerSource& inParticlePositionsSource,
                 const ParticleContainerTarget& inParticlePositionsTarget,
              const TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>& inConfiguration,
              const int inNbThreads = static_cast<int>(std::thread::hardware_concurrency())){
-    if(getenv("TBFMM_BLOCK_SIZE")){
-        std::istringstream iss(getenv("TBFMM_BLOCK_SIZE"),std::istringstream::in);
+    int blockSize = -1;
+    if(GetBlockSizeFromEnv(&blockSize)){
+        return blockSize;
+    }
+
+    const long int nbSources = static_cast<long int>(std::size(inParticlePositionsSource));
+    const long int nbTargets = static_cast<long int>(std::size(inParticlePositionsTarget));
+    const long int nbParticles = nbSources + nbTargets;
+    if(nbParticles == 0){
+        return 1;
+    }
+
+    // The sample is shared between sources and targets to keep the same sampling ratio
+    const long int sampleSizeSource = (nbSources*std::min(nbParticles, DefaultMaxSampleSize))/nbParticles;
+    const long int sampleSizeTarget = std::min(nbParticles, DefaultMaxSampleSize) - sampleSizeSource;
+
+    const SpaceIndexType spaceSystem(inConfiguration);
+    std::vector<typename SpaceIndexType::IndexType> sampleKeys;
+    AddSampleKeys(sampleKeys, spaceSystem, inParticlePositionsSource, sampleSizeSource);
+    AddSampleKeys(sampleKeys, spaceSystem, inParticlePositionsTarget, sampleSizeTarget);
+
+    const long int nbLeaves = EstimateNbDistinct(std::move(sampleKeys), nbParticles);
+    return std::max(1, static_cast<int>(nbLeaves/(std::max(1, inNbThreads)*2)));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// Autotuning: short executions on a subsample with several block sizes,
+/// the result is stored in a cache file for the next runs.
+///////////////////////////////////////////////////////////////////////////////
+
+// The cache is used only if a file is given to Autotune, or with TBFMM_AUTOTUNE_CACHE
+inline std::string GetAutotuneCacheFilename(){
+    if(getenv("TBFMM_AUTOTUNE_CACHE")){
+        return std::string(getenv("TBFMM_AUTOTUNE_CACHE"));
+    }
+    return std::string();
+}
+
+// The key identifies the algorithm and kernel types, the box, the height,
+// the number of particles and the number of threads (the parameters of the
+// kernel that are not part of its type must be given in inName)
+template <class AlgorithmClass, class SpacialConfiguration>
+inline std::string GetAutotuneCacheKey(const std::string& inName, const SpacialConfiguration& inConfiguration,
+                                       const long int inNbParticles, const int inNbThreads){
+    using RealType = typename SpacialConfiguration::RealType;
+    std::ostringstream key;
+    key << std::setprecision(std::numeric_limits<RealType>::max_digits10);
+    key << inName << " " << typeid(AlgorithmClass).name() << " " << inConfiguration.getTreeHeight();
+    for(long int idxDim = 0 ; idxDim < SpacialConfiguration::Dim ; ++idxDim){
+        key << " " << inConfiguration.getBoxWidths()[idxDim] << " " << inConfiguration.getBoxCenter()[idxDim];
+    }
+    key << " " << inNbParticles << " " << inNbThreads;
+    return key.str();
+}
+
+// Each line of the cache is "key blockSize"
+inline bool ReadAutotuneCache(const std::string& inFilename, const std::string& inKey, long int* outBlockSize){
+    std::ifstream cacheFile(inFilename);
+    std::string line;
+    bool found = false;
+    // The last entry is used if there are several
+    while(std::getline(cacheFile, line)){
+        const auto posLastSpace = line.find_last_of(' ');
+        if(posLastSpace != std::string::npos && line.compare(0, posLastSpace, inKey) == 0
+                && posLastSpace == inKey.size()){
+            std::istringstream blockSizeStream(line.substr(posLastSpace+1));
+            long int blockSize = -1;
+            if(blockSizeStream >> blockSize){
+                *outBlockSize = blockSize;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+inline void WriteAutotuneCache(const std::string& inFilename, const std::string& inKey, const long int inBlockSize){
+    std::ofstream cacheFile(inFilename, std::ios::app);
+    cacheFile << inKey << " " << inBlockSize << "\n";
+}
+
+// inAlgorithmBuilder must return a pointer (or a smart pointer) to a new algorithm
+// for the given configuration (the kernel can be large, so it is not built on the stack).
+// The candidates are expressed in number of groups per thread at leaf level, because
+// the subsample has less leaves than the real tree (its height is reduced to keep the
+// same number of particles per leaf). The number of groups per thread of the fastest
+// trial is converted into a block size for the complete set of particles.
+// The result is stored in inCacheFilename (if not empty), the name, the algorithm/kernel types,
+// the box and the numbers of particles/threads must be the same to use a cached value.
+template <class TreeClass, class ParticleContainer, class AlgorithmBuilderClass>
+long int Autotune(const ParticleContainer& inParticlePositions,
+                  const typename TreeClass::SpacialConfiguration& inConfiguration,
+                  AlgorithmBuilderClass&& inAlgorithmBuilder,
+                  const std::string& inName,
+                  const long int inMaxSampleSize = 20000,
+                  const std::vector<long int>& inGroupsPerThreadCandidates = {1, 2, 4, 8, 16},
+                  const std::string& inCacheFilename = GetAutotuneCacheFilename()){
+    using SpacialConfiguration = typename TreeClass::SpacialConfiguration;
+    using RealType = typename SpacialConfiguration::RealType;
+    constexpr long int Dim = SpacialConfiguration::Dim;
+
+    {
         int blockSize = -1;
-        iss >> blockSize;
-        if( /*iss.tellg()*/ iss.eof() ) return blockSize;
+        if(GetBlockSizeFromEnv(&blockSize)){
+            return blockSize;
+        }
     }
 
-    using IndexType = typename SpaceIndexType::IndexType;
+    using AlgorithmClass = typename std::decay<decltype(*inAlgorithmBuilder(inConfiguration))>::type;
+    using SpaceIndexType = typename TreeClass::SpaceIndexType;
+
+    const int nbThreads = TbfParallel::GetNbThreads();
+    const long int nbParticles = static_cast<long int>(std::size(inParticlePositions));
+    const long int treeHeight = inConfiguration.getTreeHeight();
+    const std::string cacheKey = GetAutotuneCacheKey<AlgorithmClass>(inName, inConfiguration, nbParticles, nbThreads);
 
-    SpaceIndexType spaceSystem(inConfiguration);
+    {
+        long int blockSize = -1;
+        if(inCacheFilename.size() && ReadAutotuneCache(inCacheFilename, cacheKey, &blockSize)){
+            return blockSize;
+        }
+    }
 
-    std::set<IndexType> allIndexes;
+    const long int nbLeaves = EstimateNbLeaves<RealType, ParticleContainer, SpaceIndexType>(inParticlePositions, inConfiguration);
 
-    for(long int idxPart = 0 ; idxPart < static_cast<long int>(std::size(inParticlePositionsSource)) ; ++idxPart){
-        const auto index = spaceSystem.getIndexFromPosition(inParticlePositionsSource[idxPart]);
-        allIndexes.insert(index);
+    // Subsample and reduce the height (each level divides the number of leaves by 2^Dim)
+    const long int sampleSize = std::min(nbParticles, std::max(1L, inMaxSampleSize));
+    std::vector<typename std::decay<decltype(inParticlePositions[0])>::type> samplePositions(sampleSize);
+    for(long int idxSample = 0 ; idxSample < sampleSize ; ++idxSample){
+        samplePositions[idxSample] = inParticlePositions[static_cast<long int>((static_cast<double>(idxSample)*double(nbParticles))/double(sampleSize))];
     }
 
-    for(long int idxPart = 0 ; idxPart < static_cast<long int>(std::size(inParticlePositionsTarget)) ; ++idxPart){
-        const auto index = spaceSystem.getIndexFromPosition(inParticlePositionsTarget[idxPart]);
-        allIndexes.insert(index);
+    const long int nbRemovedLevels = static_cast<long int>(std::round(std::log2(double(std::max(1L, nbParticles))/double(std::max(1L, sampleSize)))/double(Dim)));
+    const SpacialConfiguration sampleConfiguration(std::max(2L, treeHeight - nbRemovedLevels),
+                                                   inConfiguration.getBoxWidths(), inConfiguration.getBoxCenter());
+    const long int sampleNbLeaves = EstimateNbLeaves<RealType, decltype(samplePositions), SpaceIndexType>(samplePositions, sampleConfiguration);
+
+    long int bestGroupsPerThread = -1;
+    double bestTime = std::numeric_limits<double>::max();
+
+    auto algorithm = inAlgorithmBuilder(sampleConfiguration);
+
+    // Warm up (the kernel might have lazy precomputations)
+    {
+        TreeClass tree(sampleConfiguration, samplePositions, std::max(1L, sampleNbLeaves/nbThreads));
+        algorithm->execute(tree);
+    }
+
+    for(const long int groupsPerThread : inGroupsPerThreadCandidates){
+        const long int sampleBlockSize = std::max(1L, sampleNbLeaves/(groupsPerThread*nbThreads));
+        TreeClass tree(sampleConfiguration, samplePositions, sampleBlockSize);
+
+        TbfTimer timerExecute;
+        algorithm->execute(tree);
+        timerExecute.stop();
+
+        if(timerExecute.getElapsed() < bestTime){
+            bestTime = timerExecute.getElapsed();
+            bestGroupsPerThread = groupsPerThread;
+        }
+    }
+
+    const long int blockSize = (bestGroupsPerThread == -1 ? std::max(1L, nbLeaves/(2*nbThreads))
+                                                          : std::max(1L, nbLeaves/(bestGroupsPerThread*nbThreads)));
+
+    if(inCacheFilename.size()){
+        WriteAutotuneCache(inCacheFilename, cacheKey, blockSize);
     }
 
-    return std::max(1, static_cast<int>(allIndexes.size()/(inNbThreads*2)));
+    return blockSize;
 }
 
 }
@@ -0,0 +1,457 @@
+#ifndef TBFCRITICALPATHPRIORITIES_HPP
+#define TBFCRITICALPATHPRIORITIES_HPP
+
+#include "tbfglobal.hpp"
+
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "core/tbfinteractionplan.hpp"
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+// Priorities of the tasks computed from the task graph of a tree (the upward rank of HEFT):
+// the priority of a task increases with the cost of the longest path from the task to the end
+// of the execution (its own cost included), such that the tasks that gate long chains
+// (and the expensive P2P) are started first.
+// The graph is built at the level of the groups from the interaction plan of the tree.
+// The costs are estimated from the number of particles/interactions with a CostModel,
+// and then replaced by the durations of the tasks measured during the previous execution.
+// When it is disabled, the fixed priorities of TbfOperationsPriorities are returned.
+class TbfCriticalPathPriorities {
+public:
+    enum Stage {
+        StageP2M,
+        StageM2M,
+        StageM2L,
+        StageL2L,
+        StageL2P,
+        StageP2P,
+        NbStages
+    };
+
+    // The relative costs of the operators, used until the durations are measured
+    struct CostModel {
+        double p2mPerParticle = 10;
+        double m2mPerChild = 100;
+        double m2lPerInteraction = 100;
+        double l2lPerChild = 100;
+        double l2pPerParticle = 10;
+        double p2pPerPair = 1;
+    };
+
+private:
+    using CostsType = std::array<std::vector<std::vector<double>>, NbStages>;
+
+    const TbfAlgorithmUtils::TbfOperationsPriorities defaultPriorities;
+    const long int leafLevel;
+
+    bool isEnabled;
+    bool useMeasuredCosts;
+    CostModel costModel;
+
+    // The description of the tree used to build the graph
+    const TbfInteractionPlan* lastPlan;
+    std::vector<long int> lastSignature;
+    long int lastStopUpperLevel;
+
+    // For each level and group, the interval of the groups of the parents/children
+    std::vector<std::vector<std::pair<long int, long int>>> parentGroups;
+    std::vector<std::vector<std::pair<long int, long int>>> childGroups;
+
+    // For each stage, level and group (the M2M/L2L use the level of the parents as the kernels,
+    // the P2M/L2P/P2P the leaf level)
+    CostsType estimatedCosts;
+    CostsType measuredCosts;
+    CostsType currentCosts;
+    std::array<bool, NbStages> hasMeasuredCosts;
+    std::array<bool, NbStages> isMeasuringStage;
+
+    std::array<std::vector<std::vector<int>>, NbStages> priorities;
+    bool hasPriorities;
+
+    static std::vector<std::vector<double>> MakeZeroCosts(const std::vector<std::vector<double>>& inModel){
+        std::vector<std::vector<double>> costs(inModel.size());
+        for(long int idxLevel = 0 ; idxLevel < static_cast<long int>(inModel.size()) ; ++idxLevel){
+            costs[idxLevel].resize(inModel[idxLevel].size(), 0);
+        }
+        return costs;
+    }
+
+    static Stage GetStage(const int inOperation){
+        switch(inOperation){
+        case TbfAlgorithmUtils::TbfP2M: return StageP2M;
+        case TbfAlgorithmUtils::TbfM2M: return StageM2M;
+        case TbfAlgorithmUtils::TbfM2L: return StageM2L;
+        case TbfAlgorithmUtils::TbfL2L: return StageL2L;
+        case TbfAlgorithmUtils::TbfL2P: return StageL2P;
+        default: return StageP2P;
+        }
+    }
+
+    template <class TreeClass>
+    static std::vector<long int> GetSignature(const TreeClass& inTree){
+        std::vector<long int> signature;
+        for(long int idxLevel = 0 ; idxLevel < inTree.getHeight() ; ++idxLevel){
+            signature.push_back(static_cast<long int>(std::size(inTree.getCellGroupsAtLevel(idxLevel))));
+        }
+        for(const auto& particleGroup : inTree.getParticleGroups()){
+            signature.push_back(particleGroup.getNbParticles());
+        }
+        return signature;
+    }
+
+    template <class TreeClass>
+    void buildGraph(const TreeClass& inTree, const TbfInteractionPlan& inPlan, const long int inStopUpperLevel){
+        const long int treeHeight = inTree.getHeight();
+        const auto& spacialSystem = inTree.getSpacialSystem();
+
+        parentGroups.clear();
+        parentGroups.resize(treeHeight);
+        childGroups.clear();
+        childGroups.resize(treeHeight);
+        for(auto& costs : estimatedCosts){
+            costs.clear();
+            costs.resize(treeHeight);
+        }
+
+        for(long int idxLevel = inStopUpperLevel ; idxLevel <= leafLevel ; ++idxLevel){
+            const auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+            const long int nbGroups = static_cast<long int>(std::size(cellGroups));
+            parentGroups[idxLevel].resize(nbGroups, std::pair<long int, long int>(0, -1));
+            childGroups[idxLevel].resize(nbGroups, std::pair<long int, long int>(std::numeric_limits<long int>::max(), -1));
+            estimatedCosts[StageM2L][idxLevel].resize(nbGroups, 0);
+            estimatedCosts[StageM2M][idxLevel].resize(nbGroups, 0);
+
+            for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                double nbInteractions = double(inPlan.getM2LInteractionsInGroup(idxLevel, idxGroup).size());
+                const auto blocks = inPlan.getM2LBlocksBetweenGroups(idxLevel, idxGroup);
+                for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                    nbInteractions += double(blocks[idxBlock].nbInteractions);
+                }
+                estimatedCosts[StageM2L][idxLevel][idxGroup] = costModel.m2lPerInteraction * nbInteractions;
+            }
+
+            if(inStopUpperLevel < idxLevel){
+                // The children of the groups of the upper level (M2M/L2L between the two levels)
+                const auto& upperCellGroups = inTree.getCellGroupsAtLevel(idxLevel-1);
+                auto& upperChildGroups = childGroups[idxLevel-1];
+                estimatedCosts[StageL2L][idxLevel-1].resize(nbGroups, 0);
+                for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                    const auto& cellGroup = cellGroups[idxGroup];
+                    const auto firstParent = std::lower_bound(upperCellGroups.begin(), upperCellGroups.end(),
+                                                              spacialSystem.getParentIndex(cellGroup.getStartingSpacialIndex()),
+                                                              [](const auto& element, const auto& value){
+                        return element.getEndingSpacialIndex() < value;
+                    });
+                    const auto lastParent = std::lower_bound(firstParent, upperCellGroups.end(),
+                                                             spacialSystem.getParentIndex(cellGroup.getEndingSpacialIndex()),
+                                                             [](const auto& element, const auto& value){
+                        return element.getEndingSpacialIndex() < value;
+                    });
+                    assert(lastParent != upperCellGroups.end());
+                    parentGroups[idxLevel][idxGroup] = std::pair<long int, long int>(std::distance(upperCellGroups.begin(), firstParent),
+                                                                                     std::distance(upperCellGroups.begin(), lastParent));
+                    for(long int idxParent = parentGroups[idxLevel][idxGroup].first ; idxParent <= parentGroups[idxLevel][idxGroup].second ; ++idxParent){
+                        upperChildGroups[idxParent].first = std::min(upperChildGroups[idxParent].first, idxGroup);
+                        upperChildGroups[idxParent].second = std::max(upperChildGroups[idxParent].second, idxGroup);
+                    }
+                    // Each cell is a child of one cell of the parent groups
+                    const double costPerParent = double(cellGroup.getNbCells())
+                            / double(parentGroups[idxLevel][idxGroup].second - parentGroups[idxLevel][idxGroup].first + 1);
+                    for(long int idxParent = parentGroups[idxLevel][idxGroup].first ; idxParent <= parentGroups[idxLevel][idxGroup].second ; ++idxParent){
+                        estimatedCosts[StageM2M][idxLevel-1][idxParent] += costModel.m2mPerChild * costPerParent;
+                    }
+                    estimatedCosts[StageL2L][idxLevel-1][idxGroup] = costModel.l2lPerChild * double(cellGroup.getNbCells());
+                }
+            }
+        }
+
+        const auto& particleGroups = inTree.getParticleGroups();
+        const long int nbLeafGroups = static_cast<long int>(std::size(particleGroups));
+        estimatedCosts[StageP2M][leafLevel].resize(nbLeafGroups, 0);
+        estimatedCosts[StageL2P][leafLevel].resize(nbLeafGroups, 0);
+        estimatedCosts[StageP2P][leafLevel].resize(nbLeafGroups, 0);
+        for(long int idxGroup = 0 ; idxGroup < nbLeafGroups ; ++idxGroup){
+            const auto& particleGroup = particleGroups[idxGroup];
+            estimatedCosts[StageP2M][leafLevel][idxGroup] = costModel.p2mPerParticle * double(particleGroup.getNbParticles());
+            estimatedCosts[StageL2P][leafLevel][idxGroup] = costModel.l2pPerParticle * double(particleGroup.getNbParticles());
+
+            double nbPairs = 0;
+            for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                nbPairs += double(particleGroup.getNbParticlesInLeaf(idxLeaf)) * double(particleGroup.getNbParticlesInLeaf(idxLeaf));
+            }
+            const auto interactionsInGroup = inPlan.getP2PInteractionsInGroup(idxGroup);
+            for(long int idxInteraction = 0 ; idxInteraction < interactionsInGroup.size() ; ++idxInteraction){
+                nbPairs += double(particleGroup.getNbParticlesInLeaf(interactionsInGroup[idxInteraction].idxTarget))
+                        * double(particleGroup.getNbParticlesInLeaf(interactionsInGroup[idxInteraction].idxSrc));
+            }
+            const auto blocks = inPlan.getP2PBlocksBetweenGroups(idxGroup);
+            for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                const auto& srcGroup = particleGroups[blocks[idxBlock].idxSrcGroup];
+                const auto interactions = inPlan.getP2PInteractions(blocks[idxBlock]);
+                for(long int idxInteraction = 0 ; idxInteraction < interactions.size() ; ++idxInteraction){
+                    nbPairs += double(particleGroup.getNbParticlesInLeaf(interactions[idxInteraction].idxTarget))
+                            * double(srcGroup.getNbParticlesInLeaf(interactions[idxInteraction].idxSrc));
+                }
+            }
+            estimatedCosts[StageP2P][leafLevel][idxGroup] = costModel.p2pPerPair * nbPairs;
+        }
+
+        for(long int idxStage = 0 ; idxStage < NbStages ; ++idxStage){
+            measuredCosts[idxStage] = MakeZeroCosts(estimatedCosts[idxStage]);
+            currentCosts[idxStage] = MakeZeroCosts(estimatedCosts[idxStage]);
+            hasMeasuredCosts[idxStage] = false;
+            isMeasuringStage[idxStage] = false;
+        }
+    }
+
+    // The costs of the stages that have not been measured are converted with the ratio
+    // between the measured and the estimated costs of the other stages
+    CostsType getCosts() const{
+        double sumMeasured = 0;
+        double sumEstimated = 0;
+        for(long int idxStage = 0 ; idxStage < NbStages ; ++idxStage){
+            if(hasMeasuredCosts[idxStage]){
+                for(long int idxLevel = 0 ; idxLevel < static_cast<long int>(estimatedCosts[idxStage].size()) ; ++idxLevel){
+                    for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(estimatedCosts[idxStage][idxLevel].size()) ; ++idxGroup){
+                        sumMeasured += measuredCosts[idxStage][idxLevel][idxGroup];
+                        sumEstimated += estimatedCosts[idxStage][idxLevel][idxGroup];
+                    }
+                }
+            }
+        }
+        const double scaling = (sumMeasured != 0 && sumEstimated != 0 ? sumMeasured/sumEstimated : 1);
+
+        CostsType costs;
+        for(long int idxStage = 0 ; idxStage < NbStages ; ++idxStage){
+            if(hasMeasuredCosts[idxStage]){
+                costs[idxStage] = measuredCosts[idxStage];
+            }
+            else{
+                costs[idxStage] = estimatedCosts[idxStage];
+                for(auto& levelCosts : costs[idxStage]){
+                    for(auto& cost : levelCosts){
+                        cost *= scaling;
+                    }
+                }
+            }
+        }
+        return costs;
+    }
+
+    void computePriorities(const TbfInteractionPlan& inPlan, const long int inStopUpperLevel){
+        const CostsType costs = getCosts();
+
+        // The bottom level of the tasks (their cost plus the bottom level of their longest successor)
+        CostsType bottomLevels;
+        for(long int idxStage = 0 ; idxStage < NbStages ; ++idxStage){
+            bottomLevels[idxStage] = MakeZeroCosts(costs[idxStage]);
+        }
+
+        bottomLevels[StageL2P][leafLevel] = costs[StageL2P][leafLevel];
+        bottomLevels[StageP2P][leafLevel] = costs[StageP2P][leafLevel];
+
+        // From the leaves to the top for the downward pass (the M2L and the L2L that target a group
+        // have the same successors)
+        for(long int idxLevel = leafLevel ; idxLevel >= inStopUpperLevel ; --idxLevel){
+            const long int nbGroups = static_cast<long int>(childGroups[idxLevel].size());
+            for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                double successors = 0;
+                if(idxLevel == leafLevel){
+                    successors = bottomLevels[StageL2P][leafLevel][idxGroup];
+                }
+                else{
+                    for(long int idxChild = childGroups[idxLevel][idxGroup].first ; idxChild <= childGroups[idxLevel][idxGroup].second ; ++idxChild){
+                        successors = std::max(successors, bottomLevels[StageL2L][idxLevel][idxChild]);
+                    }
+                }
+                bottomLevels[StageM2L][idxLevel][idxGroup] = costs[StageM2L][idxLevel][idxGroup] + successors;
+                if(inStopUpperLevel < idxLevel){
+                    bottomLevels[StageL2L][idxLevel-1][idxGroup] = costs[StageL2L][idxLevel-1][idxGroup] + successors;
+                }
+            }
+        }
+
+        // From the top to the leaves for the upward pass
+        for(long int idxLevel = inStopUpperLevel ; idxLevel <= leafLevel ; ++idxLevel){
+            const long int nbGroups = static_cast<long int>(parentGroups[idxLevel].size());
+            std::vector<double> successors(nbGroups, 0);
+            for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                // Only the groups that have M2L interactions have M2L tasks
+                const double bottomLevelM2L = bottomLevels[StageM2L][idxLevel][idxGroup];
+                if(inPlan.getM2LInteractionsInGroup(idxLevel, idxGroup).size()){
+                    successors[idxGroup] = std::max(successors[idxGroup], bottomLevelM2L);
+                }
+                const auto blocks = inPlan.getM2LBlocksBetweenGroups(idxLevel, idxGroup);
+                for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                    successors[blocks[idxBlock].idxSrcGroup] = std::max(successors[blocks[idxBlock].idxSrcGroup], bottomLevelM2L);
+                }
+                if(inStopUpperLevel < idxLevel){
+                    for(long int idxParent = parentGroups[idxLevel][idxGroup].first ; idxParent <= parentGroups[idxLevel][idxGroup].second ; ++idxParent){
+                        successors[idxGroup] = std::max(successors[idxGroup], bottomLevels[StageM2M][idxLevel-1][idxParent]);
+                    }
+                }
+            }
+            const Stage stageUp = (idxLevel == leafLevel ? StageP2M : StageM2M);
+            for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                bottomLevels[stageUp][idxLevel][idxGroup] = costs[stageUp][idxLevel][idxGroup] + successors[idxGroup];
+            }
+        }
+
+        double maxBottomLevel = 0;
+        for(const auto& stageBottomLevels : bottomLevels){
+            for(const auto& levelBottomLevels : stageBottomLevels){
+                for(const double bottomLevel : levelBottomLevels){
+                    maxBottomLevel = std::max(maxBottomLevel, bottomLevel);
+                }
+            }
+        }
+
+        // The bottom levels are mapped to [0, getNbPriorities()[
+        const int nbPriorities = getNbPriorities();
+        for(long int idxStage = 0 ; idxStage < NbStages ; ++idxStage){
+            priorities[idxStage].resize(bottomLevels[idxStage].size());
+            for(long int idxLevel = 0 ; idxLevel < static_cast<long int>(bottomLevels[idxStage].size()) ; ++idxLevel){
+                const auto& levelBottomLevels = bottomLevels[idxStage][idxLevel];
+                priorities[idxStage][idxLevel].resize(levelBottomLevels.size());
+                for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(levelBottomLevels.size()) ; ++idxGroup){
+                    const double ratio = (maxBottomLevel != 0 ? levelBottomLevels[idxGroup]/maxBottomLevel : 0);
+                    priorities[idxStage][idxLevel][idxGroup] = std::min(nbPriorities-1, int(ratio*double(nbPriorities)));
+                }
+            }
+        }
+        hasPriorities = true;
+    }
+
+    int getPriority(const Stage inStage, const long int inLevel, const long int inIdxGroup, const int inDefaultPriority) const{
+        if(!isEnabled || !hasPriorities){
+            return inDefaultPriority;
+        }
+        assert(inLevel < static_cast<long int>(priorities[inStage].size())
+               && inIdxGroup < static_cast<long int>(priorities[inStage][inLevel].size()));
+        return priorities[inStage][inLevel][inIdxGroup];
+    }
+
+public:
+    explicit TbfCriticalPathPriorities(const long int inTreeHeight)
+        : defaultPriorities(inTreeHeight), leafLevel(inTreeHeight-1), isEnabled(false), useMeasuredCosts(true),
+          lastPlan(nullptr), lastStopUpperLevel(-1),
+          hasMeasuredCosts{}, isMeasuringStage{}, hasPriorities(false){
+    }
+
+    void setEnabled(const bool inIsEnabled){
+        isEnabled = inIsEnabled;
+    }
+
+    bool getEnabled() const{
+        return isEnabled;
+    }
+
+    // If false, only the CostModel is used
+    void setUseMeasuredCosts(const bool inUseMeasuredCosts){
+        useMeasuredCosts = inUseMeasuredCosts;
+        lastPlan = nullptr;
+    }
+
+    bool getUseMeasuredCosts() const{
+        return useMeasuredCosts;
+    }
+
+    void setCostModel(const CostModel& inCostModel){
+        costModel = inCostModel;
+        lastPlan = nullptr;
+    }
+
+    const CostModel& getCostModel() const{
+        return costModel;
+    }
+
+    // Must be called before the creation of the tasks (and not during their execution),
+    // the graph is built again if the tree has changed, otherwise the durations measured
+    // during the previous execution replace the costs of the stages that were executed.
+    // The interaction plan of the tree is built if needed.
+    template <class TreeClass>
+    void update(const TreeClass& inTree, const long int inStopUpperLevel, const int inOperationToProceed){
+        if(!isEnabled || inTree.getHeight() == 0){
+            return;
+        }
+
+        const TbfInteractionPlan& plan = inTree.getInteractionPlan();
+        std::vector<long int> signature = GetSignature(inTree);
+        if(&plan != lastPlan || signature != lastSignature || inStopUpperLevel != lastStopUpperLevel){
+            buildGraph(inTree, plan, inStopUpperLevel);
+            lastPlan = &plan;
+            lastSignature = std::move(signature);
+            lastStopUpperLevel = inStopUpperLevel;
+        }
+        else{
+            for(long int idxStage = 0 ; idxStage < NbStages ; ++idxStage){
+                if(isMeasuringStage[idxStage]){
+                    std::swap(measuredCosts[idxStage], currentCosts[idxStage]);
+                    currentCosts[idxStage] = MakeZeroCosts(measuredCosts[idxStage]);
+                    hasMeasuredCosts[idxStage] = true;
+                }
+            }
+        }
+
+        computePriorities(plan, inStopUpperLevel);
+
+        for(const int operation : {TbfAlgorithmUtils::TbfP2M, TbfAlgorithmUtils::TbfM2M, TbfAlgorithmUtils::TbfM2L,
+                                   TbfAlgorithmUtils::TbfL2L, TbfAlgorithmUtils::TbfL2P, TbfAlgorithmUtils::TbfP2P}){
+            isMeasuringStage[GetStage(operation)] = (useMeasuredCosts && (inOperationToProceed & operation));
+        }
+    }
+
+    // Calls inFunc and adds its duration to the cost of the task if it is measured.
+    // The tasks of a stage that target the same group must be mutually exclusive (as the commutative writes).
+    template <class FuncType>
+    void measure(const Stage inStage, const long int inLevel, const long int inIdxGroup, FuncType&& inFunc){
+        if(!isEnabled || !isMeasuringStage[inStage]){
+            inFunc();
+            return;
+        }
+        const auto startTime = std::chrono::steady_clock::now();
+        inFunc();
+        const auto endTime = std::chrono::steady_clock::now();
+        assert(inLevel < static_cast<long int>(currentCosts[inStage].size())
+               && inIdxGroup < static_cast<long int>(currentCosts[inStage][inLevel].size()));
+        currentCosts[inStage][inLevel][inIdxGroup] += std::chrono::duration<double>(endTime - startTime).count();
+    }
+
+    int getP2PPriority(const long int inIdxGroup) const{
+        return getPriority(StageP2P, leafLevel, inIdxGroup, defaultPriorities.getP2PPriority());
+    }
+
+    int getP2MPriority(const long int inIdxGroup) const{
+        return getPriority(StageP2M, leafLevel, inIdxGroup, defaultPriorities.getP2MPriority());
+    }
+
+    // inLevel is the level of the parents
+    int getM2MPriority(const long int inLevel, const long int inIdxGroup) const{
+        return getPriority(StageM2M, inLevel, inIdxGroup, defaultPriorities.getM2MPriority(inLevel));
+    }
+
+    int getM2LPriority(const long int inLevel, const long int inIdxGroup) const{
+        return getPriority(StageM2L, inLevel, inIdxGroup, defaultPriorities.getM2LPriority(inLevel));
+    }
+
+    // inLevel is the level of the parents, inIdxGroup is the index of the group of the children
+    int getL2LPriority(const long int inLevel, const long int inIdxGroup) const{
+        return getPriority(StageL2L, inLevel, inIdxGroup, defaultPriorities.getL2LPriority(inLevel));
+    }
+
+    int getL2PPriority(const long int inIdxGroup) const{
+        return getPriority(StageL2P, leafLevel, inIdxGroup, defaultPriorities.getL2PPriority());
+    }
+
+    // The priorities are in [0, getNbPriorities()[ (as the ones of TbfOperationsPriorities)
+    int getNbPriorities() const{
+        return defaultPriorities.getNbPriorities();
+    }
+};
+
+#endif
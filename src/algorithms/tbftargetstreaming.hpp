@@ -0,0 +1,60 @@
+#ifndef TBFTARGETSTREAMING_HPP
+#define TBFTARGETSTREAMING_HPP
+
+#include "tbfglobal.hpp"
+
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "utils/tbfparallel.hpp"
+
+#include <memory>
+#include <cassert>
+
+// Evaluates batches of target particles against the sources of a TSM tree (TbfTreeTsm).
+// The upward pass (P2M/M2M) is done once on the sources, then each batch only
+// costs its M2L/L2L/L2P/P2P, and the target tree of the next batch is built
+// while the current batch is computed.
+namespace TbfTargetStreaming {
+
+// inGetBatchPositions(idxBatch) must return the positions of the targets of a batch,
+// it is called from a separate thread (but never concurrently with itself).
+// inProcessBatch(idxBatch, inTree) is called once a batch has been computed,
+// the results can be read from the target particles of inTree.
+// If inComputeSources is false, the multipoles of the sources must be up to date.
+template <class AlgorithmClass, class TreeClass, class GetBatchFunc, class ProcessBatchFunc>
+inline void Execute(AlgorithmClass& inAlgorithm, TreeClass& inTree, const long int inNbBatches,
+                    GetBatchFunc&& inGetBatchPositions, ProcessBatchFunc&& inProcessBatch,
+                    const bool inComputeSources = true){
+    if(inComputeSources){
+        inAlgorithm.execute(inTree, TbfAlgorithmUtils::TbfBottomToTopStages);
+    }
+
+    if(inNbBatches <= 0){
+        return;
+    }
+
+    auto nextTargetTree = inTree.buildTargetTree(inGetBatchPositions(0L));
+
+    for(long int idxBatch = 0 ; idxBatch < inNbBatches ; ++idxBatch){
+        inTree.swapTargetTree(nextTargetTree);
+
+        auto computeBatch = [&](){
+            inAlgorithm.execute(inTree, TbfAlgorithmUtils::TbfTransferStages | TbfAlgorithmUtils::TbfTopToBottomStages);
+            inProcessBatch(idxBatch, inTree);
+        };
+
+        if(idxBatch+1 < inNbBatches){
+            // nextTargetTree holds the previous targets that are not used anymore,
+            // the builder is joined even if the batch throws
+            TbfParallel::RunConcurrently([&inTree, &nextTargetTree, &inGetBatchPositions, idxBatch](){
+                nextTargetTree = inTree.buildTargetTree(inGetBatchPositions(idxBatch+1));
+            }, computeBatch);
+        }
+        else{
+            computeBatch();
+        }
+    }
+}
+
+}
+
+#endif
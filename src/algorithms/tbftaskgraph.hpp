@@ -0,0 +1,571 @@
+#ifndef TBFTASKGRAPH_HPP
+#define TBFTASKGRAPH_HPP
+
+#include "tbfglobal.hpp"
+
+#include "algorithms/tbftasktracer.hpp"
+
+#include <vector>
+#include <deque>
+#include <queue>
+#include <set>
+#include <memory>
+#include <unordered_map>
+#include <initializer_list>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <limits>
+#include <cassert>
+
+// The task graph (DAG) of one execution of a parallel algorithm: one node per task, and
+// the dependencies computed from the accesses of the tasks in the order of insertion
+// (as TbfTaskRuntime or OpenMP depend):
+// - Read: after the last writes,
+// - Write: after all the previous accesses,
+// - CommuteWrite: after the previous reads and writes, the consecutive commutative writes
+//   on a data are not ordered but cannot be executed at the same time (the node keeps
+//   the ids of its commutative data).
+// The cost of a node is its measured duration (in seconds) or an estimation from the
+// number of items/interactions with a CostModel.
+// The graph can be saved/loaded, and Simulate executes it with a list scheduling on
+// a given number of cores, to predict the scaling without running on the machine.
+class TbfTaskGraph {
+public:
+    using Operation = TbfTaskTracer::Operation;
+
+    enum class AccessMode {
+        Read,
+        Write,
+        CommuteWrite
+    };
+
+    struct Access {
+        const void* data;
+        AccessMode mode;
+    };
+
+    template <class DataType>
+    static Access Read(const DataType& inData){
+        return Access{&inData, AccessMode::Read};
+    }
+
+    template <class DataType>
+    static Access Write(DataType& inData){
+        return Access{&inData, AccessMode::Write};
+    }
+
+    template <class DataType>
+    static Access CommuteWrite(DataType& inData){
+        return Access{&inData, AccessMode::CommuteWrite};
+    }
+
+    // The relative costs of the operators, used for the nodes that are not measured
+    // (the P2P interactions are between two leaves, including a leaf with itself)
+    struct CostModel {
+        double p2mPerParticle = 10;
+        double m2mPerChild = 100;
+        double m2lPerInteraction = 100;
+        double l2lPerChild = 100;
+        double l2pPerParticle = 10;
+        double p2pPerInteraction = 500;
+    };
+
+    // The source and target groups/items are the ones given to the tracer (TbfTaskTracer::Record)
+    struct Node {
+        Operation operation;
+        long int level;
+        long int idxSrcGroup;
+        long int idxTargetGroup;
+        long int nbSrcItems;
+        long int nbTargetItems;
+        long int nbInteractions;
+        int priority;
+        // Negative if the node has not been measured
+        double measuredCost;
+        std::vector<long int> predecessors;
+        std::vector<long int> commuteData;
+    };
+
+    // Measures the duration of a node (if not null) until it is destroyed
+    class Timer {
+        Node* node;
+        std::chrono::steady_clock::time_point startTime;
+
+    public:
+        explicit Timer(Node* inNode)
+            : node(inNode){
+            if(node){
+                startTime = std::chrono::steady_clock::now();
+            }
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        ~Timer(){
+            if(node){
+                node->measuredCost = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            }
+        }
+    };
+
+    enum SchedulingPolicy {
+        // The ready tasks in the order of insertion
+        PolicyFifo,
+        // The priorities given to the runtime, then the order of insertion
+        PolicyPriority,
+        // The longest path to the end of the graph (HEFT)
+        PolicyCriticalPath,
+        NbPolicies
+    };
+
+    static const char* GetPolicyName(const SchedulingPolicy inPolicy){
+        const char* names[NbPolicies] = {"fifo", "priority", "critical-path"};
+        assert(0 <= inPolicy && inPolicy < NbPolicies);
+        return names[inPolicy];
+    }
+
+    struct SimulationResult {
+        long int nbCores;
+        double makespan;
+        // The sum of the costs and the longest path of the graph (the limits of the makespan)
+        double totalCost;
+        double criticalPath;
+        // totalCost / (nbCores * makespan)
+        double efficiency;
+    };
+
+private:
+    struct DataState {
+        long int idxData;
+        AccessMode currentMode = AccessMode::Read;
+        std::vector<long int> currentNodes;
+        std::vector<long int> previousNodes;
+    };
+
+    bool isEnabled;
+    CostModel costModel;
+
+    // A deque such that the tasks can keep a pointer on their node during the insertion
+    std::deque<Node> nodes;
+    std::unordered_map<const void*, DataState> dataStates;
+    long int nbCommuteData;
+
+    static void AddPredecessor(Node& inNode, const long int inIdxPredecessor){
+        if(std::find(inNode.predecessors.begin(), inNode.predecessors.end(), inIdxPredecessor) == inNode.predecessors.end()){
+            inNode.predecessors.push_back(inIdxPredecessor);
+        }
+    }
+
+    void registerAccess(Node& inNode, const long int inIdxNode, const Access& inAccess){
+        auto iterState = dataStates.find(inAccess.data);
+        if(iterState == dataStates.end()){
+            iterState = dataStates.emplace(inAccess.data, DataState()).first;
+            iterState->second.idxData = -1;
+        }
+        DataState& state = iterState->second;
+
+        if(state.currentNodes.empty() || state.currentMode != inAccess.mode || inAccess.mode == AccessMode::Write){
+            std::swap(state.previousNodes, state.currentNodes);
+            state.currentNodes.clear();
+            state.currentMode = inAccess.mode;
+        }
+        for(const long int idxPredecessor : state.previousNodes){
+            if(idxPredecessor != inIdxNode){
+                AddPredecessor(inNode, idxPredecessor);
+            }
+        }
+        if(state.currentNodes.empty() || state.currentNodes.back() != inIdxNode){
+            state.currentNodes.push_back(inIdxNode);
+        }
+
+        if(inAccess.mode == AccessMode::CommuteWrite){
+            if(state.idxData == -1){
+                state.idxData = nbCommuteData;
+                nbCommuteData += 1;
+            }
+            if(std::find(inNode.commuteData.begin(), inNode.commuteData.end(), state.idxData) == inNode.commuteData.end()){
+                inNode.commuteData.push_back(state.idxData);
+            }
+        }
+    }
+
+    static std::vector<std::vector<long int>> GetSuccessors(const std::deque<Node>& inNodes){
+        std::vector<std::vector<long int>> successors(inNodes.size());
+        for(long int idxNode = 0 ; idxNode < static_cast<long int>(inNodes.size()) ; ++idxNode){
+            for(const long int idxPredecessor : inNodes[idxNode].predecessors){
+                successors[idxPredecessor].push_back(idxNode);
+            }
+        }
+        return successors;
+    }
+
+public:
+    TbfTaskGraph()
+        : isEnabled(false), nbCommuteData(0){
+    }
+
+    void setEnabled(const bool inIsEnabled){
+        isEnabled = inIsEnabled;
+    }
+
+    bool getEnabled() const{
+        return isEnabled;
+    }
+
+    void setCostModel(const CostModel& inCostModel){
+        costModel = inCostModel;
+    }
+
+    const CostModel& getCostModel() const{
+        return costModel;
+    }
+
+    // Removes the nodes (the algorithms clear the graph at the beginning of each execution)
+    void clear(){
+        nodes.clear();
+        dataStates.clear();
+        nbCommuteData = 0;
+    }
+
+    // To be called when the task is inserted in the runtime, with the same accesses.
+    // Returns nullptr if the graph is disabled, otherwise the node stays valid until clear.
+    Node* addTask(const Operation inOperation, const long int inLevel,
+                  const long int inIdxSrcGroup, const long int inIdxTargetGroup,
+                  const long int inNbSrcItems, const long int inNbTargetItems,
+                  const long int inNbInteractions, const int inPriority,
+                  std::initializer_list<Access> inAccesses){
+        if(!isEnabled){
+            return nullptr;
+        }
+        const long int idxNode = static_cast<long int>(nodes.size());
+        nodes.emplace_back();
+        Node& node = nodes.back();
+        node.operation = inOperation;
+        node.level = inLevel;
+        node.idxSrcGroup = inIdxSrcGroup;
+        node.idxTargetGroup = inIdxTargetGroup;
+        node.nbSrcItems = inNbSrcItems;
+        node.nbTargetItems = inNbTargetItems;
+        node.nbInteractions = inNbInteractions;
+        node.priority = inPriority;
+        node.measuredCost = -1;
+
+        for(const Access& access : inAccesses){
+            registerAccess(node, idxNode, access);
+        }
+        return &node;
+    }
+
+    // Measures the task of inNode (if not null), to be called by the task before the kernel
+    static Timer Measure(Node* inNode){
+        return Timer(inNode);
+    }
+
+    long int getNbNodes() const{
+        return static_cast<long int>(nodes.size());
+    }
+
+    const Node& getNode(const long int inIdxNode) const{
+        assert(0 <= inIdxNode && inIdxNode < getNbNodes());
+        return nodes[inIdxNode];
+    }
+
+    long int getNbEdges() const{
+        long int nbEdges = 0;
+        for(const auto& node : nodes){
+            nbEdges += static_cast<long int>(node.predecessors.size());
+        }
+        return nbEdges;
+    }
+
+    // The number of data accessed with CommuteWrite (the ids of Node::commuteData)
+    long int getNbCommuteData() const{
+        return nbCommuteData;
+    }
+
+    double getEstimatedCost(const Node& inNode) const{
+        switch(inNode.operation){
+        case TbfTaskTracer::OperationP2M: return costModel.p2mPerParticle * double(inNode.nbSrcItems);
+        case TbfTaskTracer::OperationM2M: return costModel.m2mPerChild * double(inNode.nbSrcItems);
+        case TbfTaskTracer::OperationM2L: return costModel.m2lPerInteraction * double(inNode.nbInteractions);
+        case TbfTaskTracer::OperationL2L: return costModel.l2lPerChild * double(inNode.nbTargetItems);
+        case TbfTaskTracer::OperationL2P: return costModel.l2pPerParticle * double(inNode.nbTargetItems);
+        default: return costModel.p2pPerInteraction * double(inNode.nbInteractions);
+        }
+    }
+
+    // The measured costs, the estimated ones being converted with the ratio between
+    // the measured and the estimated costs of the measured nodes
+    std::vector<double> getCosts() const{
+        double sumMeasured = 0;
+        double sumEstimated = 0;
+        for(const auto& node : nodes){
+            if(node.measuredCost >= 0){
+                sumMeasured += node.measuredCost;
+                sumEstimated += getEstimatedCost(node);
+            }
+        }
+        const double scaling = (sumMeasured != 0 && sumEstimated != 0 ? sumMeasured/sumEstimated : 1);
+
+        std::vector<double> costs(nodes.size());
+        for(long int idxNode = 0 ; idxNode < getNbNodes() ; ++idxNode){
+            costs[idxNode] = (nodes[idxNode].measuredCost >= 0 ? nodes[idxNode].measuredCost
+                                                               : scaling * getEstimatedCost(nodes[idxNode]));
+        }
+        return costs;
+    }
+
+    // The cost of the longest path from each node to the end of the graph (its own cost included)
+    std::vector<double> getBottomLevels(const std::vector<double>& inCosts) const{
+        assert(static_cast<long int>(inCosts.size()) == getNbNodes());
+        // The predecessors of a node are always inserted before it
+        std::vector<double> bottomLevels(inCosts);
+        for(long int idxNode = getNbNodes()-1 ; idxNode >= 0 ; --idxNode){
+            for(const long int idxPredecessor : nodes[idxNode].predecessors){
+                assert(idxPredecessor < idxNode);
+                bottomLevels[idxPredecessor] = std::max(bottomLevels[idxPredecessor], inCosts[idxPredecessor] + bottomLevels[idxNode]);
+            }
+        }
+        return bottomLevels;
+    }
+
+    // Executes the graph on inNbCores virtual cores: each time a core is free, it takes the
+    // ready task with the highest priority of inPolicy whose commutative data are not used
+    // by a running task (the runtimes add their overheads to the measured costs only)
+    SimulationResult simulate(const long int inNbCores, const SchedulingPolicy inPolicy) const{
+        return simulate(inNbCores, inPolicy, getCosts());
+    }
+
+    SimulationResult simulate(const long int inNbCores, const SchedulingPolicy inPolicy, const std::vector<double>& inCosts) const{
+        assert(inNbCores > 0);
+        assert(static_cast<long int>(inCosts.size()) == getNbNodes());
+
+        const long int nbNodes = getNbNodes();
+        const std::vector<double> bottomLevels = getBottomLevels(inCosts);
+
+        SimulationResult result;
+        result.nbCores = inNbCores;
+        result.makespan = 0;
+        result.totalCost = 0;
+        result.criticalPath = 0;
+        for(long int idxNode = 0 ; idxNode < nbNodes ; ++idxNode){
+            result.totalCost += inCosts[idxNode];
+            result.criticalPath = std::max(result.criticalPath, bottomLevels[idxNode]);
+        }
+
+        // The ready tasks sorted by decreasing priority (and then by order of insertion)
+        std::vector<double> keys(nbNodes);
+        for(long int idxNode = 0 ; idxNode < nbNodes ; ++idxNode){
+            switch(inPolicy){
+            case PolicyFifo: keys[idxNode] = 0; break;
+            case PolicyPriority: keys[idxNode] = nodes[idxNode].priority; break;
+            default: keys[idxNode] = bottomLevels[idxNode]; break;
+            }
+        }
+        auto compareNodes = [&keys](const long int inIdxNode1, const long int inIdxNode2){
+            return keys[inIdxNode1] > keys[inIdxNode2] || (keys[inIdxNode1] == keys[inIdxNode2] && inIdxNode1 < inIdxNode2);
+        };
+        std::set<long int, decltype(compareNodes)> readyNodes(compareNodes);
+
+        const auto successors = GetSuccessors(nodes);
+        std::vector<long int> nbPredecessors(nbNodes);
+        for(long int idxNode = 0 ; idxNode < nbNodes ; ++idxNode){
+            nbPredecessors[idxNode] = static_cast<long int>(nodes[idxNode].predecessors.size());
+            if(nbPredecessors[idxNode] == 0){
+                readyNodes.insert(idxNode);
+            }
+        }
+
+        // The tasks that wait for a commutative data wait in the list of the data
+        std::vector<bool> isDataUsed(nbCommuteData, false);
+        std::vector<std::vector<long int>> waitingNodes(nbCommuteData);
+
+        // The end time and the node of the running tasks
+        using Event = std::pair<double, long int>;
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> runningNodes;
+
+        double currentTime = 0;
+        long int nbFreeCores = inNbCores;
+        long int nbFinishedNodes = 0;
+
+        while(nbFinishedNodes != nbNodes){
+            auto iterReady = readyNodes.begin();
+            while(nbFreeCores != 0 && iterReady != readyNodes.end()){
+                const long int idxNode = *iterReady;
+                iterReady = readyNodes.erase(iterReady);
+
+                const auto& commuteData = nodes[idxNode].commuteData;
+                const auto usedData = std::find_if(commuteData.begin(), commuteData.end(), [&](const long int inIdxData){
+                    return isDataUsed[inIdxData];
+                });
+                if(usedData != commuteData.end()){
+                    waitingNodes[*usedData].push_back(idxNode);
+                }
+                else{
+                    for(const long int idxData : commuteData){
+                        isDataUsed[idxData] = true;
+                    }
+                    runningNodes.emplace(currentTime + inCosts[idxNode], idxNode);
+                    nbFreeCores -= 1;
+                }
+            }
+
+            assert(runningNodes.size());
+            currentTime = runningNodes.top().first;
+            while(runningNodes.size() && runningNodes.top().first == currentTime){
+                const long int idxNode = runningNodes.top().second;
+                runningNodes.pop();
+                nbFreeCores += 1;
+                nbFinishedNodes += 1;
+
+                for(const long int idxData : nodes[idxNode].commuteData){
+                    isDataUsed[idxData] = false;
+                    readyNodes.insert(waitingNodes[idxData].begin(), waitingNodes[idxData].end());
+                    waitingNodes[idxData].clear();
+                }
+                for(const long int idxSuccessor : successors[idxNode]){
+                    nbPredecessors[idxSuccessor] -= 1;
+                    if(nbPredecessors[idxSuccessor] == 0){
+                        readyNodes.insert(idxSuccessor);
+                    }
+                }
+            }
+        }
+
+        result.makespan = currentTime;
+        result.efficiency = (result.makespan != 0 ? result.totalCost / (double(inNbCores) * result.makespan) : 1);
+        return result;
+    }
+
+    // Writes the graph in a text file: one line per node with its description, its costs
+    // (-1 if not measured), its commutative data and its predecessors
+    bool save(const std::string& inFilename) const{
+        std::ofstream file(inFilename, std::ios::trunc);
+        if(!file.is_open()){
+            return false;
+        }
+
+        file << std::setprecision(std::numeric_limits<double>::max_digits10);
+        file << "TbfTaskGraph " << getNbNodes() << " " << nbCommuteData << "\n";
+        file << "# operation level srcGroup targetGroup nbSrcItems nbTargetItems nbInteractions priority"
+                " estimatedCost measuredCost nbCommuteData [commuteData] nbPredecessors [predecessors]\n";
+        for(const auto& node : nodes){
+            file << TbfTaskTracer::GetOperationName(node.operation) << " " << node.level
+                 << " " << node.idxSrcGroup << " " << node.idxTargetGroup
+                 << " " << node.nbSrcItems << " " << node.nbTargetItems << " " << node.nbInteractions
+                 << " " << node.priority << " " << getEstimatedCost(node) << " " << node.measuredCost;
+            file << " " << node.commuteData.size();
+            for(const long int idxData : node.commuteData){
+                file << " " << idxData;
+            }
+            file << " " << node.predecessors.size();
+            for(const long int idxPredecessor : node.predecessors){
+                file << " " << idxPredecessor;
+            }
+            file << "\n";
+        }
+
+        return static_cast<bool>(file);
+    }
+
+    // Reads a file written by save() (the estimated costs are computed again from the CostModel),
+    // returns nullptr if the file cannot be read or is not valid
+    static std::unique_ptr<TbfTaskGraph> Load(const std::string& inFilename){
+        std::ifstream file(inFilename);
+        std::string header;
+        long int nbNodes = -1;
+        long int nbData = -1;
+        if(!(file >> header >> nbNodes >> nbData) || header != "TbfTaskGraph" || nbNodes < 0 || nbData < 0){
+            return nullptr;
+        }
+
+        std::unique_ptr<TbfTaskGraph> graph(new TbfTaskGraph);
+        graph->nbCommuteData = nbData;
+
+        std::string line;
+        std::getline(file, line);
+        while(graph->getNbNodes() != nbNodes && std::getline(file, line)){
+            if(line.empty() || line[0] == '#'){
+                continue;
+            }
+            std::istringstream lineStream(line);
+            Node node;
+            std::string operationName;
+            double estimatedCost;
+            long int nbNodeData = -1;
+            long int nbPredecessors = -1;
+            if(!(lineStream >> operationName >> node.level >> node.idxSrcGroup >> node.idxTargetGroup
+                 >> node.nbSrcItems >> node.nbTargetItems >> node.nbInteractions >> node.priority
+                 >> estimatedCost >> node.measuredCost >> nbNodeData) || nbNodeData < 0){
+                return nullptr;
+            }
+
+            long int idxOperation = 0;
+            while(idxOperation < TbfTaskTracer::NbOperations
+                  && operationName != TbfTaskTracer::GetOperationName(static_cast<Operation>(idxOperation))){
+                idxOperation += 1;
+            }
+            if(idxOperation == TbfTaskTracer::NbOperations){
+                return nullptr;
+            }
+            node.operation = static_cast<Operation>(idxOperation);
+
+            node.commuteData.resize(nbNodeData);
+            for(auto& idxData : node.commuteData){
+                if(!(lineStream >> idxData) || idxData < 0 || nbData <= idxData){
+                    return nullptr;
+                }
+            }
+            if(!(lineStream >> nbPredecessors) || nbPredecessors < 0){
+                return nullptr;
+            }
+            node.predecessors.resize(nbPredecessors);
+            for(auto& idxPredecessor : node.predecessors){
+                if(!(lineStream >> idxPredecessor) || idxPredecessor < 0 || graph->getNbNodes() <= idxPredecessor){
+                    return nullptr;
+                }
+            }
+            graph->nodes.emplace_back(std::move(node));
+        }
+
+        if(graph->getNbNodes() != nbNodes){
+            return nullptr;
+        }
+        return graph;
+    }
+
+    // Writes the graph in the DOT format of Graphviz (for small graphs)
+    bool exportDot(const std::string& inFilename) const{
+        std::ofstream file(inFilename, std::ios::trunc);
+        if(!file.is_open()){
+            return false;
+        }
+
+        const char* colors[TbfTaskTracer::NbOperations] = {"#e41a1c", "#ff7f00", "#377eb8", "#984ea3", "#4daf4a", "#a65628"};
+        file << "digraph TbfTaskGraph {\n";
+        file << "  node [style=filled, fontcolor=white];\n";
+        for(long int idxNode = 0 ; idxNode < getNbNodes() ; ++idxNode){
+            const Node& node = nodes[idxNode];
+            file << "  " << idxNode << " [label=\"" << TbfTaskTracer::GetOperationName(node.operation)
+                 << " " << node.level << ":" << node.idxSrcGroup << "->" << node.idxTargetGroup
+                 << "\", fillcolor=\"" << colors[node.operation] << "\"];\n";
+        }
+        for(long int idxNode = 0 ; idxNode < getNbNodes() ; ++idxNode){
+            for(const long int idxPredecessor : nodes[idxNode].predecessors){
+                file << "  " << idxPredecessor << " -> " << idxNode << ";\n";
+            }
+        }
+        file << "}\n";
+
+        return static_cast<bool>(file);
+    }
+};
+
+#endif
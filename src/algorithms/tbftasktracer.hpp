@@ -0,0 +1,332 @@
+#ifndef TBFTASKTRACER_HPP
+#define TBFTASKTRACER_HPP
+
+#include "tbfglobal.hpp"
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <utility>
+#include <cassert>
+
+// Records the execution of the tasks of the parallel algorithms (one record per task),
+// to look at the idle gaps, the critical path and the straggler groups of an execution.
+// Each thread writes in its own ring buffer (registered the first time it records a task),
+// such that recording needs no lock and no atomic operation; when a buffer is full,
+// the oldest records of the thread are overwritten.
+// The records must be read/exported when no task is running (after execute).
+// When it is disabled (the default), a task only tests a boolean.
+class TbfTaskTracer {
+public:
+    enum Operation {
+        OperationP2M,
+        OperationM2M,
+        OperationM2L,
+        OperationL2L,
+        OperationL2P,
+        OperationP2P,
+        NbOperations
+    };
+
+    static const char* GetOperationName(const Operation inOperation){
+        const char* names[NbOperations] = {"P2M", "M2M", "M2L", "L2L", "L2P", "P2P"};
+        assert(0 <= inOperation && inOperation < NbOperations);
+        return names[inOperation];
+    }
+
+    // The times are in nanoseconds since the last clear
+    // The source and target groups are the ones of the operator (for example, the lower
+    // and upper groups for the M2M), and the number of items are their number of cells/particles
+    struct Record {
+        Operation operation;
+        long int level;
+        long int idxSrcGroup;
+        long int idxTargetGroup;
+        long int nbSrcItems;
+        long int nbTargetItems;
+        long int idxThread;
+        long int submitTime;
+        long int startTime;
+        long int endTime;
+    };
+
+    static const long int DefaultCapacityPerThread = 1 << 16;
+    static const long int DefaultMaxNbThreads = 1024;
+
+private:
+    struct alignas(TbfDefaultMemoryAlignement) ThreadBuffer {
+        std::vector<Record> records;
+        long int nbRecorded;
+
+        explicit ThreadBuffer(const long int inCapacity)
+            : records(inCapacity), nbRecorded(0){}
+    };
+
+    const long int tracerId;
+    const long int capacityPerThread;
+    bool isEnabled;
+    std::chrono::steady_clock::time_point origin;
+
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::atomic<long int> nbThreads;
+    std::atomic<long int> nbLostRecords;
+
+    static long int GetNewTracerId(){
+        static std::atomic<long int> counter(0);
+        return counter++;
+    }
+
+    // The slot of the calling thread, registered at the first call
+    long int getThreadSlot(){
+        // A thread can record for several tracers (the ids are never reused)
+        thread_local std::vector<std::pair<long int, long int>> slotsOfThread;
+        for(const auto& tracerAndSlot : slotsOfThread){
+            if(tracerAndSlot.first == tracerId){
+                return tracerAndSlot.second;
+            }
+        }
+        const long int newSlot = nbThreads++;
+        if(newSlot < static_cast<long int>(buffers.size())){
+            // Only this thread accesses this slot
+            buffers[newSlot].reset(new ThreadBuffer(capacityPerThread));
+        }
+        slotsOfThread.emplace_back(tracerId, newSlot);
+        return newSlot;
+    }
+
+    void push(const Record& inRecord){
+        if(inRecord.idxThread < static_cast<long int>(buffers.size())){
+            ThreadBuffer& buffer = *buffers[inRecord.idxThread];
+            buffer.records[buffer.nbRecorded % capacityPerThread] = inRecord;
+            buffer.nbRecorded += 1;
+        }
+        else{
+            nbLostRecords += 1;
+        }
+    }
+
+    long int getTime() const{
+        return static_cast<long int>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count());
+    }
+
+public:
+    // Writes the record of a task when it is destroyed
+    class Guard {
+        TbfTaskTracer* tracer;
+        Record record;
+
+    public:
+        Guard(TbfTaskTracer* inTracer, const Record& inRecord)
+            : tracer(inTracer), record(inRecord){}
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        Guard(Guard&&) = delete;
+        Guard& operator=(Guard&&) = delete;
+
+        ~Guard(){
+            if(tracer){
+                record.endTime = tracer->getTime();
+                tracer->push(record);
+            }
+        }
+    };
+
+    explicit TbfTaskTracer(const long int inCapacityPerThread = DefaultCapacityPerThread,
+                           const long int inMaxNbThreads = DefaultMaxNbThreads)
+        : tracerId(GetNewTracerId()), capacityPerThread(inCapacityPerThread), isEnabled(false),
+          origin(std::chrono::steady_clock::now()), buffers(inMaxNbThreads), nbThreads(0), nbLostRecords(0){
+        assert(inCapacityPerThread > 0);
+    }
+
+    TbfTaskTracer(const TbfTaskTracer&) = delete;
+    TbfTaskTracer& operator=(const TbfTaskTracer&) = delete;
+
+    // Enabling the tracer clears the previous records
+    void setEnabled(const bool inIsEnabled){
+        if(inIsEnabled && !isEnabled){
+            clear();
+        }
+        isEnabled = inIsEnabled;
+    }
+
+    bool getEnabled() const{
+        return isEnabled;
+    }
+
+    // Removes the records, the times of the next records start from zero
+    void clear(){
+        for(auto& buffer : buffers){
+            if(buffer){
+                buffer->nbRecorded = 0;
+            }
+        }
+        nbLostRecords = 0;
+        origin = std::chrono::steady_clock::now();
+    }
+
+    // The submission time of a task, to be called when the task is created
+    long int now() const{
+        return isEnabled ? getTime() : 0;
+    }
+
+    // To be called by the task just before it calls the kernel, the task is recorded
+    // when the returned guard is destroyed
+    Guard trace(const Operation inOperation, const long int inLevel,
+                const long int inIdxSrcGroup, const long int inIdxTargetGroup,
+                const long int inNbSrcItems, const long int inNbTargetItems,
+                const long int inSubmitTime){
+        if(!isEnabled){
+            return Guard(nullptr, Record());
+        }
+        Record record;
+        record.operation = inOperation;
+        record.level = inLevel;
+        record.idxSrcGroup = inIdxSrcGroup;
+        record.idxTargetGroup = inIdxTargetGroup;
+        record.nbSrcItems = inNbSrcItems;
+        record.nbTargetItems = inNbTargetItems;
+        record.idxThread = getThreadSlot();
+        record.submitTime = inSubmitTime;
+        record.startTime = getTime();
+        record.endTime = record.startTime;
+        return Guard(this, record);
+    }
+
+    // The number of threads that have recorded at least one task
+    long int getNbThreads() const{
+        return std::min(nbThreads.load(), static_cast<long int>(buffers.size()));
+    }
+
+    // The records that have been overwritten or that could not be stored
+    long int getNbLostRecords() const{
+        long int nbLost = nbLostRecords.load();
+        for(const auto& buffer : buffers){
+            if(buffer){
+                nbLost += std::max(0L, buffer->nbRecorded - capacityPerThread);
+            }
+        }
+        return nbLost;
+    }
+
+    // The stored records sorted by start time
+    std::vector<Record> getRecords() const{
+        std::vector<Record> allRecords;
+        for(const auto& buffer : buffers){
+            if(buffer){
+                const long int nbStored = std::min(buffer->nbRecorded, capacityPerThread);
+                allRecords.insert(allRecords.end(), buffer->records.begin(), buffer->records.begin() + nbStored);
+            }
+        }
+        std::sort(allRecords.begin(), allRecords.end(), [](const Record& inRec1, const Record& inRec2){
+            return inRec1.startTime < inRec2.startTime
+                    || (inRec1.startTime == inRec2.startTime && inRec1.idxThread < inRec2.idxThread);
+        });
+        return allRecords;
+    }
+
+    // Writes the records in the Chrome trace event format (JSON), which can be opened
+    // with chrome://tracing or Perfetto (one line per thread, the times are in microseconds)
+    bool exportChromeTrace(const std::string& inFilename) const{
+        std::ofstream file(inFilename, std::ios::trunc);
+        if(!file.is_open()){
+            return false;
+        }
+
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        const char* separator = "\n";
+        for(long int idxThread = 0 ; idxThread < getNbThreads() ; ++idxThread){
+            file << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << idxThread
+                 << ",\"args\":{\"name\":\"Thread " << idxThread << "\"}}";
+            separator = ",\n";
+        }
+        const auto allRecords = getRecords();
+        for(const auto& record : allRecords){
+            file << separator << "{\"name\":\"" << GetOperationName(record.operation) << "\",\"cat\":\"" << GetOperationName(record.operation)
+                 << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << record.idxThread
+                 << ",\"ts\":" << static_cast<double>(record.startTime)/1000
+                 << ",\"dur\":" << static_cast<double>(record.endTime - record.startTime)/1000
+                 << ",\"args\":{\"level\":" << record.level
+                 << ",\"srcGroup\":" << record.idxSrcGroup << ",\"targetGroup\":" << record.idxTargetGroup
+                 << ",\"nbSrcItems\":" << record.nbSrcItems << ",\"nbTargetItems\":" << record.nbTargetItems
+                 << ",\"submit\":" << static_cast<double>(record.submitTime)/1000
+                 << ",\"wait\":" << static_cast<double>(record.startTime - record.submitTime)/1000 << "}}";
+            separator = ",\n";
+        }
+        file << "\n]}\n";
+        return static_cast<bool>(file);
+    }
+
+    // Writes the records in the Paje trace format, which can be opened with ViTE
+    // (one container per thread, whose state is the operator or Idle, the times are in seconds)
+    bool exportPaje(const std::string& inFilename) const{
+        std::ofstream file(inFilename, std::ios::trunc);
+        if(!file.is_open()){
+            return false;
+        }
+
+        file << "%EventDef PajeDefineContainerType 0\n%  Alias string\n%  Type string\n%  Name string\n%EndEventDef\n"
+             << "%EventDef PajeDefineStateType 1\n%  Alias string\n%  Type string\n%  Name string\n%EndEventDef\n"
+             << "%EventDef PajeDefineEntityValue 2\n%  Alias string\n%  Type string\n%  Name string\n%  Color color\n%EndEventDef\n"
+             << "%EventDef PajeCreateContainer 3\n%  Time date\n%  Alias string\n%  Type string\n%  Container string\n%  Name string\n%EndEventDef\n"
+             << "%EventDef PajeDestroyContainer 4\n%  Time date\n%  Type string\n%  Name string\n%EndEventDef\n"
+             << "%EventDef PajeSetState 5\n%  Time date\n%  Type string\n%  Container string\n%  Value string\n%EndEventDef\n";
+
+        file << "0 CT_Prog 0 \"Program\"\n"
+             << "0 CT_Thread CT_Prog \"Thread\"\n"
+             << "1 ST_Task CT_Thread \"Task\"\n";
+        const char* colors[NbOperations] = {"1.0 0.0 0.0", "1.0 0.5 0.0", "0.0 0.0 1.0",
+                                            "0.0 0.7 1.0", "0.0 0.8 0.0", "0.6 0.0 0.8"};
+        for(int idxOperation = 0 ; idxOperation < NbOperations ; ++idxOperation){
+            const char* name = GetOperationName(static_cast<Operation>(idxOperation));
+            file << "2 " << name << " ST_Task \"" << name << "\" \"" << colors[idxOperation] << "\"\n";
+        }
+        file << "2 Idle ST_Task \"Idle\" \"0.8 0.8 0.8\"\n";
+
+        const auto allRecords = getRecords();
+        long int lastTime = 0;
+        for(const auto& record : allRecords){
+            lastTime = std::max(lastTime, record.endTime);
+        }
+        auto toSeconds = [](const long int inTime){
+            return static_cast<double>(inTime)/1E9;
+        };
+        file << std::fixed << std::setprecision(9);
+
+        file << "3 0 C_Prog CT_Prog 0 \"Program\"\n";
+        for(long int idxThread = 0 ; idxThread < getNbThreads() ; ++idxThread){
+            file << "3 0 C_T" << idxThread << " CT_Thread C_Prog \"Thread " << idxThread << "\"\n";
+            file << "5 0 ST_Task C_T" << idxThread << " Idle\n";
+        }
+
+        // The events must be sorted by time, and the end of a task before the start of the next one
+        std::vector<std::pair<long int, std::string>> events;
+        events.reserve(2*allRecords.size());
+        for(const auto& record : allRecords){
+            const std::string container = " ST_Task C_T" + std::to_string(record.idxThread) + " ";
+            events.emplace_back(2*record.startTime+1, container + GetOperationName(record.operation));
+            events.emplace_back(2*record.endTime, container + "Idle");
+        }
+        std::stable_sort(events.begin(), events.end(), [](const auto& inEvent1, const auto& inEvent2){
+            return inEvent1.first < inEvent2.first;
+        });
+        for(const auto& event : events){
+            file << "5 " << toSeconds(event.first/2) << event.second << "\n";
+        }
+
+        for(long int idxThread = 0 ; idxThread < getNbThreads() ; ++idxThread){
+            file << "4 " << toSeconds(lastTime) << " CT_Thread C_T" << idxThread << "\n";
+        }
+        file << "4 " << toSeconds(lastTime) << " CT_Prog C_Prog\n";
+        return static_cast<bool>(file);
+    }
+};
+
+#endif
@@ -0,0 +1,512 @@
+#ifndef TBFTASKRUNTIME_HPP
+#define TBFTASKRUNTIME_HPP
+
+#include "tbfglobal.hpp"
+
+#include "algorithms/threadpool/tbfworkstealingdeque.hpp"
+#include "containers/tbffixedcapacityvector.hpp"
+#include "utils/tbfnuma.hpp"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <initializer_list>
+#include <algorithm>
+#include <new>
+#include <type_traits>
+#include <cstddef>
+#include <cassert>
+
+// A task-based runtime system that only needs std::thread.
+// The dependencies are computed from the data accessed by the tasks, in the order
+// of insertion (as with OpenMP depend or Spetabaru):
+// - Read: after the last writes,
+// - Write: after all the previous accesses,
+// - CommuteWrite: after the previous reads and writes, the consecutive commutative
+//   writes on a data can be executed in any order but not at the same time.
+// Each worker has one Chase-Lev deque per priority, the workers execute their own tasks
+// with the highest priority first, and steal the others' tasks otherwise.
+// The thread that inserts the tasks is the worker 0, it works when it calls waitAllTasks,
+// and the tasks cannot insert other tasks.
+// With several NUMA nodes, the workers are distributed on the nodes by contiguous intervals
+// (the worker threads are bound to the CPUs of their node) and a task can have a home node:
+// when it becomes ready on a worker of another node, it is put in the queue of its home node.
+// A worker looks for a task in its deques, in the queue of its node, in the deques of
+// the workers of its node, and only then in the other nodes.
+class TbfTaskRuntime {
+public:
+    enum class AccessMode {
+        Read,
+        Write,
+        CommuteWrite
+    };
+
+    struct Access {
+        const void* data;
+        AccessMode mode;
+    };
+
+    template <class DataType>
+    static Access Read(const DataType& inData){
+        return Access{&inData, AccessMode::Read};
+    }
+
+    template <class DataType>
+    static Access Write(DataType& inData){
+        return Access{&inData, AccessMode::Write};
+    }
+
+    template <class DataType>
+    static Access CommuteWrite(DataType& inData){
+        return Access{&inData, AccessMode::CommuteWrite};
+    }
+
+private:
+    static constexpr long int MaxAccessesPerTask = 8;
+    // The callables of the tasks are stored in the tasks if they are not bigger
+    static constexpr long int FunctionBufferSize = 128;
+    // Number of attempts to find a task before sleeping
+    static constexpr long int NbSpinsBeforeSleep = 64;
+
+    struct Task;
+
+    struct DataHandle {
+        // Used by the inserting thread only
+        AccessMode currentMode = AccessMode::Read;
+        std::vector<Task*> currentTasks;
+        std::vector<Task*> previousTasks;
+        bool isUsed = false;
+
+        // Mutual exclusion of the commutative writes
+        std::mutex mutex;
+        bool isLocked = false;
+        std::vector<Task*> waitingTasks;
+    };
+
+    struct Task {
+        alignas(std::max_align_t) unsigned char functionBuffer[FunctionBufferSize];
+        void* function = nullptr;
+        void (*invokeFunction)(void*) = nullptr;
+        void (*releaseFunction)(void*) = nullptr;
+
+        int priority = 0;
+        int homeNode = -1;
+        TbfFixedCapacityVector<DataHandle*, MaxAccessesPerTask> commuteHandles;
+
+        std::atomic<long int> nbPredecessors{0};
+        std::mutex mutex;
+        bool isFinished = false;
+        std::vector<Task*> successors;
+
+        template <class FuncType>
+        void setFunction(FuncType&& inFunc){
+            using FunctionType = typename std::decay<FuncType>::type;
+            if constexpr(sizeof(FunctionType) <= FunctionBufferSize && alignof(FunctionType) <= alignof(std::max_align_t)){
+                function = new (functionBuffer) FunctionType(std::forward<FuncType>(inFunc));
+                releaseFunction = [](void* inFunction){
+                    static_cast<FunctionType*>(inFunction)->~FunctionType();
+                };
+            }
+            else{
+                function = new FunctionType(std::forward<FuncType>(inFunc));
+                releaseFunction = [](void* inFunction){
+                    delete static_cast<FunctionType*>(inFunction);
+                };
+            }
+            invokeFunction = [](void* inFunction){
+                (*static_cast<FunctionType*>(inFunction))();
+            };
+        }
+    };
+
+    struct Worker {
+        int node = 0;
+        std::vector<std::unique_ptr<TbfWorkStealingDeque<Task*>>> deques;
+        std::vector<Task*> releasedTasks;
+    };
+
+    // The tasks that became ready on a worker of another node (one FIFO per priority)
+    struct Node {
+        std::mutex mutex;
+        std::vector<std::deque<Task*>> queues;
+        std::atomic<long int> nbTasks{0};
+    };
+
+    const int nbThreads;
+    const int nbPriorities;
+    const int nbNodes;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::vector<std::thread> threads;
+
+    // The tasks are kept between the executions (to reuse the memory)
+    std::deque<Task> tasks;
+    long int nbUsedTasks;
+
+    std::unordered_map<const void*, DataHandle> handles;
+    std::vector<DataHandle*> usedHandles;
+
+    std::atomic<long int> nbReadyTasks;
+    std::atomic<long int> nbUnfinishedTasks;
+    std::atomic<long int> nbSleepingThreads;
+    std::atomic<bool> stopWorkers;
+
+    std::mutex idleMutex;
+    std::condition_variable idleCondition;
+
+    static int& CurrentWorkerId(){
+        static thread_local int workerId = -1;
+        return workerId;
+    }
+
+    Task& getNewTask(){
+        if(nbUsedTasks == static_cast<long int>(tasks.size())){
+            tasks.emplace_back();
+        }
+        Task& newTask = tasks[nbUsedTasks];
+        nbUsedTasks += 1;
+
+        newTask.commuteHandles.clear();
+        newTask.successors.clear();
+        newTask.isFinished = false;
+        return newTask;
+    }
+
+    DataHandle& getHandle(const void* inData){
+        DataHandle& handle = handles[inData];
+        if(handle.isUsed == false){
+            handle.isUsed = true;
+            usedHandles.push_back(&handle);
+        }
+        return handle;
+    }
+
+    static void AddDependency(Task& inPredecessor, Task& inSuccessor){
+        std::lock_guard<std::mutex> lock(inPredecessor.mutex);
+        if(inPredecessor.isFinished == false){
+            inPredecessor.successors.push_back(&inSuccessor);
+            inSuccessor.nbPredecessors += 1;
+        }
+    }
+
+    static void RegisterAccess(DataHandle& inHandle, Task& inTask, const AccessMode inMode){
+        if(inHandle.currentTasks.empty() || inHandle.currentMode != inMode || inMode == AccessMode::Write){
+            std::swap(inHandle.previousTasks, inHandle.currentTasks);
+            inHandle.currentTasks.clear();
+            inHandle.currentMode = inMode;
+        }
+        for(Task* predecessor : inHandle.previousTasks){
+            if(predecessor != &inTask){
+                AddDependency(*predecessor, inTask);
+            }
+        }
+        inHandle.currentTasks.push_back(&inTask);
+    }
+
+    void pushReadyTask(const int inWorkerId, Task& inTask){
+        if(inTask.homeNode != -1 && inTask.homeNode != workers[inWorkerId]->node){
+            Node& homeNode = *nodes[inTask.homeNode];
+            std::lock_guard<std::mutex> lock(homeNode.mutex);
+            homeNode.queues[inTask.priority].push_back(&inTask);
+            homeNode.nbTasks += 1;
+        }
+        else{
+            workers[inWorkerId]->deques[inTask.priority]->push(&inTask);
+        }
+        nbReadyTasks += 1;
+        if(nbSleepingThreads.load() != 0){
+            std::lock_guard<std::mutex> lock(idleMutex);
+            idleCondition.notify_one();
+        }
+    }
+
+    Task* popFromNode(const int inNode){
+        Node& node = *nodes[inNode];
+        if(node.nbTasks.load() == 0){
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(node.mutex);
+        for(int idxPriority = nbPriorities-1 ; idxPriority >= 0 ; --idxPriority){
+            if(node.queues[idxPriority].size()){
+                Task* task = node.queues[idxPriority].front();
+                node.queues[idxPriority].pop_front();
+                node.nbTasks -= 1;
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    // Steals from the workers that are (or are not if inSameNode is false) on the node of inWorkerId
+    Task* stealFromWorkers(const int inWorkerId, const bool inSameNode){
+        const int workerNode = workers[inWorkerId]->node;
+        for(int idxPriority = nbPriorities-1 ; idxPriority >= 0 ; --idxPriority){
+            for(int idxOffset = 1 ; idxOffset < nbThreads ; ++idxOffset){
+                const int idxVictim = (inWorkerId + idxOffset) % nbThreads;
+                if((workers[idxVictim]->node == workerNode) == inSameNode){
+                    if(Task* task = workers[idxVictim]->deques[idxPriority]->steal()){
+                        return task;
+                    }
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    Task* findTaskInNodes(const int inWorkerId){
+        Worker& worker = *workers[inWorkerId];
+        for(int idxPriority = nbPriorities-1 ; idxPriority >= 0 ; --idxPriority){
+            if(Task* task = worker.deques[idxPriority]->pop()){
+                return task;
+            }
+        }
+        if(Task* task = popFromNode(worker.node)){
+            return task;
+        }
+        if(Task* task = stealFromWorkers(inWorkerId, true)){
+            return task;
+        }
+        for(int idxOffset = 1 ; idxOffset < nbNodes ; ++idxOffset){
+            if(Task* task = popFromNode((worker.node + idxOffset) % nbNodes)){
+                return task;
+            }
+        }
+        return stealFromWorkers(inWorkerId, false);
+    }
+
+    Task* findTask(const int inWorkerId){
+        if(nbReadyTasks.load() == 0){
+            return nullptr;
+        }
+        Task* task = findTaskInNodes(inWorkerId);
+        if(task){
+            nbReadyTasks -= 1;
+        }
+        return task;
+    }
+
+    void releaseHandle(const int inWorkerId, DataHandle& inHandle){
+        Worker& worker = *workers[inWorkerId];
+        {
+            std::lock_guard<std::mutex> lock(inHandle.mutex);
+            inHandle.isLocked = false;
+            worker.releasedTasks.insert(worker.releasedTasks.end(), inHandle.waitingTasks.begin(), inHandle.waitingTasks.end());
+            inHandle.waitingTasks.clear();
+        }
+        for(Task* task : worker.releasedTasks){
+            pushReadyTask(inWorkerId, *task);
+        }
+        worker.releasedTasks.clear();
+    }
+
+    // If a commutative data is used by another task, inTask waits
+    // for it to be released and it is pushed again
+    bool acquireHandles(const int inWorkerId, Task& inTask){
+        for(long int idxHandle = 0 ; idxHandle < inTask.commuteHandles.size() ; ++idxHandle){
+            DataHandle& handle = *inTask.commuteHandles[idxHandle];
+            std::unique_lock<std::mutex> lock(handle.mutex);
+            if(handle.isLocked){
+                handle.waitingTasks.push_back(&inTask);
+                lock.unlock();
+                for(long int idxAcquired = 0 ; idxAcquired < idxHandle ; ++idxAcquired){
+                    releaseHandle(inWorkerId, *inTask.commuteHandles[idxAcquired]);
+                }
+                return false;
+            }
+            handle.isLocked = true;
+        }
+        return true;
+    }
+
+    void executeTask(const int inWorkerId, Task& inTask){
+        if(acquireHandles(inWorkerId, inTask) == false){
+            return;
+        }
+
+        inTask.invokeFunction(inTask.function);
+        inTask.releaseFunction(inTask.function);
+
+        for(DataHandle* handle : inTask.commuteHandles){
+            releaseHandle(inWorkerId, *handle);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(inTask.mutex);
+            inTask.isFinished = true;
+        }
+        // No successor can be added once the task is finished
+        for(Task* successor : inTask.successors){
+            if(successor->nbPredecessors.fetch_sub(1) == 1){
+                pushReadyTask(inWorkerId, *successor);
+            }
+        }
+
+        if(nbUnfinishedTasks.fetch_sub(1) == 1 && nbSleepingThreads.load() != 0){
+            std::lock_guard<std::mutex> lock(idleMutex);
+            idleCondition.notify_all();
+        }
+    }
+
+    template <class PredicateType>
+    void waitForWork(PredicateType&& inPredicate){
+        for(long int idxSpin = 0 ; idxSpin < NbSpinsBeforeSleep ; ++idxSpin){
+            if(inPredicate()){
+                return;
+            }
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(idleMutex);
+        nbSleepingThreads += 1;
+        idleCondition.wait(lock, inPredicate);
+        nbSleepingThreads -= 1;
+    }
+
+    void workerLoop(const int inWorkerId){
+        CurrentWorkerId() = inWorkerId;
+        while(true){
+            if(Task* task = findTask(inWorkerId)){
+                executeTask(inWorkerId, *task);
+            }
+            else if(stopWorkers.load()){
+                break;
+            }
+            else{
+                waitForWork([this](){
+                    return nbReadyTasks.load() != 0 || stopWorkers.load();
+                });
+            }
+        }
+    }
+
+public:
+    // The calling thread (the worker 0) is considered to be on the node 0 but it is not bound
+    explicit TbfTaskRuntime(const int inNbThreads, const int inNbPriorities = 1, const int inNbNodes = 1)
+        : nbThreads(std::max(1, inNbThreads)), nbPriorities(std::max(1, inNbPriorities)), nbNodes(std::max(1, inNbNodes)),
+          nbUsedTasks(0), nbReadyTasks(0), nbUnfinishedTasks(0), nbSleepingThreads(0), stopWorkers(false){
+        for(int idxWorker = 0 ; idxWorker < nbThreads ; ++idxWorker){
+            workers.emplace_back(new Worker);
+            workers.back()->node = TbfNuma::GetNodeOfPosition(idxWorker, nbThreads, nbNodes);
+            for(int idxPriority = 0 ; idxPriority < nbPriorities ; ++idxPriority){
+                workers.back()->deques.emplace_back(new TbfWorkStealingDeque<Task*>());
+            }
+        }
+        for(int idxNode = 0 ; idxNode < nbNodes ; ++idxNode){
+            nodes.emplace_back(new Node);
+            nodes.back()->queues.resize(nbPriorities);
+        }
+        threads.reserve(nbThreads-1);
+        for(int idxWorker = 1 ; idxWorker < nbThreads ; ++idxWorker){
+            threads.emplace_back([this, idxWorker](){
+                if(nbNodes > 1){
+                    TbfNuma::BindCurrentThreadToNode(workers[idxWorker]->node);
+                }
+                workerLoop(idxWorker);
+            });
+        }
+    }
+
+    ~TbfTaskRuntime(){
+        waitAllTasks();
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            stopWorkers = true;
+        }
+        idleCondition.notify_all();
+        for(auto& thread : threads){
+            thread.join();
+        }
+    }
+
+    TbfTaskRuntime(const TbfTaskRuntime&) = delete;
+    TbfTaskRuntime& operator=(const TbfTaskRuntime&) = delete;
+
+    // Insert a task that accesses inAccesses (priority in [0, getNbPriorities()[)
+    template <class FuncType>
+    void task(const int inPriority, std::initializer_list<Access> inAccesses, FuncType&& inFunc){
+        task(inPriority, -1, inAccesses, std::forward<FuncType>(inFunc));
+    }
+
+    // Insert a task that should be executed by a worker of inHomeNode (in [0, getNbNodes()[,
+    // or -1 if the task has no home node)
+    template <class FuncType>
+    void task(const int inPriority, const int inHomeNode, std::initializer_list<Access> inAccesses, FuncType&& inFunc){
+        assert(0 <= inPriority && inPriority < nbPriorities);
+        assert(-1 <= inHomeNode && inHomeNode < nbNodes);
+        assert(static_cast<long int>(inAccesses.size()) <= MaxAccessesPerTask);
+
+        Task& newTask = getNewTask();
+        newTask.setFunction(std::forward<FuncType>(inFunc));
+        newTask.priority = inPriority;
+        newTask.homeNode = (nbNodes > 1 ? inHomeNode : -1);
+        // Prevent the task from being executed during the insertion
+        newTask.nbPredecessors = 1;
+        nbUnfinishedTasks += 1;
+
+        for(const Access& access : inAccesses){
+            DataHandle& handle = getHandle(access.data);
+            RegisterAccess(handle, newTask, access.mode);
+            if(access.mode == AccessMode::CommuteWrite){
+                newTask.commuteHandles.emplace_back(&handle);
+            }
+        }
+        // The handles are locked in the same order by all the tasks
+        std::sort(newTask.commuteHandles.begin(), newTask.commuteHandles.end());
+
+        if(newTask.nbPredecessors.fetch_sub(1) == 1){
+            pushReadyTask(0, newTask);
+        }
+    }
+
+    // The calling thread executes tasks until all the tasks are over
+    void waitAllTasks(){
+        CurrentWorkerId() = 0;
+        while(nbUnfinishedTasks.load() != 0){
+            if(Task* task = findTask(0)){
+                executeTask(0, *task);
+            }
+            else{
+                waitForWork([this](){
+                    return nbReadyTasks.load() != 0 || nbUnfinishedTasks.load() == 0;
+                });
+            }
+        }
+
+        for(DataHandle* handle : usedHandles){
+            handle->currentTasks.clear();
+            handle->previousTasks.clear();
+            handle->isUsed = false;
+        }
+        usedHandles.clear();
+        nbUsedTasks = 0;
+    }
+
+    int getNbThreads() const{
+        return nbThreads;
+    }
+
+    int getNbPriorities() const{
+        return nbPriorities;
+    }
+
+    int getNbNodes() const{
+        return nbNodes;
+    }
+
+    // The node of the worker inWorkerId
+    int getWorkerNode(const int inWorkerId) const{
+        return workers[inWorkerId]->node;
+    }
+
+    // The id of the worker that executes the current task, in [0, getNbThreads()[
+    static int GetWorkerId(){
+        return CurrentWorkerId();
+    }
+};
+
+#endif
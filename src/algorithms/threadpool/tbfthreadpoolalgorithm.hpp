@@ -0,0 +1,600 @@
+#ifndef TBFTHREADPOOLALGORITHM_HPP
+#define TBFTHREADPOOLALGORITHM_HPP
+
+#include "tbfglobal.hpp"
+
+#include "../sequential/tbfgroupkernelinterface.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "core/tbfinteraction.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/tbfcriticalpathpriorities.hpp"
+#include "algorithms/tbftasktracer.hpp"
+#include "algorithms/tbftaskgraph.hpp"
+#include "core/tbfinteractionplan.hpp"
+#include "utils/tbfparallel.hpp"
+
+#include "algorithms/threadpool/tbftaskruntime.hpp"
+
+
+#include <cassert>
+#include <iterator>
+#include <memory>
+
+template <class RealType_T, class KernelClass_T, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
+class TbfThreadPoolAlgorithm {
+public:
+    using RealType = RealType_T;
+    using KernelClass = KernelClass_T;
+    using SpaceIndexType = SpaceIndexType_T;
+    using SpacialConfiguration = TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>;
+
+protected:
+    const SpacialConfiguration configuration;
+    const SpaceIndexType spaceSystem;
+
+    const long int stopUpperLevel;
+
+    TbfGroupKernelInterface<SpaceIndexType> kernelWrapper;
+    std::vector<KernelClass> kernels;
+
+    // The fixed priorities, or the ones of the critical path if enabled
+    TbfCriticalPathPriorities priorities;
+
+    // Records the tasks if enabled
+    TbfTaskTracer tracer;
+
+    // Records the task graph of the last execution if enabled
+    TbfTaskGraph taskGraph;
+
+    // The interaction lists used by the tasks (the tasks have a view on them)
+    TbfAlgorithmUtils::TbfTaskDataPool<std::vector<TbfXtoXInteraction<typename SpaceIndexType::IndexType>>> interactionsPool;
+
+    // The interaction lists computed in parallel before the M2L/P2P tasks are created
+    TbfAlgorithmUtils::TbfInteractionListsCache<typename SpaceIndexType::IndexType> interactionLists;
+
+    // If true, the M2L and P2P use the interaction plan of the tree
+    bool useInteractionPlan;
+
+    // The threads are kept between the executions
+    std::unique_ptr<TbfTaskRuntime> taskRuntime;
+
+    template <class TreeClass>
+    void P2M(TbfTaskRuntime& runtime, TreeClass& inTree){
+        if(configuration.getTreeHeight() > stopUpperLevel){
+            auto& leafGroups = inTree.getLeafGroups();
+            const auto& particleGroups = inTree.getParticleGroups();
+
+            assert(std::size(leafGroups) == std::size(particleGroups));
+
+            auto currentLeafGroup = leafGroups.begin();
+            auto currentParticleGroup = particleGroups.cbegin();
+
+            const auto endLeafGroup = leafGroups.end();
+            const auto endParticleGroup = particleGroups.cend();
+
+            while(currentLeafGroup != endLeafGroup && currentParticleGroup != endParticleGroup){
+                assert((*currentParticleGroup).getStartingSpacialIndex() == (*currentLeafGroup).getStartingSpacialIndex()
+                       && (*currentParticleGroup).getEndingSpacialIndex() == (*currentLeafGroup).getEndingSpacialIndex()
+                       && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
+                auto& leafGroupObj = *currentLeafGroup;
+                const auto& particleGroupObj = *currentParticleGroup;
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  particleGroupObj.getNbParticles(), leafGroupObj.getNbCells(), 0, priorities.getP2MPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(*particleGroupObj.getDataPtr()), TbfTaskGraph::CommuteWrite(*leafGroupObj.getMultipolePtr())});
+                runtime.task(priorities.getP2MPriority(idxGroup), getHomeNode(idxGroup, std::size(leafGroups)), {TbfTaskRuntime::Read(*particleGroupObj.getDataPtr()), TbfTaskRuntime::CommuteWrite(*leafGroupObj.getMultipolePtr())},
+                                   [this, graphNode, idxGroup, &leafGroupObj, &particleGroupObj, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         particleGroupObj.getNbParticles(), leafGroupObj.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageP2M, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.P2M(kernels[TbfTaskRuntime::GetWorkerId()], particleGroupObj, leafGroupObj);
+                    });
+                });
+                ++currentParticleGroup;
+                ++currentLeafGroup;
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void M2M(TbfTaskRuntime& runtime, TreeClass& inTree){
+        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= stopUpperLevel ; --idxLevel){
+            auto& upperCellGroup = inTree.getCellGroupsAtLevel(idxLevel);
+            const auto& lowerCellGroup = inTree.getCellGroupsAtLevel(idxLevel+1);
+
+            auto currentUpperGroup = upperCellGroup.begin();
+            auto currentLowerGroup = lowerCellGroup.cbegin();
+
+            const auto endUpperGroup = upperCellGroup.end();
+            const auto endLowerGroup = lowerCellGroup.cend();
+
+            while(currentUpperGroup != endUpperGroup && currentLowerGroup != endLowerGroup){
+                assert(spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()
+                       || currentUpperGroup->getStartingSpacialIndex() <= spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()));
+
+                auto& upperGroup = *currentUpperGroup;
+                const auto& lowerGroup = *currentLowerGroup;
+                const long int idxUpperGroup = std::distance(upperCellGroup.begin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.cbegin(), currentLowerGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                                  lowerGroup.getNbCells(), upperGroup.getNbCells(), 0, priorities.getM2MPriority(idxLevel, idxUpperGroup),
+                                                                  {TbfTaskGraph::Read(*lowerGroup.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*upperGroup.getMultipolePtr())});
+                runtime.task(priorities.getM2MPriority(idxLevel, idxUpperGroup), getHomeNode(idxUpperGroup, std::size(upperCellGroup)), {TbfTaskRuntime::Read(*lowerGroup.getMultipolePtr()), TbfTaskRuntime::CommuteWrite(*upperGroup.getMultipolePtr())},
+                                   [this, graphNode, idxLevel, idxUpperGroup, idxLowerGroup, &upperGroup, &lowerGroup, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                         lowerGroup.getNbCells(), upperGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageM2M, idxLevel, idxUpperGroup, [&](){
+                        kernelWrapper.M2M(idxLevel, kernels[TbfTaskRuntime::GetWorkerId()], lowerGroup, upperGroup);
+                    });
+                });
+
+                if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
+                    ++currentLowerGroup;
+                    if(currentLowerGroup != endLowerGroup && currentUpperGroup->getEndingSpacialIndex() < spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex())){
+                        ++currentUpperGroup;
+                    }
+                }
+                else{
+                    ++currentUpperGroup;
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void M2L(TbfTaskRuntime& runtime, TreeClass& inTree){
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
+            auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+
+            auto currentCellGroup = cellGroups.begin();
+            const auto endCellGroup = cellGroups.end();
+
+            while(currentCellGroup != endCellGroup){
+                const long int idxGroup = std::distance(cellGroups.begin(), currentCellGroup);
+                auto& indexesForGroup = interactionLists.getM2LLists(idxLevel, idxGroup);
+                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), cellGroups, idxGroup,
+                                               [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
+                    assert(&groupTarget == &*currentCellGroup);
+
+                    TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, static_cast<long int>(&groupSrc - cellGroups.data()), idxGroup,
+                                                                      groupSrc.getNbCells(), groupTarget.getNbCells(), static_cast<long int>(indexes.size()),
+                                                                      priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                      {TbfTaskGraph::Read(*groupSrc.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*groupTarget.getLocalPtr())});
+                    runtime.task(priorities.getM2LPriority(idxLevel, idxGroup), getHomeNode(idxGroup, std::size(cellGroups)), {TbfTaskRuntime::Read(*groupSrc.getMultipolePtr()), TbfTaskRuntime::CommuteWrite(*groupTarget.getLocalPtr())},
+                                       [this, graphNode, idxLevel, idxGroup, idxSrcGroup = static_cast<long int>(&groupSrc - cellGroups.data()),
+                                        indexesView = indexes, &groupSrc, &groupTarget, traceSubmitTime = tracer.now()](){
+                        const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxSrcGroup, idxGroup,
+                                                             groupSrc.getNbCells(), groupTarget.getNbCells(), traceSubmitTime);
+                        const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                        priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                            kernelWrapper.M2LBetweenGroups(idxLevel, kernels[TbfTaskRuntime::GetWorkerId()], groupTarget, groupSrc, indexesView);
+                        });
+                    });
+                });
+
+                auto& currentGroup = *currentCellGroup;
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                                  currentGroup.getNbCells(), currentGroup.getNbCells(), static_cast<long int>(indexesForGroup.first.size()),
+                                                                  priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                  {TbfTaskGraph::Read(*currentGroup.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getLocalPtr())});
+                runtime.task(priorities.getM2LPriority(idxLevel, idxGroup), getHomeNode(idxGroup, std::size(cellGroups)), {TbfTaskRuntime::Read(*currentGroup.getMultipolePtr()), TbfTaskRuntime::CommuteWrite(*currentGroup.getLocalPtr())},
+                                   [this, graphNode, idxLevel, idxGroup, indexesForGroup_first = &interactionsPool.store(std::move(indexesForGroup.first)), &currentGroup, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                         currentGroup.getNbCells(), currentGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                        kernelWrapper.M2LInGroup(idxLevel, kernels[TbfTaskRuntime::GetWorkerId()], currentGroup, *indexesForGroup_first);
+                    });
+                });
+
+                ++currentCellGroup;
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void M2LWithPlan(TbfTaskRuntime& runtime, TreeClass& inTree, const TbfInteractionPlan& inInteractionPlan){
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
+            auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+
+            for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(cellGroups)) ; ++idxGroup){
+                auto& currentGroup = cellGroups[idxGroup];
+
+                const auto blocks = inInteractionPlan.getM2LBlocksBetweenGroups(idxLevel, idxGroup);
+                for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                    const auto block = blocks[idxBlock];
+                    const auto& groupSrc = cellGroups[block.idxSrcGroup];
+
+                    TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, block.idxSrcGroup, idxGroup,
+                                                                      groupSrc.getNbCells(), currentGroup.getNbCells(), block.nbInteractions,
+                                                                      priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                      {TbfTaskGraph::Read(*groupSrc.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getLocalPtr())});
+                    runtime.task(priorities.getM2LPriority(idxLevel, idxGroup), getHomeNode(idxGroup, std::size(cellGroups)), {TbfTaskRuntime::Read(*groupSrc.getMultipolePtr()), TbfTaskRuntime::CommuteWrite(*currentGroup.getLocalPtr())},
+                                       [this, graphNode, idxLevel, idxGroup, block, &inInteractionPlan, &groupSrc, &currentGroup, traceSubmitTime = tracer.now()](){
+                        const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, block.idxSrcGroup, idxGroup,
+                                                             groupSrc.getNbCells(), currentGroup.getNbCells(), traceSubmitTime);
+                        const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                        priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                            kernelWrapper.M2LFromPlan(idxLevel, kernels[TbfTaskRuntime::GetWorkerId()], currentGroup, groupSrc,
+                                                      inInteractionPlan.getM2LInteractions(idxLevel, block));
+                        });
+                    });
+                }
+
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                                  currentGroup.getNbCells(), currentGroup.getNbCells(),
+                                                                  inInteractionPlan.getM2LInteractionsInGroup(idxLevel, idxGroup).size(),
+                                                                  priorities.getM2LPriority(idxLevel, idxGroup),
+                                                                  {TbfTaskGraph::Read(*currentGroup.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getLocalPtr())});
+                runtime.task(priorities.getM2LPriority(idxLevel, idxGroup), getHomeNode(idxGroup, std::size(cellGroups)), {TbfTaskRuntime::Read(*currentGroup.getMultipolePtr()), TbfTaskRuntime::CommuteWrite(*currentGroup.getLocalPtr())},
+                                   [this, graphNode, idxLevel, idxGroup, &inInteractionPlan, &currentGroup, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxGroup, idxGroup,
+                                                         currentGroup.getNbCells(), currentGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageM2L, idxLevel, idxGroup, [&](){
+                        kernelWrapper.M2LFromPlan(idxLevel, kernels[TbfTaskRuntime::GetWorkerId()], currentGroup, TbfUtils::make_const(currentGroup),
+                                                  inInteractionPlan.getM2LInteractionsInGroup(idxLevel, idxGroup));
+                    });
+                });
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void L2L(TbfTaskRuntime& runtime, TreeClass& inTree){
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
+            const auto& upperCellGroup = inTree.getCellGroupsAtLevel(idxLevel);
+            auto& lowerCellGroup = inTree.getCellGroupsAtLevel(idxLevel+1);
+
+            auto currentUpperGroup = upperCellGroup.cbegin();
+            auto currentLowerGroup = lowerCellGroup.begin();
+
+            const auto endUpperGroup = upperCellGroup.cend();
+            const auto endLowerGroup = lowerCellGroup.end();
+
+            while(currentUpperGroup != endUpperGroup && currentLowerGroup != endLowerGroup){
+                assert(spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()
+                       || currentUpperGroup->getStartingSpacialIndex() <= spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()));
+
+                const auto& upperGroup = *currentUpperGroup;
+                auto& lowerGroup = *currentLowerGroup;
+                const long int idxLowerGroup = std::distance(lowerCellGroup.begin(), currentLowerGroup);
+                const long int idxUpperGroup = std::distance(upperCellGroup.cbegin(), currentUpperGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                                  upperGroup.getNbCells(), lowerGroup.getNbCells(), 0, priorities.getL2LPriority(idxLevel, idxLowerGroup),
+                                                                  {TbfTaskGraph::Read(*upperGroup.getLocalPtr()), TbfTaskGraph::CommuteWrite(*lowerGroup.getLocalPtr())});
+                runtime.task(priorities.getL2LPriority(idxLevel, idxLowerGroup), getHomeNode(idxLowerGroup, std::size(lowerCellGroup)), {TbfTaskRuntime::Read(*upperGroup.getLocalPtr()), TbfTaskRuntime::CommuteWrite(*lowerGroup.getLocalPtr())},
+                                   [this, graphNode, idxLevel, idxLowerGroup, idxUpperGroup, &upperGroup, &lowerGroup, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                         upperGroup.getNbCells(), lowerGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageL2L, idxLevel, idxLowerGroup, [&](){
+                        kernelWrapper.L2L(idxLevel, kernels[TbfTaskRuntime::GetWorkerId()], upperGroup, lowerGroup);
+                    });
+                });
+
+                if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
+                    ++currentLowerGroup;
+                    if(currentLowerGroup != endLowerGroup && currentUpperGroup->getEndingSpacialIndex() < spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex())){
+                        ++currentUpperGroup;
+                    }
+                }
+                else{
+                    ++currentUpperGroup;
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void L2P(TbfTaskRuntime& runtime, TreeClass& inTree){
+        if(configuration.getTreeHeight() > stopUpperLevel){
+            const auto& leafGroups = inTree.getLeafGroups();
+            auto& particleGroups = inTree.getParticleGroups();
+
+            assert(std::size(leafGroups) == std::size(particleGroups));
+
+            auto currentLeafGroup = leafGroups.cbegin();
+            auto currentParticleGroup = particleGroups.begin();
+
+            const auto endLeafGroup = leafGroups.cend();
+            const auto endParticleGroup = particleGroups.end();
+
+            while(currentLeafGroup != endLeafGroup && currentParticleGroup != endParticleGroup){
+                assert((*currentParticleGroup).getStartingSpacialIndex() == (*currentLeafGroup).getStartingSpacialIndex()
+                       && (*currentParticleGroup).getEndingSpacialIndex() == (*currentLeafGroup).getEndingSpacialIndex()
+                       && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
+
+                const auto& leafGroupObj = *currentLeafGroup;
+                auto& particleGroupObj = *currentParticleGroup;
+                const long int idxGroup = std::distance(particleGroups.begin(), currentParticleGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  leafGroupObj.getNbCells(), particleGroupObj.getNbParticles(), 0, priorities.getL2PPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(*leafGroupObj.getLocalPtr()),
+                                                                   TbfTaskGraph::Read(*particleGroupObj.getDataPtr()), TbfTaskGraph::CommuteWrite(*particleGroupObj.getRhsPtr())});
+                runtime.task(priorities.getL2PPriority(idxGroup), getHomeNode(idxGroup, std::size(particleGroups)), {TbfTaskRuntime::Read(*leafGroupObj.getLocalPtr()),
+                             TbfTaskRuntime::Read(*particleGroupObj.getDataPtr()), TbfTaskRuntime::CommuteWrite(*particleGroupObj.getRhsPtr())},
+                                   [this, graphNode, idxGroup, &leafGroupObj, &particleGroupObj, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         leafGroupObj.getNbCells(), particleGroupObj.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageL2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.L2P(kernels[TbfTaskRuntime::GetWorkerId()], leafGroupObj, particleGroupObj);
+                    });
+                });
+
+                ++currentParticleGroup;
+                ++currentLeafGroup;
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void P2P(TbfTaskRuntime& runtime, TreeClass& inTree){
+        auto& particleGroups = inTree.getParticleGroups();
+
+        auto currentParticleGroup = particleGroups.begin();
+        const auto endParticleGroup = particleGroups.end();
+
+        while(currentParticleGroup != endParticleGroup){
+            const long int idxGroup = std::distance(particleGroups.begin(), currentParticleGroup);
+
+            auto& indexesForGroup = interactionLists.getP2PLists(idxGroup);
+            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), particleGroups, idxGroup,
+                                           [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
+                assert(&groupTarget == &*currentParticleGroup);
+
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, static_cast<long int>(&groupSrc - particleGroups.data()), idxGroup,
+                                                                  groupSrc.getNbParticles(), groupTarget.getNbParticles(), static_cast<long int>(indexes.size()),
+                                                                  priorities.getP2PPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(*groupSrc.getDataPtr()), TbfTaskGraph::CommuteWrite(*groupSrc.getRhsPtr()),
+                                                                   TbfTaskGraph::Read(*groupTarget.getDataPtr()), TbfTaskGraph::CommuteWrite(*groupTarget.getRhsPtr())});
+                runtime.task(priorities.getP2PPriority(idxGroup), getHomeNode(idxGroup, std::size(particleGroups)), {TbfTaskRuntime::Read(*groupSrc.getDataPtr()), TbfTaskRuntime::CommuteWrite(*groupSrc.getRhsPtr()),
+                             TbfTaskRuntime::Read(*groupTarget.getDataPtr()), TbfTaskRuntime::CommuteWrite(*groupTarget.getRhsPtr())},
+                                   [this, graphNode, idxGroup, idxSrcGroup = static_cast<long int>(&groupSrc - particleGroups.data()),
+                                    indexesView = indexes, &groupSrc, &groupTarget, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxSrcGroup, idxGroup,
+                                                         groupSrc.getNbParticles(), groupTarget.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.P2PBetweenGroups(kernels[TbfTaskRuntime::GetWorkerId()], groupTarget, groupSrc, indexesView);
+                    });
+                });
+
+            });
+
+            auto& currentGroup = *currentParticleGroup;
+            TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                              currentGroup.getNbParticles(), currentGroup.getNbParticles(),
+                                                              static_cast<long int>(indexesForGroup.first.size()) + currentGroup.getNbLeaves(),
+                                                              priorities.getP2PPriority(idxGroup),
+                                                              {TbfTaskGraph::Read(*currentGroup.getDataPtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getRhsPtr())});
+            runtime.task(priorities.getP2PPriority(idxGroup), getHomeNode(idxGroup, std::size(particleGroups)), {TbfTaskRuntime::Read(*currentGroup.getDataPtr()),TbfTaskRuntime::CommuteWrite(*currentGroup.getRhsPtr())},
+                               [this, graphNode, idxGroup, indexesForGroup_first = &interactionsPool.store(std::move(indexesForGroup.first)), &currentGroup, traceSubmitTime = tracer.now()](){
+                const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                     currentGroup.getNbParticles(), currentGroup.getNbParticles(), traceSubmitTime);
+                const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                    kernelWrapper.P2PInGroup(kernels[TbfTaskRuntime::GetWorkerId()], currentGroup, *indexesForGroup_first);
+
+                    kernelWrapper.P2PInner(kernels[TbfTaskRuntime::GetWorkerId()], currentGroup);
+                });
+            });
+
+            ++currentParticleGroup;
+        }
+    }
+
+    template <class TreeClass>
+    void P2PWithPlan(TbfTaskRuntime& runtime, TreeClass& inTree, const TbfInteractionPlan& inInteractionPlan){
+        auto& particleGroups = inTree.getParticleGroups();
+
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(particleGroups)) ; ++idxGroup){
+            auto& currentGroup = particleGroups[idxGroup];
+
+            const auto blocks = inInteractionPlan.getP2PBlocksBetweenGroups(idxGroup);
+            for(long int idxBlock = 0 ; idxBlock < blocks.size() ; ++idxBlock){
+                const auto block = blocks[idxBlock];
+                auto& groupSrc = particleGroups[block.idxSrcGroup];
+
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, block.idxSrcGroup, idxGroup,
+                                                                  groupSrc.getNbParticles(), currentGroup.getNbParticles(), block.nbInteractions,
+                                                                  priorities.getP2PPriority(idxGroup),
+                                                                  {TbfTaskGraph::Read(*groupSrc.getDataPtr()), TbfTaskGraph::CommuteWrite(*groupSrc.getRhsPtr()),
+                                                                   TbfTaskGraph::Read(*currentGroup.getDataPtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getRhsPtr())});
+                runtime.task(priorities.getP2PPriority(idxGroup), getHomeNode(idxGroup, std::size(particleGroups)), {TbfTaskRuntime::Read(*groupSrc.getDataPtr()), TbfTaskRuntime::CommuteWrite(*groupSrc.getRhsPtr()),
+                             TbfTaskRuntime::Read(*currentGroup.getDataPtr()), TbfTaskRuntime::CommuteWrite(*currentGroup.getRhsPtr())},
+                                   [this, graphNode, idxGroup, block, &inInteractionPlan, &groupSrc, &currentGroup, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, block.idxSrcGroup, idxGroup,
+                                                         groupSrc.getNbParticles(), currentGroup.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                        kernelWrapper.P2PFromPlan(kernels[TbfTaskRuntime::GetWorkerId()], currentGroup, groupSrc, inInteractionPlan.getP2PInteractions(block));
+                    });
+                });
+            }
+
+            TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                              currentGroup.getNbParticles(), currentGroup.getNbParticles(),
+                                                              inInteractionPlan.getP2PInteractionsInGroup(idxGroup).size() + currentGroup.getNbLeaves(),
+                                                              priorities.getP2PPriority(idxGroup),
+                                                              {TbfTaskGraph::Read(*currentGroup.getDataPtr()), TbfTaskGraph::CommuteWrite(*currentGroup.getRhsPtr())});
+            runtime.task(priorities.getP2PPriority(idxGroup), getHomeNode(idxGroup, std::size(particleGroups)), {TbfTaskRuntime::Read(*currentGroup.getDataPtr()),TbfTaskRuntime::CommuteWrite(*currentGroup.getRhsPtr())},
+                               [this, graphNode, idxGroup, &inInteractionPlan, &currentGroup, traceSubmitTime = tracer.now()](){
+                const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                     currentGroup.getNbParticles(), currentGroup.getNbParticles(), traceSubmitTime);
+                const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                priorities.measure(TbfCriticalPathPriorities::StageP2P, configuration.getTreeHeight()-1, idxGroup, [&](){
+                    kernelWrapper.P2PFromPlan(kernels[TbfTaskRuntime::GetWorkerId()], currentGroup, currentGroup, inInteractionPlan.getP2PInteractionsInGroup(idxGroup));
+
+                    kernelWrapper.P2PInner(kernels[TbfTaskRuntime::GetWorkerId()], currentGroup);
+                });
+            });
+        }
+    }
+
+    template <class TreeClass>
+    void computeInteractionLists(TreeClass& inTree, const int inOperationToProceed){
+        // The P2M/M2M tasks are executed by the runtime in the meantime
+        interactionLists.compute(inTree, stopUpperLevel, inOperationToProceed & TbfAlgorithmUtils::TbfM2L, inOperationToProceed & TbfAlgorithmUtils::TbfP2P,
+                                 [](const long int inNbJobs, auto&& inFunc){
+            TbfParallel::ParallelFor(0, inNbJobs, TbfParallel::GetNbThreads(), inFunc);
+        });
+    }
+
+    // The node of the group inIdxGroup of inNbGroups (as TbfNumaAllocator places it)
+    int getHomeNode(const long int inIdxGroup, const long int inNbGroups) const{
+        return TbfNuma::GetNodeOfPosition(inIdxGroup, inNbGroups, taskRuntime->getNbNodes());
+    }
+
+    void increaseNumberOfKernels(const int inNbThreads){
+        for(long int idxThread = kernels.size() ; idxThread < inNbThreads ; ++idxThread){
+            kernels.emplace_back(kernels[0]);
+        }
+    }
+
+public:
+    explicit TbfThreadPoolAlgorithm(const SpacialConfiguration& inConfiguration, const long int inStopUpperLevel = TbfDefaultLastLevel)
+        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
+          kernelWrapper(configuration),
+          priorities(configuration.getTreeHeight()), useInteractionPlan(false),
+          taskRuntime(new TbfTaskRuntime(GetNbThreads(), priorities.getNbPriorities())){
+        kernels.emplace_back(configuration);
+    }
+
+    template <class SourceKernelClass,
+              typename = typename std::enable_if<!std::is_same<long int, typename std::remove_const<typename std::remove_reference<SourceKernelClass>::type>::type>::value
+                                                 && !std::is_same<int, typename std::remove_const<typename std::remove_reference<SourceKernelClass>::type>::type>::value, void>::type>
+    TbfThreadPoolAlgorithm(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inStopUpperLevel = TbfDefaultLastLevel)
+        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
+          kernelWrapper(configuration),
+          priorities(configuration.getTreeHeight()), useInteractionPlan(false),
+          taskRuntime(new TbfTaskRuntime(GetNbThreads(), priorities.getNbPriorities())){
+        kernels.emplace_back(std::forward<SourceKernelClass>(inKernel));
+    }
+
+    // The interaction lists of the M2L/P2P are computed once and kept in the tree (see TbfTree::getInteractionPlan),
+    // the tasks then use the plan directly instead of a copy of their interactions
+    void setUseInteractionPlan(const bool inUseInteractionPlan){
+        useInteractionPlan = inUseInteractionPlan;
+    }
+
+    bool getUseInteractionPlan() const{
+        return useInteractionPlan;
+    }
+
+    // The workers are distributed on inNbNodes NUMA nodes (TbfNuma::GetNbNodes() for the ones of the machine)
+    // and each task prefers the node of the group it writes, such that it is executed where
+    // TbfNumaAllocator placed the group (the threads are restarted)
+    void setNbNumaNodes(const int inNbNodes){
+        taskRuntime.reset(new TbfTaskRuntime(taskRuntime->getNbThreads(), priorities.getNbPriorities(), inNbNodes));
+    }
+
+    int getNbNumaNodes() const{
+        return taskRuntime->getNbNodes();
+    }
+
+    // The priorities of the tasks are computed from the critical path of the task graph
+    // (see TbfCriticalPathPriorities), instead of the type of the operators and the level
+    void setUseCriticalPathPriorities(const bool inUseCriticalPathPriorities){
+        priorities.setEnabled(inUseCriticalPathPriorities);
+    }
+
+    bool getUseCriticalPathPriorities() const{
+        return priorities.getEnabled();
+    }
+
+    TbfCriticalPathPriorities& getCriticalPathPriorities(){
+        return priorities;
+    }
+
+    // The tasks are recorded when the tracer is enabled (see TbfTaskTracer)
+    TbfTaskTracer& getTaskTracer(){
+        return tracer;
+    }
+
+    // The task graph of the last execution is recorded when it is enabled (see TbfTaskGraph)
+    TbfTaskGraph& getTaskGraph(){
+        return taskGraph;
+    }
+
+    template <class TreeClass>
+    void execute(TreeClass& inTree, const int inOperationToProceed = TbfAlgorithmUtils::TbfOperations::TbfNearAndFarFields){
+        assert(configuration == inTree.getSpacialConfiguration());
+
+        const TbfInteractionPlan* interactionPlan = (useInteractionPlan ? &inTree.getInteractionPlan() : nullptr);
+
+        increaseNumberOfKernels(taskRuntime->getNbThreads());
+
+        priorities.update(inTree, stopUpperLevel, inOperationToProceed);
+
+        if(taskGraph.getEnabled()){
+            taskGraph.clear();
+        }
+
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfP2M){
+            P2M(*taskRuntime, inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfM2M){
+            M2M(*taskRuntime, inTree);
+        }
+        if(interactionPlan == nullptr && (inOperationToProceed & (TbfAlgorithmUtils::TbfM2L | TbfAlgorithmUtils::TbfP2P))){
+            computeInteractionLists(inTree, inOperationToProceed);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
+            if(interactionPlan){
+                M2LWithPlan(*taskRuntime, inTree, *interactionPlan);
+            }
+            else{
+                M2L(*taskRuntime, inTree);
+            }
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfL2L){
+            L2L(*taskRuntime, inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfP2P){
+            if(interactionPlan){
+                P2PWithPlan(*taskRuntime, inTree, *interactionPlan);
+            }
+            else{
+                P2P(*taskRuntime, inTree);
+            }
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfL2P){
+            L2P(*taskRuntime, inTree);
+        }
+
+        taskRuntime->waitAllTasks();
+
+        interactionsPool.reset();
+    }
+
+    template <class FuncType>
+    auto applyToAllKernels(FuncType&& inFunc) const {
+        for(const auto& kernel : kernels){
+            inFunc(kernel);
+        }
+    }
+
+    template <class StreamClass>
+    friend  StreamClass& operator<<(StreamClass& inStream, const TbfThreadPoolAlgorithm& inAlgo) {
+        inStream << "TbfThreadPoolAlgorithm @ " << &inAlgo << "\n";
+        inStream << " - Configuration: " << "\n";
+        inStream << inAlgo.configuration << "\n";
+        inStream << " - Space system: " << "\n";
+        inStream << inAlgo.spaceSystem << "\n";
+        return inStream;
+    }
+
+    static int GetNbThreads(){
+        return TbfParallel::GetNbThreads();
+    }
+
+    static const char* GetName(){
+        return "TbfThreadPoolAlgorithm";
+    }
+};
+
+#endif
@@ -0,0 +1,404 @@
+#ifndef TBFTHREADPOOLALGORITHMTSM_HPP
+#define TBFTHREADPOOLALGORITHMTSM_HPP
+
+#include "tbfglobal.hpp"
+
+#include "../sequential/tbfgroupkernelinterface.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "core/tbfinteraction.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/tbftasktracer.hpp"
+#include "algorithms/tbftaskgraph.hpp"
+#include "utils/tbfparallel.hpp"
+
+#include "algorithms/threadpool/tbftaskruntime.hpp"
+
+
+#include <cassert>
+#include <iterator>
+#include <memory>
+
+template <class RealType_T, class KernelClass_T, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
+class TbfThreadPoolAlgorithmTsm {
+public:
+    using RealType = RealType_T;
+    using KernelClass = KernelClass_T;
+    using SpaceIndexType = SpaceIndexType_T;
+    using SpacialConfiguration = TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>;
+
+protected:
+    const SpacialConfiguration configuration;
+    const SpaceIndexType spaceSystem;
+
+    const long int stopUpperLevel;
+
+    TbfGroupKernelInterface<SpaceIndexType> kernelWrapper;
+    std::vector<KernelClass> kernels;
+
+    TbfAlgorithmUtils::TbfOperationsPriorities priorities;
+
+    // Records the tasks if enabled
+    TbfTaskTracer tracer;
+
+    // Records the task graph of the last execution if enabled
+    TbfTaskGraph taskGraph;
+
+    // The interaction lists used by the tasks (the tasks have a view on them)
+    TbfAlgorithmUtils::TbfTaskDataPool<std::vector<TbfXtoXInteraction<typename SpaceIndexType::IndexType>>> interactionsPool;
+
+    // The threads are kept between the executions
+    std::unique_ptr<TbfTaskRuntime> taskRuntime;
+
+    template <class TreeClass>
+    void P2M(TbfTaskRuntime& runtime, TreeClass& inTree){
+        if(configuration.getTreeHeight() > 2){
+            auto& leafGroups = inTree.getLeafGroupsSource();
+            const auto& particleGroups = inTree.getParticleGroupsSource();
+
+            assert(std::size(leafGroups) == std::size(particleGroups));
+
+            auto currentLeafGroup = leafGroups.begin();
+            auto currentParticleGroup = particleGroups.cbegin();
+
+            const auto endLeafGroup = leafGroups.end();
+            const auto endParticleGroup = particleGroups.cend();
+
+            while(currentLeafGroup != endLeafGroup && currentParticleGroup != endParticleGroup){
+                assert((*currentParticleGroup).getStartingSpacialIndex() == (*currentLeafGroup).getStartingSpacialIndex()
+                       && (*currentParticleGroup).getEndingSpacialIndex() == (*currentLeafGroup).getEndingSpacialIndex()
+                       && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
+                auto& leafGroupObj = *currentLeafGroup;
+                const auto& particleGroupObj = *currentParticleGroup;
+                const long int idxGroup = std::distance(leafGroups.begin(), currentLeafGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  particleGroupObj.getNbParticles(), leafGroupObj.getNbCells(), 0, priorities.getP2MPriority(),
+                                                                  {TbfTaskGraph::Read(*particleGroupObj.getDataPtr()), TbfTaskGraph::CommuteWrite(*leafGroupObj.getMultipolePtr())});
+                runtime.task(priorities.getP2MPriority(), {TbfTaskRuntime::Read(*particleGroupObj.getDataPtr()), TbfTaskRuntime::CommuteWrite(*leafGroupObj.getMultipolePtr())},
+                                   [this, graphNode, idxGroup, &leafGroupObj, &particleGroupObj, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2M, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         particleGroupObj.getNbParticles(), leafGroupObj.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    kernelWrapper.P2M(kernels[TbfTaskRuntime::GetWorkerId()], particleGroupObj, leafGroupObj);
+                });
+                ++currentParticleGroup;
+                ++currentLeafGroup;
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void M2M(TbfTaskRuntime& runtime, TreeClass& inTree){
+        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= stopUpperLevel ; --idxLevel){
+            auto& upperCellGroup = inTree.getCellGroupsAtLevelSource(idxLevel);
+            const auto& lowerCellGroup = inTree.getCellGroupsAtLevelSource(idxLevel+1);
+
+            auto currentUpperGroup = upperCellGroup.begin();
+            auto currentLowerGroup = lowerCellGroup.cbegin();
+
+            const auto endUpperGroup = upperCellGroup.end();
+            const auto endLowerGroup = lowerCellGroup.cend();
+
+            while(currentUpperGroup != endUpperGroup && currentLowerGroup != endLowerGroup){
+                assert(spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()
+                       || currentUpperGroup->getStartingSpacialIndex() <= spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()));
+
+                auto& upperGroup = *currentUpperGroup;
+                const auto& lowerGroup = *currentLowerGroup;
+                const long int idxUpperGroup = std::distance(upperCellGroup.begin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.cbegin(), currentLowerGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                                  lowerGroup.getNbCells(), upperGroup.getNbCells(), 0, priorities.getM2MPriority(idxLevel),
+                                                                  {TbfTaskGraph::Read(*lowerGroup.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*upperGroup.getMultipolePtr())});
+                runtime.task(priorities.getM2MPriority(idxLevel), {TbfTaskRuntime::Read(*lowerGroup.getMultipolePtr()), TbfTaskRuntime::CommuteWrite(*upperGroup.getMultipolePtr())},
+                                   [this, graphNode, idxLevel, idxUpperGroup, idxLowerGroup, &upperGroup, &lowerGroup, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2M, idxLevel, idxLowerGroup, idxUpperGroup,
+                                                         lowerGroup.getNbCells(), upperGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    kernelWrapper.M2M(idxLevel, kernels[TbfTaskRuntime::GetWorkerId()], lowerGroup, upperGroup);
+                });
+
+                if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
+                    ++currentLowerGroup;
+                    if(currentLowerGroup != endLowerGroup && currentUpperGroup->getEndingSpacialIndex() < spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex())){
+                        ++currentUpperGroup;
+                    }
+                }
+                else{
+                    ++currentUpperGroup;
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void M2L(TbfTaskRuntime& runtime, TreeClass& inTree){
+        const auto& spacialSystem = inTree.getSpacialSystem();
+
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-1 ; ++idxLevel){
+            auto& cellGroupsTarget = inTree.getCellGroupsAtLevelTarget(idxLevel);
+            auto& cellGroupsSource = inTree.getCellGroupsAtLevelSource(idxLevel);
+
+            auto currentCellGroup = cellGroupsTarget.begin();
+            const auto endCellGroup = cellGroupsTarget.end();
+
+            while(currentCellGroup != endCellGroup){
+                auto indexesForGroup = spacialSystem.getInteractionListForBlock(*currentCellGroup, idxLevel, false);
+
+                indexesForGroup.second.reserve(std::size(indexesForGroup.first) + std::size(indexesForGroup.first));
+                indexesForGroup.second.insert(indexesForGroup.second.end(), indexesForGroup.first.begin(), indexesForGroup.first.end());
+
+                TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), cellGroupsSource,
+                                                          std::distance(cellGroupsTarget.begin(),currentCellGroup), cellGroupsTarget,
+                                               [&](auto& groupTarget, const auto& groupSrc, const auto& indexes){
+                    assert(&groupTarget == &*currentCellGroup);
+
+                    const long int idxSrcGroup = static_cast<long int>(&groupSrc - cellGroupsSource.data());
+                    const long int idxTargetGroup = static_cast<long int>(&groupTarget - cellGroupsTarget.data());
+                    TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationM2L, idxLevel, idxSrcGroup, idxTargetGroup,
+                                                                      groupSrc.getNbCells(), groupTarget.getNbCells(), static_cast<long int>(indexes.size()),
+                                                                      priorities.getM2LPriority(idxLevel),
+                                                                      {TbfTaskGraph::Read(*groupSrc.getMultipolePtr()), TbfTaskGraph::CommuteWrite(*groupTarget.getLocalPtr())});
+                    runtime.task(priorities.getM2LPriority(idxLevel), {TbfTaskRuntime::Read(*groupSrc.getMultipolePtr()), TbfTaskRuntime::CommuteWrite(*groupTarget.getLocalPtr())},
+                                       [this, graphNode, idxLevel, idxSrcGroup, idxTargetGroup,
+                                        indexesView = indexes, &groupSrc, &groupTarget, traceSubmitTime = tracer.now()](){
+                        const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxLevel, idxSrcGroup, idxTargetGroup,
+                                                             groupSrc.getNbCells(), groupTarget.getNbCells(), traceSubmitTime);
+                        const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                        kernelWrapper.M2LBetweenGroups(idxLevel, kernels[TbfTaskRuntime::GetWorkerId()], groupTarget, groupSrc, indexesView);
+                    });
+                });
+
+                ++currentCellGroup;
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void L2L(TbfTaskRuntime& runtime, TreeClass& inTree){
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= configuration.getTreeHeight()-2 ; ++idxLevel){
+            const auto& upperCellGroup = inTree.getCellGroupsAtLevelTarget(idxLevel);
+            auto& lowerCellGroup = inTree.getCellGroupsAtLevelTarget(idxLevel+1);
+
+            auto currentUpperGroup = upperCellGroup.cbegin();
+            auto currentLowerGroup = lowerCellGroup.begin();
+
+            const auto endUpperGroup = upperCellGroup.cend();
+            const auto endLowerGroup = lowerCellGroup.end();
+
+            while(currentUpperGroup != endUpperGroup && currentLowerGroup != endLowerGroup){
+                assert(spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()
+                       || currentUpperGroup->getStartingSpacialIndex() <= spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()));
+
+                const auto& upperGroup = *currentUpperGroup;
+                auto& lowerGroup = *currentLowerGroup;
+                const long int idxUpperGroup = std::distance(upperCellGroup.cbegin(), currentUpperGroup);
+                const long int idxLowerGroup = std::distance(lowerCellGroup.begin(), currentLowerGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                                  upperGroup.getNbCells(), lowerGroup.getNbCells(), 0, priorities.getL2LPriority(idxLevel),
+                                                                  {TbfTaskGraph::Read(*upperGroup.getLocalPtr()), TbfTaskGraph::CommuteWrite(*lowerGroup.getLocalPtr())});
+                runtime.task(priorities.getL2LPriority(idxLevel), {TbfTaskRuntime::Read(*upperGroup.getLocalPtr()), TbfTaskRuntime::CommuteWrite(*lowerGroup.getLocalPtr())},
+                                   [this, graphNode, idxLevel, idxUpperGroup, idxLowerGroup, &upperGroup, &lowerGroup, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2L, idxLevel, idxUpperGroup, idxLowerGroup,
+                                                         upperGroup.getNbCells(), lowerGroup.getNbCells(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    kernelWrapper.L2L(idxLevel, kernels[TbfTaskRuntime::GetWorkerId()], upperGroup, lowerGroup);
+                });
+
+                if(spaceSystem.getParentIndex(currentLowerGroup->getEndingSpacialIndex()) <= currentUpperGroup->getEndingSpacialIndex()){
+                    ++currentLowerGroup;
+                    if(currentLowerGroup != endLowerGroup && currentUpperGroup->getEndingSpacialIndex() < spaceSystem.getParentIndex(currentLowerGroup->getStartingSpacialIndex())){
+                        ++currentUpperGroup;
+                    }
+                }
+                else{
+                    ++currentUpperGroup;
+                }
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void L2P(TbfTaskRuntime& runtime, TreeClass& inTree){
+        if(configuration.getTreeHeight() > 2){
+            const auto& leafGroups = inTree.getLeafGroupsTarget();
+            auto& particleGroups = inTree.getParticleGroupsTarget();
+
+            assert(std::size(leafGroups) == std::size(particleGroups));
+
+            auto currentLeafGroup = leafGroups.cbegin();
+            auto currentParticleGroup = particleGroups.begin();
+
+            const auto endLeafGroup = leafGroups.cend();
+            const auto endParticleGroup = particleGroups.end();
+
+            while(currentLeafGroup != endLeafGroup && currentParticleGroup != endParticleGroup){
+                assert((*currentParticleGroup).getStartingSpacialIndex() == (*currentLeafGroup).getStartingSpacialIndex()
+                       && (*currentParticleGroup).getEndingSpacialIndex() == (*currentLeafGroup).getEndingSpacialIndex()
+                       && (*currentParticleGroup).getNbLeaves() == (*currentLeafGroup).getNbCells());
+
+                const auto& leafGroupObj = *currentLeafGroup;
+                auto& particleGroupObj = *currentParticleGroup;
+                const long int idxGroup = std::distance(particleGroups.begin(), currentParticleGroup);
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                                  leafGroupObj.getNbCells(), particleGroupObj.getNbParticles(), 0, priorities.getL2PPriority(),
+                                                                  {TbfTaskGraph::Read(*leafGroupObj.getLocalPtr()),
+                                                                   TbfTaskGraph::Read(*particleGroupObj.getDataPtr()), TbfTaskGraph::CommuteWrite(*particleGroupObj.getRhsPtr())});
+                runtime.task(priorities.getL2PPriority(), {TbfTaskRuntime::Read(*leafGroupObj.getLocalPtr()), TbfTaskRuntime::Read(*particleGroupObj.getDataPtr()),
+                             TbfTaskRuntime::CommuteWrite(*particleGroupObj.getRhsPtr())},
+                                   [this, graphNode, idxGroup, &leafGroupObj, &particleGroupObj, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationL2P, configuration.getTreeHeight()-1, idxGroup, idxGroup,
+                                                         leafGroupObj.getNbCells(), particleGroupObj.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    kernelWrapper.L2P(kernels[TbfTaskRuntime::GetWorkerId()], leafGroupObj, particleGroupObj);
+                });
+
+                ++currentParticleGroup;
+                ++currentLeafGroup;
+            }
+        }
+    }
+
+    template <class TreeClass>
+    void P2P(TbfTaskRuntime& runtime, TreeClass& inTree){
+        const auto& spacialSystem = inTree.getSpacialSystem();
+
+        auto& particleGroupsTarget = inTree.getParticleGroupsTarget();
+        auto& particleGroupsSource = inTree.getParticleGroupsSource();
+
+        auto currentParticleGroupTarget = particleGroupsTarget.begin();
+        const auto endParticleGroupTarget = particleGroupsTarget.end();
+
+        while(currentParticleGroupTarget != endParticleGroupTarget){
+            auto indexesForGroup = spacialSystem.getNeighborListForBlock(*currentParticleGroupTarget, configuration.getTreeHeight()-1, false, false);
+
+            indexesForGroup.second.reserve(std::size(indexesForGroup.first) + std::size(indexesForGroup.first));
+            indexesForGroup.second.insert(indexesForGroup.second.end(), indexesForGroup.first.begin(), indexesForGroup.first.end());
+
+            auto indexesForSelfGroup = spacialSystem.getSelfListForBlock(*currentParticleGroupTarget);
+            indexesForGroup.second.insert(indexesForGroup.second.end(), indexesForSelfGroup.begin(), indexesForSelfGroup.end());
+
+            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(interactionsPool.store(std::move(indexesForGroup.second)), particleGroupsSource,
+                                                      std::distance(particleGroupsTarget.begin(), currentParticleGroupTarget), particleGroupsTarget,
+                                           [&](auto& groupTarget, auto& groupSrc, const auto& indexes){
+                assert(&groupTarget == &*currentParticleGroupTarget);
+
+                const long int idxSrcGroup = static_cast<long int>(&groupSrc - particleGroupsSource.data());
+                const long int idxTargetGroup = static_cast<long int>(&groupTarget - particleGroupsTarget.data());
+                TbfTaskGraph::Node* graphNode = taskGraph.addTask(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxSrcGroup, idxTargetGroup,
+                                                                  groupSrc.getNbParticles(), groupTarget.getNbParticles(), static_cast<long int>(indexes.size()),
+                                                                  priorities.getP2PPriority(),
+                                                                  {TbfTaskGraph::Read(*groupSrc.getDataPtr()), TbfTaskGraph::Read(*groupTarget.getDataPtr()),
+                                                                   TbfTaskGraph::CommuteWrite(*groupTarget.getRhsPtr())});
+                runtime.task(priorities.getP2PPriority(), {TbfTaskRuntime::Read(*groupSrc.getDataPtr()), TbfTaskRuntime::Read(*groupTarget.getDataPtr()),
+                             TbfTaskRuntime::CommuteWrite(*groupTarget.getRhsPtr())},
+                                   [this, graphNode, idxSrcGroup, idxTargetGroup,
+                                    indexesView = indexes, &groupSrc, &groupTarget, traceSubmitTime = tracer.now()](){
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, configuration.getTreeHeight()-1, idxSrcGroup, idxTargetGroup,
+                                                         groupSrc.getNbParticles(), groupTarget.getNbParticles(), traceSubmitTime);
+                    const auto graphTimer = TbfTaskGraph::Measure(graphNode);
+                    kernelWrapper.P2PBetweenGroupsTsm(kernels[TbfTaskRuntime::GetWorkerId()], groupTarget, groupSrc, indexesView);
+                });
+
+            });
+
+            ++currentParticleGroupTarget;
+        }
+    }
+
+    void increaseNumberOfKernels(const int inNbThreads){
+        for(long int idxThread = kernels.size() ; idxThread < inNbThreads ; ++idxThread){
+            kernels.emplace_back(kernels[0]);
+        }
+    }
+
+public:
+    explicit TbfThreadPoolAlgorithmTsm(const SpacialConfiguration& inConfiguration, const long int inStopUpperLevel = TbfDefaultLastLevel)
+        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
+          kernelWrapper(configuration),
+          priorities(configuration.getTreeHeight()),
+          taskRuntime(new TbfTaskRuntime(GetNbThreads(), priorities.getNbPriorities())){
+        kernels.emplace_back(configuration);
+    }
+
+    template <class SourceKernelClass,
+              typename = typename std::enable_if<!std::is_same<long int, typename std::remove_const<typename std::remove_reference<SourceKernelClass>::type>::type>::value
+                                                 && !std::is_same<int, typename std::remove_const<typename std::remove_reference<SourceKernelClass>::type>::type>::value, void>::type>
+    TbfThreadPoolAlgorithmTsm(const SpacialConfiguration& inConfiguration, SourceKernelClass&& inKernel, const long int inStopUpperLevel = TbfDefaultLastLevel)
+        : configuration(inConfiguration), spaceSystem(configuration), stopUpperLevel(std::max(0L, inStopUpperLevel)),
+          kernelWrapper(configuration),
+          priorities(configuration.getTreeHeight()),
+          taskRuntime(new TbfTaskRuntime(GetNbThreads(), priorities.getNbPriorities())){
+        kernels.emplace_back(std::forward<SourceKernelClass>(inKernel));
+    }
+
+    // The tasks are recorded when the tracer is enabled (see TbfTaskTracer)
+    TbfTaskTracer& getTaskTracer(){
+        return tracer;
+    }
+
+    // The task graph of the last execution is recorded when it is enabled (see TbfTaskGraph)
+    TbfTaskGraph& getTaskGraph(){
+        return taskGraph;
+    }
+
+    template <class TreeClass>
+    void execute(TreeClass& inTree, const int inOperationToProceed = TbfAlgorithmUtils::TbfOperations::TbfNearAndFarFields){
+        assert(configuration == inTree.getSpacialConfiguration());
+
+        increaseNumberOfKernels(taskRuntime->getNbThreads());
+
+        if(taskGraph.getEnabled()){
+            taskGraph.clear();
+        }
+
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfP2M){
+            P2M(*taskRuntime, inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfM2M){
+            M2M(*taskRuntime, inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfM2L){
+            M2L(*taskRuntime, inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfL2L){
+            L2L(*taskRuntime, inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfP2P){
+            P2P(*taskRuntime, inTree);
+        }
+        if(inOperationToProceed & TbfAlgorithmUtils::TbfL2P){
+            L2P(*taskRuntime, inTree);
+        }
+
+        taskRuntime->waitAllTasks();
+
+        interactionsPool.reset();
+    }
+
+    template <class FuncType>
+    auto applyToAllKernels(FuncType&& inFunc) const {
+        for(const auto& kernel : kernels){
+            inFunc(kernel);
+        }
+    }
+
+    template <class StreamClass>
+    friend  StreamClass& operator<<(StreamClass& inStream, const TbfThreadPoolAlgorithmTsm& inAlgo) {
+        inStream << "TbfThreadPoolAlgorithmTsm @ " << &inAlgo << "\n";
+        inStream << " - Configuration: " << "\n";
+        inStream << inAlgo.configuration << "\n";
+        inStream << " - Space system: " << "\n";
+        inStream << inAlgo.spaceSystem << "\n";
+        return inStream;
+    }
+
+    static int GetNbThreads(){
+        return TbfParallel::GetNbThreads();
+    }
+
+    static const char* GetName(){
+        return "TbfThreadPoolAlgorithmTsm";
+    }
+};
+
+#endif
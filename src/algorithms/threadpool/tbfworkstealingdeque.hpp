@@ -0,0 +1,130 @@
+#ifndef TBFWORKSTEALINGDEQUE_HPP
+#define TBFWORKSTEALINGDEQUE_HPP
+
+#include "tbfglobal.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cassert>
+
+// Chase-Lev work-stealing deque (with the memory orders of Le et al. "Correct and
+// Efficient Work-Stealing for Weak Memory Models", PPoPP 2013).
+// Only the owner calls push and pop (at the bottom), any thread can call steal (at the top).
+// ItemType must be trivially copyable (pointers in practice), and a default constructed
+// item is returned when the deque is empty or when a steal fails.
+template <class ItemType>
+class TbfWorkStealingDeque {
+    class Buffer {
+        const long int capacity;
+        std::unique_ptr<std::atomic<ItemType>[]> items;
+
+    public:
+        explicit Buffer(const long int inCapacity)
+            : capacity(inCapacity), items(new std::atomic<ItemType>[inCapacity]){
+            assert((capacity & (capacity-1)) == 0);
+        }
+
+        long int getCapacity() const{
+            return capacity;
+        }
+
+        ItemType get(const long int inIndex) const{
+            return items[inIndex & (capacity-1)].load(std::memory_order_relaxed);
+        }
+
+        void put(const long int inIndex, const ItemType inItem){
+            items[inIndex & (capacity-1)].store(inItem, std::memory_order_relaxed);
+        }
+    };
+
+    alignas(TbfDefaultMemoryAlignement) std::atomic<long int> top;
+    alignas(TbfDefaultMemoryAlignement) std::atomic<long int> bottom;
+    std::atomic<Buffer*> buffer;
+
+    // The old buffers are kept until the deque is destroyed since a thief can still read them
+    std::vector<std::unique_ptr<Buffer>> allBuffers;
+
+    Buffer* grow(Buffer* inBuffer, const long int inTop, const long int inBottom){
+        allBuffers.emplace_back(new Buffer(inBuffer->getCapacity()*2));
+        Buffer* newBuffer = allBuffers.back().get();
+        for(long int idxItem = inTop ; idxItem < inBottom ; ++idxItem){
+            newBuffer->put(idxItem, inBuffer->get(idxItem));
+        }
+        buffer.store(newBuffer, std::memory_order_release);
+        return newBuffer;
+    }
+
+public:
+    explicit TbfWorkStealingDeque(const long int inInitialCapacity = 64)
+        : top(0), bottom(0), buffer(nullptr){
+        long int capacity = 1;
+        while(capacity < inInitialCapacity){
+            capacity *= 2;
+        }
+        allBuffers.emplace_back(new Buffer(capacity));
+        buffer.store(allBuffers.back().get(), std::memory_order_relaxed);
+    }
+
+    TbfWorkStealingDeque(const TbfWorkStealingDeque&) = delete;
+    TbfWorkStealingDeque& operator=(const TbfWorkStealingDeque&) = delete;
+
+    void push(const ItemType inItem){
+        const long int currentBottom = bottom.load(std::memory_order_relaxed);
+        const long int currentTop = top.load(std::memory_order_acquire);
+        Buffer* currentBuffer = buffer.load(std::memory_order_relaxed);
+        if(currentBottom - currentTop > currentBuffer->getCapacity() - 1){
+            currentBuffer = grow(currentBuffer, currentTop, currentBottom);
+        }
+        currentBuffer->put(currentBottom, inItem);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(currentBottom + 1, std::memory_order_relaxed);
+    }
+
+    ItemType pop(){
+        const long int currentBottom = bottom.load(std::memory_order_relaxed) - 1;
+        Buffer* currentBuffer = buffer.load(std::memory_order_relaxed);
+        bottom.store(currentBottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long int currentTop = top.load(std::memory_order_relaxed);
+
+        ItemType item{};
+        if(currentTop <= currentBottom){
+            item = currentBuffer->get(currentBottom);
+            if(currentTop == currentBottom){
+                // Last item, compete with the thieves
+                if(!top.compare_exchange_strong(currentTop, currentTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+                    item = ItemType{};
+                }
+                bottom.store(currentBottom + 1, std::memory_order_relaxed);
+            }
+        }
+        else{
+            bottom.store(currentBottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    ItemType steal(){
+        long int currentTop = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const long int currentBottom = bottom.load(std::memory_order_acquire);
+
+        ItemType item{};
+        if(currentTop < currentBottom){
+            Buffer* currentBuffer = buffer.load(std::memory_order_acquire);
+            item = currentBuffer->get(currentTop);
+            if(!top.compare_exchange_strong(currentTop, currentTop + 1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+                item = ItemType{};
+            }
+        }
+        return item;
+    }
+
+    // Approximate when called concurrently
+    bool empty() const{
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+};
+
+#endif
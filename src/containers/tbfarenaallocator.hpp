@@ -0,0 +1,207 @@
+#ifndef TBFARENAALLOCATOR_HPP
+#define TBFARENAALLOCATOR_HPP
+
+#include "tbfglobal.hpp"
+
+#include "tbfmemoryallocator.hpp"
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <new>
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+enum class TbfHugePages {
+    None,
+    Transparent, // madvise(MADV_HUGEPAGE) on chunks aligned on the huge page size
+    Explicit     // MAP_HUGETLB (needs reserved pages), falls back to Transparent if it fails
+};
+
+// All the blocks are carved out of large chunks (bump allocation), such that the groups
+// of a tree are contiguous and backed by few mappings (possibly huge pages).
+// The memory of a chunk is never reused, a chunk is released when all its blocks are deleted
+// and when it is not the current chunk anymore. As the new pages are zeros the blocks do not
+// need to be reset.
+class TbfArenaAllocator : public TbfMemoryAllocator {
+public:
+    constexpr static long int DefaultChunkSizeInByte = 64L*1024L*1024L;
+    constexpr static long int HugePageSizeInByte = 2L*1024L*1024L;
+
+private:
+    struct Stats {
+        std::atomic<long int> nbChunks{0};
+        std::atomic<long int> nbHugeTlbChunks{0};
+        std::atomic<long int> mappedSizeInByte{0};
+    };
+
+    struct Chunk {
+        unsigned char* ptr = nullptr;
+        long int sizeInByte = 0;
+        long int usedSizeInByte = 0;
+        bool isHugeTlb = false;
+        std::shared_ptr<Stats> stats;
+
+        ~Chunk(){
+            if(ptr){
+                munmap(ptr, static_cast<size_t>(sizeInByte));
+                stats->nbChunks -= 1;
+                stats->nbHugeTlbChunks -= (isHugeTlb ? 1 : 0);
+                stats->mappedSizeInByte -= sizeInByte;
+            }
+        }
+    };
+
+    const long int pageSize;
+    const long int chunkSizeInByte;
+    const TbfHugePages hugePages;
+
+    std::shared_ptr<Stats> stats;
+    std::shared_ptr<Chunk> currentChunk;
+    std::mutex arenaMutex;
+
+    static long int RoundUp(const long int inSize, const long int inAlignement){
+        return ((inSize + inAlignement - 1)/inAlignement)*inAlignement;
+    }
+
+    // The offset of the first address aligned on inAlignement at or after inOffsetInByte in the chunk
+    static long int AlignedOffset(const Chunk& inChunk, const long int inOffsetInByte, const long int inAlignement){
+        const long int chunkAddress = static_cast<long int>(reinterpret_cast<std::uintptr_t>(inChunk.ptr));
+        return RoundUp(chunkAddress + inOffsetInByte, inAlignement) - chunkAddress;
+    }
+
+    unsigned char* mapMemory(const long int inSizeInByte, bool* outIsHugeTlb) const{
+        (*outIsHugeTlb) = false;
+#ifdef MAP_HUGETLB
+        if(hugePages == TbfHugePages::Explicit){
+            void* ptr = mmap(nullptr, static_cast<size_t>(inSizeInByte), PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if(ptr != MAP_FAILED){
+                (*outIsHugeTlb) = true;
+                return static_cast<unsigned char*>(ptr);
+            }
+        }
+#endif
+        if(hugePages == TbfHugePages::None){
+            void* ptr = mmap(nullptr, static_cast<size_t>(inSizeInByte), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            return (ptr == MAP_FAILED ? nullptr : static_cast<unsigned char*>(ptr));
+        }
+
+        // Map more to align the chunk on the huge page size, and remove the extra parts
+        const long int extendedSizeInByte = inSizeInByte + HugePageSizeInByte;
+        void* ptr = mmap(nullptr, static_cast<size_t>(extendedSizeInByte), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(ptr == MAP_FAILED){
+            return nullptr;
+        }
+        unsigned char* extendedPtr = static_cast<unsigned char*>(ptr);
+        const long int headSizeInByte = RoundUp(static_cast<long int>(reinterpret_cast<std::uintptr_t>(extendedPtr)), HugePageSizeInByte)
+                                        - static_cast<long int>(reinterpret_cast<std::uintptr_t>(extendedPtr));
+        if(headSizeInByte){
+            munmap(extendedPtr, static_cast<size_t>(headSizeInByte));
+        }
+        if(HugePageSizeInByte - headSizeInByte){
+            munmap(extendedPtr + headSizeInByte + inSizeInByte, static_cast<size_t>(HugePageSizeInByte - headSizeInByte));
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(extendedPtr + headSizeInByte, static_cast<size_t>(inSizeInByte), MADV_HUGEPAGE);
+#endif
+        return extendedPtr + headSizeInByte;
+    }
+
+    std::shared_ptr<Chunk> newChunk(const long int inMinSizeInByte) const{
+        const long int granularity = (hugePages == TbfHugePages::None ? pageSize : HugePageSizeInByte);
+        const long int sizeInByte = RoundUp(std::max(inMinSizeInByte, chunkSizeInByte), granularity);
+
+        std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>();
+        chunk->ptr = mapMemory(sizeInByte, &chunk->isHugeTlb);
+        if(chunk->ptr == nullptr){
+            throw std::bad_alloc();
+        }
+        chunk->sizeInByte = sizeInByte;
+        chunk->stats = stats;
+
+        stats->nbChunks += 1;
+        stats->nbHugeTlbChunks += (chunk->isHugeTlb ? 1 : 0);
+        stats->mappedSizeInByte += sizeInByte;
+        return chunk;
+    }
+
+public:
+    explicit TbfArenaAllocator(const long int inChunkSizeInByte = DefaultChunkSizeInByte,
+                               const TbfHugePages inHugePages = TbfHugePages::None)
+        : pageSize(sysconf(_SC_PAGESIZE)), chunkSizeInByte(std::max(1L, inChunkSizeInByte)),
+          hugePages(inHugePages), stats(std::make_shared<Stats>()){
+    }
+
+    TbfHugePages getHugePages() const{
+        return hugePages;
+    }
+
+    long int getChunkSizeInByte() const{
+        return chunkSizeInByte;
+    }
+
+    // The number of chunks that are mapped (including the current one)
+    long int getNbChunks() const{
+        return stats->nbChunks;
+    }
+
+    // The number of chunks mapped with MAP_HUGETLB
+    long int getNbHugeTlbChunks() const{
+        return stats->nbHugeTlbChunks;
+    }
+
+    long int getMappedSizeInByte() const{
+        return stats->mappedSizeInByte;
+    }
+
+    // Releases the current chunk (it is unmapped when all its blocks are deleted)
+    void releaseCurrentChunk(){
+        std::lock_guard<std::mutex> lock(arenaMutex);
+        currentChunk.reset();
+    }
+
+    bool givesZeroedMemory() const final{
+        return true;
+    }
+
+    std::pair<unsigned char*, TbfMemoryBlockDeleter> allocate(const long int inSizeInByte, const long int inAlignementBytes) final{
+        // Each block starts on its own cache line
+        const long int alignement = std::max(inAlignementBytes, TbfDefaultMemoryAlignement);
+        const long int sizeInByte = RoundUp(std::max(1L, inSizeInByte), alignement);
+        // The chunks are aligned on the page size, if the alignement is not
+        // a divisor of the page size the block may start after some padding
+        const long int maxPaddingInByte = (pageSize % alignement == 0 ? 0 : alignement);
+
+        std::shared_ptr<Chunk> chunk;
+        long int offsetInByte = 0;
+        {
+            std::lock_guard<std::mutex> lock(arenaMutex);
+            if(currentChunk && AlignedOffset(*currentChunk, currentChunk->usedSizeInByte, alignement) + sizeInByte <= currentChunk->sizeInByte){
+                chunk = currentChunk;
+            }
+            else if(sizeInByte + maxPaddingInByte > chunkSizeInByte/2){
+                // Large blocks have their own chunk, the current one is kept
+                chunk = newChunk(sizeInByte + maxPaddingInByte);
+            }
+            else{
+                currentChunk = newChunk(sizeInByte + maxPaddingInByte);
+                chunk = currentChunk;
+            }
+            offsetInByte = AlignedOffset(*chunk, chunk->usedSizeInByte, alignement);
+            chunk->usedSizeInByte = offsetInByte + sizeInByte;
+            assert(chunk->usedSizeInByte <= chunk->sizeInByte);
+        }
+
+        // The deleter keeps the chunk alive
+        return std::make_pair(chunk->ptr + offsetInByte, [chunk](unsigned char* /*inPtr*/) mutable {
+            chunk.reset();
+        });
+    }
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef TBFFIXEDCAPACITYVECTOR_HPP
+#define TBFFIXEDCAPACITYVECTOR_HPP
+
+#include "tbfglobal.hpp"
+
+#include <array>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <cassert>
+
+// A vector with its elements stored inline (no allocation), used to give the children
+// or the neighbors of a cell to the kernels (as a std::vector, but with at most Capacity elements).
+template <class ElementType_T, long int Capacity>
+class TbfFixedCapacityVector {
+public:
+    using ElementType = ElementType_T;
+    using value_type = ElementType_T;
+
+private:
+    std::array<typename std::aligned_storage<sizeof(ElementType), alignof(ElementType)>::type, Capacity> elements;
+    long int nbElements;
+
+public:
+    TbfFixedCapacityVector() : nbElements(0){}
+
+    ~TbfFixedCapacityVector(){
+        clear();
+    }
+
+    TbfFixedCapacityVector(const TbfFixedCapacityVector&) = delete;
+    TbfFixedCapacityVector& operator=(const TbfFixedCapacityVector&) = delete;
+
+    template <class ... Params>
+    ElementType& emplace_back(Params&& ... inParams){
+        assert(nbElements < Capacity);
+        ElementType* element = new (&elements[nbElements]) ElementType(std::forward<Params>(inParams)...);
+        nbElements += 1;
+        return *element;
+    }
+
+    void clear(){
+        if constexpr(!std::is_trivially_destructible<ElementType>::value){
+            for(long int idxElement = 0 ; idxElement < nbElements ; ++idxElement){
+                data()[idxElement].~ElementType();
+            }
+        }
+        nbElements = 0;
+    }
+
+    long int size() const{
+        return nbElements;
+    }
+
+    bool empty() const{
+        return nbElements == 0;
+    }
+
+    constexpr static long int capacity(){
+        return Capacity;
+    }
+
+    ElementType* data(){
+        return std::launder(reinterpret_cast<ElementType*>(elements.data()));
+    }
+
+    const ElementType* data() const{
+        return std::launder(reinterpret_cast<const ElementType*>(elements.data()));
+    }
+
+    ElementType& operator[](const long int inIndex){
+        assert(inIndex < nbElements);
+        return data()[inIndex];
+    }
+
+    const ElementType& operator[](const long int inIndex) const{
+        assert(inIndex < nbElements);
+        return data()[inIndex];
+    }
+
+    ElementType* begin(){
+        return data();
+    }
+
+    ElementType* end(){
+        return data() + nbElements;
+    }
+
+    const ElementType* begin() const{
+        return data();
+    }
+
+    const ElementType* end() const{
+        return data() + nbElements;
+    }
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef TBFMAPPEDFILEALLOCATOR_HPP
+#define TBFMAPPEDFILEALLOCATOR_HPP
+
+#include "tbfglobal.hpp"
+
+#include "tbfmemoryallocator.hpp"
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Out-of-core allocator, the blocks are mapped from a temporary file (shared mapping),
+// such that the system can write them to the disk and evict them when the memory is full.
+// The file is removed when it is created and disappears when the allocator and all the blocks are deleted.
+class TbfMappedFileAllocator : public TbfMemoryAllocator {
+    struct MappedFile {
+        int fileDescriptor = -1;
+        long int fileSizeInByte = 0;
+        long int allocatedSizeInByte = 0;
+        // The live mappings, address => (offset in the file, mapped size)
+        std::map<const unsigned char*, std::pair<long int, long int>> mappings;
+        std::mutex fileMutex;
+
+        ~MappedFile(){
+            if(fileDescriptor != -1){
+                close(fileDescriptor);
+            }
+        }
+    };
+
+    const long int pageSize;
+    std::shared_ptr<MappedFile> mappedFile;
+
+    long int getPageAlignedSize(const long int inSizeInByte) const{
+        return ((inSizeInByte + pageSize - 1)/pageSize)*pageSize;
+    }
+
+    long int getOffsetInPage(const unsigned char* inPtr) const{
+        return static_cast<long int>(reinterpret_cast<uintptr_t>(inPtr) % static_cast<uintptr_t>(pageSize));
+    }
+
+public:
+    static std::string GetDefaultDirectory(){
+        if(const char* directory = getenv("TBFMM_OUT_OF_CORE_DIR")){
+            return directory;
+        }
+        if(const char* directory = getenv("TMPDIR")){
+            return directory;
+        }
+        return "/tmp";
+    }
+
+    explicit TbfMappedFileAllocator(const std::string& inDirectory = GetDefaultDirectory())
+        : pageSize(sysconf(_SC_PAGESIZE)), mappedFile(std::make_shared<MappedFile>()){
+        std::string filename = inDirectory + "/tbfmm-out-of-core-XXXXXX";
+        mappedFile->fileDescriptor = mkstemp(&filename[0]);
+        if(mappedFile->fileDescriptor != -1){
+            unlink(filename.c_str());
+            // The groups are prefetched explicitly (adviseWillNeed), the readahead of the system
+            // would load the neighbors in the file, which are not the neighbors in the tree
+            posix_fadvise(mappedFile->fileDescriptor, 0, 0, POSIX_FADV_RANDOM);
+        }
+    }
+
+    bool isOpen() const{
+        return mappedFile->fileDescriptor != -1;
+    }
+
+    // The size of the blocks that currently exist
+    long int getAllocatedSizeInByte() const{
+        std::lock_guard<std::mutex> lock(mappedFile->fileMutex);
+        return mappedFile->allocatedSizeInByte;
+    }
+
+    // The new pages of a mapping are zeros
+    bool givesZeroedMemory() const final{
+        return true;
+    }
+
+    std::pair<unsigned char*, TbfMemoryBlockDeleter> allocate(const long int inSizeInByte, const long int inAlignementBytes) final{
+        // The memory is aligned on the page size
+        assert(pageSize % inAlignementBytes == 0);
+        (void)inAlignementBytes;
+        const long int mappedSize = getPageAlignedSize(std::max(1L, inSizeInByte));
+        long int fileOffset;
+        {
+            std::lock_guard<std::mutex> lock(mappedFile->fileMutex);
+            fileOffset = mappedFile->fileSizeInByte;
+            if(!isOpen() || ftruncate(mappedFile->fileDescriptor, fileOffset + mappedSize) != 0){
+                throw std::bad_alloc();
+            }
+            mappedFile->fileSizeInByte += mappedSize;
+            mappedFile->allocatedSizeInByte += mappedSize;
+        }
+
+        void* ptr = mmap(nullptr, static_cast<size_t>(mappedSize), PROT_READ | PROT_WRITE, MAP_SHARED,
+                         mappedFile->fileDescriptor, fileOffset);
+        if(ptr == MAP_FAILED){
+            throw std::bad_alloc();
+        }
+        madvise(ptr, static_cast<size_t>(mappedSize), MADV_RANDOM);
+        {
+            std::lock_guard<std::mutex> lock(mappedFile->fileMutex);
+            mappedFile->mappings[static_cast<unsigned char*>(ptr)] = std::make_pair(fileOffset, mappedSize);
+        }
+
+        std::shared_ptr<MappedFile> file = mappedFile;
+        return std::make_pair(static_cast<unsigned char*>(ptr), [file, fileOffset, mappedSize](unsigned char* inPtr){
+            munmap(inPtr, static_cast<size_t>(mappedSize));
+            std::lock_guard<std::mutex> lock(file->fileMutex);
+            file->mappings.erase(inPtr);
+#ifdef FALLOC_FL_PUNCH_HOLE
+            // Give back the disk space (the offsets are never reused)
+            fallocate(file->fileDescriptor, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, fileOffset, mappedSize);
+#endif
+            file->allocatedSizeInByte -= mappedSize;
+        });
+    }
+
+    void adviseWillNeed(unsigned char* inPtr, const long int inSizeInByte) final{
+        // madvise needs an address aligned on the page size, the blocks are
+        // page aligned, so this only removes the offset of a sub-block
+        const long int offsetInPage = getOffsetInPage(inPtr);
+        if(inPtr && inSizeInByte){
+            madvise(inPtr - offsetInPage, static_cast<size_t>(getPageAlignedSize(inSizeInByte + offsetInPage)), MADV_WILLNEED);
+        }
+    }
+
+    void adviseDoNotNeed(unsigned char* inPtr, const long int inSizeInByte) final{
+        if(!inPtr || !inSizeInByte){
+            return;
+        }
+        unsigned char* alignedPtr = inPtr - getOffsetInPage(inPtr);
+        const long int alignedSize = getPageAlignedSize(inSizeInByte + getOffsetInPage(inPtr));
+        // On a shared mapping, MADV_DONTNEED only removes the pages from the process,
+        // they stay in the page cache, so they are written to the file and evicted from the cache
+        msync(alignedPtr, static_cast<size_t>(alignedSize), MS_SYNC);
+        madvise(alignedPtr, static_cast<size_t>(alignedSize), MADV_DONTNEED);
+
+        std::lock_guard<std::mutex> lock(mappedFile->fileMutex);
+        auto iterMapping = mappedFile->mappings.upper_bound(alignedPtr);
+        if(iterMapping != mappedFile->mappings.begin()){
+            --iterMapping;
+            const long int offsetInMapping = static_cast<long int>(alignedPtr - iterMapping->first);
+            if(offsetInMapping < iterMapping->second.second){
+                posix_fadvise(mappedFile->fileDescriptor, iterMapping->second.first + offsetInMapping,
+                              alignedSize, POSIX_FADV_DONTNEED);
+            }
+        }
+    }
+
+    // The number of pages of the live blocks that are in memory
+    long int getNbResidentPages() const{
+        std::lock_guard<std::mutex> lock(mappedFile->fileMutex);
+        long int nbResidentPages = 0;
+        std::vector<unsigned char> residentFlags;
+        for(const auto& mapping : mappedFile->mappings){
+            const long int nbPages = mapping.second.second/pageSize;
+            residentFlags.resize(static_cast<size_t>(nbPages));
+            if(mincore(const_cast<unsigned char*>(mapping.first), static_cast<size_t>(mapping.second.second), residentFlags.data()) == 0){
+                nbResidentPages += std::count_if(residentFlags.begin(), residentFlags.end(),
+                                                 [](const unsigned char inFlag){ return (inFlag & 1) != 0; });
+            }
+        }
+        return nbResidentPages;
+    }
+
+    long int getPageSize() const{
+        return pageSize;
+    }
+};
+
+#endif
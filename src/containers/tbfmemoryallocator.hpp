@@ -0,0 +1,40 @@
+#ifndef TBFMEMORYALLOCATOR_HPP
+#define TBFMEMORYALLOCATOR_HPP
+
+#include "tbfglobal.hpp"
+
+#include <functional>
+#include <utility>
+#include <memory>
+
+// Releases the memory of a block, the default one uses delete[]
+using TbfMemoryBlockDeleter = std::function<void(unsigned char*)>;
+
+// Gives the memory of the blocks (TbfMemoryBlock uses new[] when there is no allocator).
+// The allocators are shared by all the blocks of a tree and must be thread safe.
+class TbfMemoryAllocator : public std::enable_shared_from_this<TbfMemoryAllocator> {
+public:
+    virtual ~TbfMemoryAllocator(){}
+
+    // The allocator to use for the group inIdxGroup of inNbGroups (of a level), the default
+    // one uses the same allocator for all the groups
+    virtual std::shared_ptr<TbfMemoryAllocator> getAllocatorForGroup(const long int /*inIdxGroup*/, const long int /*inNbGroups*/){
+        return shared_from_this();
+    }
+
+    // Returns the memory (of at least inSizeInByte, aligned on inAlignementBytes) and the function to release it
+    virtual std::pair<unsigned char*, TbfMemoryBlockDeleter> allocate(const long int inSizeInByte, const long int inAlignementBytes) = 0;
+
+    // If true, the memory returned by allocate is filled with zeros (such that the blocks do not need to reset it)
+    virtual bool givesZeroedMemory() const{
+        return false;
+    }
+
+    // Hints that the memory is going to be used soon
+    virtual void adviseWillNeed(unsigned char* /*inPtr*/, const long int /*inSizeInByte*/){}
+
+    // Hints that the memory is not going to be used soon (its content must be kept)
+    virtual void adviseDoNotNeed(unsigned char* /*inPtr*/, const long int /*inSizeInByte*/){}
+};
+
+#endif
@@ -3,11 +3,17 @@
 
 #include "tbfglobal.hpp"
 
+#include "tbfmemoryallocator.hpp"
+
 #include <tuple>
 #include <array>
 #include <memory>
+#include <cstdint>
 #include <cassert>
 #include <cstring>
+#include <new>
+#include <algorithm>
+#include <type_traits>
 
 template <class ... BlockDefinitions>
 class TbfMemoryBlock{
@@ -47,17 +53,27 @@ class TbfMemoryBlock{
         return sizeAndOffset;
     }
 
+    static void AlignedDelete(unsigned char* inPtr){
+        operator delete[](inPtr, std::align_val_t(MemoryAlignementBytes));
+    }
+
+    std::shared_ptr<TbfMemoryAllocator> allocator;
+    // The allocator that gave the current memory (nullptr if it does not come from an allocator)
+    TbfMemoryAllocator* memoryAllocator;
     long int allocatedMemorySizeInByte;
-    std::unique_ptr<unsigned char[]> rawMemoryPtr;
+    std::unique_ptr<unsigned char[], TbfMemoryBlockDeleter> rawMemoryPtr;
     long int* nbItemsInBlocks;
     long int* offsetOfBlocksForPtrs;
     std::array<unsigned char*,NbBlocks> blockRawPtrs;
 
-    void constructAllItems(){
-        applyToAllElements([](auto& inItem){
+    // If the memory is set to zero, the trivial items are already value-initialized
+    void constructAllItems(const bool inMemoryIsZero){
+        applyToAllElements([inMemoryIsZero](auto& inItem){
             static_assert (std::is_reference<decltype(inItem)>::value, "Should be a ref here");
             using ItemType = typename std::decay<decltype(inItem)>::type;
-            new(&inItem) ItemType();
+            if(!std::is_trivially_default_constructible<ItemType>::value || !inMemoryIsZero){
+                new(&inItem) ItemType();
+            }
         });
     }
 
@@ -70,8 +86,11 @@ class TbfMemoryBlock{
     }
 
 public:
+    // The memory is aligned for all the blocks (the offsets of the blocks are multiples of their alignment)
+    constexpr static long int MemoryAlignementBytes = std::max({BlockDefinitions::BlockMemoryAlignementBytes ...});
+
     TbfMemoryBlock()
-        : allocatedMemorySizeInByte(0), rawMemoryPtr(nullptr), nbItemsInBlocks(nullptr),
+        : memoryAllocator(nullptr), allocatedMemorySizeInByte(0), rawMemoryPtr(nullptr, &AlignedDelete), nbItemsInBlocks(nullptr),
           offsetOfBlocksForPtrs(nullptr){
         for(auto& blockPtr : blockRawPtrs){
             blockPtr = nullptr;
@@ -86,12 +105,15 @@ public:
     }
 
     TbfMemoryBlock& operator=(TbfMemoryBlock&& other){
+        allocator = std::move(other.allocator);
+        memoryAllocator = other.memoryAllocator;
         allocatedMemorySizeInByte = other.allocatedMemorySizeInByte;
         rawMemoryPtr = std::move(other.rawMemoryPtr);
         nbItemsInBlocks = other.nbItemsInBlocks;
         offsetOfBlocksForPtrs = other.offsetOfBlocksForPtrs;
         blockRawPtrs = other.blockRawPtrs;
 
+        other.memoryAllocator = nullptr;
         other.allocatedMemorySizeInByte = 0;
         other.nbItemsInBlocks = nullptr;
         other.offsetOfBlocksForPtrs = nullptr;
@@ -108,9 +130,24 @@ public:
         resetBlocksFromSizes(std::forward<SizeContainerClass>(inNbItemsInBlocks));
     }
 
+    // The memory must have been allocated as the blocks do without allocator
+    // (aligned new[]), see getPtr() and getAllocatedMemorySizeInByte()
     explicit TbfMemoryBlock(unsigned char* inRawMemoryPtr, const long int inBlockSizeInByte)
-        : allocatedMemorySizeInByte(inBlockSizeInByte), rawMemoryPtr(inRawMemoryPtr), nbItemsInBlocks(nullptr),
+        : TbfMemoryBlock(inRawMemoryPtr, inBlockSizeInByte, &AlignedDelete){
+    }
+
+    // The memory must come from a block (see getPtr() and getAllocatedMemorySizeInByte()),
+    // it is released with inDeleter (which can do nothing if the memory is not owned)
+    explicit TbfMemoryBlock(unsigned char* inRawMemoryPtr, const long int inBlockSizeInByte, TbfMemoryBlockDeleter inDeleter)
+        : memoryAllocator(nullptr), allocatedMemorySizeInByte(inBlockSizeInByte), rawMemoryPtr(inRawMemoryPtr, std::move(inDeleter)), nbItemsInBlocks(nullptr),
           offsetOfBlocksForPtrs(nullptr){
+        for(auto& blockPtr : blockRawPtrs){
+            blockPtr = nullptr;
+        }
+        if(inRawMemoryPtr == nullptr || inBlockSizeInByte == 0){
+            allocatedMemorySizeInByte = 0;
+            return;
+        }
 
         nbItemsInBlocks = reinterpret_cast<long int*>(&rawMemoryPtr[allocatedMemorySizeInByte] - (sizeof(long int) * NbBlocks));
         offsetOfBlocksForPtrs = reinterpret_cast<long int*>(&rawMemoryPtr[allocatedMemorySizeInByte] - (sizeof(long int) * NbBlocks)
@@ -130,11 +167,24 @@ public:
                                             + sizeof(long int) * NbBlocks
                                             + sizeof(long int) * NbBlocks);
 
-        if(allocatedMemorySizeInByte < totalMemoryToAlloc){
-            rawMemoryPtr.reset(new unsigned char[totalMemoryToAlloc]);
+        bool memoryIsZero = false;
+        if(allocatedMemorySizeInByte < totalMemoryToAlloc || memoryAllocator != allocator.get()){
+            if(allocator){
+                auto memoryAndDeleter = allocator->allocate(totalMemoryToAlloc, MemoryAlignementBytes);
+                assert(reinterpret_cast<std::uintptr_t>(memoryAndDeleter.first) % MemoryAlignementBytes == 0);
+                rawMemoryPtr = std::unique_ptr<unsigned char[], TbfMemoryBlockDeleter>(memoryAndDeleter.first, std::move(memoryAndDeleter.second));
+                memoryIsZero = allocator->givesZeroedMemory();
+            }
+            else{
+                rawMemoryPtr = std::unique_ptr<unsigned char[], TbfMemoryBlockDeleter>(new (std::align_val_t(MemoryAlignementBytes)) unsigned char[totalMemoryToAlloc],
+                                                                                    &AlignedDelete);
+            }
+            memoryAllocator = allocator.get();
             allocatedMemorySizeInByte = totalMemoryToAlloc;
         }
-        memset(rawMemoryPtr.get(), 0, totalMemoryToAlloc);
+        if(!memoryIsZero){
+            memset(rawMemoryPtr.get(), 0, totalMemoryToAlloc);
+        }
 
         nbItemsInBlocks = reinterpret_cast<long int*>(&rawMemoryPtr[allocatedMemorySizeInByte] - (sizeof(long int) * NbBlocks));
         offsetOfBlocksForPtrs = reinterpret_cast<long int*>(&rawMemoryPtr[allocatedMemorySizeInByte] - (sizeof(long int) * NbBlocks)
@@ -146,7 +196,33 @@ public:
             blockRawPtrs[idxBlock] = &rawMemoryPtr[offsetOfBlocksForPtrs[idxBlock]];
         }
 
-        constructAllItems();
+        constructAllItems(true);
+    }
+
+    // The allocator is used by the next resetBlocksFromSizes (nullptr to use new[])
+    void setAllocator(std::shared_ptr<TbfMemoryAllocator> inAllocator){
+        allocator = std::move(inAllocator);
+    }
+
+    const std::shared_ptr<TbfMemoryAllocator>& getAllocator() const{
+        return allocator;
+    }
+
+    void adviseWillNeed() const{
+        if(allocator && memoryAllocator == allocator.get()){
+            allocator->adviseWillNeed(rawMemoryPtr.get(), allocatedMemorySizeInByte);
+        }
+    }
+
+    void adviseDoNotNeed() const{
+        if(allocator && memoryAllocator == allocator.get()){
+            allocator->adviseDoNotNeed(rawMemoryPtr.get(), allocatedMemorySizeInByte);
+        }
+    }
+
+    void resetAllItems(){
+        freeAllItems();
+        constructAllItems(false);
     }
 
     bool isEmpty() const {
@@ -161,6 +237,10 @@ public:
         return rawMemoryPtr.get();
     }
 
+    long int getAllocatedMemorySizeInByte() const{
+        return allocatedMemorySizeInByte;
+    }
+
     //////////////////////////////////////////////////////////////////////
 
     template <class FuncType>
@@ -0,0 +1,95 @@
+#ifndef TBFNUMAALLOCATOR_HPP
+#define TBFNUMAALLOCATOR_HPP
+
+#include "tbfglobal.hpp"
+
+#include "tbfmemoryallocator.hpp"
+#include "utils/tbfnuma.hpp"
+
+#include <new>
+#include <cassert>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Places the blocks on the NUMA nodes.
+// An allocator built without node gives each group to the node of its position
+// in the level (group index x nb nodes / nb groups), such that each node gets a
+// contiguous interval of the space filling curve whatever thread builds the group.
+// An allocator built with a node places all its blocks on this node.
+class TbfNumaAllocator : public TbfMemoryAllocator {
+    const long int pageSize;
+    const int node;
+    std::shared_ptr<std::atomic<long int>> nbAllocationsNotPlaced;
+    std::vector<std::shared_ptr<TbfNumaAllocator>> nodeAllocators;
+
+    TbfNumaAllocator(const int inNode, std::shared_ptr<std::atomic<long int>> inNbAllocationsNotPlaced)
+        : pageSize(sysconf(_SC_PAGESIZE)), node(inNode), nbAllocationsNotPlaced(std::move(inNbAllocationsNotPlaced)){
+    }
+
+public:
+    // If inNode is -1, the blocks allocated directly (without getAllocatorForGroup)
+    // are placed on the node of the allocating thread
+    explicit TbfNumaAllocator(const int inNode = -1)
+        : TbfNumaAllocator(inNode, std::make_shared<std::atomic<long int>>(0)){
+        if(node == -1){
+            const int nbNodes = TbfNuma::GetNbNodes();
+            for(int idxNode = 0 ; idxNode < nbNodes ; ++idxNode){
+                nodeAllocators.emplace_back(new TbfNumaAllocator(idxNode, nbAllocationsNotPlaced));
+            }
+        }
+    }
+
+    // The node of the blocks (-1 if it is the one of the allocating thread)
+    int getNode() const{
+        return node;
+    }
+
+    int getNbNodes() const{
+        return (node == -1 ? static_cast<int>(nodeAllocators.size()) : 1);
+    }
+
+    std::shared_ptr<TbfMemoryAllocator> getAllocatorForGroup(const long int inIdxGroup, const long int inNbGroups) final{
+        if(node != -1){
+            return shared_from_this();
+        }
+        return nodeAllocators[TbfNuma::GetNodeOfPosition(inIdxGroup, inNbGroups, getNbNodes())];
+    }
+
+    // The number of blocks for which the system refused the placement (they use the default policy),
+    // it is shared with the allocators of the nodes
+    long int getNbAllocationsNotPlaced() const{
+        return *nbAllocationsNotPlaced;
+    }
+
+    // The new pages of a mapping are zeros
+    bool givesZeroedMemory() const final{
+        return true;
+    }
+
+    std::pair<unsigned char*, TbfMemoryBlockDeleter> allocate(const long int inSizeInByte, const long int inAlignementBytes) final{
+        // The memory is aligned on the page size
+        assert(pageSize % inAlignementBytes == 0);
+        (void)inAlignementBytes;
+        const long int mappedSize = ((std::max(1L, inSizeInByte) + pageSize - 1)/pageSize)*pageSize;
+        void* ptr = mmap(nullptr, static_cast<size_t>(mappedSize), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(ptr == MAP_FAILED){
+            throw std::bad_alloc();
+        }
+
+        // The pages are not touched yet, they will be allocated on the node when the block is initialized
+        if(!TbfNuma::SetPreferredNode(ptr, mappedSize, (node == -1 ? TbfNuma::GetCurrentNode() : node))){
+            *nbAllocationsNotPlaced += 1;
+        }
+
+        return std::make_pair(static_cast<unsigned char*>(ptr), [mappedSize](unsigned char* inPtr){
+            munmap(inPtr, static_cast<size_t>(mappedSize));
+        });
+    }
+};
+
+#endif
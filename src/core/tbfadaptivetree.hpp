@@ -0,0 +1,423 @@
+#ifndef TBFADAPTIVETREE_HPP
+#define TBFADAPTIVETREE_HPP
+
+#include "tbfglobal.hpp"
+#include "tbfparticlescontainer.hpp"
+#include "tbfparticlesorter.hpp"
+#include "tbfinteraction.hpp"
+#include "tbfcellscontainer.hpp"
+
+#include "utils/tbfparallel.hpp"
+
+#include <vector>
+#include <array>
+#include <optional>
+#include <algorithm>
+#include <memory>
+#include <cassert>
+
+// A tree where the leaves can be at any level: a cell is subdivided
+// only if it contains more than inMaxParticlesPerLeaf particles (and if it is
+// not at the last level of the configuration).
+// At each level, the cell groups contain all the cells (internal cells and leaves),
+// and the particle groups contain the leaves of this level.
+template <class RealType, class DataType, long int NbDataValuesPerParticle, class RhsType, long int NbRhsValuesPerParticle,
+          class MultipoleClass, class LocalClass, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
+class TbfAdaptiveTree {
+public:
+    using LeafGroupClass = TbfParticlesContainer<RealType, DataType, NbDataValuesPerParticle, RhsType, NbRhsValuesPerParticle, SpaceIndexType>;
+    using CellGroupClass = TbfCellsContainer<RealType, MultipoleClass, LocalClass, SpaceIndexType>;
+    using SpacialConfiguration = TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>;
+    using IndexType = typename SpaceIndexType::IndexType;
+
+protected:
+    using SorterClass = TbfParticleSorter<RealType, SpaceIndexType>;
+
+    struct AdaptiveLeaf{
+        IndexType spaceIndex;
+        long int firstSortedLeaf;
+        long int lastSortedLeaf;
+    };
+
+    // Describes a group of leaves of the same level (to be used as a GroupInfoClass),
+    // the particles are given by the sorter (computed at the last level)
+    class AdaptiveGroupInfo{
+        const SorterClass& sorter;
+        std::vector<IndexType> leavesIndex;
+        std::vector<long int> leavesOffset;
+        std::vector<long int> sortedIndexes;
+
+    public:
+        AdaptiveGroupInfo(const SorterClass& inSorter, const AdaptiveLeaf* inLeaves, const long int inNbLeaves)
+            : sorter(inSorter){
+            leavesIndex.reserve(inNbLeaves);
+            leavesOffset.reserve(inNbLeaves+1);
+            for(long int idxLeaf = 0 ; idxLeaf < inNbLeaves ; ++idxLeaf){
+                leavesIndex.push_back(inLeaves[idxLeaf].spaceIndex);
+                leavesOffset.push_back(static_cast<long int>(sortedIndexes.size()));
+                const long int firstParticle = sorter.getFirstParticleInLeaf(inLeaves[idxLeaf].firstSortedLeaf);
+                const long int lastParticle = sorter.getFirstParticleInLeaf(inLeaves[idxLeaf].lastSortedLeaf);
+                for(long int idxPart = firstParticle ; idxPart < lastParticle ; ++idxPart){
+                    sortedIndexes.push_back(idxPart);
+                }
+            }
+            leavesOffset.push_back(static_cast<long int>(sortedIndexes.size()));
+        }
+
+        long int getNbLeaves() const{
+            return static_cast<long int>(leavesIndex.size());
+        }
+
+        long int getNbParticles() const{
+            return static_cast<long int>(sortedIndexes.size());
+        }
+
+        IndexType getSpacialIndexForLeaf(const long int inLeafIndex) const{
+            return leavesIndex[inLeafIndex];
+        }
+
+        long int getNbParticlesInLeaf(const long int inLeafIndex) const{
+            return leavesOffset[inLeafIndex+1] - leavesOffset[inLeafIndex];
+        }
+
+        IndexType getSpacialIndexForParticle(const long int inIdxParticle) const{
+            const auto iterLeaf = std::upper_bound(leavesOffset.begin(), leavesOffset.end(), inIdxParticle);
+            return leavesIndex[std::distance(leavesOffset.begin(), iterLeaf) - 1];
+        }
+
+        long int getParticleIndex(const long int inIdxParticle) const{
+            return sorter.getParticleIndex(sortedIndexes[inIdxParticle]);
+        }
+
+        long int getParticlePositionIndex(const long int inIdxParticle) const{
+            return sorter.getParticlePositionIndex(sortedIndexes[inIdxParticle]);
+        }
+    };
+
+    const SpacialConfiguration configuration;
+    const SpaceIndexType spaceSystem;
+    const long int maxParticlesPerLeaf;
+    long int nbElementsPerBlock;
+
+    std::vector<std::vector<CellGroupClass>> cellBlocks;
+    std::vector<std::vector<LeafGroupClass>> particleGroups;
+
+    long int nbParticles;
+
+    IndexType getAncestorIndex(IndexType inIndex, const long int inLevel, const long int inAncestorLevel) const{
+        for(long int idxLevel = inLevel ; idxLevel > inAncestorLevel ; --idxLevel){
+            inIndex = spaceSystem.getParentIndex(inIndex);
+        }
+        return inIndex;
+    }
+
+    // The leaves of the sorter (at the last level) in [inFirstSortedLeaf, inLastSortedLeaf[ are in the cell
+    void subdivide(const SorterClass& inSorter, const long int inLevel, const IndexType inCellIndex,
+                   const long int inFirstSortedLeaf, const long int inLastSortedLeaf,
+                   std::vector<std::vector<IndexType>>& inOutCellIndexes,
+                   std::vector<std::vector<AdaptiveLeaf>>& inOutLeaves) const {
+        const long int lastLevel = configuration.getTreeHeight()-1;
+        const long int nbParticlesInCell = inSorter.getFirstParticleInLeaf(inLastSortedLeaf) - inSorter.getFirstParticleInLeaf(inFirstSortedLeaf);
+
+        inOutCellIndexes[inLevel].push_back(inCellIndex);
+
+        if(inLevel == lastLevel || nbParticlesInCell <= maxParticlesPerLeaf){
+            inOutLeaves[inLevel].push_back(AdaptiveLeaf{inCellIndex, inFirstSortedLeaf, inLastSortedLeaf});
+            return;
+        }
+
+        long int idxSortedLeaf = inFirstSortedLeaf;
+        while(idxSortedLeaf != inLastSortedLeaf){
+            const IndexType childIndex = getAncestorIndex(inSorter.getSpacialIndexForLeaf(idxSortedLeaf), lastLevel, inLevel+1);
+            long int idxLastSortedLeafInChild = idxSortedLeaf + 1;
+            while(idxLastSortedLeafInChild != inLastSortedLeaf
+                  && getAncestorIndex(inSorter.getSpacialIndexForLeaf(idxLastSortedLeafInChild), lastLevel, inLevel+1) == childIndex){
+                idxLastSortedLeafInChild += 1;
+            }
+            subdivide(inSorter, inLevel+1, childIndex, idxSortedLeaf, idxLastSortedLeafInChild, inOutCellIndexes, inOutLeaves);
+            idxSortedLeaf = idxLastSortedLeafInChild;
+        }
+    }
+
+    template <class GroupClass, class BuilderFunc>
+    static void BuildGroups(std::vector<GroupClass>& outGroups, const long int inNbGroups, const int inNbThreads,
+                            BuilderFunc&& inBuilder){
+        std::vector<std::optional<GroupClass>> groups(inNbGroups);
+        TbfParallel::ParallelFor(0, inNbGroups, inNbThreads, [&](const long int idxGroup){
+            groups[idxGroup].emplace(inBuilder(idxGroup));
+        });
+
+        outGroups.clear();
+        outGroups.reserve(inNbGroups);
+        for(auto& group : groups){
+            outGroups.emplace_back(std::move(*group));
+        }
+    }
+
+    template <class GroupContainerClass>
+    static auto FindInGroups(GroupContainerClass& inGroups, const IndexType inMIndex){
+        using GroupClass = typename std::remove_reference<decltype(*std::begin(inGroups))>::type;
+        using ResultType = std::optional<std::pair<std::reference_wrapper<GroupClass>,long int>>;
+
+        const auto groupIter = std::lower_bound(std::begin(inGroups), std::end(inGroups), inMIndex, [](const auto& groupToTest, const auto& mindex){
+            return groupToTest.getEndingSpacialIndex() < mindex;
+        });
+
+        if(groupIter != std::end(inGroups) && (*groupIter).getStartingSpacialIndex() <= inMIndex){
+            auto foundElement = (*groupIter).getElementFromSpacialIndex(inMIndex);
+            if(foundElement){
+                return ResultType(std::make_pair(std::ref(*groupIter), *foundElement));
+            }
+        }
+
+        return ResultType();
+    }
+
+public:
+
+    template<class ParticleContainer>
+    TbfAdaptiveTree(const SpacialConfiguration& inConfiguration,
+                    const ParticleContainer& inParticlePositions,
+                    const long int inMaxParticlesPerLeaf,
+                    const long int inNbElementsPerBlock = -1)
+        : configuration(inConfiguration), spaceSystem(configuration),
+          maxParticlesPerLeaf(std::max(1L, inMaxParticlesPerLeaf)), nbElementsPerBlock(inNbElementsPerBlock),
+          nbParticles(static_cast<long int>(std::size(inParticlePositions))){
+
+        const int nbThreads = TbfParallel::GetNbThreads();
+        const long int treeHeight = configuration.getTreeHeight();
+
+        cellBlocks.resize(treeHeight);
+        particleGroups.resize(treeHeight);
+
+        if(nbParticles == 0 || treeHeight <= 0){
+            return;
+        }
+
+        const SorterClass partSorter(spaceSystem, inParticlePositions, nbThreads);
+
+        std::vector<std::vector<IndexType>> cellIndexes(treeHeight);
+        std::vector<std::vector<AdaptiveLeaf>> leaves(treeHeight);
+        subdivide(partSorter, 0, getAncestorIndex(partSorter.getSpacialIndexForLeaf(0), treeHeight-1, 0),
+                  0, partSorter.getNbLeaves(), cellIndexes, leaves);
+
+        if(nbElementsPerBlock <= 0){
+            long int nbLeaves = 0;
+            for(const auto& leavesAtLevel : leaves){
+                nbLeaves += static_cast<long int>(leavesAtLevel.size());
+            }
+            nbElementsPerBlock = std::max(1L, nbLeaves/(2*nbThreads));
+        }
+
+        for(long int idxLevel = 0 ; idxLevel < treeHeight ; ++idxLevel){
+            const long int nbLeavesAtLevel = static_cast<long int>(leaves[idxLevel].size());
+            BuildGroups(particleGroups[idxLevel], (nbLeavesAtLevel + nbElementsPerBlock - 1)/nbElementsPerBlock, nbThreads,
+                        [&](const long int idxGroup){
+                const long int firstLeaf = idxGroup*nbElementsPerBlock;
+                const AdaptiveGroupInfo groupInfo(partSorter, &leaves[idxLevel][firstLeaf],
+                                                  std::min(nbElementsPerBlock, nbLeavesAtLevel - firstLeaf));
+                return LeafGroupClass(groupInfo, inParticlePositions, spaceSystem);
+            });
+
+            const long int nbCellsAtLevel = static_cast<long int>(cellIndexes[idxLevel].size());
+            BuildGroups(cellBlocks[idxLevel], (nbCellsAtLevel + nbElementsPerBlock - 1)/nbElementsPerBlock, nbThreads,
+                        [&](const long int idxGroup){
+                const auto firstCell = cellIndexes[idxLevel].begin() + idxGroup*nbElementsPerBlock;
+                const std::vector<IndexType> groupIndexes(firstCell, firstCell + std::min(nbElementsPerBlock, nbCellsAtLevel - idxGroup*nbElementsPerBlock));
+                return CellGroupClass(groupIndexes, spaceSystem);
+            });
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+
+    long int getNbParticles() const{
+        return nbParticles;
+    }
+
+    long int getNbElementsPerGroup() const{
+        return nbElementsPerBlock;
+    }
+
+    long int getMaxParticlesPerLeaf() const{
+        return maxParticlesPerLeaf;
+    }
+
+    const SpacialConfiguration& getSpacialConfiguration() const{
+        return configuration;
+    }
+
+    const SpaceIndexType& getSpacialSystem() const{
+        return spaceSystem;
+    }
+
+    long int getHeight() const{
+        return configuration.getTreeHeight();
+    }
+
+    long int getNbCellGroupsAtLevel(const long int inIdxLevel) const{
+        return static_cast<long int>(cellBlocks[inIdxLevel].size());
+    }
+
+    std::vector<CellGroupClass>& getCellGroupsAtLevel(const long int inIdxLevel){
+        return cellBlocks[inIdxLevel];
+    }
+
+    const std::vector<CellGroupClass>& getCellGroupsAtLevel(const long int inIdxLevel) const {
+        return cellBlocks[inIdxLevel];
+    }
+
+    long int getNbParticleGroupsAtLevel(const long int inIdxLevel) const{
+        return static_cast<long int>(particleGroups[inIdxLevel].size());
+    }
+
+    std::vector<LeafGroupClass>& getParticleGroupsAtLevel(const long int inIdxLevel){
+        return particleGroups[inIdxLevel];
+    }
+
+    const std::vector<LeafGroupClass>& getParticleGroupsAtLevel(const long int inIdxLevel) const {
+        return particleGroups[inIdxLevel];
+    }
+
+    long int getNbLeaves() const{
+        long int nbLeaves = 0;
+        for(const auto& groupsAtLevel : particleGroups){
+            for(const auto& leafGroup : groupsAtLevel){
+                nbLeaves += leafGroup.getNbLeaves();
+            }
+        }
+        return nbLeaves;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+
+    auto findGroupWithCell(const long int inLevel, const IndexType inMIndex){
+        assert(inLevel < configuration.getTreeHeight());
+        return FindInGroups(cellBlocks[inLevel], inMIndex);
+    }
+
+    auto findGroupWithCell(const long int inLevel, const IndexType inMIndex) const {
+        assert(inLevel < configuration.getTreeHeight());
+        return FindInGroups(cellBlocks[inLevel], inMIndex);
+    }
+
+    auto findGroupWithLeaf(const long int inLevel, const IndexType inMIndex){
+        assert(inLevel < configuration.getTreeHeight());
+        return FindInGroups(particleGroups[inLevel], inMIndex);
+    }
+
+    auto findGroupWithLeaf(const long int inLevel, const IndexType inMIndex) const {
+        assert(inLevel < configuration.getTreeHeight());
+        return FindInGroups(particleGroups[inLevel], inMIndex);
+    }
+
+    TbfAdaptiveCellType getCellType(const long int inLevel, const IndexType inMIndex) const {
+        if(inLevel < 0 || configuration.getTreeHeight() <= inLevel){
+            return TbfAdaptiveCellType::NotExist;
+        }
+        if(findGroupWithLeaf(inLevel, inMIndex)){
+            return TbfAdaptiveCellType::Leaf;
+        }
+        if(findGroupWithCell(inLevel, inMIndex)){
+            return TbfAdaptiveCellType::Internal;
+        }
+        return TbfAdaptiveCellType::NotExist;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+
+    template <class FuncClass>
+    void applyToAllCells(FuncClass&& inFunc){
+        for (long int idxLevel = 0 ; idxLevel < configuration.getTreeHeight() ; ++idxLevel) {
+            for(auto& cellGroup : cellBlocks[idxLevel]){
+                cellGroup.applyToAllCells(idxLevel, inFunc);
+            }
+        }
+    }
+
+    template <class FuncClass>
+    void applyToAllCells(FuncClass&& inFunc) const {
+        for (long int idxLevel = 0 ; idxLevel < configuration.getTreeHeight() ; ++idxLevel) {
+            for(auto& cellGroup : cellBlocks[idxLevel]){
+                cellGroup.applyToAllCells(idxLevel, inFunc);
+            }
+        }
+    }
+
+    template <class FuncClass>
+    void applyToAllLeaves(FuncClass&& inFunc){
+        for(auto& groupsAtLevel : particleGroups){
+            for(auto& leafGroup : groupsAtLevel){
+                leafGroup.applyToAllLeaves(inFunc);
+            }
+        }
+    }
+
+    template <class FuncClass>
+    void applyToAllLeaves(FuncClass&& inFunc) const {
+        for(auto& groupsAtLevel : particleGroups){
+            for(auto& leafGroup : groupsAtLevel){
+                leafGroup.applyToAllLeaves(inFunc);
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+
+    auto getAllParticlesData(){
+        std::unique_ptr<std::array<RealType, NbDataValuesPerParticle>[]> data(new std::array<RealType, NbDataValuesPerParticle>[nbParticles]());
+
+        applyToAllLeaves([&data](auto&& leafHeader, const long int* particleIndexes,
+                             const std::array<DataType*, NbDataValuesPerParticle> particleDataPtr,
+                             const std::array<RhsType*, NbRhsValuesPerParticle> /*particleRhsPtr*/){
+            for(int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    data[particleIndexes[idxPart]][idxValue] = particleDataPtr[idxValue][idxPart];
+                }
+            }
+        });
+
+        return data;
+    }
+
+    auto getAllParticlesRhs(){
+        std::unique_ptr<std::array<RhsType, NbRhsValuesPerParticle>[]> rhs(new std::array<RhsType, NbRhsValuesPerParticle>[nbParticles]());
+
+        applyToAllLeaves([&rhs](auto&& leafHeader, const long int* particleIndexes,
+                             const std::array<DataType*, NbDataValuesPerParticle> /*particleDataPtr*/,
+                             const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+            for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    rhs[particleIndexes[idxPart]][idxValue] = particleRhsPtr[idxValue][idxPart];
+                }
+            }
+        });
+
+        return rhs;
+    }
+
+    template <class StreamClass>
+    friend  StreamClass& operator<<(StreamClass& inStream, const TbfAdaptiveTree& inTree) {
+        inStream << "TbfAdaptiveTree @ " << &inTree << "\n";
+        inStream << " - Configuration: " << "\n";
+        inStream << inTree.configuration << "\n";
+        inStream << " - Max particles per leaf: " << inTree.getMaxParticlesPerLeaf() << "\n";
+        inStream << " - Number of elements per group: " << inTree.getNbElementsPerGroup() << "\n";
+        inStream << " - Number of particles: " << inTree.getNbParticles() << "\n";
+        inStream << " - Number of leaves: " << inTree.getNbLeaves() << "\n";
+        for(long int idxLevel = 0 ; idxLevel < inTree.getHeight() ; ++idxLevel){
+            long int nbCells = 0;
+            for(const auto& cellGroup : inTree.cellBlocks[idxLevel]){
+                nbCells += cellGroup.getNbCells();
+            }
+            long int nbLeaves = 0;
+            for(const auto& leafGroup : inTree.particleGroups[idxLevel]){
+                nbLeaves += leafGroup.getNbLeaves();
+            }
+            inStream << " - Level " << idxLevel << ": " << nbCells << " cells (" << nbLeaves << " leaves)\n";
+        }
+        return inStream;
+    }
+};
+
+#endif
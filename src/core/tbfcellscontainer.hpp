@@ -6,9 +6,11 @@
 #include "containers/tbfmemoryblock.hpp"
 #include "containers/tbfmemoryscalar.hpp"
 #include "containers/tbfmemoryvector.hpp"
+#include "utils/tbfnuma.hpp"
 
 #include <array>
 #include <optional>
+#include <memory>
 
 template <class RealType_T, class MultipoleClass_T, class LocalClass_T, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType_T>>
 class TbfCellsContainer{
@@ -46,11 +48,20 @@ private:
     MultipoleMemoryBlockType objectMultipole;
     LocalMemoryBlockType objectLocal;
 
+    // Copy of the interval of the header, the groups can be searched without touching their memory (out-of-core)
+    IndexType startingSpaceIndex;
+    IndexType endingSpaceIndex;
+
 public:
     template <class ContainerClass, class ConverterClass>
-    explicit TbfCellsContainer(const ContainerClass& inCellSpatialIndexes, const ConverterClass& inConverter){
+    explicit TbfCellsContainer(const ContainerClass& inCellSpatialIndexes, const ConverterClass& inConverter,
+                               const std::shared_ptr<TbfMemoryAllocator>& inAllocator = nullptr){
         const long int nbCells = static_cast<long int>(std::size(inCellSpatialIndexes));
 
+        objectData.setAllocator(inAllocator);
+        objectMultipole.setAllocator(inAllocator);
+        objectLocal.setAllocator(inAllocator);
+
         if(nbCells == 0){
             const std::array<long int, 2> sizes{{1, 0}};
             objectData.resetBlocksFromSizes(sizes);
@@ -58,6 +69,8 @@ public:
             header.startingSpaceIndex   = 0;
             header.endingSpaceIndex     = 0;
             header.nbCells              = 0;
+            startingSpaceIndex = 0;
+            endingSpaceIndex = 0;
 
             objectMultipole.resetBlocksFromSizes(std::array<long int, 1>{{0}});
             objectLocal.resetBlocksFromSizes(std::array<long int, 1>{{0}});
@@ -74,6 +87,8 @@ public:
         header.startingSpaceIndex   = inCellSpatialIndexes.front();
         header.endingSpaceIndex     = inCellSpatialIndexes.back();
         header.nbCells              = nbCells;
+        startingSpaceIndex = header.startingSpaceIndex;
+        endingSpaceIndex = header.endingSpaceIndex;
 
         auto cellsViewer = objectData.template getViewerForBlock<1>();
 
@@ -83,6 +98,19 @@ public:
         }
     }
 
+    // Build the container on the memory of existing blocks (as given by getDataPtr(),
+    // getMultipolePtr() and getLocalPtr()), each buffer is released with inDeleter
+    explicit TbfCellsContainer(unsigned char* inDataPtr, const long int inDataSizeInByte,
+                               unsigned char* inMultipolePtr, const long int inMultipoleSizeInByte,
+                               unsigned char* inLocalPtr, const long int inLocalSizeInByte,
+                               const TbfMemoryBlockDeleter& inDeleter)
+        : objectData(inDataPtr, inDataSizeInByte, inDeleter),
+          objectMultipole(inMultipolePtr, inMultipoleSizeInByte, inDeleter),
+          objectLocal(inLocalPtr, inLocalSizeInByte, inDeleter),
+          startingSpaceIndex(objectData.template getViewerForBlockConst<0>().getItem().startingSpaceIndex),
+          endingSpaceIndex(objectData.template getViewerForBlockConst<0>().getItem().endingSpaceIndex){
+    }
+
     TbfCellsContainer(const TbfCellsContainer&) = delete;
     TbfCellsContainer& operator=(const TbfCellsContainer&) = delete;
 
@@ -90,11 +118,11 @@ public:
     TbfCellsContainer& operator=(TbfCellsContainer&&) = default;
 
     IndexType getStartingSpacialIndex() const{
-        return objectData.template getViewerForBlockConst<0>().getItem().startingSpaceIndex;
+        return startingSpaceIndex;
     }
 
     IndexType getEndingSpacialIndex() const{
-        return objectData.template getViewerForBlockConst<0>().getItem().endingSpaceIndex;
+        return endingSpaceIndex;
     }
 
     long int getNbCells() const{
@@ -131,6 +159,11 @@ public:
         return objectLocal.template getViewerForBlockConst<0>().getItem(inIdxCell);
     }
 
+    void resetMultipolesAndLocals(){
+        objectMultipole.resetAllItems();
+        objectLocal.resetAllItems();
+    }
+
     ///////////////////////////////////////////////////////////////////////////
 
     unsigned char* getDataPtr(){
@@ -157,6 +190,36 @@ public:
         return objectLocal.getPtr();
     }
 
+    long int getDataSizeInByte() const {
+        return objectData.getAllocatedMemorySizeInByte();
+    }
+
+    long int getMultipoleSizeInByte() const {
+        return objectMultipole.getAllocatedMemorySizeInByte();
+    }
+
+    long int getLocalSizeInByte() const {
+        return objectLocal.getAllocatedMemorySizeInByte();
+    }
+
+    // The NUMA node where the group is (-1 if unknown)
+    int getNumaNode() const {
+        return TbfNuma::GetNodeOfAddress(objectMultipole.getPtr());
+    }
+
+    // Used with out-of-core allocators, see TbfMemoryAllocator
+    void adviseWillNeed() const {
+        objectData.adviseWillNeed();
+        objectMultipole.adviseWillNeed();
+        objectLocal.adviseWillNeed();
+    }
+
+    void adviseDoNotNeed() const {
+        objectData.adviseDoNotNeed();
+        objectMultipole.adviseDoNotNeed();
+        objectLocal.adviseDoNotNeed();
+    }
+
 
     ///////////////////////////////////////////////////////////////////////////
 
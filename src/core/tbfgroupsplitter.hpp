@@ -0,0 +1,142 @@
+#ifndef TBFGROUPSPLITTER_HPP
+#define TBFGROUPSPLITTER_HPP
+
+#include "tbfglobal.hpp"
+
+#include "utils/tbfparallel.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+
+enum class TbfGroupSplitStrategy {
+    FixedSize,  // Each group has the same number of leaves/cells
+    BalancedCost // Each group has the same estimated cost (same number of groups as FixedSize)
+};
+
+// The weights used to estimate the cost of a leaf/cell,
+// one interaction between two particles is the unit
+struct TbfGroupCostModel {
+    double pairInteractionCost = 1;
+    double m2lCost = 100;
+    double m2mOrL2lCost = 100;
+};
+
+namespace TbfGroupSplitter {
+
+// The P2P cost of a leaf is nbParticles x (nbParticles + nb particles in the neighbors),
+// the M2L cost depends on the number of cells that exist in the interaction list
+template <class SpaceIndexType, class IndexType>
+inline std::vector<double> ComputeLeafCosts(const SpaceIndexType& inSpaceSystem, const long int inLevel,
+                                            const std::vector<IndexType>& inLeafIndexes,
+                                            const std::vector<long int>& inNbParticlesPerLeaf,
+                                            const TbfGroupCostModel& inCostModel,
+                                            const int inNbThreads = TbfParallel::GetNbThreads()){
+    assert(std::is_sorted(inLeafIndexes.begin(), inLeafIndexes.end()));
+    assert(inLeafIndexes.size() == inNbParticlesPerLeaf.size());
+    const long int nbLeaves = static_cast<long int>(inLeafIndexes.size());
+    std::vector<double> costs(nbLeaves);
+
+    TbfParallel::ParallelFor(0, nbLeaves, inNbThreads, [&](const long int idxLeaf){
+        long int nbNeighborParticles = inNbParticlesPerLeaf[idxLeaf];
+        for(const IndexType neighborIndex : inSpaceSystem.getNeighborListForIndex(inLeafIndexes[idxLeaf], inLevel)){
+            const auto found = std::lower_bound(inLeafIndexes.begin(), inLeafIndexes.end(), neighborIndex);
+            if(found != inLeafIndexes.end() && *found == neighborIndex){
+                nbNeighborParticles += inNbParticlesPerLeaf[std::distance(inLeafIndexes.begin(), found)];
+            }
+        }
+
+        long int nbInteractions = 0;
+        for(const IndexType interactionIndex : inSpaceSystem.getInteractionListForIndex(inLeafIndexes[idxLeaf], inLevel)){
+            if(std::binary_search(inLeafIndexes.begin(), inLeafIndexes.end(), interactionIndex)){
+                nbInteractions += 1;
+            }
+        }
+
+        costs[idxLeaf] = double(inNbParticlesPerLeaf[idxLeaf]) * double(nbNeighborParticles) * inCostModel.pairInteractionCost
+                         + double(nbInteractions) * inCostModel.m2lCost;
+    });
+
+    return costs;
+}
+
+template <class SpaceIndexType, class IndexType>
+inline std::vector<double> ComputeCellCosts(const SpaceIndexType& inSpaceSystem, const long int inLevel,
+                                            const std::vector<IndexType>& inCellIndexes,
+                                            const std::vector<long int>& inNbChildrenPerCell,
+                                            const TbfGroupCostModel& inCostModel,
+                                            const int inNbThreads = TbfParallel::GetNbThreads()){
+    assert(std::is_sorted(inCellIndexes.begin(), inCellIndexes.end()));
+    assert(inCellIndexes.size() == inNbChildrenPerCell.size());
+    const long int nbCells = static_cast<long int>(inCellIndexes.size());
+    std::vector<double> costs(nbCells);
+
+    TbfParallel::ParallelFor(0, nbCells, inNbThreads, [&](const long int idxCell){
+        long int nbInteractions = 0;
+        for(const IndexType interactionIndex : inSpaceSystem.getInteractionListForIndex(inCellIndexes[idxCell], inLevel)){
+            if(std::binary_search(inCellIndexes.begin(), inCellIndexes.end(), interactionIndex)){
+                nbInteractions += 1;
+            }
+        }
+
+        costs[idxCell] = double(nbInteractions) * inCostModel.m2lCost
+                         + double(2 * inNbChildrenPerCell[idxCell]) * inCostModel.m2mOrL2lCost;
+    });
+
+    return costs;
+}
+
+// Returns the intervals [result[idx], result[idx+1]) of the groups
+inline std::vector<long int> SplitFixedSize(const long int inNbElements, const long int inGroupSize){
+    std::vector<long int> intervals;
+    if(inGroupSize <= 0 || inNbElements == 0){
+        return intervals;
+    }
+
+    for(long int idxElement = 0 ; idxElement < inNbElements ; idxElement += inGroupSize){
+        intervals.push_back(idxElement);
+    }
+    intervals.push_back(inNbElements);
+    return intervals;
+}
+
+// The number of groups is the one obtained with inGroupSize, but the limits
+// are moved such that the groups have (approximately) the same cost
+inline std::vector<long int> SplitBalancedCost(const std::vector<double>& inCosts, const long int inGroupSize){
+    const long int nbElements = static_cast<long int>(inCosts.size());
+    if(inGroupSize <= 0 || nbElements == 0){
+        return std::vector<long int>();
+    }
+
+    const long int nbGroups = (nbElements + inGroupSize - 1)/inGroupSize;
+
+    std::vector<double> prefixCosts(nbElements+1, 0);
+    for(long int idxElement = 0 ; idxElement < nbElements ; ++idxElement){
+        prefixCosts[idxElement+1] = prefixCosts[idxElement] + inCosts[idxElement];
+    }
+
+    std::vector<long int> intervals;
+    intervals.reserve(nbGroups+1);
+    intervals.push_back(0);
+
+    for(long int idxGroup = 1 ; idxGroup < nbGroups ; ++idxGroup){
+        const double targetCost = prefixCosts[nbElements] * double(idxGroup) / double(nbGroups);
+        long int limit = std::distance(prefixCosts.begin(), std::lower_bound(prefixCosts.begin(), prefixCosts.end(), targetCost));
+        // Take the closest limit to the target
+        if(limit > 0 && targetCost - prefixCosts[limit-1] < prefixCosts[limit] - targetCost){
+            limit -= 1;
+        }
+        // Each group must have at least one element
+        limit = std::max(limit, intervals.back() + 1);
+        limit = std::min(limit, nbElements - (nbGroups - idxGroup));
+        intervals.push_back(limit);
+    }
+
+    intervals.push_back(nbElements);
+    return intervals;
+}
+
+}
+
+#endif
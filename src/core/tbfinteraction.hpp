@@ -20,4 +20,19 @@ struct TbfXtoXInteraction{
     }
 };
 
+// Used by the adaptive trees, where a cell can be a leaf at any level
+enum class TbfAdaptiveCellType{
+    NotExist,
+    Leaf,
+    Internal
+};
+
+template <class IndexType_T>
+struct TbfAdaptiveCell{
+    using IndexType = IndexType_T;
+
+    long int level;
+    IndexType index;
+};
+
 #endif
@@ -0,0 +1,191 @@
+#ifndef TBFINTERACTIONPLAN_HPP
+#define TBFINTERACTIONPLAN_HPP
+
+#include "tbfglobal.hpp"
+
+#include "containers/tbfvectorview.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+// The M2L and P2P interactions of a tree resolved to the positions of the cells/leaves
+// in their groups, such that they can be applied again without computing the interaction
+// lists, sorting them and searching the spacial indexes.
+// It must be rebuilt when the tree changes (see TbfTree::getInteractionPlan).
+class TbfInteractionPlan {
+public:
+    struct Interaction {
+        std::int32_t idxTarget;
+        std::int32_t idxSrc;
+        std::int32_t arrayIndexSrc;
+    };
+
+    struct Block {
+        long int idxSrcGroup;
+        long int offset;
+        long int nbInteractions;
+    };
+
+private:
+    // For each target group, the first block are the interactions inside the group,
+    // followed by the interactions with the other groups (the interactions are sorted by target)
+    struct LevelPlan {
+        std::vector<Interaction> interactions;
+        std::vector<Block> blocks;
+        std::vector<long int> firstBlockOfGroups;
+    };
+
+    std::vector<LevelPlan> m2lPlans;
+    LevelPlan p2pPlan;
+
+    static Interaction MakeInteraction(const long int inIdxTarget, const long int inIdxSrc, const long int inArrayIndexSrc){
+        assert(inIdxTarget <= std::numeric_limits<std::int32_t>::max()
+               && inIdxSrc <= std::numeric_limits<std::int32_t>::max()
+               && inArrayIndexSrc <= std::numeric_limits<std::int32_t>::max());
+        return Interaction{static_cast<std::int32_t>(inIdxTarget), static_cast<std::int32_t>(inIdxSrc), static_cast<std::int32_t>(inArrayIndexSrc)};
+    }
+
+    static void AddBlock(LevelPlan& inPlan, const long int inIdxSrcGroup, const long int inOffset, const bool inSortByTarget){
+        if(inSortByTarget){
+            std::stable_sort(inPlan.interactions.begin() + inOffset, inPlan.interactions.end(), [](const Interaction& i1, const Interaction& i2){
+                return i1.idxTarget < i2.idxTarget;
+            });
+        }
+        inPlan.blocks.emplace_back(Block{inIdxSrcGroup, inOffset, static_cast<long int>(inPlan.interactions.size()) - inOffset});
+    }
+
+    // inFuncGetLists returns the interaction lists of a group (as getInteractionListForBlock)
+    template <class GroupContainerClass, class FuncGetLists>
+    static LevelPlan BuildLevelPlan(const GroupContainerClass& inGroups, FuncGetLists&& inFuncGetLists, const bool inSortByTarget){
+        LevelPlan plan;
+        plan.firstBlockOfGroups.resize(std::size(inGroups) + 1, 0);
+
+        for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(std::size(inGroups)) ; ++idxGroup){
+            const auto& currentGroup = inGroups[idxGroup];
+            plan.firstBlockOfGroups[idxGroup] = static_cast<long int>(plan.blocks.size());
+
+            auto indexesForGroup = inFuncGetLists(currentGroup);
+
+            const long int offsetInGroup = static_cast<long int>(plan.interactions.size());
+            for(const auto& interaction : indexesForGroup.first){
+                auto foundSrc = currentGroup.getElementFromSpacialIndex(interaction.indexSrc);
+                assert(foundSrc);
+                plan.interactions.emplace_back(MakeInteraction(interaction.globalTargetPos, *foundSrc, interaction.arrayIndexSrc));
+            }
+            AddBlock(plan, idxGroup, offsetInGroup, inSortByTarget);
+
+            TbfAlgorithmUtils::TbfMapIndexesAndBlocks(std::move(indexesForGroup.second), inGroups, idxGroup,
+                                                      [&](const auto& groupTarget, const auto& groupSrc, const auto& indexes){
+                assert(&groupTarget == &currentGroup);
+                (void)groupTarget;
+                const long int offsetBetweenGroups = static_cast<long int>(plan.interactions.size());
+                for(long int idxInteraction = 0 ; idxInteraction < static_cast<long int>(indexes.size()) ; ++idxInteraction){
+                    auto foundSrc = groupSrc.getElementFromSpacialIndex(indexes[idxInteraction].indexSrc);
+                    if(foundSrc){
+                        plan.interactions.emplace_back(MakeInteraction(indexes[idxInteraction].globalTargetPos, *foundSrc,
+                                                                       indexes[idxInteraction].arrayIndexSrc));
+                    }
+                }
+                if(offsetBetweenGroups != static_cast<long int>(plan.interactions.size())){
+                    AddBlock(plan, std::distance(&inGroups[0], &groupSrc), offsetBetweenGroups, inSortByTarget);
+                }
+            });
+        }
+        plan.firstBlockOfGroups[std::size(inGroups)] = static_cast<long int>(plan.blocks.size());
+
+        plan.interactions.shrink_to_fit();
+        plan.blocks.shrink_to_fit();
+        return plan;
+    }
+
+    static auto GetInteractions(const LevelPlan& inPlan, const Block& inBlock){
+        return TbfMakeVectorView(inPlan.interactions, inBlock.offset, inBlock.nbInteractions);
+    }
+
+    static auto GetBlocksBetweenGroups(const LevelPlan& inPlan, const long int inIdxGroup){
+        assert(inIdxGroup+1 < static_cast<long int>(inPlan.firstBlockOfGroups.size()));
+        const long int firstBlock = inPlan.firstBlockOfGroups[inIdxGroup] + 1;
+        return TbfMakeVectorView(inPlan.blocks, firstBlock, inPlan.firstBlockOfGroups[inIdxGroup+1] - firstBlock);
+    }
+
+    static auto GetInteractionsInGroup(const LevelPlan& inPlan, const long int inIdxGroup){
+        assert(inIdxGroup+1 < static_cast<long int>(inPlan.firstBlockOfGroups.size()));
+        return GetInteractions(inPlan, inPlan.blocks[inPlan.firstBlockOfGroups[inIdxGroup]]);
+    }
+
+public:
+    template <class TreeClass>
+    explicit TbfInteractionPlan(const TreeClass& inTree){
+        const auto& spacialSystem = inTree.getSpacialSystem();
+
+        m2lPlans.resize(inTree.getHeight());
+        for(long int idxLevel = 0 ; idxLevel < inTree.getHeight() ; ++idxLevel){
+            m2lPlans[idxLevel] = BuildLevelPlan(inTree.getCellGroupsAtLevel(idxLevel), [&](const auto& inGroup){
+                return spacialSystem.getInteractionListForBlock(inGroup, idxLevel);
+            }, true);
+        }
+
+        if(inTree.getHeight()){
+            p2pPlan = BuildLevelPlan(inTree.getParticleGroups(), [&](const auto& inGroup){
+                return spacialSystem.getNeighborListForBlock(inGroup, inTree.getHeight()-1, true);
+            }, false);
+        }
+    }
+
+    long int getHeight() const{
+        return static_cast<long int>(m2lPlans.size());
+    }
+
+    auto getM2LInteractionsInGroup(const long int inLevel, const long int inIdxGroup) const{
+        return GetInteractionsInGroup(m2lPlans[inLevel], inIdxGroup);
+    }
+
+    auto getM2LBlocksBetweenGroups(const long int inLevel, const long int inIdxGroup) const{
+        return GetBlocksBetweenGroups(m2lPlans[inLevel], inIdxGroup);
+    }
+
+    auto getM2LInteractions(const long int inLevel, const Block& inBlock) const{
+        return GetInteractions(m2lPlans[inLevel], inBlock);
+    }
+
+    auto getP2PInteractionsInGroup(const long int inIdxGroup) const{
+        return GetInteractionsInGroup(p2pPlan, inIdxGroup);
+    }
+
+    auto getP2PBlocksBetweenGroups(const long int inIdxGroup) const{
+        return GetBlocksBetweenGroups(p2pPlan, inIdxGroup);
+    }
+
+    auto getP2PInteractions(const Block& inBlock) const{
+        return GetInteractions(p2pPlan, inBlock);
+    }
+
+    // The total number of interactions stored
+    long int getNbInteractions() const{
+        long int nbInteractions = static_cast<long int>(p2pPlan.interactions.size());
+        for(const auto& plan : m2lPlans){
+            nbInteractions += static_cast<long int>(plan.interactions.size());
+        }
+        return nbInteractions;
+    }
+
+    long int getMemorySizeInByte() const{
+        long int sizeInByte = 0;
+        auto addLevelPlan = [&sizeInByte](const LevelPlan& inPlan){
+            sizeInByte += static_cast<long int>(inPlan.interactions.size()*sizeof(Interaction)
+                                                + inPlan.blocks.size()*sizeof(Block)
+                                                + inPlan.firstBlockOfGroups.size()*sizeof(long int));
+        };
+        addLevelPlan(p2pPlan);
+        for(const auto& plan : m2lPlans){
+            addLevelPlan(plan);
+        }
+        return sizeInByte;
+    }
+};
+
+#endif
@@ -7,10 +7,12 @@
 #include "containers/tbfmemoryscalar.hpp"
 #include "containers/tbfmemoryvector.hpp"
 #include "containers/tbfmemorymultirvector.hpp"
+#include "utils/tbfnuma.hpp"
 #include "tbfparticlesorter.hpp"
 
 #include <array>
 #include <optional>
+#include <memory>
 #include <cassert>
 
 template <class RealType_T, class DataType_T, long int NbDataValuesPerParticle_T,
@@ -53,8 +55,23 @@ private:
     SymbolcMemoryBlockType objectData;
     RhsMemoryBlockType objectRhs;
 
+    // Also kept out of the blocks, such that looking for a group does not load it (out-of-core)
+    IndexType startingSpaceIndex;
+    IndexType endingSpaceIndex;
+
 public:
 
+    // Build the container on the memory of existing blocks (as given by getDataPtr()
+    // and getRhsPtr()), each buffer is released with inDeleter
+    explicit TbfParticlesContainer(unsigned char* inDataPtr, const long int inDataSizeInByte,
+                                   unsigned char* inRhsPtr, const long int inRhsSizeInByte,
+                                   const TbfMemoryBlockDeleter& inDeleter)
+        : objectData(inDataPtr, inDataSizeInByte, inDeleter),
+          objectRhs(inRhsPtr, inRhsSizeInByte, inDeleter),
+          startingSpaceIndex(objectData.template getViewerForBlockConst<0>().getItem().startingSpaceIndex),
+          endingSpaceIndex(objectData.template getViewerForBlockConst<0>().getItem().endingSpaceIndex){
+    }
+
     TbfParticlesContainer(const TbfParticlesContainer&) = delete;
     TbfParticlesContainer& operator=(const TbfParticlesContainer&) = delete;
 
@@ -63,9 +80,12 @@ public:
 
     template <class GroupInfoClass, class ContainerClass, class ConverterClass>
     explicit TbfParticlesContainer(const GroupInfoClass& inParticleGroupInfo, const ContainerClass& inParticlePositions,
-                                   const ConverterClass& inConverter){
+                                   const ConverterClass& inConverter, const std::shared_ptr<TbfMemoryAllocator>& inAllocator = nullptr){
         const long int nbParticles = inParticleGroupInfo.getNbParticles();
 
+        objectData.setAllocator(inAllocator);
+        objectRhs.setAllocator(inAllocator);
+
         const std::array<long int, 4> sizesData{{1, inParticleGroupInfo.getNbLeaves(),
                                            nbParticles*1,
                                            nbParticles*NbDataValuesPerParticle}};
@@ -76,6 +96,8 @@ public:
         header.endingSpaceIndex     = inParticleGroupInfo.getSpacialIndexForLeaf(inParticleGroupInfo.getNbLeaves()-1);
         header.nbLeaves             = inParticleGroupInfo.getNbLeaves();
         header.nbParticles          = nbParticles;
+        startingSpaceIndex = header.startingSpaceIndex;
+        endingSpaceIndex = header.endingSpaceIndex;
 
         auto leavesViewer = objectData.template getViewerForBlock<1>();
         auto particlesIndexViewer = objectData.template getViewerForBlock<2>();
@@ -102,8 +124,9 @@ public:
             const long int originalParticleIdx = inParticleGroupInfo.getParticleIndex(idxPart);
             particlesIndexViewer.getItem(idxPart) = originalParticleIdx;
 
+            const long int particlePositionIdx = inParticleGroupInfo.getParticlePositionIndex(idxPart);
             for(long int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
-                particlesDataViewer.getItem(idxPart, idxValue) = inParticlePositions[originalParticleIdx][idxValue];
+                particlesDataViewer.getItem(idxPart, idxValue) = inParticlePositions[particlePositionIdx][idxValue];
             }
         }
 
@@ -129,10 +152,12 @@ public:
             header.endingSpaceIndex     = 0;
             header.nbLeaves             = 0;
             header.nbParticles          = 0;
+            startingSpaceIndex = 0;
+            endingSpaceIndex = 0;
             return;
         }
 
-        TbfParticleSorter<RealType> partSorter(inSpaceSystem, inParticlePositions);
+        TbfParticleSorter<RealType, SpaceIndexType> partSorter(inSpaceSystem, inParticlePositions);
         auto groups = partSorter.splitInGroups(partSorter.getNbLeaves());
         assert(std::size(groups) == 1);
 
@@ -140,11 +165,11 @@ public:
     }
 
     IndexType getStartingSpacialIndex() const{
-        return objectData.template getViewerForBlockConst<0>().getItem().startingSpaceIndex;
+        return startingSpaceIndex;
     }
 
     IndexType getEndingSpacialIndex() const{
-        return objectData.template getViewerForBlockConst<0>().getItem().endingSpaceIndex;
+        return endingSpaceIndex;
     }
 
     long int getNbParticles() const{
@@ -286,6 +311,30 @@ public:
         return objectRhs.getPtr();
     }
 
+    long int getDataSizeInByte() const {
+        return objectData.getAllocatedMemorySizeInByte();
+    }
+
+    long int getRhsSizeInByte() const {
+        return objectRhs.getAllocatedMemorySizeInByte();
+    }
+
+    // The NUMA node where the group is (-1 if unknown)
+    int getNumaNode() const {
+        return TbfNuma::GetNodeOfAddress(objectData.getPtr());
+    }
+
+    // Used with out-of-core allocators, see TbfMemoryAllocator
+    void adviseWillNeed() const {
+        objectData.adviseWillNeed();
+        objectRhs.adviseWillNeed();
+    }
+
+    void adviseDoNotNeed() const {
+        objectData.adviseDoNotNeed();
+        objectRhs.adviseDoNotNeed();
+    }
+
     ///////////////////////////////////////////////////////////////////////////
 
     template <class FuncClass>
@@ -3,7 +3,13 @@
 
 #include "tbfglobal.hpp"
 
+#include "utils/tbfparallel.hpp"
+#include "utils/tbfradixsort.hpp"
+#include "core/tbfgroupsplitter.hpp"
+
 #include <vector>
+#include <array>
+#include <utility>
 #include <algorithm>
 #include <cassert>
 
@@ -13,34 +19,204 @@ public:
     using RealType = RealType_T;
     using SpaceIndexType = SpaceIndexType_T;
     using IndexType = typename SpaceIndexType::IndexType;
+
+    enum SortStrategy {
+        SortComparison,
+        SortRadix,
+        SortAdaptive
+    };
+
+    // The adaptive sort considers the input nearly sorted below one descent every 64 elements
+    static constexpr long int MaxDescentsRatioForNearlySorted = 64;
+
 private:
     std::vector<std::pair<IndexType, long int>> leaves;
+    std::vector<long int> leavesOffset;
     std::vector<std::pair<IndexType, long int>> particleIndexes;
+    std::vector<long int> originalIndexes;
 
-public:
-    template <class ContainerClass>
-    explicit TbfParticleSorter(const SpaceIndexType& inSpaceSystem, const ContainerClass& inParticlePositions){
-        particleIndexes.resize(inParticlePositions.size());
+    // The position index is used to break ties such that the order is unique
+    static bool KeyIndexLess(const std::pair<IndexType, long int>& p1, const std::pair<IndexType, long int>& p2){
+        return p1.first < p2.first || (p1.first == p2.first && p1.second < p2.second);
+    }
+
+    template <class SpaceIndexClass, class ContainerClass>
+    static auto TestGetIndexesFromPositions(int) -> decltype(std::declval<const SpaceIndexClass&>().getIndexesFromPositions(
+                                                                 std::declval<const ContainerClass&>(), 0L, 0L,
+                                                                 std::declval<typename SpaceIndexClass::IndexType*>()),
+                                                             std::true_type());
 
-        for(long int idxPart = 0 ; idxPart < static_cast<long int>(inParticlePositions.size()) ; ++idxPart){
-            particleIndexes[idxPart].first = inSpaceSystem.getIndexFromPosition(inParticlePositions[idxPart]);
-            particleIndexes[idxPart].second = idxPart;
+    template <class SpaceIndexClass, class ContainerClass>
+    static std::false_type TestGetIndexesFromPositions(...);
+
+    // The batched computation of the indexes is optional in the spacial systems
+    template <class ContainerClass>
+    static void ComputeIndexes(const SpaceIndexType& inSpaceSystem, const ContainerClass& inParticlePositions,
+                               std::vector<std::pair<IndexType, long int>>& outParticleIndexes, const int inNbThreads){
+        const long int nbParticles = static_cast<long int>(outParticleIndexes.size());
+        if constexpr(decltype(TestGetIndexesFromPositions<SpaceIndexType, ContainerClass>(0))::value){
+            const long int nbChunks = TbfParallel::GetNbChunks(nbParticles, inNbThreads, 4096);
+            TbfParallel::ForEachChunk(nbParticles, nbChunks, [&](const long int /*inIdxChunk*/, const long int inChunkBegin, const long int inChunkEnd){
+                constexpr long int BufferSize = 1024;
+                std::array<IndexType, BufferSize> indexes;
+                for(long int idxBuffer = inChunkBegin ; idxBuffer < inChunkEnd ; idxBuffer += BufferSize){
+                    const long int nbItems = std::min(BufferSize, inChunkEnd - idxBuffer);
+                    inSpaceSystem.getIndexesFromPositions(inParticlePositions, idxBuffer, idxBuffer + nbItems, indexes.data());
+                    for(long int idxPart = 0 ; idxPart < nbItems ; ++idxPart){
+                        outParticleIndexes[idxBuffer + idxPart].first = indexes[idxPart];
+                        outParticleIndexes[idxBuffer + idxPart].second = idxBuffer + idxPart;
+                    }
+                }
+            });
+        }
+        else{
+            TbfParallel::ParallelFor(0, nbParticles, inNbThreads, [&](const long int idxPart){
+                outParticleIndexes[idxPart].first = inSpaceSystem.getIndexFromPosition(inParticlePositions[idxPart]);
+                outParticleIndexes[idxPart].second = idxPart;
+            });
         }
+    }
 
-        std::sort(particleIndexes.begin(), particleIndexes.end(),[](auto& p1, auto& p2){
-            return p1.first < p2.first;
+    static long int CountDescents(const std::vector<std::pair<IndexType, long int>>& inElements, const int inNbThreads){
+        const long int nbElements = static_cast<long int>(inElements.size());
+        const long int nbChunks = TbfParallel::GetNbChunks(nbElements, inNbThreads, 16384);
+        std::vector<long int> nbDescentsPerChunk(nbChunks, 0);
+
+        TbfParallel::ForEachChunk(nbElements, nbChunks, [&](const long int inIdxChunk, const long int inChunkBegin, const long int inChunkEnd){
+            long int nbDescents = 0;
+            for(long int idxElement = std::max(1L, inChunkBegin) ; idxElement < inChunkEnd ; ++idxElement){
+                if(KeyIndexLess(inElements[idxElement], inElements[idxElement-1])){
+                    nbDescents += 1;
+                }
+            }
+            nbDescentsPerChunk[inIdxChunk] = nbDescents;
         });
 
-        leaves.reserve(inParticlePositions.size()/100);
+        long int nbDescents = 0;
+        for(const long int nbDescentsInChunk : nbDescentsPerChunk){
+            nbDescents += nbDescentsInChunk;
+        }
+        return nbDescents;
+    }
+
+    // Keep the elements that are in order (compacted at the beginning of the array)
+    // and extract the ones that break the order: each time an element is
+    // smaller than the last kept element, both are moved out.
+    // The few extracted elements are sorted and merged back.
+    static void SortNearlySorted(std::vector<std::pair<IndexType, long int>>& inOutElements, const int inNbThreads){
+        const long int nbElements = static_cast<long int>(inOutElements.size());
+        std::vector<std::pair<IndexType, long int>> outOfOrder;
+
+        long int nbKept = 0;
+        for(long int idxElement = 0 ; idxElement < nbElements ; ++idxElement){
+            if(nbKept && KeyIndexLess(inOutElements[idxElement], inOutElements[nbKept-1])){
+                outOfOrder.push_back(inOutElements[nbKept-1]);
+                outOfOrder.push_back(inOutElements[idxElement]);
+                nbKept -= 1;
+            }
+            else{
+                inOutElements[nbKept] = inOutElements[idxElement];
+                nbKept += 1;
+            }
+        }
+
+        TbfParallel::Sort(outOfOrder.begin(), outOfOrder.end(), KeyIndexLess, inNbThreads);
+
+        // Merge from the end, the free space after the kept elements is exactly the size of outOfOrder
+        long int idxKept = nbKept - 1;
+        long int idxOutOfOrder = static_cast<long int>(outOfOrder.size()) - 1;
+        for(long int idxDest = nbElements - 1 ; idxOutOfOrder >= 0 ; --idxDest){
+            if(idxKept >= 0 && KeyIndexLess(outOfOrder[idxOutOfOrder], inOutElements[idxKept])){
+                inOutElements[idxDest] = inOutElements[idxKept];
+                idxKept -= 1;
+            }
+            else{
+                inOutElements[idxDest] = outOfOrder[idxOutOfOrder];
+                idxOutOfOrder -= 1;
+            }
+        }
+    }
+
+public:
+    // The elements must be given with increasing second member
+    static void SortParticleIndexes(std::vector<std::pair<IndexType, long int>>& inOutElements, const IndexType inUpperBound,
+                                    const int inNbThreads, const SortStrategy inStrategy = SortAdaptive){
+        if(inStrategy == SortComparison){
+            TbfParallel::Sort(inOutElements.begin(), inOutElements.end(), KeyIndexLess, inNbThreads);
+        }
+        else if(inStrategy == SortRadix){
+            TbfRadixSort::SortPairs(inOutElements, inUpperBound, inNbThreads);
+        }
+        else{
+            const long int nbDescents = CountDescents(inOutElements, inNbThreads);
+            if(nbDescents == 0){
+                return;
+            }
+            else if(nbDescents <= static_cast<long int>(inOutElements.size())/MaxDescentsRatioForNearlySorted){
+                SortNearlySorted(inOutElements, inNbThreads);
+            }
+            else{
+                TbfRadixSort::SortPairs(inOutElements, inUpperBound, inNbThreads);
+            }
+        }
+    }
+
+    template <class ContainerClass>
+    explicit TbfParticleSorter(const SpaceIndexType& inSpaceSystem, const ContainerClass& inParticlePositions,
+                               const int inNbThreads = TbfParallel::GetNbThreads())
+        : TbfParticleSorter(inSpaceSystem, inParticlePositions, std::vector<long int>(), inNbThreads){
+    }
 
-        for(long int idxPart = 0 ; idxPart < static_cast<long int>(inParticlePositions.size()) ; ++idxPart){
-            if(leaves.empty() || leaves.back().first != particleIndexes[idxPart].first){
-                leaves.emplace_back();
-                leaves.back().first = particleIndexes[idxPart].first;
-                leaves.back().second = 0;
+    // inOriginalIndexes gives the index of the particles that will be stored in the tree,
+    // if empty the position in the container is used
+    template <class ContainerClass>
+    explicit TbfParticleSorter(const SpaceIndexType& inSpaceSystem, const ContainerClass& inParticlePositions,
+                               std::vector<long int> inOriginalIndexes,
+                               const int inNbThreads = TbfParallel::GetNbThreads())
+        : originalIndexes(std::move(inOriginalIndexes)){
+        const long int nbParticles = static_cast<long int>(std::size(inParticlePositions));
+        assert(originalIndexes.empty() || static_cast<long int>(originalIndexes.size()) == nbParticles);
+        particleIndexes.resize(nbParticles);
+
+        ComputeIndexes(inSpaceSystem, inParticlePositions, particleIndexes, inNbThreads);
+
+        SortParticleIndexes(particleIndexes, inSpaceSystem.getUpperBoundAtLeafLevel(), inNbThreads);
+
+        const long int nbChunks = TbfParallel::GetNbChunks(nbParticles, inNbThreads, 4096);
+        std::vector<long int> nbLeavesPerChunk(nbChunks+1, 0);
+
+        TbfParallel::ForEachChunk(nbParticles, nbChunks, [&](const long int inIdxChunk, const long int inChunkBegin, const long int inChunkEnd){
+            long int nbLeavesInChunk = 0;
+            for(long int idxPart = inChunkBegin ; idxPart < inChunkEnd ; ++idxPart){
+                if(idxPart == 0 || particleIndexes[idxPart-1].first != particleIndexes[idxPart].first){
+                    nbLeavesInChunk += 1;
+                }
             }
-            leaves.back().second += 1;
+            nbLeavesPerChunk[inIdxChunk+1] = nbLeavesInChunk;
+        });
+
+        for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+            nbLeavesPerChunk[idxChunk+1] += nbLeavesPerChunk[idxChunk];
         }
+
+        leaves.resize(nbLeavesPerChunk[nbChunks]);
+        leavesOffset.resize(nbLeavesPerChunk[nbChunks]+1);
+        leavesOffset.back() = nbParticles;
+
+        TbfParallel::ForEachChunk(nbParticles, nbChunks, [&](const long int inIdxChunk, const long int inChunkBegin, const long int inChunkEnd){
+            long int idxLeaf = nbLeavesPerChunk[inIdxChunk];
+            for(long int idxPart = inChunkBegin ; idxPart < inChunkEnd ; ++idxPart){
+                if(idxPart == 0 || particleIndexes[idxPart-1].first != particleIndexes[idxPart].first){
+                    leaves[idxLeaf].first = particleIndexes[idxPart].first;
+                    leavesOffset[idxLeaf] = idxPart;
+                    idxLeaf += 1;
+                }
+            }
+        });
+
+        TbfParallel::ParallelFor(0, getNbLeaves(), inNbThreads, [&](const long int idxLeaf){
+            leaves[idxLeaf].second = leavesOffset[idxLeaf+1] - leavesOffset[idxLeaf];
+        });
     }
 
     TbfParticleSorter(const TbfParticleSorter&) = delete;
@@ -65,11 +241,22 @@ public:
         return leaves[inLeafIndex].second;
     }
 
-    long int getSpacialIndexForParticle(const long int inSortedIndex) const{
+    long int getFirstParticleInLeaf(const long int inLeafIndex) const{
+        return leavesOffset[inLeafIndex];
+    }
+
+    IndexType getSpacialIndexForParticle(const long int inSortedIndex) const{
         return particleIndexes[inSortedIndex].first;
     }
 
     long int getParticleIndex(const long int inSortedIndex) const{
+        if(originalIndexes.empty()){
+            return particleIndexes[inSortedIndex].second;
+        }
+        return originalIndexes[particleIndexes[inSortedIndex].second];
+    }
+
+    long int getParticlePositionIndex(const long int inSortedIndex) const{
         return particleIndexes[inSortedIndex].second;
     }
 
@@ -121,7 +308,7 @@ public:
             return parent.getNbParticlesInLeaf(firstCell + inLeafIndex);
         }
 
-        long int getSpacialIndexForParticle(const long int inSortedIndex) const{
+        IndexType getSpacialIndexForParticle(const long int inSortedIndex) const{
             assert(inSortedIndex < nbParticles);
             return parent.getSpacialIndexForParticle(firstParticle + inSortedIndex);
         }
@@ -130,44 +317,55 @@ public:
             assert(inSortedIndex < nbParticles);
             return parent.getParticleIndex(firstParticle + inSortedIndex);
         }
+
+        long int getParticlePositionIndex(const long int inSortedIndex) const{
+            assert(inSortedIndex < nbParticles);
+            return parent.getParticlePositionIndex(firstParticle + inSortedIndex);
+        }
     };
 
     std::vector<GroupProperty> splitInGroups(const long int inGroupSize) const {
-        if(inGroupSize <= 0){
+        return splitInGroups(TbfGroupSplitter::SplitFixedSize(getNbLeaves(), inGroupSize));
+    }
+
+    // The group idx contains the leaves [inIntervals[idx], inIntervals[idx+1])
+    std::vector<GroupProperty> splitInGroups(const std::vector<long int>& inIntervals) const {
+        if(inIntervals.size() < 2){
             return std::vector<GroupProperty>();
         }
+        assert(inIntervals.front() == 0 && inIntervals.back() == getNbLeaves());
 
-        const long int nbGroups = (getNbLeaves() + inGroupSize - 1)/inGroupSize;
+        const long int nbGroups = static_cast<long int>(inIntervals.size()) - 1;
 
         std::vector<GroupProperty> groups;
         groups.reserve(nbGroups);
 
         for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+            assert(inIntervals[idxGroup] < inIntervals[idxGroup+1]);
             groups.emplace_back(*this);
 
-            groups.back().setFirstCell(idxGroup*inGroupSize);
-            groups.back().setNbCells(std::min((idxGroup+1)*inGroupSize, getNbLeaves()) - groups.back().firstCell);
-            if(idxGroup == 0){
-                groups.back().setFirstParticle(0);
-            }
-            else{
-                groups.back().setFirstParticle(groups[idxGroup-1].firstParticle + groups[idxGroup-1].nbParticles);
-            }
-
-            long int currentNbParticles = 0;
-
-            const auto groupSpacialLimit = getSpacialIndexForLeaf(groups.back().firstCell + groups.back().nbCells - 1) + 1;
-
-            while(groups.back().firstParticle + currentNbParticles < static_cast<long int>(particleIndexes.size())
-                  && getSpacialIndexForParticle(groups.back().firstParticle + currentNbParticles) < groupSpacialLimit){
-                currentNbParticles += 1;
-            }
-
-            groups.back().setNbParticles(currentNbParticles);
+            groups.back().setFirstCell(inIntervals[idxGroup]);
+            groups.back().setNbCells(inIntervals[idxGroup+1] - inIntervals[idxGroup]);
+            groups.back().setFirstParticle(leavesOffset[groups.back().firstCell]);
+            groups.back().setNbParticles(leavesOffset[groups.back().firstCell + groups.back().nbCells]
+                                         - groups.back().firstParticle);
         }
 
         return groups;
     }
+
+    // Cost of each leaf (see TbfGroupSplitter::ComputeLeafCosts)
+    std::vector<double> computeLeafCosts(const SpaceIndexType& inSpaceSystem, const TbfGroupCostModel& inCostModel,
+                                         const int inNbThreads = TbfParallel::GetNbThreads()) const {
+        std::vector<IndexType> leafIndexes(getNbLeaves());
+        std::vector<long int> nbParticlesPerLeaf(getNbLeaves());
+        for(long int idxLeaf = 0 ; idxLeaf < getNbLeaves() ; ++idxLeaf){
+            leafIndexes[idxLeaf] = leaves[idxLeaf].first;
+            nbParticlesPerLeaf[idxLeaf] = leaves[idxLeaf].second;
+        }
+        return TbfGroupSplitter::ComputeLeafCosts(inSpaceSystem, inSpaceSystem.getConfiguration().getTreeHeight()-1,
+                                                  leafIndexes, nbParticlesPerLeaf, inCostModel, inNbThreads);
+    }
 };
 
 #endif
@@ -5,136 +5,408 @@
 #include "tbfparticlescontainer.hpp"
 #include "tbfinteraction.hpp"
 #include "tbfcellscontainer.hpp"
+#include "tbfgroupsplitter.hpp"
+#include "tbfinteractionplan.hpp"
 
 #include "algorithms/tbfblocksizefinder.hpp"
+#include "utils/tbfparallel.hpp"
+#include "utils/tbffilemapping.hpp"
 
 #include <vector>
 #include <array>
+#include <optional>
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
 
 template <class RealType, class DataType, long int NbDataValuesPerParticle, class RhsType, long int NbRhsValuesPerParticle,
-          class MultipoleClass, class LocalClass, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
+          class MultipoleClass, class LocalClass, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType>>
 class TbfTree {
 public:
+    using SpaceIndexType = SpaceIndexType_T;
     using LeafGroupClass = TbfParticlesContainer<RealType, DataType, NbDataValuesPerParticle, RhsType, NbRhsValuesPerParticle, SpaceIndexType>;
     using CellGroupClass = TbfCellsContainer<RealType, MultipoleClass, LocalClass, SpaceIndexType>;
     using SpacialConfiguration = TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>;
-    using IndexType = typename TbfDefaultSpaceIndexType<RealType>::IndexType;
+    using IndexType = typename SpaceIndexType::IndexType;
 
 protected:
     const SpacialConfiguration configuration;
     const SpaceIndexType spaceSystem;
     const long int nbElementsPerBlock;
+    // The block size of each level, -1 to use nbElementsPerBlock
+    const std::vector<long int> nbElementsPerBlockAtLevel;
+    // If positive, a level is split to have at least this number of groups per thread
+    const long int minGroupsPerThread;
     const bool oneGroupPerParent;
+    const TbfGroupSplitStrategy splitStrategy;
+    const TbfGroupCostModel costModel;
+    // Gives the memory of the groups, nullptr to use new[]
+    const std::shared_ptr<TbfMemoryAllocator> allocator;
 
     std::vector<std::vector<CellGroupClass>> cellBlocks;
     std::vector<LeafGroupClass> particleGroups;
 
     long int nbParticles;
 
-public:
+    // The interaction plan and its mutex, it is not moved with the tree
+    // (a moved tree has a new mutex and rebuilds its plan when requested)
+    class InteractionPlanCache{
+        std::mutex planMutex;
+        std::unique_ptr<TbfInteractionPlan> plan;
 
-    template<class ParticleContainer>
-    TbfTree(const SpacialConfiguration& inConfiguration,
-               const ParticleContainer& inParticlePositions,
-               const long int inNbElementsPerBlock = -1,
-               const bool inOneGroupPerParent = false)
-        : configuration(inConfiguration), spaceSystem(configuration),
-          nbElementsPerBlock(inNbElementsPerBlock == -1 ? TbfBlockSizeFinder::Estimate<RealType>(inParticlePositions,
-                                                                                                 inConfiguration):
-                                                          inNbElementsPerBlock),
-          oneGroupPerParent(inOneGroupPerParent), nbParticles(static_cast<long int>(std::size(inParticlePositions))){
+    public:
+        InteractionPlanCache() = default;
 
-        cellBlocks.resize(configuration.getTreeHeight());
-        if(std::size(inParticlePositions) == 0){
-            return;
+        InteractionPlanCache(InteractionPlanCache&&) noexcept{
         }
 
-        {
-            TbfParticleSorter<RealType, SpaceIndexType> partSorter(spaceSystem, inParticlePositions);
-            const auto groupProperties = partSorter.splitInGroups(nbElementsPerBlock);
-            particleGroups.reserve(std::size(groupProperties));
+        InteractionPlanCache& operator=(InteractionPlanCache&&) noexcept{
+            reset();
+            return *this;
+        }
 
-            for(const auto& groupProperty : groupProperties){
-                particleGroups.emplace_back(groupProperty, inParticlePositions, spaceSystem);
+        template <class TreeClass>
+        const TbfInteractionPlan& get(const TreeClass& inTree){
+            std::lock_guard<std::mutex> lock(planMutex);
+            if(!plan){
+                plan.reset(new TbfInteractionPlan(inTree));
             }
+            return *plan;
         }
 
-        if(configuration.getTreeHeight() <= 0){
-            return;
+        bool exists(){
+            std::lock_guard<std::mutex> lock(planMutex);
+            return bool(plan);
         }
 
-        {
-            std::vector<IndexType> leafIndexes;
+        void reset(){
+            std::lock_guard<std::mutex> lock(planMutex);
+            plan.reset();
+        }
+    };
 
-            cellBlocks[configuration.getTreeHeight()-1].reserve(particleGroups.size());
-            for(const auto& particleGroup : particleGroups){
-                leafIndexes.resize(particleGroup.getNbLeaves());
+    // Built when it is requested, and reset when the groups change
+    mutable InteractionPlanCache interactionPlan;
 
-                for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
-                    leafIndexes[idxLeaf] = particleGroup.getLeafSpacialIndex(idxLeaf);
+protected:
+    struct IncrementalParticle{
+        IndexType spaceIndex;
+        long int originalIndex;
+        std::array<DataType, NbDataValuesPerParticle> data;
+        std::array<RhsType, NbRhsValuesPerParticle> rhs;
+
+        const DataType& operator[](const long int inIdxValue) const{
+            return data[inIdxValue];
+        }
+    };
+
+    // Describes a group made of sorted IncrementalParticle (to be used as a GroupInfoClass)
+    class IncrementalGroupInfo{
+        const IncrementalParticle* particles;
+        long int nbParticles;
+        std::vector<long int> leavesOffset;
+
+    public:
+        IncrementalGroupInfo(const IncrementalParticle* inParticles, const long int inNbParticles)
+            : particles(inParticles), nbParticles(inNbParticles){
+            for(long int idxPart = 0 ; idxPart < getNbParticles() ; ++idxPart){
+                if(idxPart == 0 || particles[idxPart-1].spaceIndex != particles[idxPart].spaceIndex){
+                    leavesOffset.push_back(idxPart);
                 }
-
-                cellBlocks[configuration.getTreeHeight()-1].emplace_back(leafIndexes, spaceSystem);
             }
+            leavesOffset.push_back(getNbParticles());
         }
 
-        std::vector<IndexType> cellIndexes;
-        cellIndexes.reserve(nbElementsPerBlock);
+        long int getNbLeaves() const{
+            return static_cast<long int>(leavesOffset.size()) - 1;
+        }
 
-        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= 0 ; --idxLevel){
-            if(oneGroupPerParent){
-                cellBlocks[idxLevel].reserve(cellBlocks[idxLevel+1].size());
+        long int getNbParticles() const{
+            return nbParticles;
+        }
 
-                for(const auto& lowerCellGroup : cellBlocks[idxLevel+1]){
-                    cellIndexes.clear();
-                    long int idxCell = 0;
+        IndexType getSpacialIndexForLeaf(const long int inLeafIndex) const{
+            return particles[leavesOffset[inLeafIndex]].spaceIndex;
+        }
 
-                    if(cellBlocks[idxLevel].size()){
-                        while(idxCell < lowerCellGroup.getNbCells()
-                              && spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)) <= cellBlocks[idxLevel].back().getEndingSpacialIndex()){
-                            idxCell += 1;
-                        }
-                    }
+        long int getNbParticlesInLeaf(const long int inLeafIndex) const{
+            return leavesOffset[inLeafIndex+1] - leavesOffset[inLeafIndex];
+        }
 
-                    for( ; idxCell < lowerCellGroup.getNbCells() ; ++idxCell){
-                        if(cellIndexes.size() == 0 || cellIndexes.back() != spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell))){
-                            cellIndexes.push_back(spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)));
-                        }
-                    }
+        IndexType getSpacialIndexForParticle(const long int inSortedIndex) const{
+            return particles[inSortedIndex].spaceIndex;
+        }
 
-                    if(cellIndexes.size()){
-                        cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
-                    }
+        long int getParticleIndex(const long int inSortedIndex) const{
+            return particles[inSortedIndex].originalIndex;
+        }
+
+        long int getParticlePositionIndex(const long int inSortedIndex) const{
+            return inSortedIndex;
+        }
+    };
+
+    // The file starts with this header, followed by the block sizes of each level,
+    // the number of cell groups of each level, and the (offset, size) of all the buffers
+    // (data and rhs of the particle groups, then data, multipole and local of the cell groups
+    // from the top level). The buffers are aligned on TbfDefaultMemoryAlignement.
+    struct CheckpointHeader{
+        char magic[8];
+        long int version;
+        long int dim;
+        long int sizeOfReal;
+        long int sizeOfIndex;
+        long int sizeOfData;
+        long int nbDataValuesPerParticle;
+        long int sizeOfRhs;
+        long int nbRhsValuesPerParticle;
+        long int sizeOfMultipole;
+        long int sizeOfLocal;
+        long int treeHeight;
+        std::array<RealType, SpaceIndexType::Dim> boxWidths;
+        std::array<RealType, SpaceIndexType::Dim> boxCenter;
+        long int nbElementsPerBlock;
+        long int minGroupsPerThread;
+        long int oneGroupPerParent;
+        long int splitStrategy;
+        TbfGroupCostModel costModel;
+        long int nbParticles;
+        long int nbParticleGroups;
+    };
+
+    static constexpr char CheckpointMagic[8] = "TBFTREE";
+    static constexpr long int CheckpointVersion = 1;
+
+    static CheckpointHeader GetCheckpointHeaderModel(){
+        // Value-initialized, the cost model keeps its default values
+        CheckpointHeader header{};
+        memcpy(header.magic, CheckpointMagic, sizeof(header.magic));
+        header.version = CheckpointVersion;
+        header.dim = SpaceIndexType::Dim;
+        header.sizeOfReal = sizeof(RealType);
+        header.sizeOfIndex = sizeof(IndexType);
+        header.sizeOfData = sizeof(DataType);
+        header.nbDataValuesPerParticle = NbDataValuesPerParticle;
+        header.sizeOfRhs = sizeof(RhsType);
+        header.nbRhsValuesPerParticle = NbRhsValuesPerParticle;
+        header.sizeOfMultipole = sizeof(MultipoleClass);
+        header.sizeOfLocal = sizeof(LocalClass);
+        return header;
+    }
+
+    static long int AlignCheckpointOffset(const long int inOffset){
+        return ((inOffset + TbfDefaultMemoryAlignement - 1)/TbfDefaultMemoryAlignement)*TbfDefaultMemoryAlignement;
+    }
+
+    // Used by Load, the groups are added after
+    TbfTree(const CheckpointHeader& inHeader, const long int* inNbElementsPerBlockAtLevel)
+        : configuration(inHeader.treeHeight, inHeader.boxWidths, inHeader.boxCenter), spaceSystem(configuration),
+          nbElementsPerBlock(inHeader.nbElementsPerBlock),
+          nbElementsPerBlockAtLevel(inNbElementsPerBlockAtLevel, inNbElementsPerBlockAtLevel + inHeader.treeHeight),
+          minGroupsPerThread(inHeader.minGroupsPerThread), oneGroupPerParent(inHeader.oneGroupPerParent != 0),
+          splitStrategy(static_cast<TbfGroupSplitStrategy>(inHeader.splitStrategy)), costModel(inHeader.costModel),
+          nbParticles(inHeader.nbParticles){
+        cellBlocks.resize(configuration.getTreeHeight());
+    }
+
+    template <class GroupClass, class BuilderFunc>
+    static void BuildGroups(std::vector<GroupClass>& outGroups, const long int inNbGroups,
+                            const int inNbThreads, BuilderFunc&& inBuilder){
+        std::vector<std::optional<GroupClass>> groups(inNbGroups);
+
+        TbfParallel::ParallelFor(0, inNbGroups, inNbThreads, [&](const long int idxGroup){
+            groups[idxGroup].emplace(inBuilder(idxGroup));
+        });
+
+        outGroups.reserve(outGroups.size() + inNbGroups);
+        for(auto& group : groups){
+            outGroups.emplace_back(std::move(*group));
+        }
+    }
+
+    static std::vector<long int> GetLeafOnlyBlockSizes(const long int inTreeHeight, const long int inNbElementsPerBlock){
+        std::vector<long int> blockSizes(std::max(0L, inTreeHeight), -1);
+        if(blockSizes.size()){
+            blockSizes.back() = inNbElementsPerBlock;
+        }
+        return blockSizes;
+    }
+
+    long int getBlockSizeForLevel(const long int inLevel, const long int inNbElementsAtLevel, const int inNbThreads) const{
+        long int blockSize = getNbElementsPerGroupAtLevel(inLevel);
+        if(minGroupsPerThread > 0){
+            blockSize = std::min(blockSize, std::max(1L, inNbElementsAtLevel/(minGroupsPerThread*inNbThreads)));
+        }
+        return blockSize;
+    }
+
+    // The parents of each group of the lower level form a group
+    // (a parent that is shared by two groups goes in the first one)
+    std::vector<std::vector<IndexType>> getParentIndexesOneGroupPerParent(const std::vector<CellGroupClass>& inLowerCellGroups) const{
+        std::vector<std::vector<IndexType>> cellIndexesPerGroup;
+        cellIndexesPerGroup.reserve(inLowerCellGroups.size());
+        IndexType lastParentIndex = -1;
+
+        for(const auto& lowerCellGroup : inLowerCellGroups){
+            std::vector<IndexType> cellIndexes;
+            long int idxCell = 0;
+
+            if(cellIndexesPerGroup.size()){
+                while(idxCell < lowerCellGroup.getNbCells()
+                      && spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)) <= lastParentIndex){
+                    idxCell += 1;
                 }
             }
-            else{
-                cellBlocks[idxLevel].reserve(cellBlocks[idxLevel+1].size()/8);
 
-                cellIndexes.clear();
-                IndexType previousIndex = -1;
+            for( ; idxCell < lowerCellGroup.getNbCells() ; ++idxCell){
+                if(cellIndexes.size() == 0 || cellIndexes.back() != spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell))){
+                    cellIndexes.push_back(spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)));
+                }
+            }
+
+            if(cellIndexes.size()){
+                lastParentIndex = cellIndexes.back();
+                cellIndexesPerGroup.emplace_back(std::move(cellIndexes));
+            }
+        }
+        return cellIndexesPerGroup;
+    }
+
+    template<class ParticleContainer>
+    void buildTree(const ParticleContainer& inParticlePositions, std::vector<long int> inOriginalIndexes = std::vector<long int>()){
+        const int nbThreads = TbfParallel::GetNbThreads();
+
+        resetInteractionPlan();
+
+        cellBlocks.clear();
+        particleGroups.clear();
+
+        cellBlocks.resize(configuration.getTreeHeight());
+        if(std::size(inParticlePositions) == 0){
+            return;
+        }
+
+        {
+            TbfParticleSorter<RealType, SpaceIndexType> partSorter(spaceSystem, inParticlePositions, std::move(inOriginalIndexes), nbThreads);
+            const long int leafBlockSize = getBlockSizeForLevel(configuration.getTreeHeight()-1, partSorter.getNbLeaves(), nbThreads);
+            const auto groupProperties = (splitStrategy == TbfGroupSplitStrategy::BalancedCost ?
+                                              partSorter.splitInGroups(TbfGroupSplitter::SplitBalancedCost(
+                                                    partSorter.computeLeafCosts(spaceSystem, costModel, nbThreads), leafBlockSize)) :
+                                              partSorter.splitInGroups(leafBlockSize));
+
+            BuildGroups(particleGroups, static_cast<long int>(std::size(groupProperties)), nbThreads,
+                        [&](const long int idxGroup){
+                return LeafGroupClass(groupProperties[idxGroup], inParticlePositions, spaceSystem,
+                                      getAllocatorForGroup(idxGroup, static_cast<long int>(std::size(groupProperties))));
+            });
+        }
+
+        if(configuration.getTreeHeight() <= 0){
+            return;
+        }
+
+        BuildGroups(cellBlocks[configuration.getTreeHeight()-1], getNbParticleGroups(), nbThreads,
+                    [&](const long int idxGroup){
+            const auto& particleGroup = particleGroups[idxGroup];
+            std::vector<IndexType> leafIndexes(particleGroup.getNbLeaves());
+
+            for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                leafIndexes[idxLeaf] = particleGroup.getLeafSpacialIndex(idxLeaf);
+            }
+
+            return CellGroupClass(leafIndexes, spaceSystem, getAllocatorForGroup(idxGroup, getNbParticleGroups()));
+        });
+
+        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= 0 ; --idxLevel){
+            std::vector<std::vector<IndexType>> cellIndexesPerGroup;
+
+            if(oneGroupPerParent){
+                cellIndexesPerGroup = getParentIndexesOneGroupPerParent(cellBlocks[idxLevel+1]);
+            }
+            else{
+                std::vector<IndexType> cellIndexes;
+                std::vector<long int> nbChildrenPerCell;
 
                 for(const auto& lowerCellGroup : cellBlocks[idxLevel+1]){
                     for(long int idxCell = 0; idxCell < lowerCellGroup.getNbCells() ; ++idxCell){
-                        if(previousIndex != spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell))){
-                            cellIndexes.push_back(spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)));
-                            previousIndex = spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell));
-
-                            if(static_cast<long int>(cellIndexes.size()) == nbElementsPerBlock){
-                                cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
-                                cellIndexes.clear();
-                            }
+                        const IndexType parentIndex = spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell));
+                        if(cellIndexes.size() == 0 || cellIndexes.back() != parentIndex){
+                            cellIndexes.push_back(parentIndex);
+                            nbChildrenPerCell.push_back(0);
                         }
+                        nbChildrenPerCell.back() += 1;
                     }
                 }
 
-                if(cellIndexes.size()){
-                    cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
-                    cellIndexes.clear();
+                const long int levelBlockSize = getBlockSizeForLevel(idxLevel, static_cast<long int>(cellIndexes.size()), nbThreads);
+                const std::vector<long int> intervals = (splitStrategy == TbfGroupSplitStrategy::BalancedCost ?
+                                                    TbfGroupSplitter::SplitBalancedCost(TbfGroupSplitter::ComputeCellCosts(spaceSystem, idxLevel, cellIndexes,
+                                                                                                                           nbChildrenPerCell, costModel, nbThreads),
+                                                                                        levelBlockSize) :
+                                                    TbfGroupSplitter::SplitFixedSize(static_cast<long int>(cellIndexes.size()), levelBlockSize));
+
+                cellIndexesPerGroup.reserve(std::max(0L, static_cast<long int>(intervals.size()) - 1));
+                for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(intervals.size()) - 1 ; ++idxGroup){
+                    cellIndexesPerGroup.emplace_back(cellIndexes.begin() + intervals[idxGroup], cellIndexes.begin() + intervals[idxGroup+1]);
                 }
             }
+
+            BuildGroups(cellBlocks[idxLevel], static_cast<long int>(cellIndexesPerGroup.size()), nbThreads,
+                        [&](const long int idxGroup){
+                return CellGroupClass(cellIndexesPerGroup[idxGroup], spaceSystem,
+                                      getAllocatorForGroup(idxGroup, static_cast<long int>(cellIndexesPerGroup.size())));
+            });
         }
     }
 
+public:
+
+    template<class ParticleContainer>
+    TbfTree(const SpacialConfiguration& inConfiguration,
+               const ParticleContainer& inParticlePositions,
+               const long int inNbElementsPerBlock = -1,
+               const bool inOneGroupPerParent = false,
+               const TbfGroupSplitStrategy inSplitStrategy = TbfGroupSplitStrategy::FixedSize,
+               const TbfGroupCostModel& inCostModel = TbfGroupCostModel(),
+               const long int inMinGroupsPerThread = 0,
+               const std::shared_ptr<TbfMemoryAllocator>& inAllocator = nullptr)
+        : TbfTree(inConfiguration, inParticlePositions, GetLeafOnlyBlockSizes(inConfiguration.getTreeHeight(), inNbElementsPerBlock),
+                  inOneGroupPerParent, inSplitStrategy, inCostModel, inMinGroupsPerThread, inAllocator){
+    }
+
+    // inNbElementsPerBlockAtLevel[idxLevel] is the block size of the level idxLevel, with -1
+    // the block size of the leaf level is used (which is estimated if it is -1).
+    // With inOneGroupPerParent the groups of the upper levels follow the groups of the
+    // leaf level, so only the leaf level can have a block size (the others must be -1).
+    template<class ParticleContainer>
+    TbfTree(const SpacialConfiguration& inConfiguration,
+               const ParticleContainer& inParticlePositions,
+               const std::vector<long int>& inNbElementsPerBlockAtLevel,
+               const bool inOneGroupPerParent = false,
+               const TbfGroupSplitStrategy inSplitStrategy = TbfGroupSplitStrategy::FixedSize,
+               const TbfGroupCostModel& inCostModel = TbfGroupCostModel(),
+               const long int inMinGroupsPerThread = 0,
+               const std::shared_ptr<TbfMemoryAllocator>& inAllocator = nullptr)
+        : configuration(inConfiguration), spaceSystem(configuration),
+          nbElementsPerBlock((inNbElementsPerBlockAtLevel.size() == 0 || inNbElementsPerBlockAtLevel.back() == -1) ?
+                                 TbfBlockSizeFinder::Estimate<RealType>(inParticlePositions, inConfiguration):
+                                 inNbElementsPerBlockAtLevel.back()),
+          nbElementsPerBlockAtLevel(inNbElementsPerBlockAtLevel), minGroupsPerThread(inMinGroupsPerThread),
+          oneGroupPerParent(inOneGroupPerParent), splitStrategy(inSplitStrategy), costModel(inCostModel), allocator(inAllocator),
+          nbParticles(static_cast<long int>(std::size(inParticlePositions))){
+        assert(static_cast<long int>(nbElementsPerBlockAtLevel.size()) == configuration.getTreeHeight());
+        assert(oneGroupPerParent == false || nbElementsPerBlockAtLevel.size() == 0
+               || std::all_of(nbElementsPerBlockAtLevel.begin(), nbElementsPerBlockAtLevel.end()-1,
+                              [](const long int inBlockSize){ return inBlockSize == -1; }));
+
+        buildTree(inParticlePositions);
+    }
+
     //////////////////////////////////////////////////////////////////////////////
 
     long int getNbParticles() const{
@@ -145,6 +417,31 @@ public:
         return nbElementsPerBlock;
     }
 
+    // The block size given for a level (the groups can be smaller if there is a minimum number of groups per thread)
+    long int getNbElementsPerGroupAtLevel(const long int inLevel) const{
+        if(inLevel < static_cast<long int>(nbElementsPerBlockAtLevel.size()) && nbElementsPerBlockAtLevel[inLevel] != -1){
+            return nbElementsPerBlockAtLevel[inLevel];
+        }
+        return nbElementsPerBlock;
+    }
+
+    long int getMinGroupsPerThread() const{
+        return minGroupsPerThread;
+    }
+
+    TbfGroupSplitStrategy getGroupSplitStrategy() const{
+        return splitStrategy;
+    }
+
+    const std::shared_ptr<TbfMemoryAllocator>& getAllocator() const{
+        return allocator;
+    }
+
+    // The allocator of the group inIdxGroup of inNbGroups of a level (nullptr if there is no allocator)
+    std::shared_ptr<TbfMemoryAllocator> getAllocatorForGroup(const long int inIdxGroup, const long int inNbGroups) const{
+        return (allocator ? allocator->getAllocatorForGroup(inIdxGroup, inNbGroups) : nullptr);
+    }
+
     const SpacialConfiguration& getSpacialConfiguration() const{
         return configuration;
     }
@@ -189,6 +486,21 @@ public:
         return particleGroups;
     }
 
+    // The M2L/P2P interactions resolved to the positions in the groups (built at the first call),
+    // it remains valid until the tree is rebuilt
+    const TbfInteractionPlan& getInteractionPlan() const{
+        return interactionPlan.get(*this);
+    }
+
+    bool hasInteractionPlan() const{
+        return interactionPlan.exists();
+    }
+
+    // Must be called if the groups are modified directly
+    void resetInteractionPlan(){
+        interactionPlan.reset();
+    }
+
     //////////////////////////////////////////////////////////////////////////////
 
     auto findGroupWithCell(const long int inLevel, const IndexType inMIndex){
@@ -280,7 +592,7 @@ public:
                              const std::array<RhsType*, NbRhsValuesPerParticle> /*particleRhsPtr*/){
             for(int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
                 for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
-                    data[idxValue][particleIndexes[idxPart]] = particleDataPtr[idxValue][idxPart];
+                    data[particleIndexes[idxPart]][idxValue] = particleDataPtr[idxValue][idxPart];
                 }
             }
         });
@@ -296,7 +608,7 @@ public:
                              const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
             for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
                 for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
-                    rhs[idxValue][particleIndexes[idxPart]] = particleRhsPtr[idxValue][idxPart];
+                    rhs[particleIndexes[idxPart]][idxValue] = particleRhsPtr[idxValue][idxPart];
                 }
             }
         });
@@ -305,130 +617,483 @@ public:
     }
 
     void rebuild(){
+        const int nbThreads = TbfParallel::GetNbThreads();
+
+        // The particles are extracted in the current tree order, such that
+        // the keys are nearly sorted if the particles did not move much
+        std::vector<long int> groupOffsets(particleGroups.size()+1, 0);
+        for(size_t idxGroup = 0 ; idxGroup < particleGroups.size() ; ++idxGroup){
+            groupOffsets[idxGroup+1] = groupOffsets[idxGroup] + particleGroups[idxGroup].getNbParticles();
+        }
+
         std::vector<std::array<RealType, NbDataValuesPerParticle>> data(nbParticles);
+        std::vector<long int> originalIndexes(nbParticles);
         std::vector<std::array<RhsType, NbRhsValuesPerParticle>> rhs(nbParticles);
 
-        applyToAllLeaves([&data, &rhs](auto&& leafHeader, const long int* particleIndexes,
-                             const std::array<DataType*, NbDataValuesPerParticle> particleDataPtr,
-                             const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
-            for(int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
+        TbfParallel::ParallelFor(0, getNbParticleGroups(), nbThreads, [&](const long int idxGroup){
+            long int idxParticle = groupOffsets[idxGroup];
+            particleGroups[idxGroup].applyToAllLeaves([&](auto&& leafHeader, const long int* particleIndexes,
+                                 const std::array<DataType*, NbDataValuesPerParticle> particleDataPtr,
+                                 const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
                 for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
-                    data[idxValue][particleIndexes[idxPart]] = particleDataPtr[idxValue][idxPart];
+                    for(int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
+                        data[idxParticle + idxPart][idxValue] = particleDataPtr[idxValue][idxPart];
+                    }
+                    originalIndexes[idxParticle + idxPart] = particleIndexes[idxPart];
                 }
-            }
-            for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
-                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
-                    rhs[idxValue][particleIndexes[idxPart]] = particleRhsPtr[idxValue][idxPart];
+                for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                    for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                        rhs[particleIndexes[idxPart]][idxValue] = particleRhsPtr[idxValue][idxPart];
+                    }
                 }
-            }
+                idxParticle += leafHeader.nbParticles;
+            });
         });
 
+        buildTree(data, std::move(originalIndexes));
 
-        cellBlocks.clear();
-        particleGroups.clear();
-
-        cellBlocks.resize(configuration.getTreeHeight());
-        if(std::size(data) == 0){
-            return;
-        }
+        TbfParallel::ParallelFor(0, getNbParticleGroups(), nbThreads, [&](const long int idxGroup){
+            particleGroups[idxGroup].applyToAllLeaves([&rhs](auto&& leafHeader, const long int* particleIndexes,
+                                      const std::array<DataType*, NbDataValuesPerParticle> /*particleDataPtr*/,
+                                      const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+                 for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                     for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                         particleRhsPtr[idxValue][idxPart] = rhs[particleIndexes[idxPart]][idxValue];
+                     }
+                 }
+             });
+        });
+    }
 
-        {
-            TbfParticleSorter<RealType> partSorter(spaceSystem, data);
-            const auto groupProperties = partSorter.splitInGroups(nbElementsPerBlock);
-            particleGroups.reserve(std::size(groupProperties));
 
-            for(const auto& groupProperty : groupProperties){
-                particleGroups.emplace_back(groupProperty, data, spaceSystem);
-            }
-        }
+    // Recompute the leaf of each particle and move only the particles that changed of leaf.
+    // The groups keep their interval of spacial indexes, and only the groups (particles
+    // and cells at all levels) whose content has changed are re-allocated.
+    // The groups respect the block size of each level and the one group per parent
+    // alignment as in buildTree.
+    // The multipoles and locals are reset as with rebuild(), and the rhs are kept.
+    // Returns the number of particles that changed of leaf.
+    long int rebuildIncremental(){
+        const int nbThreads = TbfParallel::GetNbThreads();
+        const long int nbGroups = getNbParticleGroups();
 
-        if(configuration.getTreeHeight() <= 0){
-            return;
-        }
+        resetInteractionPlan();
 
-        {
-            std::vector<IndexType> leafIndexes;
+        std::vector<std::vector<IncrementalParticle>> outgoingParticles(nbGroups);
+        std::vector<std::vector<unsigned char>> particleHasMoved(nbGroups);
 
-            cellBlocks[configuration.getTreeHeight()-1].reserve(particleGroups.size());
-            for(const auto& particleGroup : particleGroups){
-                leafIndexes.resize(particleGroup.getNbLeaves());
+        TbfParallel::ParallelFor(0, nbGroups, nbThreads, [&](const long int idxGroup){
+            particleHasMoved[idxGroup].resize(particleGroups[idxGroup].getNbParticles(), 0);
+            long int idxParticle = 0;
 
-                for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
-                    leafIndexes[idxLeaf] = particleGroup.getLeafSpacialIndex(idxLeaf);
+            particleGroups[idxGroup].applyToAllLeaves([&](auto&& leafHeader, const long int* particleIndexes,
+                                 const std::array<DataType*, NbDataValuesPerParticle> particleDataPtr,
+                                 const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    std::array<RealType, SpaceIndexType::Dim> position;
+                    for(long int idxDim = 0 ; idxDim < SpaceIndexType::Dim ; ++idxDim){
+                        position[idxDim] = particleDataPtr[idxDim][idxPart];
+                    }
+                    const IndexType spaceIndex = spaceSystem.getIndexFromPosition(position);
+
+                    if(spaceIndex != leafHeader.spaceIndex){
+                        outgoingParticles[idxGroup].emplace_back();
+                        IncrementalParticle& particle = outgoingParticles[idxGroup].back();
+                        particle.spaceIndex = spaceIndex;
+                        particle.originalIndex = particleIndexes[idxPart];
+                        for(int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
+                            particle.data[idxValue] = particleDataPtr[idxValue][idxPart];
+                        }
+                        for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                            particle.rhs[idxValue] = particleRhsPtr[idxValue][idxPart];
+                        }
+                        particleHasMoved[idxGroup][idxParticle + idxPart] = 1;
+                    }
                 }
+                idxParticle += leafHeader.nbParticles;
+            });
+        });
 
-                cellBlocks[configuration.getTreeHeight()-1].emplace_back(leafIndexes, spaceSystem);
+        // A particle goes to the group whose interval contains its index,
+        // or to the previous group if it falls between two groups
+        std::vector<std::vector<IncrementalParticle>> incomingParticles(nbGroups);
+        long int nbMovedParticles = 0;
+
+        for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+            nbMovedParticles += static_cast<long int>(outgoingParticles[idxGroup].size());
+
+            for(auto& particle : outgoingParticles[idxGroup]){
+                const auto nextGroup = std::upper_bound(particleGroups.begin(), particleGroups.end(), particle.spaceIndex,
+                                                        [](const IndexType& inSpaceIndex, const auto& inGroup){
+                    return inSpaceIndex < inGroup.getStartingSpacialIndex();
+                });
+                const long int idxDestGroup = std::max(0L, static_cast<long int>(std::distance(particleGroups.begin(), nextGroup)) - 1);
+                incomingParticles[idxDestGroup].emplace_back(std::move(particle));
             }
         }
 
-        std::vector<IndexType> cellIndexes;
-        cellIndexes.reserve(nbElementsPerBlock);
+        std::vector<unsigned char> groupHasChanged(nbGroups, 0);
+        // A changed group is split if it has more leaves than the block size of the leaf level
+        // (the number of leaves before the rebuild is used for the minimum number of groups per thread)
+        long int nbLeavesBefore = 0;
+        for(const auto& particleGroup : particleGroups){
+            nbLeavesBefore += particleGroup.getNbLeaves();
+        }
+        const long int leafBlockSize = getBlockSizeForLevel(configuration.getTreeHeight()-1, nbLeavesBefore, nbThreads);
 
-        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= 0 ; --idxLevel){
-            if(oneGroupPerParent){
-                cellBlocks[idxLevel].reserve(cellBlocks[idxLevel+1].size());
+        std::vector<std::vector<LeafGroupClass>> newParticleGroups(nbGroups);
 
-                for(const auto& lowerCellGroup : cellBlocks[idxLevel+1]){
-                    cellIndexes.clear();
-                    long int idxCell = 0;
+        TbfParallel::ParallelFor(0, nbGroups, nbThreads, [&](const long int idxGroup){
+            if(outgoingParticles[idxGroup].empty() && incomingParticles[idxGroup].empty()){
+                return;
+            }
+            groupHasChanged[idxGroup] = 1;
+
+            std::sort(incomingParticles[idxGroup].begin(), incomingParticles[idxGroup].end(),
+                      [](const IncrementalParticle& p1, const IncrementalParticle& p2){
+                return p1.spaceIndex < p2.spaceIndex || (p1.spaceIndex == p2.spaceIndex && p1.originalIndex < p2.originalIndex);
+            });
 
-                    if(cellBlocks[idxLevel].size()){
-                        while(idxCell < lowerCellGroup.getNbCells()
-                              && spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)) <= cellBlocks[idxLevel].back().getEndingSpacialIndex()){
-                            idxCell += 1;
+            std::vector<IncrementalParticle> stayingParticles;
+            stayingParticles.reserve(particleGroups[idxGroup].getNbParticles() - outgoingParticles[idxGroup].size());
+            long int idxParticle = 0;
+
+            particleGroups[idxGroup].applyToAllLeaves([&](auto&& leafHeader, const long int* particleIndexes,
+                                 const std::array<DataType*, NbDataValuesPerParticle> particleDataPtr,
+                                 const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    if(particleHasMoved[idxGroup][idxParticle + idxPart] == 0){
+                        stayingParticles.emplace_back();
+                        IncrementalParticle& particle = stayingParticles.back();
+                        particle.spaceIndex = leafHeader.spaceIndex;
+                        particle.originalIndex = particleIndexes[idxPart];
+                        for(int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
+                            particle.data[idxValue] = particleDataPtr[idxValue][idxPart];
                         }
+                        for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                            particle.rhs[idxValue] = particleRhsPtr[idxValue][idxPart];
+                        }
+                    }
+                }
+                idxParticle += leafHeader.nbParticles;
+            });
+
+            std::vector<IncrementalParticle> particles(stayingParticles.size() + incomingParticles[idxGroup].size());
+            std::merge(stayingParticles.begin(), stayingParticles.end(),
+                       incomingParticles[idxGroup].begin(), incomingParticles[idxGroup].end(),
+                       particles.begin(), [](const IncrementalParticle& p1, const IncrementalParticle& p2){
+                return p1.spaceIndex < p2.spaceIndex;
+            });
+
+            long int idxFirstParticle = 0;
+            while(idxFirstParticle < static_cast<long int>(particles.size())){
+                long int idxEndParticle = idxFirstParticle;
+                long int nbLeaves = 0;
+                while(idxEndParticle < static_cast<long int>(particles.size())
+                      && (nbLeaves < leafBlockSize || particles[idxEndParticle].spaceIndex == particles[idxEndParticle-1].spaceIndex)){
+                    if(idxEndParticle == idxFirstParticle || particles[idxEndParticle].spaceIndex != particles[idxEndParticle-1].spaceIndex){
+                        nbLeaves += 1;
                     }
+                    idxEndParticle += 1;
+                }
 
-                    for( ; idxCell < lowerCellGroup.getNbCells() ; ++idxCell){
-                        if(cellIndexes.size() == 0 || cellIndexes.back() != spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell))){
-                            cellIndexes.push_back(spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)));
+                const IncrementalGroupInfo groupInfo(particles.data() + idxFirstParticle, idxEndParticle - idxFirstParticle);
+                newParticleGroups[idxGroup].emplace_back(groupInfo, particles.data() + idxFirstParticle, spaceSystem,
+                                                         getAllocatorForGroup(idxGroup, nbGroups));
+
+                long int idxNewParticle = idxFirstParticle;
+                newParticleGroups[idxGroup].back().applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                          const std::array<DataType*, NbDataValuesPerParticle> /*particleDataPtr*/,
+                                          const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
+                    for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                        for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                            particleRhsPtr[idxValue][idxPart] = particles[idxNewParticle + idxPart].rhs[idxValue];
                         }
                     }
+                    idxNewParticle += leafHeader.nbParticles;
+                });
 
-                    if(cellIndexes.size()){
-                        cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
+                idxFirstParticle = idxEndParticle;
+            }
+        });
+
+        // Update the particle groups and the leaf level
+        {
+            std::vector<LeafGroupClass> oldParticleGroups(std::move(particleGroups));
+            std::vector<CellGroupClass> oldLeafGroups(std::move(cellBlocks[configuration.getTreeHeight()-1]));
+            particleGroups.clear();
+            cellBlocks[configuration.getTreeHeight()-1].clear();
+
+            // The index of the old group for the unchanged groups, -1 otherwise
+            std::vector<long int> oldGroupIndexes;
+            for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                if(groupHasChanged[idxGroup] == 0){
+                    particleGroups.emplace_back(std::move(oldParticleGroups[idxGroup]));
+                    oldGroupIndexes.push_back(idxGroup);
+                }
+                else{
+                    for(auto& newParticleGroup : newParticleGroups[idxGroup]){
+                        particleGroups.emplace_back(std::move(newParticleGroup));
+                        oldGroupIndexes.push_back(-1);
                     }
                 }
             }
-            else{
-                cellBlocks[idxLevel].reserve(cellBlocks[idxLevel+1].size()/8);
 
-                cellIndexes.clear();
-                IndexType previousIndex = -1;
+            BuildGroups(cellBlocks[configuration.getTreeHeight()-1], static_cast<long int>(particleGroups.size()), nbThreads,
+                        [&](const long int idxNewGroup){
+                if(oldGroupIndexes[idxNewGroup] != -1){
+                    CellGroupClass cellGroup(std::move(oldLeafGroups[oldGroupIndexes[idxNewGroup]]));
+                    cellGroup.resetMultipolesAndLocals();
+                    return cellGroup;
+                }
 
+                const auto& particleGroup = particleGroups[idxNewGroup];
+                std::vector<IndexType> leafIndexes(particleGroup.getNbLeaves());
+                for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                    leafIndexes[idxLeaf] = particleGroup.getLeafSpacialIndex(idxLeaf);
+                }
+                return CellGroupClass(leafIndexes, spaceSystem, getAllocatorForGroup(idxNewGroup, static_cast<long int>(particleGroups.size())));
+            });
+        }
+
+        // Update the upper levels, the groups are built as in buildTree if there is one group per parent,
+        // otherwise the cells are distributed using the intervals of the existing groups (which are split
+        // if they become larger than the block size of the level)
+        for(long int idxLevel = configuration.getTreeHeight()-2 ; idxLevel >= 0 ; --idxLevel){
+            std::vector<CellGroupClass> oldCellGroups(std::move(cellBlocks[idxLevel]));
+            cellBlocks[idxLevel].clear();
+
+            std::vector<std::vector<IndexType>> cellIndexesPerGroup;
+
+            if(oneGroupPerParent){
+                cellIndexesPerGroup = getParentIndexesOneGroupPerParent(cellBlocks[idxLevel+1]);
+            }
+            else{
+                const long int nbOldGroups = static_cast<long int>(oldCellGroups.size());
+                std::vector<std::vector<IndexType>> cellIndexesPerOldGroup(std::max(1L, nbOldGroups));
+                long int nbCellsAtLevel = 0;
+
+                long int idxCurrentGroup = 0;
                 for(const auto& lowerCellGroup : cellBlocks[idxLevel+1]){
                     for(long int idxCell = 0; idxCell < lowerCellGroup.getNbCells() ; ++idxCell){
-                        if(previousIndex != spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell))){
-                            cellIndexes.push_back(spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell)));
-                            previousIndex = spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell));
-
-                            if(static_cast<long int>(cellIndexes.size()) == nbElementsPerBlock){
-                                cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
-                                cellIndexes.clear();
-                            }
+                        const IndexType parentIndex = spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell));
+                        while(idxCurrentGroup + 1 < nbOldGroups && oldCellGroups[idxCurrentGroup+1].getStartingSpacialIndex() <= parentIndex){
+                            idxCurrentGroup += 1;
+                        }
+                        auto& cellIndexes = cellIndexesPerOldGroup[idxCurrentGroup];
+                        if(cellIndexes.empty() || cellIndexes.back() != parentIndex){
+                            cellIndexes.push_back(parentIndex);
+                            nbCellsAtLevel += 1;
                         }
                     }
                 }
 
-                if(cellIndexes.size()){
-                    cellBlocks[idxLevel].emplace_back(cellIndexes, spaceSystem);
-                    cellIndexes.clear();
+                const long int levelBlockSize = getBlockSizeForLevel(idxLevel, nbCellsAtLevel, nbThreads);
+                for(const auto& cellIndexes : cellIndexesPerOldGroup){
+                    const std::vector<long int> intervals = TbfGroupSplitter::SplitFixedSize(static_cast<long int>(cellIndexes.size()), levelBlockSize);
+                    for(long int idxGroup = 0 ; idxGroup < static_cast<long int>(intervals.size()) - 1 ; ++idxGroup){
+                        cellIndexesPerGroup.emplace_back(cellIndexes.begin() + intervals[idxGroup], cellIndexes.begin() + intervals[idxGroup+1]);
+                    }
                 }
             }
+
+            // The old groups are moved concurrently, so their first indexes are copied before
+            std::vector<IndexType> oldStartingIndexes(oldCellGroups.size());
+            for(long int idxOldGroup = 0 ; idxOldGroup < static_cast<long int>(oldCellGroups.size()) ; ++idxOldGroup){
+                oldStartingIndexes[idxOldGroup] = oldCellGroups[idxOldGroup].getStartingSpacialIndex();
+            }
+
+            BuildGroups(cellBlocks[idxLevel], static_cast<long int>(cellIndexesPerGroup.size()), nbThreads,
+                        [&](const long int idxGroup){
+                const auto& cellIndexes = cellIndexesPerGroup[idxGroup];
+
+                // An old group that has exactly the same cells is kept
+                const auto oldStartingIndex = std::lower_bound(oldStartingIndexes.begin(), oldStartingIndexes.end(), cellIndexes.front());
+                if(oldStartingIndex != oldStartingIndexes.end() && *oldStartingIndex == cellIndexes.front()){
+                    CellGroupClass& oldGroup = oldCellGroups[std::distance(oldStartingIndexes.begin(), oldStartingIndex)];
+                    bool sameCells = (oldGroup.getNbCells() == static_cast<long int>(cellIndexes.size()));
+                    for(long int idxCell = 0 ; sameCells && idxCell < oldGroup.getNbCells() ; ++idxCell){
+                        sameCells = (oldGroup.getCellSpacialIndex(idxCell) == cellIndexes[idxCell]);
+                    }
+                    if(sameCells){
+                        CellGroupClass cellGroup(std::move(oldGroup));
+                        cellGroup.resetMultipolesAndLocals();
+                        return cellGroup;
+                    }
+                }
+
+                return CellGroupClass(cellIndexes, spaceSystem, getAllocatorForGroup(idxGroup, static_cast<long int>(cellIndexesPerGroup.size())));
+            });
         }
 
-        applyToAllLeaves([&rhs](auto&& leafHeader, const long int* particleIndexes,
-                                  const std::array<DataType*, NbDataValuesPerParticle> /*particleDataPtr*/,
-                                  const std::array<RhsType*, NbRhsValuesPerParticle> particleRhsPtr){
-             for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
-                 for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
-                     particleRhsPtr[idxValue][idxPart] = rhs[idxValue][particleIndexes[idxPart]];
-                 }
-             }
-         });
+        return nbMovedParticles;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+
+    // Write the configuration and the raw memory of all the groups (including the
+    // multipoles, locals and rhs), the file is only valid for the same types and architecture.
+    bool save(const std::string& inFilename) const{
+        static_assert(std::is_trivially_copyable<DataType>::value && std::is_trivially_copyable<RhsType>::value,
+                      "The particle data and rhs must be trivially copyable to be saved as raw memory");
+        static_assert(std::is_trivially_copyable<MultipoleClass>::value && std::is_trivially_copyable<LocalClass>::value,
+                      "The multipoles and locals must be trivially copyable to be saved as raw memory");
+        CheckpointHeader header = GetCheckpointHeaderModel();
+        header.treeHeight = configuration.getTreeHeight();
+        header.boxWidths = configuration.getBoxWidths();
+        header.boxCenter = configuration.getBoxCenter();
+        header.nbElementsPerBlock = nbElementsPerBlock;
+        header.minGroupsPerThread = minGroupsPerThread;
+        header.oneGroupPerParent = oneGroupPerParent;
+        header.splitStrategy = static_cast<long int>(splitStrategy);
+        header.costModel = costModel;
+        header.nbParticles = nbParticles;
+        header.nbParticleGroups = getNbParticleGroups();
+
+        std::vector<long int> nbCellGroupsAtLevel(configuration.getTreeHeight());
+        std::vector<std::pair<const unsigned char*, long int>> buffers;
+        for(const auto& particleGroup : particleGroups){
+            buffers.emplace_back(particleGroup.getDataPtr(), particleGroup.getDataSizeInByte());
+            buffers.emplace_back(particleGroup.getRhsPtr(), particleGroup.getRhsSizeInByte());
+        }
+        for(long int idxLevel = 0 ; idxLevel < configuration.getTreeHeight() ; ++idxLevel){
+            nbCellGroupsAtLevel[idxLevel] = getNbCellGroupsAtLevel(idxLevel);
+            for(const auto& cellGroup : cellBlocks[idxLevel]){
+                buffers.emplace_back(cellGroup.getDataPtr(), cellGroup.getDataSizeInByte());
+                buffers.emplace_back(cellGroup.getMultipolePtr(), cellGroup.getMultipoleSizeInByte());
+                buffers.emplace_back(cellGroup.getLocalPtr(), cellGroup.getLocalSizeInByte());
+            }
+        }
 
+        std::vector<std::array<long int, 2>> bufferOffsetsAndSizes(buffers.size());
+        long int currentOffset = AlignCheckpointOffset(static_cast<long int>(sizeof(CheckpointHeader)
+                                                           + sizeof(long int) * nbElementsPerBlockAtLevel.size()
+                                                           + sizeof(long int) * nbCellGroupsAtLevel.size()
+                                                           + sizeof(long int) * 2 * buffers.size()));
+        for(size_t idxBuffer = 0 ; idxBuffer < buffers.size() ; ++idxBuffer){
+            bufferOffsetsAndSizes[idxBuffer] = {{currentOffset, buffers[idxBuffer].second}};
+            currentOffset = AlignCheckpointOffset(currentOffset + buffers[idxBuffer].second);
+        }
+
+        std::ofstream file(inFilename, std::ios::binary | std::ios::trunc);
+        if(!file.is_open()){
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CheckpointHeader));
+        file.write(reinterpret_cast<const char*>(nbElementsPerBlockAtLevel.data()), sizeof(long int) * nbElementsPerBlockAtLevel.size());
+        file.write(reinterpret_cast<const char*>(nbCellGroupsAtLevel.data()), sizeof(long int) * nbCellGroupsAtLevel.size());
+        file.write(reinterpret_cast<const char*>(bufferOffsetsAndSizes.data()), sizeof(long int) * 2 * bufferOffsetsAndSizes.size());
+
+        const std::array<char, TbfDefaultMemoryAlignement> padding = {};
+        for(size_t idxBuffer = 0 ; idxBuffer < buffers.size() ; ++idxBuffer){
+            file.write(padding.data(), bufferOffsetsAndSizes[idxBuffer][0] - static_cast<long int>(file.tellp()));
+            file.write(reinterpret_cast<const char*>(buffers[idxBuffer].first), buffers[idxBuffer].second);
+        }
+
+        return static_cast<bool>(file);
     }
 
+    // Map a file written by save(), the groups use the mapped memory directly
+    // (private mapping, such that the file is never modified).
+    // Returns nullptr if the file cannot be read or does not match the tree types.
+    static std::unique_ptr<TbfTree> Load(const std::string& inFilename){
+        static_assert(std::is_trivially_copyable<DataType>::value && std::is_trivially_copyable<RhsType>::value,
+                      "The particle data and rhs must be trivially copyable to be loaded from raw memory");
+        static_assert(std::is_trivially_copyable<MultipoleClass>::value && std::is_trivially_copyable<LocalClass>::value,
+                      "The multipoles and locals must be trivially copyable to be loaded from raw memory");
+        std::shared_ptr<TbfFileMapping> mapping = std::make_shared<TbfFileMapping>(inFilename);
+        if(!mapping->isMapped() || mapping->getSizeInByte() < static_cast<long int>(sizeof(CheckpointHeader))){
+            return nullptr;
+        }
+
+        unsigned char* filePtr = mapping->getPtr();
+        const long int fileSize = mapping->getSizeInByte();
+
+        CheckpointHeader header;
+        memcpy(&header, filePtr, sizeof(CheckpointHeader));
+
+        const CheckpointHeader headerModel = GetCheckpointHeaderModel();
+        if(memcmp(header.magic, headerModel.magic, sizeof(header.magic)) != 0
+                || header.version != headerModel.version || header.dim != headerModel.dim
+                || header.sizeOfReal != headerModel.sizeOfReal || header.sizeOfIndex != headerModel.sizeOfIndex
+                || header.sizeOfData != headerModel.sizeOfData || header.nbDataValuesPerParticle != headerModel.nbDataValuesPerParticle
+                || header.sizeOfRhs != headerModel.sizeOfRhs || header.nbRhsValuesPerParticle != headerModel.nbRhsValuesPerParticle
+                || header.sizeOfMultipole != headerModel.sizeOfMultipole || header.sizeOfLocal != headerModel.sizeOfLocal
+                || header.treeHeight <= 0 || header.nbParticleGroups < 0){
+            return nullptr;
+        }
+
+        long int currentOffset = static_cast<long int>(sizeof(CheckpointHeader));
+        auto readLongs = [&](const long int inNbValues) -> const long int* {
+            if(inNbValues < 0 || fileSize - currentOffset < static_cast<long int>(sizeof(long int)) * inNbValues){
+                return nullptr;
+            }
+            const long int* values = reinterpret_cast<const long int*>(&filePtr[currentOffset]);
+            currentOffset += static_cast<long int>(sizeof(long int)) * inNbValues;
+            return values;
+        };
+
+        const long int* blockSizesAtLevel = readLongs(header.treeHeight);
+        const long int* nbCellGroupsAtLevel = readLongs(header.treeHeight);
+        if(blockSizesAtLevel == nullptr || nbCellGroupsAtLevel == nullptr){
+            return nullptr;
+        }
+
+        long int nbBuffers = 2 * header.nbParticleGroups;
+        for(long int idxLevel = 0 ; idxLevel < header.treeHeight ; ++idxLevel){
+            if(nbCellGroupsAtLevel[idxLevel] < 0){
+                return nullptr;
+            }
+            nbBuffers += 3 * nbCellGroupsAtLevel[idxLevel];
+        }
+
+        const long int* bufferOffsetsAndSizes = readLongs(2 * nbBuffers);
+        if(bufferOffsetsAndSizes == nullptr){
+            return nullptr;
+        }
+        for(long int idxBuffer = 0 ; idxBuffer < nbBuffers ; ++idxBuffer){
+            const long int offset = bufferOffsetsAndSizes[2*idxBuffer];
+            const long int size = bufferOffsetsAndSizes[2*idxBuffer+1];
+            if(offset < 0 || size < 0 || offset > fileSize || fileSize - offset < size
+                    || offset % TbfDefaultMemoryAlignement != 0){
+                return nullptr;
+            }
+        }
+
+        std::unique_ptr<TbfTree> tree(new TbfTree(header, blockSizesAtLevel));
+
+        // The mapping is released when all the groups have been deleted
+        const TbfMemoryBlockDeleter deleter = [mapping](unsigned char*){};
+        long int idxBuffer = 0;
+        auto nextBuffer = [&]() -> std::pair<unsigned char*, long int> {
+            const long int offset = bufferOffsetsAndSizes[2*idxBuffer];
+            const long int size = bufferOffsetsAndSizes[2*idxBuffer+1];
+            idxBuffer += 1;
+            return std::make_pair(size ? &filePtr[offset] : nullptr, size);
+        };
+
+        tree->particleGroups.reserve(header.nbParticleGroups);
+        for(long int idxGroup = 0 ; idxGroup < header.nbParticleGroups ; ++idxGroup){
+            const auto dataBuffer = nextBuffer();
+            const auto rhsBuffer = nextBuffer();
+            tree->particleGroups.emplace_back(dataBuffer.first, dataBuffer.second, rhsBuffer.first, rhsBuffer.second, deleter);
+        }
+
+        for(long int idxLevel = 0 ; idxLevel < header.treeHeight ; ++idxLevel){
+            tree->cellBlocks[idxLevel].reserve(nbCellGroupsAtLevel[idxLevel]);
+            for(long int idxGroup = 0 ; idxGroup < nbCellGroupsAtLevel[idxLevel] ; ++idxGroup){
+                const auto dataBuffer = nextBuffer();
+                const auto multipoleBuffer = nextBuffer();
+                const auto localBuffer = nextBuffer();
+                tree->cellBlocks[idxLevel].emplace_back(dataBuffer.first, dataBuffer.second,
+                                                        multipoleBuffer.first, multipoleBuffer.second,
+                                                        localBuffer.first, localBuffer.second, deleter);
+            }
+        }
+
+        return tree;
+    }
 
     template <class StreamClass>
     friend  StreamClass& operator<<(StreamClass& inStream, const TbfTree& inAlgo) {
@@ -438,7 +1103,12 @@ public:
         inStream << " - Space system: " << "\n";
         inStream << inAlgo.spaceSystem << "\n";
         inStream << " - Number of elements per block: " << inAlgo.nbElementsPerBlock << "\n";
+        for (long int idxLevel = 0 ; idxLevel < inAlgo.configuration.getTreeHeight() ; ++idxLevel) {
+            inStream << " - Number of elements per block at level " << idxLevel << ": " << inAlgo.getNbElementsPerGroupAtLevel(idxLevel) << "\n";
+        }
+        inStream << " - Min groups per thread: " << inAlgo.minGroupsPerThread << "\n";
         inStream << " - One group per element: " << inAlgo.oneGroupPerParent << "\n";
+        inStream << " - Balanced cost groups: " << (inAlgo.splitStrategy == TbfGroupSplitStrategy::BalancedCost) << "\n";
         inStream << " - Number of particles: " << inAlgo.nbParticles << "\n";
 
         inStream << " -- Cell groups:" << "\n";
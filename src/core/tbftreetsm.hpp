@@ -11,11 +11,15 @@
 
 #include <vector>
 #include <array>
+#include <memory>
+#include <utility>
+#include <cassert>
 
 template <class RealType, class DataType, long int NbDataValuesPerParticle, class RhsType, long int NbRhsValuesPerParticle,
-          class MultipoleClass, class LocalClass, class SpaceIndexType = TbfDefaultSpaceIndexType<RealType>>
+          class MultipoleClass, class LocalClass, class SpaceIndexType_T = TbfDefaultSpaceIndexType<RealType>>
 class TbfTreeTsm {
 public:
+    using SpaceIndexType = SpaceIndexType_T;
     using TreeClassSource = TbfTree<RealType, DataType, NbDataValuesPerParticle, void_data, 0, MultipoleClass, void_data, SpaceIndexType>;
     using TreeClassTarget = TbfTree<RealType, DataType, NbDataValuesPerParticle, RhsType, NbRhsValuesPerParticle, void_data, LocalClass, SpaceIndexType>;
 
@@ -26,14 +30,43 @@ public:
     using CellGroupClassTarget = typename TreeClassTarget::CellGroupClass;
 
     using SpacialConfiguration = TbfSpacialConfiguration<RealType, SpaceIndexType::Dim>;
-    using IndexType = typename TbfDefaultSpaceIndexType<RealType>::IndexType;
+    using IndexType = typename SpaceIndexType::IndexType;
 
 protected:
     const SpacialConfiguration configuration;
     const SpaceIndexType spaceSystem;
 
+    // Kept to build new target trees
+    const std::vector<long int> nbElementsPerBlockAtLevel;
+    const bool oneGroupPerParent;
+    const TbfGroupSplitStrategy splitStrategy;
+    const TbfGroupCostModel costModel;
+    const long int minGroupsPerThread;
+
     TreeClassSource treeSource;
-    TreeClassTarget treeTarget;
+    // The target tree can be replaced while the source tree is kept
+    std::unique_ptr<TreeClassTarget> treeTarget;
+
+    // The same block sizes are used for the sources and the targets
+    template<class ParticleContainer>
+    static std::vector<long int> GetBlockSizes(std::vector<long int> inNbElementsPerBlockAtLevel,
+                                               const ParticleContainer& inParticleSourcePositions,
+                                               const ParticleContainer& inParticleTargetPositions,
+                                               const SpacialConfiguration& inConfiguration){
+        if(static_cast<long int>(inNbElementsPerBlockAtLevel.size()) != inConfiguration.getTreeHeight()){
+            assert(inNbElementsPerBlockAtLevel.size() <= 1);
+            const long int leafBlockSize = (inNbElementsPerBlockAtLevel.size() ? inNbElementsPerBlockAtLevel.back() : -1);
+            inNbElementsPerBlockAtLevel.assign(inConfiguration.getTreeHeight(), -1);
+            if(inNbElementsPerBlockAtLevel.size()){
+                inNbElementsPerBlockAtLevel.back() = leafBlockSize;
+            }
+        }
+        if(inNbElementsPerBlockAtLevel.size() && inNbElementsPerBlockAtLevel.back() == -1){
+            inNbElementsPerBlockAtLevel.back() = TbfBlockSizeFinder::EstimateTsm<RealType>(inParticleSourcePositions, inParticleTargetPositions,
+                                                                                         inConfiguration);
+        }
+        return inNbElementsPerBlockAtLevel;
+    }
 
 public:
 
@@ -42,24 +75,61 @@ public:
                const ParticleContainer& inParticleSourcePositions,
                const ParticleContainer& inParticleTargetPositions,
                const long int inNbElementsPerBlock = -1,
-               const bool inOneGroupPerParent = false)
+               const bool inOneGroupPerParent = false,
+               const TbfGroupSplitStrategy inSplitStrategy = TbfGroupSplitStrategy::FixedSize,
+               const TbfGroupCostModel& inCostModel = TbfGroupCostModel(),
+               const long int inMinGroupsPerThread = 0)
+        : TbfTreeTsm(inConfiguration, inParticleSourcePositions, inParticleTargetPositions,
+                     std::vector<long int>{inNbElementsPerBlock}, inOneGroupPerParent, inSplitStrategy, inCostModel,
+                     inMinGroupsPerThread){
+    }
+
+    // See TbfTree, -1 can be used at the leaf level to estimate the block size,
+    // a vector with a single value gives the block size of the leaf level
+    template<class ParticleContainer>
+    TbfTreeTsm(const SpacialConfiguration& inConfiguration,
+               const ParticleContainer& inParticleSourcePositions,
+               const ParticleContainer& inParticleTargetPositions,
+               std::vector<long int> inNbElementsPerBlockAtLevel,
+               const bool inOneGroupPerParent = false,
+               const TbfGroupSplitStrategy inSplitStrategy = TbfGroupSplitStrategy::FixedSize,
+               const TbfGroupCostModel& inCostModel = TbfGroupCostModel(),
+               const long int inMinGroupsPerThread = 0)
         : configuration(inConfiguration), spaceSystem(configuration),
-          treeSource(inConfiguration, inParticleSourcePositions,
-                     inNbElementsPerBlock == -1 ?
-                         TbfBlockSizeFinder::EstimateTsm<RealType>(inParticleSourcePositions, inParticleTargetPositions, configuration):
-                         inNbElementsPerBlock,
-                     inOneGroupPerParent),
-          treeTarget(inConfiguration, inParticleTargetPositions,
-                     inNbElementsPerBlock == -1 ?
-                         TbfBlockSizeFinder::EstimateTsm<RealType>(inParticleSourcePositions, inParticleTargetPositions, configuration):
-                         inNbElementsPerBlock,
-                     inOneGroupPerParent){
+          nbElementsPerBlockAtLevel(GetBlockSizes(inNbElementsPerBlockAtLevel, inParticleSourcePositions, inParticleTargetPositions, inConfiguration)),
+          oneGroupPerParent(inOneGroupPerParent), splitStrategy(inSplitStrategy), costModel(inCostModel),
+          minGroupsPerThread(inMinGroupsPerThread),
+          treeSource(inConfiguration, inParticleSourcePositions, nbElementsPerBlockAtLevel,
+                     inOneGroupPerParent, inSplitStrategy, inCostModel, inMinGroupsPerThread),
+          treeTarget(buildTargetTree(inParticleTargetPositions)){
+    }
+
+    //////////////////////////////////////////////////////////////////////////////
+
+    // Builds a target tree with the configuration and the block sizes of the current tree,
+    // the current tree is not modified (an algorithm can be executed on it meanwhile)
+    template<class ParticleContainer>
+    std::unique_ptr<TreeClassTarget> buildTargetTree(const ParticleContainer& inParticleTargetPositions) const{
+        return std::unique_ptr<TreeClassTarget>(new TreeClassTarget(configuration, inParticleTargetPositions, nbElementsPerBlockAtLevel,
+                                                                    oneGroupPerParent, splitStrategy, costModel, minGroupsPerThread));
+    }
+
+    // Replaces the target tree by inOutTargetTree (built with buildTargetTree), which receives the previous one.
+    // The source tree, and so the multipoles, are kept.
+    void swapTargetTree(std::unique_ptr<TreeClassTarget>& inOutTargetTree){
+        assert(inOutTargetTree && inOutTargetTree->getSpacialConfiguration() == configuration);
+        std::swap(treeTarget, inOutTargetTree);
+    }
+
+    template<class ParticleContainer>
+    void resetTargets(const ParticleContainer& inParticleTargetPositions){
+        treeTarget = buildTargetTree(inParticleTargetPositions);
     }
 
     //////////////////////////////////////////////////////////////////////////////
 
     long int getNbParticles() const{
-        return treeSource.getNbParticles() + treeTarget.getNbParticles();
+        return treeSource.getNbParticles() + treeTarget->getNbParticles();
     }
 
     long int getNbElementsPerGroupSource() const{
@@ -67,7 +137,7 @@ public:
     }
 
     long int getNbElementsPerGroupTarget() const{
-        return treeTarget.getNbElementsPerGroup();
+        return treeTarget->getNbElementsPerGroup();
     }
 
     const SpacialConfiguration& getSpacialConfiguration() const{
@@ -117,35 +187,35 @@ public:
     }
 
     long int getNbCellGroupsAtLevelTarget(const long int inIdxLevel) const{
-        return treeTarget.getNbCellGroupsAtLevel(inIdxLevel);
+        return treeTarget->getNbCellGroupsAtLevel(inIdxLevel);
     }
 
     auto& getCellGroupsAtLevelTarget(const long int inIdxLevel){
-        return treeTarget.getCellGroupsAtLevel(inIdxLevel);
+        return treeTarget->getCellGroupsAtLevel(inIdxLevel);
     }
 
     const auto& getCellGroupsAtLevelTarget(const long int inIdxLevel) const {
-        return treeTarget.getCellGroupsAtLevel(inIdxLevel);
+        return treeTarget->getCellGroupsAtLevel(inIdxLevel);
     }
 
     auto& getLeafGroupsTarget(){
-        return treeTarget.getLeafGroups();
+        return treeTarget->getLeafGroups();
     }
 
     const auto& getLeafGroupsTarget() const {
-        return treeTarget.getLeafGroups();
+        return treeTarget->getLeafGroups();
     }
 
     long int getNbParticleGroupsTarget() const{
-        return treeTarget.getNbParticleGroups();
+        return treeTarget->getNbParticleGroups();
     }
 
     auto& getParticleGroupsTarget(){
-        return treeTarget.getParticleGroups();
+        return treeTarget->getParticleGroups();
     }
 
     const auto& getParticleGroupsTarget() const {
-        return treeTarget.getParticleGroups();
+        return treeTarget->getParticleGroups();
     }
 
     //////////////////////////////////////////////////////////////////////////////
@@ -155,7 +225,7 @@ public:
     }
 
     auto findGroupWithCellTarget(const long int inLevel, const IndexType inMIndex){
-        return treeTarget.findGroupWithCell(inLevel, inMIndex);
+        return treeTarget->findGroupWithCell(inLevel, inMIndex);
     }
 
     auto findGroupWithLeafSource(const IndexType inMIndex){
@@ -163,7 +233,7 @@ public:
     }
 
     auto findGroupWithLeafTarget(const IndexType inMIndex){
-        return treeTarget.findGroupWithLeaf(inMIndex);
+        return treeTarget->findGroupWithLeaf(inMIndex);
     }
 
     //////////////////////////////////////////////////////////////////////////////
@@ -171,7 +241,7 @@ public:
     template <class FuncClass>
     void applyToAllCells(FuncClass&& inFunc){
         treeSource.applyToAllCells(inFunc);
-        treeTarget.applyToAllCells(inFunc);
+        treeTarget->applyToAllCells(inFunc);
     }
 
     template <class FuncClass>
@@ -181,13 +251,13 @@ public:
 
     template <class FuncClass>
     void applyToAllCellsTarget(FuncClass&& inFunc){
-        treeTarget.applyToAllCells(inFunc);
+        treeTarget->applyToAllCells(inFunc);
     }
 
     template <class FuncClass>
     void applyToAllLeaves(FuncClass&& inFunc){
         treeSource.applyToAllLeaves(inFunc);
-        treeTarget.applyToAllLeaves(inFunc);
+        treeTarget->applyToAllLeaves(inFunc);
     }
 
     template <class FuncClass>
@@ -197,13 +267,13 @@ public:
 
     template <class FuncClass>
     void applyToAllLeavesTarget(FuncClass&& inFunc){
-        treeTarget.applyToAllLeaves(inFunc);
+        treeTarget->applyToAllLeaves(inFunc);
     }
 
     template <class FuncClass>
     void applyToAllCells(FuncClass&& inFunc) const {
         treeSource.applyToAllCells(inFunc);
-        treeTarget.applyToAllCells(inFunc);
+        treeTarget->applyToAllCells(inFunc);
     }
 
     template <class FuncClass>
@@ -213,13 +283,13 @@ public:
 
     template <class FuncClass>
     void applyToAllCellsTarget(FuncClass&& inFunc) const {
-        treeTarget.applyToAllCells(inFunc);
+        treeTarget->applyToAllCells(inFunc);
     }
 
     template <class FuncClass>
     void applyToAllLeaves(FuncClass&& inFunc) const {
         treeSource.applyToAllLeaves(inFunc);
-        treeTarget.applyToAllLeaves(inFunc);
+        treeTarget->applyToAllLeaves(inFunc);
     }
 
     template <class FuncClass>
@@ -229,7 +299,7 @@ public:
 
     template <class FuncClass>
     void applyToAllLeavesTarget(FuncClass&& inFunc) const {
-        treeTarget.applyToAllLeaves(inFunc);
+        treeTarget->applyToAllLeaves(inFunc);
     }
 
     //////////////////////////////////////////////////////////////////////////////
@@ -239,16 +309,20 @@ public:
     }
 
     auto getAllParticlesDataTarget(){
-        return treeTarget.getAllParticlesData();
+        return treeTarget->getAllParticlesData();
     }
 
     auto getAllParticlesRhsTarget(){
-        return treeTarget.getAllParticlesRhs();
+        return treeTarget->getAllParticlesRhs();
     }
 
     void rebuild(){
         treeSource.rebuild();
-        treeTarget.rebuild();
+        treeTarget->rebuild();
+    }
+
+    long int rebuildIncremental(){
+        return treeSource.rebuildIncremental() + treeTarget->rebuildIncremental();
     }
 
 
@@ -11,6 +11,7 @@
 #include "kernels/unifkernel/FP2PR.hpp"
 
 #include "utils/tbfperiodicshifter.hpp"
+#include "utils/tbfutils.hpp"
 
 /** This is a recursion to get the minimal size of the matrix dlmk
   */
@@ -873,6 +874,21 @@ private:
         return getLeafCenter(spaceIndexSystem.getBoxPosFromIndex(inIndex));
     }
 
+    /** Return the center of a leaf from its symbolic data,
+      * the leaves of an adaptive tree can be above the last level
+      */
+    template <class CellSymbolicData>
+    std::array<RealType,3> getLeafCenterFromSymbolicData(const CellSymbolicData& inLeafIndex) const {
+        const long int leafLevel = TbfUtils::GetLevelOrDefault(inLeafIndex, treeHeight-1);
+        if(leafLevel == treeHeight-1){
+            return getLeafCenter(inLeafIndex.boxCoord);
+        }
+        const RealType widthAtLevel = boxWidth / RealType(1L << leafLevel);
+        return std::array<RealType, 3>{boxCorner[0] + (RealType(inLeafIndex.boxCoord[0]) + RealType(.5)) * widthAtLevel,
+                      boxCorner[1] + (RealType(inLeafIndex.boxCoord[1]) + RealType(.5)) * widthAtLevel,
+                      boxCorner[2] + (RealType(inLeafIndex.boxCoord[2]) + RealType(.5)) * widthAtLevel};
+    }
+
     /** Return position in the array of the l/m couple
       * P[atLm(l,m)] => P{l,m}
       * 0
@@ -938,7 +954,7 @@ public:
         std::complex<RealType>* const w = &LeafCell[0];
 
         // Copying the position is faster than using cell position
-        const std::array<RealType,3> cellPosition = getLeafCenter(LeafIndex.boxCoord);
+        const std::array<RealType,3> cellPosition = getLeafCenterFromSymbolicData(LeafIndex);
 
         // We need a legendre array
         RealType legendre[SizeArray];
@@ -1183,7 +1199,7 @@ public:
         const std::complex<RealType>* const u = &LeafCell[0];
 
         // Copying the position is faster than using cell position
-        const std::array<RealType,3> cellPosition = getLeafCenter(LeafIndex.boxCoord);
+        const std::array<RealType,3> cellPosition = getLeafCenterFromSymbolicData(LeafIndex);
 
         // For all particles in the leaf box
         const RealType*const physicalValues = inOutParticles[3];
@@ -59,6 +59,23 @@ public:
         }
     }
 
+    template <class CellSymbolicData, class CellClass, class LeafSymbolicData, class ParticlesClassValues, class ParticlesClassRhs>
+    void M2P(const CellSymbolicData& /*inCellIndex*/, const long int /*inLevel*/, const CellClass& inCell,
+             const LeafSymbolicData& /*inLeafIndex*/, const long int /*particlesIndexes*/[],
+             const ParticlesClassValues& /*inOutParticles*/, ParticlesClassRhs& inOutParticlesRhs,
+             const long int inNbParticles) const {
+        for(int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            inOutParticlesRhs[0][idxPart] += inCell[0];
+        }
+    }
+
+    template <class LeafSymbolicData, class ParticlesClassValues, class CellSymbolicData, class CellClass>
+    void P2L(const LeafSymbolicData& /*inLeafIndex*/, const long int /*particlesIndexes*/[],
+             const ParticlesClassValues& /*inParticles*/, const long int inNbParticles,
+             const CellSymbolicData& /*inCellIndex*/, const long int /*inLevel*/, CellClass& inOutCell) const {
+        inOutCell[0] += inNbParticles;
+    }
+
     template <class LeafSymbolicData,class ParticlesClassValues, class ParticlesClassRhs>
     void P2P(const LeafSymbolicData& /*inNeighborIndex*/, const long int /*neighborsIndexes*/[],
              const ParticlesClassValues& /*inParticlesNeighbors*/, ParticlesClassRhs& inParticlesNeighborsRhs,
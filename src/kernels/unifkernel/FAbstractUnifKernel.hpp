@@ -22,6 +22,7 @@
 #include <memory>
 
 #include "FUnifInterpolator.hpp"
+#include "utils/tbfutils.hpp"
 
 /**
  * @author Pierre Blanchard (pierre.blanchard@inria.fr)
@@ -90,6 +91,26 @@ protected:
       return getLeafCellCenter(spaceIndexSystem.getBoxPosFromIndex(inIndex));
   }
 
+  /**
+   * Width and center of a leaf from its symbolic data, the leaves
+   * of an adaptive tree can be above the last level.
+   */
+  template <class CellSymbolicData>
+  RealType getLeafWidthFromSymbolicData(const CellSymbolicData& inLeafIndex) const{
+      const long int leafLevel = TbfUtils::GetLevelOrDefault(inLeafIndex, TreeHeight-1);
+      return BoxWidthLeaf*RealType(1L << (TreeHeight-1-leafLevel));
+  }
+
+  template <class CellSymbolicData>
+  std::array<RealType, Dim> getLeafCellCenterFromSymbolicData(const CellSymbolicData& inLeafIndex) const{
+      const RealType leafWidth = getLeafWidthFromSymbolicData(inLeafIndex);
+      std::array<RealType, Dim> res;
+      for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+          res[idxDim] = BoxCorner[idxDim] + (RealType(inLeafIndex.boxCoord[idxDim]) + RealType(.5)) * leafWidth;
+      }
+      return res;
+  }
+
   /** 
    * @brief Return the position of the center of a cell from its tree
    *  coordinate 
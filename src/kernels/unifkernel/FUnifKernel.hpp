@@ -91,9 +91,9 @@ public:
     template <class CellSymbolicData, class ParticlesClass, class LeafClass>
     void P2M(const CellSymbolicData& LeafIndex,  const long int /*particlesIndexes*/[],
              const ParticlesClass& SourceParticles, const long int inNbParticles, LeafClass& LeafCell) const {
-        const auto LeafCellCenter = AbstractBaseClass::getLeafCellCenter(LeafIndex.boxCoord);
+        const auto LeafCellCenter = AbstractBaseClass::getLeafCellCenterFromSymbolicData(LeafIndex);
         // 1) apply Sy
-        AbstractBaseClass::Interpolator->applyP2M(LeafCellCenter, AbstractBaseClass::BoxWidthLeaf,
+        AbstractBaseClass::Interpolator->applyP2M(LeafCellCenter, AbstractBaseClass::getLeafWidthFromSymbolicData(LeafIndex),
                                                   LeafCell.multipole_exp, std::forward<const ParticlesClass>(SourceParticles), inNbParticles);
         // 2) apply Discrete Fourier Transform
         M2LHandler.applyZeroPaddingAndDFT(LeafCell.multipole_exp,
@@ -156,7 +156,8 @@ public:
              const LeafClass& LeafCell,  const long int /*particlesIndexes*/[],
              const ParticlesClass& inOutParticles, ParticlesClassRhs& inOutParticlesRhs,
              const long int inNbParticles) {
-        const std::array<RealType, Dim> LeafCellCenter(AbstractBaseClass::getLeafCellCenter(LeafIndex.boxCoord));
+        const std::array<RealType, Dim> LeafCellCenter(AbstractBaseClass::getLeafCellCenterFromSymbolicData(LeafIndex));
+        const RealType LeafCellWidth = AbstractBaseClass::getLeafWidthFromSymbolicData(LeafIndex);
 
         RealType localExp[AbstractBaseClass::nnodes] = {0};
 
@@ -166,12 +167,12 @@ public:
         FBlas::add(AbstractBaseClass::nnodes,const_cast<RealType*>(LeafCell.local_exp),localExp);
 
         // 2.a) apply Sx
-        AbstractBaseClass::Interpolator->applyL2P(LeafCellCenter, AbstractBaseClass::BoxWidthLeaf,
+        AbstractBaseClass::Interpolator->applyL2P(LeafCellCenter, LeafCellWidth,
                                                   localExp, std::forward<const ParticlesClass>(inOutParticles),
                                                   std::forward<ParticlesClassRhs>(inOutParticlesRhs), inNbParticles);
 
         // 2.b) apply Px (grad Sx)
-        AbstractBaseClass::Interpolator->applyL2PGradient(LeafCellCenter, AbstractBaseClass::BoxWidthLeaf,
+        AbstractBaseClass::Interpolator->applyL2PGradient(LeafCellCenter, LeafCellWidth,
                                                           localExp, std::forward<const ParticlesClass>(inOutParticles),
                                                           std::forward<ParticlesClassRhs>(inOutParticlesRhs), inNbParticles);
     }
@@ -0,0 +1,93 @@
+#ifndef TBFADAPTIVELISTS_HPP
+#define TBFADAPTIVELISTS_HPP
+
+#include "tbfglobal.hpp"
+
+#include "core/tbfinteraction.hpp"
+
+#include <vector>
+#include <array>
+#include <utility>
+#include <algorithm>
+
+// The interaction lists of the adaptive trees, they only need the positions of the
+// cells, so they are shared by all the spacial indexes (Morton, Hilbert, ...)
+namespace TbfAdaptiveLists{
+
+// Tells if two cells, that can be at different levels, share at least a corner.
+// It should not be called with a cell and one of its ancestors.
+template <long int Dim>
+inline bool AreCellsAdjacent(const std::array<long int, Dim>& inCellPos1, const long int inLevel1,
+                             const std::array<long int, Dim>& inCellPos2, const long int inLevel2){
+    const long int finestLevel = std::max(inLevel1, inLevel2);
+
+    for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+        const long int begin1 = (inCellPos1[idxDim] << (finestLevel-inLevel1));
+        const long int end1 = ((inCellPos1[idxDim]+1) << (finestLevel-inLevel1));
+        const long int begin2 = (inCellPos2[idxDim] << (finestLevel-inLevel2));
+        const long int end2 = ((inCellPos2[idxDim]+1) << (finestLevel-inLevel2));
+        if(end1 < begin2 || end2 < begin1){
+            return false;
+        }
+    }
+    return true;
+}
+
+// Builds the lists of a leaf in an adaptive tree, inGetCellType(level, index) must
+// return the type of any cell (TbfAdaptiveCellType).
+// The first list (U) contains the adjacent leaves that are at the same level with a lower index,
+// or at a lower level, such that a pair of leaves appears only once.
+// The second list (W) contains the cells whose parent is adjacent to the leaf but that are
+// not adjacent to it (they are smaller than the leaf), the X list is the dual of the W list.
+// The V list is the usual interaction list (getInteractionListForIndex).
+template <class SpaceIndexType, class CellTypeFunc>
+inline auto GetListsForLeaf(const SpaceIndexType& inSpaceSystem, const typename SpaceIndexType::IndexType inLeafIndex,
+                            const long int inLeafLevel, CellTypeFunc&& inGetCellType){
+    static_assert(SpaceIndexType::IsPeriodic == false, "The adaptive lists are not available for periodic systems");
+    using IndexType = typename SpaceIndexType::IndexType;
+
+    const auto leafPos = inSpaceSystem.getBoxPosFromIndex(inLeafIndex);
+
+    std::vector<TbfAdaptiveCell<IndexType>> uList;
+    std::vector<TbfAdaptiveCell<IndexType>> wList;
+    std::vector<TbfAdaptiveCell<IndexType>> cellsToVisit;
+
+    for(const IndexType neighborIndex : inSpaceSystem.getNeighborListForIndex(inLeafIndex, inLeafLevel)){
+        const TbfAdaptiveCellType cellType = inGetCellType(inLeafLevel, neighborIndex);
+        if(cellType == TbfAdaptiveCellType::Leaf && neighborIndex < inLeafIndex){
+            uList.push_back(TbfAdaptiveCell<IndexType>{inLeafLevel, neighborIndex});
+        }
+        else if(cellType == TbfAdaptiveCellType::Internal){
+            cellsToVisit.push_back(TbfAdaptiveCell<IndexType>{inLeafLevel, neighborIndex});
+        }
+    }
+
+    while(cellsToVisit.size()){
+        const TbfAdaptiveCell<IndexType> cell = cellsToVisit.back();
+        cellsToVisit.pop_back();
+
+        for(long int idxChild = 0 ; idxChild < inSpaceSystem.getNbChildrenPerCell() ; ++idxChild){
+            const TbfAdaptiveCell<IndexType> child{cell.level+1, inSpaceSystem.getChildIndexFromParent(cell.index, idxChild)};
+            const TbfAdaptiveCellType childType = inGetCellType(child.level, child.index);
+
+            if(childType != TbfAdaptiveCellType::NotExist){
+                if(AreCellsAdjacent<SpaceIndexType::Dim>(inSpaceSystem.getBoxPosFromIndex(child.index), child.level,
+                                                        leafPos, inLeafLevel) == false){
+                    wList.push_back(child);
+                }
+                else if(childType == TbfAdaptiveCellType::Leaf){
+                    uList.push_back(child);
+                }
+                else{
+                    cellsToVisit.push_back(child);
+                }
+            }
+        }
+    }
+
+    return std::make_pair(std::move(uList), std::move(wList));
+}
+
+}
+
+#endif
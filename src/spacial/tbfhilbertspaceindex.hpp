@@ -5,18 +5,21 @@
 
 #include "utils/tbfutils.hpp"
 #include "core/tbfinteraction.hpp"
+#include "spacial/tbfmortoncoder.hpp"
+#include "utils/tbfindextype.hpp"
 
 #include <vector>
 #include <array>
 #include <cassert>
+#include <algorithm>
 
-template <long int Dim_T, class ConfigurationClass_T, const bool IsPeriodic_v = false>
+template <long int Dim_T, class ConfigurationClass_T, const bool IsPeriodic_v = false, class IndexType_T = long int>
 class TbfHilbertSpaceIndex{
 public:
     static_assert (Dim_T > 0, "Dimension must be greater than 0" );
     static_assert (Dim_T == 3, "Dimension must be 3 for now" );
 
-    using IndexType = long int;
+    using IndexType = IndexType_T;
     using ConfigurationClass = ConfigurationClass_T;
     using RealType = typename ConfigurationClass::RealType;
 
@@ -24,15 +27,16 @@ public:
     static constexpr bool IsPeriodic = IsPeriodic_v;
 
 protected:
+    using CoderType = TbfMortonCoder<Dim, IndexType>;
+    using UIndexType = typename TbfIndexTypeTraits<IndexType>::UnsignedType;
+
     const ConfigurationClass configuration;
 
     long int getTreeCoordinate(const RealType inRelativePosition, const long int inDim) const {
         assert(inRelativePosition >= 0 && inRelativePosition <= configuration.getBoxWidths()[inDim]);
-        if(inRelativePosition == configuration.getBoxWidths()[inDim]){
-            return (1 << (configuration.getTreeHeight()-1))-1;
-        }
         const RealType indexFReal = inRelativePosition / configuration.getLeafWidths()[inDim];
-        return static_cast<long int>(indexFReal);
+        // A position on the upper border is in the last box
+        return std::min(static_cast<long int>(indexFReal), (1L << (configuration.getTreeHeight()-1))-1);
     }
 
     /// The following code has been taken from FMB
@@ -82,78 +86,87 @@ protected:
     };
 
 
-    long int Hilbert2Morton(long int Hilbert_ind) const{
-      long int mask = 0x7LL;
-      long int h;
-      long int shift = 0;
-      long int current_state = 0;
-      long int Hilbert_triplet;
-      long int Morton_triplet; /* can NOT be defined as an "unsigned char"! */
-      long int res = 0x0LL;
-
-      shift = (configuration.getTreeHeight()-1) * CHILDREN_BITS_NUMBER;
-      mask <<= shift; /* Set the mask on the triplet of bits corresponding to the first level. */
-
-      for (h=configuration.getTreeHeight(); h>0; --h){
-        Hilbert_triplet = (Hilbert_ind & mask) >> shift; /* Get the triplet of bits corresponding
-                                                          * to the current level. */
-
-        /* Get the corresponding triplet with Morton ordering: */
-        Morton_triplet = Hilbert2Morton_table[current_state][Hilbert_triplet].triplet;
-        /* Get state for next iteration: */
-        current_state = Hilbert2Morton_table[current_state][Hilbert_triplet].next_state;
-
-        /* Write Morton triplet at the place according to the current level: */
-        res |= (Morton_triplet << shift);
-
-        mask >>= CHILDREN_BITS_NUMBER;
-        shift -= CHILDREN_BITS_NUMBER;
-      }
-
-      return res;
+    // The conversions process three triplets per step, an item of the following tables is
+    // (next state << 9) | the 9 bits converted, for [state][the 9 bits to convert]
+    static constexpr long int NbTripletsPerStep = 3;
+    static constexpr long int NbBitsPerStep = NbTripletsPerStep*CHILDREN_BITS_NUMBER;
+    static constexpr long int NbValuesPerStep = (1 << NbBitsPerStep);
+
+    using StepTable = std::array<std::array<unsigned short, NbValuesPerStep>, 12>;
+
+    static constexpr StepTable BuildStepTable(const Hilbert_Morton_table_case_t inTable[12][8]){
+        StepTable table{};
+        for(int idxState = 0 ; idxState < 12 ; ++idxState){
+            for(int idxBits = 0 ; idxBits < NbValuesPerStep ; ++idxBits){
+                int currentState = idxState;
+                int converted = 0;
+                for(long int shift = NbBitsPerStep - CHILDREN_BITS_NUMBER ; shift >= 0 ; shift -= CHILDREN_BITS_NUMBER){
+                    const auto& item = inTable[currentState][(idxBits >> shift) & 0x7];
+                    converted |= (item.triplet << shift);
+                    currentState = item.next_state;
+                }
+                table[idxState][idxBits] = static_cast<unsigned short>((currentState << NbBitsPerStep) | converted);
+            }
+        }
+        return table;
     }
 
+    static constexpr StepTable Hilbert2Morton_steps = BuildStepTable(Hilbert2Morton_table);
+    static constexpr StepTable Morton2Hilbert_steps = BuildStepTable(Morton2Hilbert_table);
 
-    long int Morton2Hilbert(long int Morton_ind) const {
-      long int mask = 0x7LL;
-      long int h;
-      long int shift = 0;
-      long int current_state = 0;
-      long int  Hilbert_triplet;  /* can NOT be defined as an "unsigned char"! */
-      long int Morton_triplet;
-      long int res = 0x0LL;
+    // The indexes are converted on getTreeHeight() triplets, which are completed with leading
+    // zero triplets to have full steps. In both tables, a zero triplet goes from the state 2 to 0,
+    // and from 1 to 2, so the padding is the same as starting from the state 2 (or 1 for two triplets).
+    long int nbConversionSteps() const{
+        return (configuration.getTreeHeight() + NbTripletsPerStep - 1)/NbTripletsPerStep;
+    }
 
-      shift = (configuration.getTreeHeight()-1) * CHILDREN_BITS_NUMBER;
-      mask <<= shift; /* Set the mask on the triplet of bits corresponding to the first level. */
+    long int firstConversionState() const{
+        const long int nbPaddingTriplets = nbConversionSteps()*NbTripletsPerStep - configuration.getTreeHeight();
+        return (NbTripletsPerStep - nbPaddingTriplets) % NbTripletsPerStep;
+    }
 
-      for (h=configuration.getTreeHeight(); h>0; --h){
-        Morton_triplet = (Morton_ind & mask) >> shift; /* Get the triplet of bits corresponding
-                                                        * to the current level. */
+    IndexType convert(const StepTable& inTable, const IndexType inIndex) const{
+        const UIndexType index = static_cast<UIndexType>(inIndex);
+        UIndexType res = 0;
+        long int currentState = firstConversionState();
 
-        /* Get the corresponding triplet with Morton ordering: */
-        Hilbert_triplet = Morton2Hilbert_table[current_state][Morton_triplet].triplet;
-        /* Get state for next iteration: */
-        current_state = Morton2Hilbert_table[current_state][Morton_triplet].next_state;
+        for(long int shift = (nbConversionSteps()-1) * NbBitsPerStep ; shift >= 0 ; shift -= NbBitsPerStep){
+            const unsigned short converted = inTable[currentState][(index >> shift) & (NbValuesPerStep-1)];
+            res |= (static_cast<UIndexType>(converted & (NbValuesPerStep-1)) << shift);
+            currentState = (converted >> NbBitsPerStep);
+        }
 
-        /* Write Morton triplet at the place according to the current level: */
-        res |= (Hilbert_triplet << shift);
+        return static_cast<IndexType>(res);
+    }
 
-        mask >>= CHILDREN_BITS_NUMBER;
-        shift -= CHILDREN_BITS_NUMBER;
-      }
+    IndexType Hilbert2Morton(const IndexType inHilbertIndex) const{
+        return convert(Hilbert2Morton_steps, inHilbertIndex);
+    }
 
-      return res;
+    IndexType Morton2Hilbert(const IndexType inMortonIndex) const {
+        return convert(Morton2Hilbert_steps, inMortonIndex);
     }
 
 public:
     TbfHilbertSpaceIndex(const ConfigurationClass& inConfiguration)
         : configuration(inConfiguration){
+        assert(configuration.getTreeHeight() <= getMaxTreeHeight());
+    }
+
+    // The deepest tree that can be indexed with IndexType
+    static long int constexpr getMaxTreeHeight() {
+        return TbfGetMaxTreeHeight<IndexType, Dim>();
     }
 
     IndexType getUpperBound(const long int inLevel) const{
         return (IndexType(1) << (inLevel * Dim));
     }
 
+    IndexType getUpperBoundAtLeafLevel() const{
+        return getUpperBound(configuration.getTreeHeight()-1);
+    }
+
     template <class PositionType>
     IndexType getIndexFromPosition(const PositionType& inPos) const {
         std::array<long int,Dim> host;
@@ -161,7 +174,7 @@ public:
             host[idxDim] = getTreeCoordinate( inPos[idxDim] - configuration.getBoxCorner()[idxDim], idxDim);
         }
 
-        return Morton2Hilbert(getIndexFromBoxPos(host));
+        return getIndexFromBoxPos(host);
     }
 
     std::array<RealType,Dim> getRealPosFromBoxPos(const std::array<long int,Dim>& inPos) const {
@@ -176,28 +189,8 @@ public:
         return host;
     }
 
-    std::array<long int,Dim> getBoxPosFromIndex(IndexType inMindexHilbert) const{
-        IndexType inMindex = Hilbert2Morton(inMindexHilbert);
-        IndexType mask = 0x1LL;
-
-        std::array<long int,Dim> boxPos;
-
-        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
-            boxPos[idxDim] = 0;
-        }
-
-        while(inMindex >= mask) {
-            for(long int idxDim = Dim-1 ; idxDim > 0 ; --idxDim){
-                boxPos[idxDim] |= static_cast<long int>(inMindex & mask);
-                inMindex >>= 1;
-            }
-
-            boxPos[0] |= static_cast<long int>(inMindex & mask);
-
-            mask <<= 1;
-        }
-
-        return boxPos;
+    std::array<long int,Dim> getBoxPosFromIndex(const IndexType inMindexHilbert) const{
+        return CoderType::Decode(Hilbert2Morton(inMindexHilbert));
     }
 
     IndexType getParentIndex(IndexType inIndex) const{
@@ -205,7 +198,7 @@ public:
     }
 
     long int childPositionFromParent(const IndexType inIndexChild) const {
-        return inIndexChild & static_cast<long int>(~(((~0UL)>>Dim)<<Dim));
+        return static_cast<long int>(inIndexChild & IndexType((1L << Dim)-1));
     }
 
     const auto& getConfiguration() const{
@@ -213,28 +206,7 @@ public:
     }
 
     IndexType getIndexFromBoxPos(const std::array<long int,Dim>& inBoxPos) const{
-        IndexType index = 0x0LL;
-        IndexType mask = 0x1LL;
-
-        bool shouldContinue = false;
-
-        std::array<IndexType,Dim> mcoord;
-        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
-            mcoord[idxDim] = (inBoxPos[idxDim] << (Dim - idxDim - 1));
-            shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
-        }
-
-        while(shouldContinue){
-            shouldContinue = false;
-            for(long int idxDim = Dim-1 ; idxDim >= 0 ; --idxDim){
-                index |= (mcoord[idxDim] & mask);
-                mask <<= 1;
-                mcoord[idxDim] <<= (Dim-1);
-                shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
-            }
-        }
-
-        return Morton2Hilbert(index);
+        return Morton2Hilbert(CoderType::Encode(inBoxPos));
     }
 
     IndexType getChildIndexFromParent(const IndexType inParentIndex, const long int inChild) const{
@@ -255,8 +227,8 @@ public:
             }
         }
 
-        const long int boxLimite = (1 << (inLevel));
-        const long int boxLimiteParent = (1 << (inLevel-1));
+        const long int boxLimite = (1L << (inLevel));
+        const long int boxLimiteParent = (1L << (inLevel-1));
 
         const IndexType cellIndex = inMIndex;
         const auto cellPos = getBoxPosFromIndex(cellIndex);
@@ -360,7 +332,7 @@ public:
 
 
         if constexpr(IsPeriodic){
-            assert(std::size(indexes) == getNbInteractionsPerCell());
+            assert(static_cast<long int>(std::size(indexes)) == getNbInteractionsPerCell());
         }
 
         return indexes;
@@ -387,8 +359,8 @@ public:
             }
         }
 
-        const long int boxLimite = (1 << (inLevel));
-        const long int boxLimiteParent = (1 << (inLevel-1));
+        const long int boxLimite = (1L << (inLevel));
+        const long int boxLimiteParent = (1L << (inLevel-1));
 
         for(long int idxCell = 0 ; idxCell < inGroup.getNbCells() ; ++idxCell){
             const IndexType cellIndex = inGroup.getCellSpacialIndex(idxCell);
@@ -513,7 +485,7 @@ public:
 
     auto getNeighborListForIndex(const IndexType cellIndex, const long int inLevel, const bool upperExclusion = false) const{
         assert(inLevel >= 0);
-        const long int boxLimite = (1 << (inLevel));
+        const long int boxLimite = (1L << (inLevel));
 
         std::vector<IndexType> indexes;
         indexes.reserve(TbfUtils::lipow(3,Dim)/2);
@@ -601,7 +573,7 @@ public:
         }
 
         if constexpr(IsPeriodic){
-            assert(std::size(indexes) == getNbNeighborsPerLeaf());
+            assert(static_cast<long int>(std::size(indexes)) == getNbNeighborsPerLeaf());
         }
 
         return indexes;
@@ -610,7 +582,7 @@ public:
     template <class GroupClass>
     auto getNeighborListForBlock(const GroupClass& inGroup, const long int inLevel, const bool upperExclusion = false, const bool testSelfInclusion = true) const{
         assert(inLevel >= 0);
-        const long int boxLimite = (1 << (inLevel));
+        const long int boxLimite = (1L << (inLevel));
 
         std::vector<TbfXtoXInteraction<IndexType>> indexesInternal;
         indexesInternal.reserve(inGroup.getNbLeaves());
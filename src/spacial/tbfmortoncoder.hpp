@@ -0,0 +1,370 @@
+#ifndef TBFMORTONCODER_HPP
+#define TBFMORTONCODER_HPP
+
+#include "tbfglobal.hpp"
+
+#include "utils/tbfindextype.hpp"
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#if defined(__BMI2__)
+// pdep/pext can be used directly
+#define TBF_MORTON_BMI2_STATIC
+#else
+// pdep/pext are used if the CPU supports them (detected at runtime)
+#define TBF_MORTON_BMI2_DYNAMIC
+#endif
+#endif
+
+// Interleave/deinterleave the bits of box coordinates.
+// The bit idxBit of the coordinate idxDim is at position idxBit*Dim + (Dim-idxDim-1) in the index
+// (the first dimension has the most significant bit of each level).
+// Three implementations give the same result:
+// - Loop: one bit at a time,
+// - Table: one byte at a time with lookup tables,
+// - Bmi2: pdep/pext on x86-64 (only if the CPU supports BMI2), on each 64-bit word of the index.
+// Encode/Decode select the fastest available.
+// The index type can be any integer or TbfUInt128 (see TbfIndexTypeTraits).
+template <long int Dim_T, class IndexType_T = long int>
+class TbfMortonCoder {
+public:
+    static_assert (Dim_T > 0, "Dimension must be greater than 0" );
+    static_assert (TbfIndexTypeTraits<IndexType_T>::NbBits > 0, "The index type must be an integer" );
+
+    static constexpr long int Dim = Dim_T;
+    using IndexType = IndexType_T;
+    using CoordType = std::array<long int, Dim>;
+
+private:
+    using UIndexType = typename TbfIndexTypeTraits<IndexType>::UnsignedType;
+
+    static constexpr long int NbBitsIndex = TbfIndexTypeTraits<IndexType>::NbBits;
+    // The tables are used only if the 8 bits of a coordinate byte fit in an index (and in a SpreadTable item)
+    static constexpr bool UseTable = (8*Dim <= NbBitsIndex && 8*Dim <= 64 && Dim > 1);
+    static constexpr long int NbWords = (NbBitsIndex + 63)/64;
+    static constexpr bool CanUseBmi2 = ((NbBitsIndex == 64 || NbBitsIndex == 128) && Dim > 1);
+
+    // SpreadTable[byte] has the bit idxBit of byte at position idxBit*Dim
+    static constexpr std::array<std::uint64_t, 256> BuildSpreadTable(){
+        std::array<std::uint64_t, 256> table{};
+        for(long int idxValue = 0 ; idxValue < 256 ; ++idxValue){
+            std::uint64_t spread = 0;
+            for(long int idxBit = 0 ; idxBit < 8 && idxBit*Dim < 64 ; ++idxBit){
+                if(idxValue & (1L << idxBit)){
+                    spread |= (std::uint64_t(1) << (idxBit*Dim));
+                }
+            }
+            table[idxValue] = spread;
+        }
+        return table;
+    }
+
+    // A group of Dim bytes of the index contains 8 bits of each coordinate,
+    // CompactTable[idxByteInGroup*256 + byte] gives these bits for each dimension
+    static constexpr std::array<std::array<std::uint8_t, Dim>, 256*Dim> BuildCompactTable(){
+        std::array<std::array<std::uint8_t, Dim>, 256*Dim> table{};
+        for(long int idxByteInGroup = 0 ; idxByteInGroup < Dim ; ++idxByteInGroup){
+            for(long int idxValue = 0 ; idxValue < 256 ; ++idxValue){
+                for(long int idxBit = 0 ; idxBit < 8 ; ++idxBit){
+                    if(idxValue & (1L << idxBit)){
+                        const long int posInGroup = idxByteInGroup*8 + idxBit;
+                        const long int idxDim = Dim - 1 - (posInGroup % Dim);
+                        table[idxByteInGroup*256 + idxValue][idxDim] |= static_cast<std::uint8_t>(1 << (posInGroup / Dim));
+                    }
+                }
+            }
+        }
+        return table;
+    }
+
+    // Bmi2Masks[idxDim][idxWord] selects the bits of the coordinate idxDim in the word idxWord of the index
+    static constexpr std::array<std::array<std::uint64_t, NbWords>, Dim> BuildBmi2Masks(){
+        std::array<std::array<std::uint64_t, NbWords>, Dim> masks{};
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            for(long int idxBit = 0 ; idxBit*Dim + (Dim-idxDim-1) < NbWords*64 ; ++idxBit){
+                const long int posInIndex = idxBit*Dim + (Dim-idxDim-1);
+                masks[idxDim][posInIndex/64] |= (std::uint64_t(1) << (posInIndex%64));
+            }
+        }
+        return masks;
+    }
+
+    // Bmi2Shifts[idxDim][idxWord] is the number of bits of the coordinate idxDim in the words before idxWord
+    static constexpr std::array<std::array<long int, NbWords>, Dim> BuildBmi2Shifts(){
+        const auto masks = BuildBmi2Masks();
+        std::array<std::array<long int, NbWords>, Dim> shifts{};
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            for(long int idxWord = 1 ; idxWord < NbWords ; ++idxWord){
+                long int nbBits = 0;
+                for(long int idxBit = 0 ; idxBit < 64 ; ++idxBit){
+                    nbBits += static_cast<long int>((masks[idxDim][idxWord-1] >> idxBit) & 1);
+                }
+                shifts[idxDim][idxWord] = shifts[idxDim][idxWord-1] + nbBits;
+            }
+        }
+        return shifts;
+    }
+
+    static constexpr std::array<std::uint64_t, 256> SpreadTable = BuildSpreadTable();
+    static constexpr std::array<std::array<std::uint8_t, Dim>, 256*Dim> CompactTable = BuildCompactTable();
+    static constexpr std::array<std::array<std::uint64_t, NbWords>, Dim> Bmi2Masks = BuildBmi2Masks();
+    static constexpr std::array<std::array<long int, NbWords>, Dim> Bmi2Shifts = BuildBmi2Shifts();
+
+#if defined(TBF_MORTON_BMI2_DYNAMIC)
+    __attribute__((target("bmi2")))
+    static IndexType EncodeBmi2Impl(const CoordType& inBoxPos){
+        UIndexType index = 0;
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            const std::uint64_t coord = static_cast<std::uint64_t>(inBoxPos[idxDim]);
+            for(long int idxWord = 0 ; idxWord < NbWords ; ++idxWord){
+                index |= (static_cast<UIndexType>(_pdep_u64(coord >> Bmi2Shifts[idxDim][idxWord], Bmi2Masks[idxDim][idxWord])) << (64*idxWord));
+            }
+        }
+        return static_cast<IndexType>(index);
+    }
+
+    __attribute__((target("bmi2")))
+    static CoordType DecodeBmi2Impl(const IndexType inIndex){
+        const UIndexType index = static_cast<UIndexType>(inIndex);
+        CoordType boxPos;
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            std::uint64_t coord = 0;
+            for(long int idxWord = 0 ; idxWord < NbWords ; ++idxWord){
+                coord |= (_pext_u64(static_cast<std::uint64_t>(index >> (64*idxWord)), Bmi2Masks[idxDim][idxWord]) << Bmi2Shifts[idxDim][idxWord]);
+            }
+            boxPos[idxDim] = static_cast<long int>(coord);
+        }
+        return boxPos;
+    }
+#elif defined(TBF_MORTON_BMI2_STATIC)
+    static IndexType EncodeBmi2Impl(const CoordType& inBoxPos){
+        UIndexType index = 0;
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            const std::uint64_t coord = static_cast<std::uint64_t>(inBoxPos[idxDim]);
+            for(long int idxWord = 0 ; idxWord < NbWords ; ++idxWord){
+                index |= (static_cast<UIndexType>(_pdep_u64(coord >> Bmi2Shifts[idxDim][idxWord], Bmi2Masks[idxDim][idxWord])) << (64*idxWord));
+            }
+        }
+        return static_cast<IndexType>(index);
+    }
+
+    static CoordType DecodeBmi2Impl(const IndexType inIndex){
+        const UIndexType index = static_cast<UIndexType>(inIndex);
+        CoordType boxPos;
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            std::uint64_t coord = 0;
+            for(long int idxWord = 0 ; idxWord < NbWords ; ++idxWord){
+                coord |= (_pext_u64(static_cast<std::uint64_t>(index >> (64*idxWord)), Bmi2Masks[idxDim][idxWord]) << Bmi2Shifts[idxDim][idxWord]);
+            }
+            boxPos[idxDim] = static_cast<long int>(coord);
+        }
+        return boxPos;
+    }
+#endif
+
+public:
+    enum class Method {
+        Loop,
+        Table,
+        Bmi2
+    };
+
+    static bool HasBmi2(){
+#if defined(TBF_MORTON_BMI2_STATIC)
+        return CanUseBmi2;
+#elif defined(TBF_MORTON_BMI2_DYNAMIC)
+        static const bool cpuHasBmi2 = __builtin_cpu_supports("bmi2");
+        return CanUseBmi2 && cpuHasBmi2;
+#else
+        return false;
+#endif
+    }
+
+    // The method used by Encode/Decode
+    static Method GetBestMethod(){
+        if(HasBmi2()){
+            return Method::Bmi2;
+        }
+        return (UseTable ? Method::Table : Method::Loop);
+    }
+
+    static const char* GetMethodName(const Method inMethod){
+        switch(inMethod){
+        case Method::Bmi2 : return "bmi2";
+        case Method::Table : return "table";
+        default : return "loop";
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    static IndexType EncodeLoop(const CoordType& inBoxPos){
+        IndexType index = 0x0LL;
+        IndexType mask = 0x1LL;
+
+        bool shouldContinue = false;
+
+        std::array<IndexType,Dim> mcoord;
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            mcoord[idxDim] = (static_cast<IndexType>(inBoxPos[idxDim]) << (Dim - idxDim - 1));
+            shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
+        }
+
+        while(shouldContinue){
+            shouldContinue = false;
+            for(long int idxDim = Dim-1 ; idxDim >= 0 ; --idxDim){
+                index |= (mcoord[idxDim] & mask);
+                mask <<= 1;
+                mcoord[idxDim] <<= (Dim-1);
+                shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
+            }
+        }
+
+        return index;
+    }
+
+    static CoordType DecodeLoop(IndexType inIndex){
+        IndexType mask = 0x1LL;
+
+        CoordType boxPos;
+
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            boxPos[idxDim] = 0;
+        }
+
+        while(inIndex >= mask) {
+            for(long int idxDim = Dim-1 ; idxDim > 0 ; --idxDim){
+                boxPos[idxDim] |= static_cast<long int>(inIndex & mask);
+                inIndex >>= 1;
+            }
+
+            boxPos[0] |= static_cast<long int>(inIndex & mask);
+
+            mask <<= 1;
+        }
+
+        return boxPos;
+    }
+
+    static IndexType EncodeTable(const CoordType& inBoxPos){
+        if constexpr(UseTable == false){
+            return EncodeLoop(inBoxPos);
+        }
+        else{
+            UIndexType index = 0;
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                std::uint64_t coord = static_cast<std::uint64_t>(inBoxPos[idxDim]);
+                long int shift = Dim - idxDim - 1;
+                while(coord && shift < NbBitsIndex){
+                    index |= (static_cast<UIndexType>(SpreadTable[coord & 0xFF]) << shift);
+                    coord >>= 8;
+                    shift += 8*Dim;
+                }
+            }
+            return static_cast<IndexType>(index);
+        }
+    }
+
+    static CoordType DecodeTable(const IndexType inIndex){
+        if constexpr(UseTable == false){
+            return DecodeLoop(inIndex);
+        }
+        else{
+            CoordType boxPos;
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                boxPos[idxDim] = 0;
+            }
+
+            UIndexType index = static_cast<UIndexType>(inIndex);
+            for(long int idxByte = 0 ; index ; ++idxByte){
+                const auto& compacted = CompactTable[(idxByte%Dim)*256 + static_cast<long int>(index & 0xFF)];
+                const long int shift = 8*(idxByte/Dim);
+                for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    boxPos[idxDim] |= (static_cast<long int>(compacted[idxDim]) << shift);
+                }
+                index >>= 8;
+            }
+            return boxPos;
+        }
+    }
+
+    // Must be called only if HasBmi2() is true (uses the tables otherwise)
+    static IndexType EncodeBmi2(const CoordType& inBoxPos){
+#if defined(TBF_MORTON_BMI2_STATIC) || defined(TBF_MORTON_BMI2_DYNAMIC)
+        if constexpr(CanUseBmi2){
+            return EncodeBmi2Impl(inBoxPos);
+        }
+#endif
+        return EncodeTable(inBoxPos);
+    }
+
+    static CoordType DecodeBmi2(const IndexType inIndex){
+#if defined(TBF_MORTON_BMI2_STATIC) || defined(TBF_MORTON_BMI2_DYNAMIC)
+        if constexpr(CanUseBmi2){
+            return DecodeBmi2Impl(inIndex);
+        }
+#endif
+        return DecodeTable(inIndex);
+    }
+
+    /////////////////////////////////////////////////////////////////////////////////////////
+
+    static IndexType Encode(const CoordType& inBoxPos){
+        if constexpr(Dim == 1){
+            return static_cast<IndexType>(inBoxPos[0]);
+        }
+#if defined(TBF_MORTON_BMI2_STATIC)
+        if constexpr(CanUseBmi2){
+            return EncodeBmi2Impl(inBoxPos);
+        }
+#elif defined(TBF_MORTON_BMI2_DYNAMIC)
+        if constexpr(CanUseBmi2){
+            if(HasBmi2()){
+                return EncodeBmi2Impl(inBoxPos);
+            }
+        }
+#endif
+        return EncodeTable(inBoxPos);
+    }
+
+    static CoordType Decode(const IndexType inIndex){
+        if constexpr(Dim == 1){
+            return CoordType{{static_cast<long int>(inIndex)}};
+        }
+#if defined(TBF_MORTON_BMI2_STATIC)
+        if constexpr(CanUseBmi2){
+            return DecodeBmi2Impl(inIndex);
+        }
+#elif defined(TBF_MORTON_BMI2_DYNAMIC)
+        if constexpr(CanUseBmi2){
+            if(HasBmi2()){
+                return DecodeBmi2Impl(inIndex);
+            }
+        }
+#endif
+        return DecodeTable(inIndex);
+    }
+
+    // Encode inNbItems coordinates
+    static void EncodeArray(const CoordType inBoxPos[], const long int inNbItems, IndexType outIndexes[]){
+#if defined(TBF_MORTON_BMI2_DYNAMIC)
+        if constexpr(CanUseBmi2 && Dim > 1){
+            if(HasBmi2()){
+                for(long int idxItem = 0 ; idxItem < inNbItems ; ++idxItem){
+                    outIndexes[idxItem] = EncodeBmi2Impl(inBoxPos[idxItem]);
+                }
+                return;
+            }
+        }
+#endif
+        for(long int idxItem = 0 ; idxItem < inNbItems ; ++idxItem){
+            outIndexes[idxItem] = Encode(inBoxPos[idxItem]);
+        }
+    }
+};
+
+#endif
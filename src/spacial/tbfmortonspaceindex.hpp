@@ -5,17 +5,20 @@
 
 #include "utils/tbfutils.hpp"
 #include "core/tbfinteraction.hpp"
+#include "spacial/tbfmortoncoder.hpp"
+#include "utils/tbfindextype.hpp"
 
 #include <vector>
 #include <array>
 #include <cassert>
+#include <algorithm>
 
-template <long int Dim_T, class ConfigurationClass_T, const bool IsPeriodic_v = false>
+template <long int Dim_T, class ConfigurationClass_T, const bool IsPeriodic_v = false, class IndexType_T = long int>
 class TbfMortonSpaceIndex{
 public:
     static_assert (Dim_T > 0, "Dimension must be greater than 0" );
 
-    using IndexType = long int;
+    using IndexType = IndexType_T;
     using ConfigurationClass = ConfigurationClass_T;
     using RealType = typename ConfigurationClass::RealType;
 
@@ -23,20 +26,26 @@ public:
     static constexpr bool IsPeriodic = IsPeriodic_v;
 
 protected:
+    using CoderType = TbfMortonCoder<Dim, IndexType>;
+
     const ConfigurationClass configuration;
 
     long int getTreeCoordinate(const RealType inRelativePosition, const long int inDim) const {
         assert(inRelativePosition >= 0 && inRelativePosition <= configuration.getBoxWidths()[inDim]);
-        if(inRelativePosition == configuration.getBoxWidths()[inDim]){
-            return (1 << (configuration.getTreeHeight()-1))-1;
-        }
         const RealType indexFReal = inRelativePosition / configuration.getLeafWidths()[inDim];
-        return static_cast<long int>(indexFReal);
+        // A position on the upper border is in the last box
+        return std::min(static_cast<long int>(indexFReal), (1L << (configuration.getTreeHeight()-1))-1);
     }
 
 public:
     TbfMortonSpaceIndex(const ConfigurationClass& inConfiguration)
         : configuration(inConfiguration){
+        assert(configuration.getTreeHeight() <= getMaxTreeHeight());
+    }
+
+    // The deepest tree that can be indexed with IndexType
+    static long int constexpr getMaxTreeHeight() {
+        return TbfGetMaxTreeHeight<IndexType, Dim>();
     }
 
     IndexType getUpperBound(const long int inLevel) const{
@@ -65,6 +74,39 @@ public:
         return getIndexFromBoxPos(host);
     }
 
+    // Computes the indexes of the positions [inBegin, inEnd[ of inPositions (outIndexes[0] is the index of inPositions[inBegin]),
+    // the coordinates are computed by blocks such that the loops can be vectorized
+    template <class ContainerClass>
+    void getIndexesFromPositions(const ContainerClass& inPositions, const long int inBegin, const long int inEnd,
+                                 IndexType outIndexes[]) const {
+        constexpr long int BlockSize = 256;
+        std::array<std::array<long int,BlockSize>,Dim> boxCoordinates;
+
+        const long int lastBoxCoordinate = (1L << (configuration.getTreeHeight()-1))-1;
+
+        for(long int idxBlock = inBegin ; idxBlock < inEnd ; idxBlock += BlockSize){
+            const long int nbItems = std::min(BlockSize, inEnd - idxBlock);
+
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                const RealType boxCorner = configuration.getBoxCorner()[idxDim];
+                const RealType leafWidth = configuration.getLeafWidths()[idxDim];
+                for(long int idxItem = 0 ; idxItem < nbItems ; ++idxItem){
+                    const RealType relativePosition = inPositions[idxBlock + idxItem][idxDim] - boxCorner;
+                    assert(relativePosition >= 0 && relativePosition <= configuration.getBoxWidths()[idxDim]);
+                    boxCoordinates[idxDim][idxItem] = std::min(static_cast<long int>(relativePosition / leafWidth), lastBoxCoordinate);
+                }
+            }
+
+            for(long int idxItem = 0 ; idxItem < nbItems ; ++idxItem){
+                std::array<long int,Dim> boxPos;
+                for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    boxPos[idxDim] = boxCoordinates[idxDim][idxItem];
+                }
+                outIndexes[idxBlock - inBegin + idxItem] = CoderType::Encode(boxPos);
+            }
+        }
+    }
+
     std::array<RealType,Dim> getRealPosFromBoxPos(const std::array<long int,Dim>& inPos) const {
         const std::array<RealType,Dim> boxCorner(configuration.getBoxCenter(),-(configuration.getBoxWidths()/2));
 
@@ -77,27 +119,8 @@ public:
         return host;
     }
 
-    std::array<long int,Dim> getBoxPosFromIndex(IndexType inMindex) const{
-        IndexType mask = 0x1LL;
-
-        std::array<long int,Dim> boxPos;
-
-        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
-            boxPos[idxDim] = 0;
-        }
-
-        while(inMindex >= mask) {
-            for(long int idxDim = Dim-1 ; idxDim > 0 ; --idxDim){
-                boxPos[idxDim] |= static_cast<long int>(inMindex & mask);
-                inMindex >>= 1;
-            }
-
-            boxPos[0] |= static_cast<long int>(inMindex & mask);
-
-            mask <<= 1;
-        }
-
-        return boxPos;
+    std::array<long int,Dim> getBoxPosFromIndex(const IndexType inMindex) const{
+        return CoderType::Decode(inMindex);
     }
 
     IndexType getParentIndex(IndexType inIndex) const{
@@ -105,7 +128,7 @@ public:
     }
 
     long int childPositionFromParent(const IndexType inIndexChild) const {
-        return inIndexChild & static_cast<long int>(~(((~0UL)>>Dim)<<Dim));
+        return static_cast<long int>(inIndexChild & IndexType((1L << Dim)-1));
     }
 
     const auto& getConfiguration() const{
@@ -113,28 +136,7 @@ public:
     }
 
     IndexType getIndexFromBoxPos(const std::array<long int,Dim>& inBoxPos) const{
-        IndexType index = 0x0LL;
-        IndexType mask = 0x1LL;
-
-        bool shouldContinue = false;
-
-        std::array<IndexType,Dim> mcoord;
-        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
-            mcoord[idxDim] = (inBoxPos[idxDim] << (Dim - idxDim - 1));
-            shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
-        }
-
-        while(shouldContinue){
-            shouldContinue = false;
-            for(long int idxDim = Dim-1 ; idxDim >= 0 ; --idxDim){
-                index |= (mcoord[idxDim] & mask);
-                mask <<= 1;
-                mcoord[idxDim] <<= (Dim-1);
-                shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
-            }
-        }
-
-        return index;
+        return CoderType::Encode(inBoxPos);
     }
 
     IndexType getChildIndexFromParent(const IndexType inParentIndex, const long int inChild) const{
@@ -155,8 +157,8 @@ public:
             }
         }
 
-        const long int boxLimite = (1 << (inLevel));
-        const long int boxLimiteParent = (1 << (inLevel-1));
+        const long int boxLimite = (1L << (inLevel));
+        const long int boxLimiteParent = (1L << (inLevel-1));
 
         const IndexType cellIndex = inMIndex;
         const auto cellPos = getBoxPosFromIndex(cellIndex);
@@ -260,7 +262,7 @@ public:
 
 
         if constexpr(IsPeriodic){
-            assert(std::size(indexes) == getNbInteractionsPerCell());
+            assert(static_cast<long int>(std::size(indexes)) == getNbInteractionsPerCell());
         }
 
         return indexes;
@@ -287,8 +289,8 @@ public:
             }
         }
 
-        const long int boxLimite = (1 << (inLevel));
-        const long int boxLimiteParent = (1 << (inLevel-1));
+        const long int boxLimite = (1L << (inLevel));
+        const long int boxLimiteParent = (1L << (inLevel-1));
 
         for(long int idxCell = 0 ; idxCell < inGroup.getNbCells() ; ++idxCell){
             const IndexType cellIndex = inGroup.getCellSpacialIndex(idxCell);
@@ -413,7 +415,7 @@ public:
 
     auto getNeighborListForIndex(const IndexType cellIndex, const long int inLevel, const bool upperExclusion = false) const{
         assert(inLevel >= 0);
-        const long int boxLimite = (1 << (inLevel));
+        const long int boxLimite = (1L << (inLevel));
 
         std::vector<IndexType> indexes;
         indexes.reserve(TbfUtils::lipow(3,Dim)/2);
@@ -501,7 +503,7 @@ public:
         }
 
         if constexpr(IsPeriodic){
-            assert(std::size(indexes) == getNbNeighborsPerLeaf());
+            assert(static_cast<long int>(std::size(indexes)) == getNbNeighborsPerLeaf());
         }
 
         return indexes;
@@ -510,7 +512,7 @@ public:
     template <class GroupClass>
     auto getNeighborListForBlock(const GroupClass& inGroup, const long int inLevel, const bool upperExclusion = false, const bool testSelfInclusion = true) const{
         assert(inLevel >= 0);
-        const long int boxLimite = (1 << (inLevel));
+        const long int boxLimite = (1L << (inLevel));
 
         std::vector<TbfXtoXInteraction<IndexType>> indexesInternal;
         indexesInternal.reserve(inGroup.getNbLeaves());
@@ -2,17 +2,17 @@
 #define TBFGLOBAL_HPP
 
 
-template <long int Dim_T, class ConfigurationClass_T, const bool IsPeriodic_v>
+template <long int Dim_T, class ConfigurationClass_T, const bool IsPeriodic_v, class IndexType_T>
 class TbfMortonSpaceIndex;
 
 template <class RealType_T, long int Dim_T = 3>
 class TbfSpacialConfiguration;
 
 template <class RealType>
-using TbfDefaultSpaceIndexType = TbfMortonSpaceIndex<3, TbfSpacialConfiguration<RealType, 3>, false>;
+using TbfDefaultSpaceIndexType = TbfMortonSpaceIndex<3, TbfSpacialConfiguration<RealType, 3>, false, long int>;
 
 template <class RealType>
-using TbfDefaultSpaceIndexTypePeriodic = TbfMortonSpaceIndex<3, TbfSpacialConfiguration<RealType, 3>, true>;
+using TbfDefaultSpaceIndexTypePeriodic = TbfMortonSpaceIndex<3, TbfSpacialConfiguration<RealType, 3>, true, long int>;
 
 constexpr static long int TbfDefaultMemoryAlignement = 64;
 
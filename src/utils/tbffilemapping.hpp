@@ -0,0 +1,67 @@
+#ifndef TBFFILEMAPPING_HPP
+#define TBFFILEMAPPING_HPP
+
+#include "tbfglobal.hpp"
+
+#include <string>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Maps a file in memory (private mapping, the modifications are not written to the file)
+class TbfFileMapping {
+    unsigned char* mappedPtr;
+    long int mappedSizeInByte;
+
+public:
+    explicit TbfFileMapping(const std::string& inFilename)
+        : mappedPtr(nullptr), mappedSizeInByte(0){
+        const int fileDescriptor = open(inFilename.c_str(), O_RDONLY);
+        if(fileDescriptor == -1){
+            return;
+        }
+
+        struct stat fileStat;
+        if(fstat(fileDescriptor, &fileStat) == 0 && fileStat.st_size > 0){
+            void* ptr = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0);
+            if(ptr != MAP_FAILED){
+                mappedPtr = static_cast<unsigned char*>(ptr);
+                mappedSizeInByte = static_cast<long int>(fileStat.st_size);
+            }
+        }
+
+        close(fileDescriptor);
+    }
+
+    ~TbfFileMapping(){
+        if(mappedPtr){
+            munmap(mappedPtr, static_cast<size_t>(mappedSizeInByte));
+        }
+    }
+
+    TbfFileMapping(const TbfFileMapping&) = delete;
+    TbfFileMapping& operator=(const TbfFileMapping&) = delete;
+
+    TbfFileMapping(TbfFileMapping&&) = delete;
+    TbfFileMapping& operator=(TbfFileMapping&&) = delete;
+
+    bool isMapped() const{
+        return mappedPtr != nullptr;
+    }
+
+    unsigned char* getPtr(){
+        return mappedPtr;
+    }
+
+    const unsigned char* getPtr() const{
+        return mappedPtr;
+    }
+
+    long int getSizeInByte() const{
+        return mappedSizeInByte;
+    }
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef TBFINDEXTYPE_HPP
+#define TBFINDEXTYPE_HPP
+
+#include "tbfglobal.hpp"
+
+#include <type_traits>
+#include <algorithm>
+
+#if defined(__SIZEOF_INT128__)
+#define TBF_USE_INT128
+// __extension__ is needed to use __int128 with -pedantic
+__extension__ typedef unsigned __int128 TbfUInt128;
+#endif
+
+// The properties of the types that can be used for the space indexes.
+// Any integer type can be used, and TbfUInt128 if the compiler supports it
+// (the std traits are not specialized for __int128 in strict ISO mode).
+template <class IndexType_T, class Enable = void>
+struct TbfIndexTypeTraits;
+
+template <class IndexType_T>
+struct TbfIndexTypeTraits<IndexType_T, typename std::enable_if<std::is_integral<IndexType_T>::value>::type>{
+    using IndexType = IndexType_T;
+    using UnsignedType = typename std::make_unsigned<IndexType>::type;
+
+    static constexpr long int NbBits = static_cast<long int>(sizeof(IndexType)*8);
+    // The sign bit cannot be used
+    static constexpr long int NbUsableBits = (std::is_signed<IndexType>::value ? NbBits-1 : NbBits);
+};
+
+#if defined(TBF_USE_INT128)
+template <>
+struct TbfIndexTypeTraits<TbfUInt128>{
+    using IndexType = TbfUInt128;
+    using UnsignedType = TbfUInt128;
+
+    static constexpr long int NbBits = 128;
+    static constexpr long int NbUsableBits = 128;
+};
+#endif
+
+// The maximum height of a tree for a given dimension and index type, such that the upper bound
+// of the leaf level (1 << (Dim*(height-1))) can be represented.
+// The box coordinates are stored in long int (so a level cannot have more than 2^62 boxes per dimension).
+template <class IndexType, long int Dim>
+constexpr long int TbfGetMaxTreeHeight(){
+    return std::min((TbfIndexTypeTraits<IndexType>::NbUsableBits-1)/Dim, 62L) + 1;
+}
+
+#endif
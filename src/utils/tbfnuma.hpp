@@ -0,0 +1,140 @@
+#ifndef TBFNUMA_HPP
+#define TBFNUMA_HPP
+
+#include "tbfglobal.hpp"
+
+#include <fstream>
+#include <string>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <sched.h>
+#include <linux/mempolicy.h>
+#endif
+
+// Small helpers to place the memory on the NUMA nodes (Linux only, there is
+// a single node otherwise). The system calls are used directly such that
+// there is no dependency to libnuma.
+namespace TbfNuma {
+
+inline int GetNbNodes(){
+#ifdef __linux__
+    // The file contains the list of the online nodes, like "0-1,3"
+    std::ifstream onlineFile("/sys/devices/system/node/online");
+    std::string onlineNodes;
+    if(!(onlineFile >> onlineNodes)){
+        return 1;
+    }
+    int maxNode = 0;
+    std::string currentNumber;
+    for(const char character : onlineNodes + ","){
+        if('0' <= character && character <= '9'){
+            currentNumber += character;
+        }
+        else if(currentNumber.size()){
+            maxNode = std::max(maxNode, std::stoi(currentNumber));
+            currentNumber.clear();
+        }
+    }
+    return maxNode + 1;
+#else
+    return 1;
+#endif
+}
+
+// The node of the item inIdxItem of inNbItems, when the items are distributed
+// on the nodes by contiguous intervals (as the groups along the space filling curve)
+inline int GetNodeOfPosition(const long int inIdxItem, const long int inNbItems, const int inNbNodes){
+    if(inNbNodes <= 1 || inNbItems <= 0){
+        return 0;
+    }
+    return static_cast<int>(std::min(static_cast<long int>(inNbNodes) - 1, (inIdxItem * inNbNodes) / inNbItems));
+}
+
+// The node of the CPU that executes the calling thread
+inline int GetCurrentNode(){
+#ifdef __linux__
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if(syscall(SYS_getcpu, &cpu, &node, nullptr) == 0){
+        return static_cast<int>(node);
+    }
+#endif
+    return 0;
+}
+
+// The node where the page that contains inPtr is, -1 if unknown
+inline int GetNodeOfAddress(const void* inPtr){
+#ifdef __linux__
+    int node = -1;
+    if(inPtr && syscall(SYS_get_mempolicy, &node, nullptr, 0, inPtr, MPOL_F_NODE | MPOL_F_ADDR) == 0){
+        return node;
+    }
+    return -1;
+#else
+    return (inPtr ? 0 : -1);
+#endif
+}
+
+// The pages of [inPtr, inPtr+inSizeInByte[ (inPtr must be aligned on the page size) will be
+// allocated on inNode when they are touched, returns false if the system refused
+inline bool SetPreferredNode(void* inPtr, const long int inSizeInByte, const int inNode){
+#ifdef __linux__
+    constexpr long int NbBitsPerMask = static_cast<long int>(sizeof(unsigned long) * 8);
+    if(inNode < 0 || inNode >= 16 * NbBitsPerMask){
+        return false;
+    }
+    unsigned long nodeMask[16] = {};
+    nodeMask[inNode / NbBitsPerMask] = (1UL << (inNode % NbBitsPerMask));
+    return syscall(SYS_mbind, inPtr, static_cast<unsigned long>(inSizeInByte), MPOL_PREFERRED,
+                   nodeMask, static_cast<unsigned long>(16 * NbBitsPerMask), 0) == 0;
+#else
+    (void)inPtr;
+    (void)inSizeInByte;
+    (void)inNode;
+    return false;
+#endif
+}
+
+// The calling thread is bound to the CPUs of inNode, returns false if the system refused
+inline bool BindCurrentThreadToNode(const int inNode){
+#ifdef __linux__
+    // The file contains the list of the CPUs of the node, like "0-7,16-23"
+    std::ifstream cpuListFile("/sys/devices/system/node/node" + std::to_string(inNode) + "/cpulist");
+    std::string cpuList;
+    if(inNode < 0 || !(cpuListFile >> cpuList)){
+        return false;
+    }
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    int firstCpu = -1;
+    std::string currentNumber;
+    for(const char character : cpuList + ","){
+        if('0' <= character && character <= '9'){
+            currentNumber += character;
+        }
+        else if(character == '-'){
+            firstCpu = std::stoi(currentNumber);
+            currentNumber.clear();
+        }
+        else if(currentNumber.size()){
+            const int lastCpu = std::stoi(currentNumber);
+            for(int idxCpu = (firstCpu == -1 ? lastCpu : firstCpu) ; idxCpu <= lastCpu && idxCpu < CPU_SETSIZE ; ++idxCpu){
+                CPU_SET(idxCpu, &cpuSet);
+            }
+            firstCpu = -1;
+            currentNumber.clear();
+        }
+    }
+    return CPU_COUNT(&cpuSet) != 0 && sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0;
+#else
+    (void)inNode;
+    return false;
+#endif
+}
+
+}
+
+#endif
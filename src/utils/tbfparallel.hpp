@@ -0,0 +1,156 @@
+#ifndef TBFPARALLEL_HPP
+#define TBFPARALLEL_HPP
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <exception>
+#include <cassert>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Small helpers to parallelize the tree construction.
+// OpenMP is used when available, std::thread otherwise.
+// The work is always cut in contiguous chunks (static scheduling)
+// such that the results do not depend on the number of threads.
+namespace TbfParallel {
+
+inline int GetNbThreads(){
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+#endif
+}
+
+inline std::pair<long int, long int> GetChunkInterval(const long int inNbElements, const long int inNbChunks,
+                                                      const long int inIdxChunk){
+    const long int chunkSize = inNbElements/inNbChunks;
+    const long int nbBigChunks = inNbElements%inNbChunks;
+    const long int chunkBegin = inIdxChunk*chunkSize + std::min(inIdxChunk, nbBigChunks);
+    const long int chunkEnd = chunkBegin + chunkSize + (inIdxChunk < nbBigChunks ? 1 : 0);
+    return std::make_pair(chunkBegin, chunkEnd);
+}
+
+// Calls inFunc(idxChunk, chunkBegin, chunkEnd) on inNbChunks contiguous intervals
+// that cover [0, inNbElements[, the chunks are proceeded in parallel.
+template <class FuncType>
+inline void ForEachChunk(const long int inNbElements, const long int inNbChunks, FuncType&& inFunc){
+    assert(inNbChunks >= 1);
+    if(inNbChunks == 1){
+        inFunc(0L, 0L, inNbElements);
+        return;
+    }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(static_cast<int>(inNbChunks)) schedule(static, 1)
+    for(long int idxChunk = 0 ; idxChunk < inNbChunks ; ++idxChunk){
+        const auto interval = GetChunkInterval(inNbElements, inNbChunks, idxChunk);
+        inFunc(idxChunk, interval.first, interval.second);
+    }
+#else
+    std::vector<std::thread> threads;
+    threads.reserve(inNbChunks-1);
+    for(long int idxChunk = 1 ; idxChunk < inNbChunks ; ++idxChunk){
+        threads.emplace_back([&inFunc, inNbElements, inNbChunks, idxChunk](){
+            const auto interval = GetChunkInterval(inNbElements, inNbChunks, idxChunk);
+            inFunc(idxChunk, interval.first, interval.second);
+        });
+    }
+    {
+        const auto interval = GetChunkInterval(inNbElements, inNbChunks, 0);
+        inFunc(0L, interval.first, interval.second);
+    }
+    for(auto& thread : threads){
+        thread.join();
+    }
+#endif
+}
+
+inline long int GetNbChunks(const long int inNbElements, const int inNbThreads, const long int inMinElementsPerChunk = 1){
+    return std::max(1L, std::min(static_cast<long int>(inNbThreads), inNbElements/std::max(1L, inMinElementsPerChunk)));
+}
+
+// Calls inFunc(idx) for all idx in [inBegin, inEnd[
+template <class FuncType>
+inline void ParallelFor(const long int inBegin, const long int inEnd, const int inNbThreads, FuncType&& inFunc){
+    const long int nbElements = inEnd - inBegin;
+    if(nbElements <= 0){
+        return;
+    }
+    ForEachChunk(nbElements, GetNbChunks(nbElements, inNbThreads), [&](const long int /*idxChunk*/, const long int inChunkBegin, const long int inChunkEnd){
+        for(long int idx = inChunkBegin ; idx < inChunkEnd ; ++idx){
+            inFunc(inBegin + idx);
+        }
+    });
+}
+
+// Calls inBackgroundFunc in a separate thread while the current thread calls inFunc.
+// The thread is joined before returning, even if inFunc throws, and an exception
+// thrown by inBackgroundFunc is propagated once the thread has been joined.
+template <class BackgroundFuncType, class FuncType>
+inline void RunConcurrently(BackgroundFuncType&& inBackgroundFunc, FuncType&& inFunc){
+    std::exception_ptr backgroundException;
+    std::thread backgroundThread([&inBackgroundFunc, &backgroundException](){
+        try{
+            inBackgroundFunc();
+        }
+        catch(...){
+            backgroundException = std::current_exception();
+        }
+    });
+
+    {
+        struct ThreadJoiner{
+            std::thread& thread;
+            ~ThreadJoiner(){
+                thread.join();
+            }
+        } joiner{backgroundThread};
+
+        inFunc();
+    }
+
+    if(backgroundException){
+        std::rethrow_exception(backgroundException);
+    }
+}
+
+// Sort each chunk in parallel and merge them pair by pair.
+// The comparison must define a strict total order for the result
+// to be independent of the number of threads.
+template <class IteratorType, class CompareType>
+inline void Sort(IteratorType inBegin, IteratorType inEnd, CompareType&& inComp, const int inNbThreads){
+    const long int nbElements = static_cast<long int>(std::distance(inBegin, inEnd));
+    const long int nbChunks = GetNbChunks(nbElements, inNbThreads, 4096);
+
+    if(nbChunks == 1){
+        std::sort(inBegin, inEnd, inComp);
+        return;
+    }
+
+    ForEachChunk(nbElements, nbChunks, [&](const long int /*idxChunk*/, const long int inChunkBegin, const long int inChunkEnd){
+        std::sort(inBegin + inChunkBegin, inBegin + inChunkEnd, inComp);
+    });
+
+    for(long int mergeStep = 1 ; mergeStep < nbChunks ; mergeStep *= 2){
+        const long int nbMerges = (nbChunks + 2*mergeStep - 1)/(2*mergeStep);
+        ParallelFor(0, nbMerges, inNbThreads, [&](const long int idxMerge){
+            const long int firstChunk = idxMerge*2*mergeStep;
+            const long int middleChunk = std::min(firstChunk + mergeStep, nbChunks);
+            const long int lastChunk = std::min(firstChunk + 2*mergeStep, nbChunks);
+            if(middleChunk != lastChunk){
+                std::inplace_merge(inBegin + GetChunkInterval(nbElements, nbChunks, firstChunk).first,
+                                   inBegin + GetChunkInterval(nbElements, nbChunks, middleChunk).first,
+                                   inBegin + GetChunkInterval(nbElements, nbChunks, lastChunk-1).second,
+                                   inComp);
+            }
+        });
+    }
+}
+
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <sstream>
 #include <iostream>
 #include <cstring>
+#include <memory>
 #include <vector>
 
 namespace TbfParams{
@@ -0,0 +1,102 @@
+#ifndef TBFRADIXSORT_HPP
+#define TBFRADIXSORT_HPP
+
+#include "utils/tbfparallel.hpp"
+
+#include <vector>
+#include <cassert>
+
+// LSD radix sort on the first member of a pair (or any structure with a
+// "first" integer member). Only the bits needed to represent inUpperBound-1
+// are processed, and the sort is stable (the relative order of elements
+// with equal keys is kept).
+namespace TbfRadixSort {
+
+template <class KeyType>
+inline long int GetNbSignificantBits(const KeyType inUpperBound){
+    long int nbBits = 0;
+    KeyType maxKey = inUpperBound - 1;
+    while(maxKey > 0){
+        maxKey >>= 1;
+        nbBits += 1;
+    }
+    return nbBits;
+}
+
+inline long int GetNbPasses(const long int inNbBits, const long int inMaxBitsPerPass = 11){
+    return (inNbBits + inMaxBitsPerPass - 1)/inMaxBitsPerPass;
+}
+
+template <class ElementType, class KeyType>
+inline void SortPairs(std::vector<ElementType>& inOutElements, const KeyType inUpperBound, const int inNbThreads){
+    const long int nbElements = static_cast<long int>(inOutElements.size());
+    const long int nbBits = GetNbSignificantBits(inUpperBound);
+    const long int nbPasses = GetNbPasses(nbBits);
+
+    if(nbElements <= 1 || nbPasses == 0){
+        return;
+    }
+
+    // Balance the number of bits between the passes
+    const long int nbBitsPerPass = (nbBits + nbPasses - 1)/nbPasses;
+    const long int nbBuckets = (1L << nbBitsPerPass);
+    const long int nbChunks = TbfParallel::GetNbChunks(nbElements, inNbThreads, 16384);
+
+    std::vector<ElementType> buffer(nbElements);
+    std::vector<long int> histograms(nbChunks*nbBuckets);
+
+    std::vector<ElementType>* src = &inOutElements;
+    std::vector<ElementType>* dest = &buffer;
+
+    for(long int idxPass = 0 ; idxPass < nbPasses ; ++idxPass){
+        const long int shift = idxPass*nbBitsPerPass;
+        const KeyType mask = KeyType(nbBuckets-1);
+
+        TbfParallel::ForEachChunk(nbElements, nbChunks, [&](const long int inIdxChunk, const long int inChunkBegin, const long int inChunkEnd){
+            long int* histogram = &histograms[inIdxChunk*nbBuckets];
+            std::fill(histogram, histogram + nbBuckets, 0);
+            for(long int idxElement = inChunkBegin ; idxElement < inChunkEnd ; ++idxElement){
+                histogram[static_cast<long int>(((*src)[idxElement].first >> shift) & mask)] += 1;
+            }
+        });
+
+        // Convert to offsets, the chunks are ordered inside each bucket to keep the sort stable
+        long int offset = 0;
+        bool singleBucket = false;
+        for(long int idxBucket = 0 ; idxBucket < nbBuckets ; ++idxBucket){
+            const long int bucketStart = offset;
+            for(long int idxChunk = 0 ; idxChunk < nbChunks ; ++idxChunk){
+                const long int nbInBucket = histograms[idxChunk*nbBuckets + idxBucket];
+                histograms[idxChunk*nbBuckets + idxBucket] = offset;
+                offset += nbInBucket;
+            }
+            if(offset - bucketStart == nbElements){
+                singleBucket = true;
+            }
+        }
+
+        // All the keys have the same digit, there is nothing to do for this pass
+        if(singleBucket){
+            continue;
+        }
+
+        TbfParallel::ForEachChunk(nbElements, nbChunks, [&](const long int inIdxChunk, const long int inChunkBegin, const long int inChunkEnd){
+            long int* offsets = &histograms[inIdxChunk*nbBuckets];
+            for(long int idxElement = inChunkBegin ; idxElement < inChunkEnd ; ++idxElement){
+                const long int idxBucket = static_cast<long int>(((*src)[idxElement].first >> shift) & mask);
+                (*dest)[offsets[idxBucket]] = (*src)[idxElement];
+                offsets[idxBucket] += 1;
+            }
+        });
+
+        std::swap(src, dest);
+    }
+
+    if(src != &inOutElements){
+        inOutElements.swap(buffer);
+    }
+}
+
+}
+
+#endif
@@ -202,6 +202,23 @@ constexpr long int lower_bound_indexes(long int first, const long int last, cons
 }
 
 
+// The symbolic data of the leaves of an adaptive tree contain their level
+template <class SymbolicDataType>
+inline auto GetLevelOrDefaultCore(const SymbolicDataType& inSymbData, const long int /*inDefaultLevel*/, int)
+        -> decltype(static_cast<long int>(inSymbData.level)){
+    return static_cast<long int>(inSymbData.level);
+}
+
+template <class SymbolicDataType>
+inline long int GetLevelOrDefaultCore(const SymbolicDataType& /*inSymbData*/, const long int inDefaultLevel, long){
+    return inDefaultLevel;
+}
+
+template <class SymbolicDataType>
+inline long int GetLevelOrDefault(const SymbolicDataType& inSymbData, const long int inDefaultLevel){
+    return GetLevelOrDefaultCore(inSymbData, inDefaultLevel, 0);
+}
+
 template <typename T, std::size_t...Is>
 constexpr std::array<T, sizeof...(Is)>
 make_array_core(const T& value, std::index_sequence<Is...>)
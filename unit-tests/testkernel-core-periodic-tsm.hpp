@@ -15,6 +15,10 @@
 #include "algorithms/periodic/tbfalgorithmperiodictoptreetsm.hpp"
 #include "utils/tbftimer.hpp"
 
+#include <cstdio>
+#include <string>
+#include <filesystem>
+
 
 template <class AlgorithmClassTsm>
 class TestTestKernelPeriodicTsm : public UTester< TestTestKernelPeriodicTsm<AlgorithmClassTsm> > {
@@ -22,7 +26,8 @@ class TestTestKernelPeriodicTsm : public UTester< TestTestKernelPeriodicTsm<Algo
     using RealType = typename AlgorithmClassTsm::RealType;
 
     void CorePart(const long int NbParticles, const long int NbElementsPerBlock,
-                  const bool OneGroupPerParent, const long int TreeHeight){
+                  const bool OneGroupPerParent, const long int TreeHeight,
+                  const bool ExecuteConcurrently, const bool UseLocalReducer, const bool UseFarFieldOperator){
         const int Dim = 3;
 
         /////////////////////////////////////////////////////////////////////////////////////////
@@ -75,14 +80,41 @@ class TestTestKernelPeriodicTsm : public UTester< TestTestKernelPeriodicTsm<Algo
             AlgorithmClassTsm algorithm(configuration, LastWorkingLevel);
             TopPeriodicAlgorithmClassTsm topAlgorithm(configuration, idxExtraLevel);
 
+            if(UseLocalReducer == false){
+                topAlgorithm.setLocalReducer(nullptr);
+            }
+
+            if(UseFarFieldOperator && idxExtraLevel >= 0){
+                const std::string filename = (std::filesystem::temp_directory_path() / "utest-testkernel-periodic-tsm.tbffarf").string();
+                std::remove(filename.c_str());
+                UASSERTETRUE(topAlgorithm.loadOrComputeFarFieldOperator(tree, filename));
+                UASSERTETRUE(topAlgorithm.hasFarFieldOperator());
+
+                TopPeriodicAlgorithmClassTsm loadedTopAlgorithm(configuration, idxExtraLevel);
+                UASSERTETRUE(loadedTopAlgorithm.loadFarFieldOperator(filename));
+                // The operator depends on the number of levels
+                TopPeriodicAlgorithmClassTsm otherTopAlgorithm(configuration, idxExtraLevel+1);
+                UASSERTETRUE(otherTopAlgorithm.loadFarFieldOperator(filename) == false);
+
+                std::remove(filename.c_str());
+            }
+
             TbfTimer timerExecute;
 
             // Bottom to top
             algorithm.execute(tree, TbfAlgorithmUtils::TbfBottomToTopStages);
-            // Periodic at the top (could be done in parallel with TbfTransferStages)
-            topAlgorithm.execute(tree);
-            // Transfer (could be done in parallel with topAlgorithm.execute)
-            algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+            if(ExecuteConcurrently){
+                // Periodic at the top in parallel with the transfer
+                topAlgorithm.executeConcurrently(tree, [&](){
+                    algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+                });
+            }
+            else{
+                // Periodic at the top
+                topAlgorithm.execute(tree);
+                // Transfer
+                algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+            }
             // Top to bottom
             algorithm.execute(tree, TbfAlgorithmUtils::TbfTopToBottomStages);
 
@@ -117,7 +149,7 @@ class TestTestKernelPeriodicTsm : public UTester< TestTestKernelPeriodicTsm<Algo
             for(const long int idxNbElementsPerBlock : std::vector<long int>{{100, 10000000}}){
                 for(const bool idxOneGroupPerParent : std::vector<bool>{{true, false}}){
                     for(long int idxTreeHeight = 2 ; idxTreeHeight < 5 ; ++idxTreeHeight){
-                        CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight);
+                        CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight, false, true, false);
                     }
                 }
             }
@@ -128,7 +160,29 @@ class TestTestKernelPeriodicTsm : public UTester< TestTestKernelPeriodicTsm<Algo
             for(const long int idxNbElementsPerBlock : std::vector<long int>{{1, 100, 10000000}}){
                 for(const bool idxOneGroupPerParent : std::vector<bool>{{true, false}}){
                     const long int idxTreeHeight = 3;
-                    CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight);
+                    CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight, false, true, false);
+                }
+            }
+        }
+    }
+
+    void TestConcurrent() {
+        for(long int idxNbParticles = 1 ; idxNbParticles <= 1000 ; idxNbParticles *= 10){
+            for(const bool idxOneGroupPerParent : std::vector<bool>{{true, false}}){
+                for(long int idxTreeHeight = 2 ; idxTreeHeight < 5 ; ++idxTreeHeight){
+                    for(const bool idxUseLocalReducer : std::vector<bool>{{true, false}}){
+                        CorePart(idxNbParticles, 100, idxOneGroupPerParent, idxTreeHeight, true, idxUseLocalReducer, false);
+                    }
+                }
+            }
+        }
+    }
+
+    void TestFarFieldOperator() {
+        for(long int idxNbParticles = 1 ; idxNbParticles <= 1000 ; idxNbParticles *= 10){
+            for(long int idxTreeHeight = 2 ; idxTreeHeight < 5 ; ++idxTreeHeight){
+                for(const bool idxExecuteConcurrently : std::vector<bool>{{true, false}}){
+                    CorePart(idxNbParticles, 100, true, idxTreeHeight, idxExecuteConcurrently, true, true);
                 }
             }
         }
@@ -136,6 +190,8 @@ class TestTestKernelPeriodicTsm : public UTester< TestTestKernelPeriodicTsm<Algo
 
     void SetTests() {
         Parent::AddTest(&TestTestKernelPeriodicTsm<AlgorithmClassTsm>::TestBasic, "Basic test based on the test kernel with periodicity and tsm");
+        Parent::AddTest(&TestTestKernelPeriodicTsm<AlgorithmClassTsm>::TestConcurrent, "Test the top tree executed concurrently with the transfer and tsm");
+        Parent::AddTest(&TestTestKernelPeriodicTsm<AlgorithmClassTsm>::TestFarFieldOperator, "Test the precomputed periodic far field operator with tsm");
     }
 };
 
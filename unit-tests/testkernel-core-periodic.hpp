@@ -15,6 +15,10 @@
 #include "algorithms/periodic/tbfalgorithmperiodictoptree.hpp"
 #include "utils/tbftimer.hpp"
 
+#include <cstdio>
+#include <string>
+#include <filesystem>
+
 
 template <class AlgorithmClass>
 class TestTestKernelPeriodic : public UTester< TestTestKernelPeriodic<AlgorithmClass> > {
@@ -22,7 +26,8 @@ class TestTestKernelPeriodic : public UTester< TestTestKernelPeriodic<AlgorithmC
     using RealType = typename AlgorithmClass::RealType;
 
     void CorePart(const long int NbParticles, const long int NbElementsPerBlock,
-                  const bool OneGroupPerParent, const long int TreeHeight){
+                  const bool OneGroupPerParent, const long int TreeHeight,
+                  const bool ExecuteConcurrently, const bool UseLocalReducer, const bool UseFarFieldOperator){
         const int Dim = 3;
 
         /////////////////////////////////////////////////////////////////////////////////////////
@@ -73,14 +78,41 @@ class TestTestKernelPeriodic : public UTester< TestTestKernelPeriodic<AlgorithmC
             AlgorithmClass algorithm(configuration, LastWorkingLevel);
             TopPeriodicAlgorithmClass topAlgorithm(configuration, idxExtraLevel);
 
+            if(UseLocalReducer == false){
+                topAlgorithm.setLocalReducer(nullptr);
+            }
+
+            if(UseFarFieldOperator && idxExtraLevel >= 0){
+                const std::string filename = (std::filesystem::temp_directory_path() / "utest-testkernel-periodic.tbffarf").string();
+                std::remove(filename.c_str());
+                UASSERTETRUE(topAlgorithm.loadOrComputeFarFieldOperator(tree, filename));
+                UASSERTETRUE(topAlgorithm.hasFarFieldOperator());
+
+                TopPeriodicAlgorithmClass loadedTopAlgorithm(configuration, idxExtraLevel);
+                UASSERTETRUE(loadedTopAlgorithm.loadFarFieldOperator(filename));
+                // The operator depends on the number of levels
+                TopPeriodicAlgorithmClass otherTopAlgorithm(configuration, idxExtraLevel+1);
+                UASSERTETRUE(otherTopAlgorithm.loadFarFieldOperator(filename) == false);
+
+                std::remove(filename.c_str());
+            }
+
             TbfTimer timerExecute;
 
             // Bottom to top
             algorithm.execute(tree, TbfAlgorithmUtils::TbfBottomToTopStages);
-            // Periodic at the top (could be done in parallel with TbfTransferStages)
-            topAlgorithm.execute(tree);
-            // Transfer (could be done in parallel with topAlgorithm.execute)
-            algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+            if(ExecuteConcurrently){
+                // Periodic at the top in parallel with the transfer
+                topAlgorithm.executeConcurrently(tree, [&](){
+                    algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+                });
+            }
+            else{
+                // Periodic at the top
+                topAlgorithm.execute(tree);
+                // Transfer
+                algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+            }
             // Top to bottom
             algorithm.execute(tree, TbfAlgorithmUtils::TbfTopToBottomStages);
 
@@ -115,7 +147,7 @@ class TestTestKernelPeriodic : public UTester< TestTestKernelPeriodic<AlgorithmC
             for(const long int idxNbElementsPerBlock : std::vector<long int>{{100, 10000000}}){
                 for(const bool idxOneGroupPerParent : std::vector<bool>{{true, false}}){
                     for(long int idxTreeHeight = 2 ; idxTreeHeight < 5 ; ++idxTreeHeight){
-                        CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight);
+                        CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight, false, true, false);
                     }
                 }
             }
@@ -126,7 +158,29 @@ class TestTestKernelPeriodic : public UTester< TestTestKernelPeriodic<AlgorithmC
             for(const long int idxNbElementsPerBlock : std::vector<long int>{{1, 100, 10000000}}){
                 for(const bool idxOneGroupPerParent : std::vector<bool>{{true, false}}){
                     const long int idxTreeHeight = 3;
-                    CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight);
+                    CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight, false, true, false);
+                }
+            }
+        }
+    }
+
+    void TestConcurrent() {
+        for(long int idxNbParticles = 1 ; idxNbParticles <= 1000 ; idxNbParticles *= 10){
+            for(const bool idxOneGroupPerParent : std::vector<bool>{{true, false}}){
+                for(long int idxTreeHeight = 2 ; idxTreeHeight < 5 ; ++idxTreeHeight){
+                    for(const bool idxUseLocalReducer : std::vector<bool>{{true, false}}){
+                        CorePart(idxNbParticles, 100, idxOneGroupPerParent, idxTreeHeight, true, idxUseLocalReducer, false);
+                    }
+                }
+            }
+        }
+    }
+
+    void TestFarFieldOperator() {
+        for(long int idxNbParticles = 1 ; idxNbParticles <= 1000 ; idxNbParticles *= 10){
+            for(long int idxTreeHeight = 2 ; idxTreeHeight < 5 ; ++idxTreeHeight){
+                for(const bool idxExecuteConcurrently : std::vector<bool>{{true, false}}){
+                    CorePart(idxNbParticles, 100, true, idxTreeHeight, idxExecuteConcurrently, true, true);
                 }
             }
         }
@@ -134,6 +188,8 @@ class TestTestKernelPeriodic : public UTester< TestTestKernelPeriodic<AlgorithmC
 
     void SetTests() {
         Parent::AddTest(&TestTestKernelPeriodic<AlgorithmClass>::TestBasic, "Basic test based on the test kernel with periodicity");
+        Parent::AddTest(&TestTestKernelPeriodic<AlgorithmClass>::TestConcurrent, "Test the top tree executed concurrently with the transfer");
+        Parent::AddTest(&TestTestKernelPeriodic<AlgorithmClass>::TestFarFieldOperator, "Test the precomputed periodic far field operator");
     }
 };
 
@@ -23,7 +23,8 @@ class TestUnifKernel : public UTester< TestUnifKernel<RealType, TestAlgorithmCla
     using Parent = UTester< TestUnifKernel<RealType, TestAlgorithmClass> >;
 
     void CorePart(const long int NbParticles, const long int NbElementsPerBlock,
-                  const bool OneGroupPerParent, const long int TreeHeight){
+                  const bool OneGroupPerParent, const long int TreeHeight,
+                  const bool ExecuteConcurrently){
         const int Dim = 3;
 
         /////////////////////////////////////////////////////////////////////////////////////////
@@ -103,15 +104,32 @@ class TestUnifKernel : public UTester< TestUnifKernel<RealType, TestAlgorithmCla
             TopPeriodicAlgorithmClass topAlgorithm(configuration,
                                                    KernelClass(TopPeriodicAlgorithmClass::GenerateAboveTreeConfiguration(configuration,idxExtraLevel), &interpolator),
                                                    idxExtraLevel);
+            // Such that the M2L of the top tree can be cut
+            topAlgorithm.setLocalReducer([](LocalClass& inOutLocal, const LocalClass& inOther){
+                for(long int idx = 0 ; idx < VectorSize ; ++idx){
+                    inOutLocal.local_exp[idx] += inOther.local_exp[idx];
+                }
+                for(long int idx = 0 ; idx < TransformedVectorSize ; ++idx){
+                    inOutLocal.transformed_local_exp[idx] += inOther.transformed_local_exp[idx];
+                }
+            });
 
             TbfTimer timerExecute;
 
             // Bottom to top
             algorithm.execute(tree, TbfAlgorithmUtils::TbfBottomToTopStages);
-            // Periodic at the top (could be done in parallel with TbfTransferStages)
-            topAlgorithm.execute(tree);
-            // Transfer (could be done in parallel with topAlgorithm.execute)
-            algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+            if(ExecuteConcurrently){
+                // Periodic at the top in parallel with the transfer
+                topAlgorithm.executeConcurrently(tree, [&](){
+                    algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+                });
+            }
+            else{
+                // Periodic at the top
+                topAlgorithm.execute(tree);
+                // Transfer
+                algorithm.execute(tree, TbfAlgorithmUtils::TbfTransferStages);
+            }
             // Top to bottom
             algorithm.execute(tree, TbfAlgorithmUtils::TbfTopToBottomStages);
 
@@ -432,7 +450,9 @@ class TestUnifKernel : public UTester< TestUnifKernel<RealType, TestAlgorithmCla
         for(const long int idxNbElementsPerBlock : std::vector<long int>{{10}}){
             for(const bool idxOneGroupPerParent : std::vector<bool>{{true, false}}){
                 for(long int idxTreeHeight = 2 ; idxTreeHeight < 3 ; ++idxTreeHeight){
-                    CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight);
+                    for(const bool idxExecuteConcurrently : std::vector<bool>{{false, true}}){
+                        CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight, idxExecuteConcurrently);
+                    }
                 }
             }
         }
@@ -441,7 +461,8 @@ class TestUnifKernel : public UTester< TestUnifKernel<RealType, TestAlgorithmCla
         const long int idxNbElementsPerBlock = 10;
         const bool idxOneGroupPerParent = false;
         const long int idxTreeHeight = 2;
-        CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight);
+        CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight, false);
+        CorePart(idxNbParticles, idxNbElementsPerBlock, idxOneGroupPerParent, idxTreeHeight, true);
 #endif
     }
 
@@ -0,0 +1,201 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+#include "core/tbfadaptivetree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+#include "algorithms/sequential/tbfadaptivealgorithm.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+
+#include <vector>
+#include <array>
+#include <memory>
+
+class TestAdaptiveTree : public UTester< TestAdaptiveTree > {
+    using Parent = UTester< TestAdaptiveTree >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    // Half of the particles are in a small sphere
+    template <long int NbValues>
+    std::vector<std::array<RealType, NbValues>> generateClusteredParticles(const TbfSpacialConfiguration<RealType, Dim>& inConfiguration,
+                                                                           const long int inNbParticles){
+        TbfRandom<RealType, Dim> randomGenerator(inConfiguration.getBoxWidths());
+
+        std::vector<std::array<RealType, NbValues>> particlePositions(inNbParticles);
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            const auto pos = randomGenerator.getNewItem();
+            for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                if(idxPart%2){
+                    particlePositions[idxPart][idxDim] = pos[idxDim];
+                }
+                else{
+                    particlePositions[idxPart][idxDim] = RealType(0.3) + pos[idxDim]*RealType(0.02);
+                }
+            }
+            for(long int idxValue = Dim ; idxValue < NbValues ; ++idxValue){
+                particlePositions[idxPart][idxValue] = RealType(0.01);
+            }
+        }
+        return particlePositions;
+    }
+
+    void TestStructure() {
+        using TreeClass = TbfAdaptiveTree<RealType, RealType, Dim, long int, 1,
+                                          std::array<long int,1>, std::array<long int,1>>;
+
+        const long int NbParticles = 5000;
+        const long int TreeHeight = 8;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const TbfDefaultSpaceIndexType<RealType> spaceSystem(configuration);
+
+        const auto particlePositions = generateClusteredParticles<Dim>(configuration, NbParticles);
+
+        for(long int maxParticlesPerLeaf : {1L, 10L, 100L, NbParticles}){
+            for(long int nbElementsPerBlock : {1L, 50L, 1000L}){
+                const TreeClass tree(configuration, particlePositions, maxParticlesPerLeaf, nbElementsPerBlock);
+
+                long int nbParticlesInLeaves = 0;
+                for(long int idxLevel = 0 ; idxLevel < TreeHeight ; ++idxLevel){
+                    for(const auto& particleGroup : tree.getParticleGroupsAtLevel(idxLevel)){
+                        UASSERTETRUE(particleGroup.getNbLeaves() <= nbElementsPerBlock);
+
+                        for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                            const auto leafIndex = particleGroup.getLeafSpacialIndex(idxLeaf);
+                            UASSERTETRUE(idxLevel == TreeHeight-1 || particleGroup.getNbParticlesInLeaf(idxLeaf) <= maxParticlesPerLeaf);
+                            UASSERTETRUE(tree.getCellType(idxLevel, leafIndex) == TbfAdaptiveCellType::Leaf);
+                            UASSERTETRUE(idxLevel == 0 || tree.getCellType(idxLevel-1, spaceSystem.getParentIndex(leafIndex)) == TbfAdaptiveCellType::Internal);
+
+                            const long int* particleIndexes = particleGroup.getParticleIndexes(idxLeaf);
+                            for(long int idxPart = 0 ; idxPart < particleGroup.getNbParticlesInLeaf(idxLeaf) ; ++idxPart){
+                                auto particleIndex = spaceSystem.getIndexFromPosition(particlePositions[particleIndexes[idxPart]]);
+                                for(long int idxParentLevel = TreeHeight-1 ; idxParentLevel > idxLevel ; --idxParentLevel){
+                                    particleIndex = spaceSystem.getParentIndex(particleIndex);
+                                }
+                                UASSERTEEQUAL(particleIndex, leafIndex);
+                            }
+                            nbParticlesInLeaves += particleGroup.getNbParticlesInLeaf(idxLeaf);
+                        }
+                    }
+                }
+                UASSERTEEQUAL(nbParticlesInLeaves, NbParticles);
+
+                // An internal cell has more particles than the limit
+                tree.applyToAllCells([&](const long int inLevel, auto&& cellHeader, const auto& /*cellMultipole*/, const auto& /*cellLocal*/){
+                    if(tree.getCellType(inLevel, cellHeader.spaceIndex) == TbfAdaptiveCellType::Internal){
+                        UASSERTETRUE(maxParticlesPerLeaf < NbParticles);
+                    }
+                });
+            }
+        }
+    }
+
+    void TestTestKernel() {
+        using TreeClass = TbfAdaptiveTree<RealType, RealType, Dim, long int, 1,
+                                          std::array<long int,1>, std::array<long int,1>>;
+        using AlgorithmClass = TbfAdaptiveAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+        const long int NbParticles = 3000;
+
+        for(long int treeHeight : {1L, 3L, 8L}){
+            const TbfSpacialConfiguration<RealType, Dim> configuration(treeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+            const auto particlePositions = generateClusteredParticles<Dim>(configuration, NbParticles);
+
+            for(long int maxParticlesPerLeaf : {1L, 20L, 500L}){
+                for(long int nbElementsPerBlock : {1L, 100L}){
+                    TreeClass tree(configuration, particlePositions, maxParticlesPerLeaf, nbElementsPerBlock);
+
+                    AlgorithmClass algorithm(configuration);
+                    algorithm.execute(tree);
+
+                    // Each particle must have interacted once with all the others
+                    tree.applyToAllLeaves([this](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                                 const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                        for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                            UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+                        }
+                    });
+                }
+            }
+        }
+    }
+
+    void TestRotationKernel() {
+        const unsigned int P = 12;
+        constexpr long int NbDataValuesPerParticle = Dim+1;
+        constexpr long int NbRhsValuesPerParticle = 4;
+        constexpr long int VectorSize = ((P+2)*(P+1))/2;
+
+        using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+        using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+        using KernelClass = FRotationKernel<RealType, P>;
+        using AlgorithmClass = TbfAdaptiveAlgorithm<RealType, KernelClass>;
+        using TreeClass = TbfAdaptiveTree<RealType, RealType, NbDataValuesPerParticle, RealType, NbRhsValuesPerParticle,
+                                          MultipoleClass, LocalClass>;
+
+        const long int NbParticles = 2000;
+        const long int TreeHeight = 7;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const auto particlePositions = generateClusteredParticles<NbDataValuesPerParticle>(configuration, NbParticles);
+
+        std::array<RealType*, NbDataValuesPerParticle> particles;
+        for(auto& vec : particles){
+            vec = new RealType[NbParticles]();
+        }
+        std::array<RealType*, NbRhsValuesPerParticle> particlesRhs;
+        for(auto& vec : particlesRhs){
+            vec = new RealType[NbParticles]();
+        }
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            for(long int idxValue = 0 ; idxValue < NbDataValuesPerParticle ; ++idxValue){
+                particles[idxValue][idxPart] = particlePositions[idxPart][idxValue];
+            }
+        }
+
+        FP2PR::template GenericInner<RealType>(particles, particlesRhs, NbParticles);
+
+        for(long int maxParticlesPerLeaf : {10L, 50L}){
+            TreeClass tree(configuration, particlePositions, maxParticlesPerLeaf, 50);
+
+            std::unique_ptr<AlgorithmClass> algorithm(new AlgorithmClass(configuration));
+            algorithm->execute(tree);
+
+            std::array<TbfAccuracyChecker<RealType>, NbRhsValuesPerParticle> partcilesRhsAccuracy;
+
+            tree.applyToAllLeaves([&](auto&& leafHeader, const long int* particleIndexes,
+                                      const std::array<RealType*, NbDataValuesPerParticle> /*particleDataPtr*/,
+                                      const std::array<RealType*, NbRhsValuesPerParticle> particleRhsPtr){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                       partcilesRhsAccuracy[idxValue].addValues(particlesRhs[idxValue][particleIndexes[idxPart]],
+                                                                particleRhsPtr[idxValue][idxPart]);
+                    }
+                }
+            });
+
+            for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+               UASSERTETRUE(partcilesRhsAccuracy[idxValue].getRelativeL2Norm() < 9e-3);
+            }
+        }
+
+        for(auto& vec : particles){
+            delete[] vec;
+        }
+        for(auto& vec : particlesRhs){
+            delete[] vec;
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestAdaptiveTree::TestStructure, "Test adaptive tree structure");
+        Parent::AddTest(&TestAdaptiveTree::TestTestKernel, "Test adaptive algorithm with the test kernel");
+        Parent::AddTest(&TestAdaptiveTree::TestRotationKernel, "Test adaptive algorithm with the rotation kernel");
+    }
+};
+
+// You must do this
+TestClass(TestAdaptiveTree)
@@ -0,0 +1,152 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "containers/tbfarenaallocator.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstdint>
+
+class TestArenaAllocator : public UTester< TestArenaAllocator > {
+    using Parent = UTester< TestArenaAllocator >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+    template <class ... ItemTypes>
+    bool isAligned(const TbfMemoryBlock<ItemTypes...>& inBlock){
+        return reinterpret_cast<std::uintptr_t>(inBlock.getPtr()) % TbfMemoryBlock<ItemTypes...>::MemoryAlignementBytes == 0;
+    }
+
+    void checkResult(TreeClass& inTree, const long int inNbParticles){
+        AlgorithmClass algorithm(inTree.getSpacialConfiguration());
+        algorithm.execute(inTree);
+
+        inTree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                    const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], inNbParticles-1);
+                particleRhsPtr[0][idxPart] = 0;
+            }
+        });
+    }
+
+    void TestAllocator() {
+        {
+            // Default allocation
+            TbfMemoryBlock<TbfMemoryScalar<long int>, TbfMemoryVector<double>> block;
+            block.resetBlocksFromSizes(std::array<long int, 2>{{1, 33}});
+            UASSERTETRUE(isAligned(block));
+        }
+
+        auto allocator = std::make_shared<TbfArenaAllocator>(1024*1024);
+        UASSERTEEQUAL(allocator->getNbChunks(), 0L);
+        {
+            std::vector<TbfMemoryBlock<TbfMemoryScalar<long int>, TbfMemoryVector<double>>> blocks(100);
+            for(auto& block : blocks){
+                block.setAllocator(allocator);
+                block.resetBlocksFromSizes(std::array<long int, 2>{{1, 33}});
+                UASSERTETRUE(isAligned(block));
+                // The memory must be zero
+                auto viewer = block.getViewerForBlock<1>();
+                for(long int idx = 0 ; idx < 33 ; ++idx){
+                    UASSERTEEQUAL(viewer.getItem(idx), 0.);
+                    viewer.getItem(idx) = double(idx);
+                }
+            }
+            // All the blocks are in the same chunk
+            UASSERTEEQUAL(allocator->getNbChunks(), 1L);
+            for(long int idxBlock = 1 ; idxBlock < static_cast<long int>(blocks.size()) ; ++idxBlock){
+                UASSERTETRUE(blocks[idxBlock].getPtr() != blocks[idxBlock-1].getPtr());
+            }
+
+            // A large block has its own chunk
+            TbfMemoryBlock<TbfMemoryVector<double>> largeBlock;
+            largeBlock.setAllocator(allocator);
+            largeBlock.resetBlocksFromSizes(std::array<long int, 1>{{1024*1024}});
+            UASSERTEEQUAL(allocator->getNbChunks(), 2L);
+
+            // The values are kept
+            for(auto& block : blocks){
+                auto viewer = block.getViewerForBlock<1>();
+                for(long int idx = 0 ; idx < 33 ; ++idx){
+                    UASSERTEEQUAL(viewer.getItem(idx), double(idx));
+                }
+            }
+        }
+        // The current chunk is kept until it is released
+        UASSERTEEQUAL(allocator->getNbChunks(), 1L);
+        allocator->releaseCurrentChunk();
+        UASSERTEEQUAL(allocator->getNbChunks(), 0L);
+        UASSERTEEQUAL(allocator->getMappedSizeInByte(), 0L);
+    }
+
+    void TestAlignement() {
+        auto allocator = std::make_shared<TbfArenaAllocator>(1024*1024);
+        // The alignement does not have to be a divisor of the page size
+        for(const long int alignement : std::vector<long int>{{64, 96, 4096, 3*4096, 64*4096, 1024*1024}}){
+            for(const long int sizeInByte : std::vector<long int>{{1, 100, 5000, 600*1024}}){
+                auto memory = allocator->allocate(sizeInByte, alignement);
+                UASSERTETRUE(memory.first != nullptr);
+                UASSERTETRUE(reinterpret_cast<std::uintptr_t>(memory.first) % alignement == 0);
+                memory.first[0] = 1;
+                memory.first[sizeInByte-1] = 1;
+                memory.second(memory.first);
+            }
+        }
+        allocator->releaseCurrentChunk();
+        UASSERTEEQUAL(allocator->getNbChunks(), 0L);
+    }
+
+    void TestTree() {
+        const long int NbParticles = 10000;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        for(TbfHugePages hugePages : {TbfHugePages::None, TbfHugePages::Transparent, TbfHugePages::Explicit}){
+            auto allocator = std::make_shared<TbfArenaAllocator>(TbfArenaAllocator::DefaultChunkSizeInByte, hugePages);
+            UASSERTETRUE(allocator->getHugePages() == hugePages);
+            {
+                TreeClass tree(configuration, particlePositions, 50, false, TbfGroupSplitStrategy::FixedSize,
+                               TbfGroupCostModel(), 0, allocator);
+                UASSERTEEQUAL(allocator->getNbChunks(), 1L);
+
+                for(long int idxLevel = 0 ; idxLevel < tree.getHeight() ; ++idxLevel){
+                    for(const auto& group : tree.getCellGroupsAtLevel(idxLevel)){
+                        UASSERTETRUE(reinterpret_cast<std::uintptr_t>(group.getMultipolePtr()) % TbfDefaultMemoryAlignement == 0);
+                    }
+                }
+
+                checkResult(tree, NbParticles);
+                tree.rebuild();
+                checkResult(tree, NbParticles);
+            }
+            allocator->releaseCurrentChunk();
+            UASSERTEEQUAL(allocator->getNbChunks(), 0L);
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestArenaAllocator::TestAllocator, "Test arena allocator");
+        Parent::AddTest(&TestArenaAllocator::TestAlignement, "Test arena allocator with large alignements");
+        Parent::AddTest(&TestArenaAllocator::TestTree, "Test tree with an arena allocator");
+    }
+};
+
+// You must do this
+TestClass(TestArenaAllocator)
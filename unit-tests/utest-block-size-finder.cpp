@@ -0,0 +1,164 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfhilbertspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "algorithms/tbfblocksizefinder.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+
+#include <vector>
+#include <array>
+#include <set>
+#include <memory>
+#include <cstdio>
+
+class TestBlockSizeFinder : public UTester< TestBlockSizeFinder > {
+    using Parent = UTester< TestBlockSizeFinder >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+    std::vector<std::array<RealType, Dim>> generateParticles(const TbfSpacialConfiguration<RealType, Dim>& inConfiguration,
+                                                             const long int inNbParticles){
+        TbfRandom<RealType, Dim> randomGenerator(inConfiguration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(inNbParticles);
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+        return particlePositions;
+    }
+
+    long int countLeaves(const std::vector<std::array<RealType, Dim>>& inPositions,
+                         const TbfSpacialConfiguration<RealType, Dim>& inConfiguration){
+        const TbfDefaultSpaceIndexType<RealType> spaceSystem(inConfiguration);
+        std::set<typename TbfDefaultSpaceIndexType<RealType>::IndexType> allIndexes;
+        for(const auto& position : inPositions){
+            allIndexes.insert(spaceSystem.getIndexFromPosition(position));
+        }
+        return static_cast<long int>(allIndexes.size());
+    }
+
+    void TestDistinct() {
+        UASSERTEEQUAL(TbfBlockSizeFinder::EstimateNbDistinct(std::vector<long int>(), 0), 0L);
+        // The complete population is exact
+        UASSERTEEQUAL(TbfBlockSizeFinder::EstimateNbDistinct(std::vector<long int>{5, 1, 5, 3, 1, 1}, 6), 3L);
+        // All the keys appear several times, nothing is extrapolated
+        UASSERTEEQUAL(TbfBlockSizeFinder::EstimateNbDistinct(std::vector<long int>{1, 1, 2, 2}, 100), 2L);
+        // q = 1/2, f1 = 2, f2 = 1: D = 3 + round(2 * (2/2 + 1/4) / (2/2 + 2/4)) = 3 + round(1.67)
+        UASSERTEEQUAL(TbfBlockSizeFinder::EstimateNbDistinct(std::vector<long int>{1, 2, 3, 3}, 8), 5L);
+        // Cannot be more than the population
+        UASSERTEEQUAL(TbfBlockSizeFinder::EstimateNbDistinct(std::vector<long int>{1, 2, 3, 4}, 5), 5L);
+    }
+
+    void TestEstimate() {
+        for(long int treeHeight : {3L, 5L, 7L}){
+            const TbfSpacialConfiguration<RealType, Dim> configuration(treeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+            for(long int nbParticles : {1000L, 200000L}){
+                const auto particlePositions = generateParticles(configuration, nbParticles);
+                const long int nbLeaves = countLeaves(particlePositions, configuration);
+                const long int estimation = TbfBlockSizeFinder::EstimateNbLeaves<RealType>(particlePositions, configuration);
+
+                // Exact when all the particles are in the sample
+                if(nbParticles <= TbfBlockSizeFinder::DefaultMaxSampleSize){
+                    UASSERTEEQUAL(estimation, nbLeaves);
+                }
+                else{
+                    UASSERTETRUE(std::abs(estimation - nbLeaves) <= nbLeaves/5);
+                }
+
+                UASSERTEEQUAL(TbfBlockSizeFinder::Estimate<RealType>(particlePositions, configuration, 4),
+                              std::max(1, static_cast<int>(estimation/8)));
+            }
+        }
+    }
+
+    void TestAutotune() {
+        const std::string cacheFilename = "utest-block-size-finder.cache";
+        std::remove(cacheFilename.c_str());
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const auto particlePositions = generateParticles(configuration, 20000);
+
+        long int nbBuilds = 0;
+        auto builder = [&nbBuilds](const auto& inConfiguration){
+            nbBuilds += 1;
+            return std::unique_ptr<AlgorithmClass>(new AlgorithmClass(inConfiguration));
+        };
+
+        const long int blockSize = TbfBlockSizeFinder::Autotune<TreeClass>(particlePositions, configuration, builder,
+                                                                           AlgorithmClass::GetName(), 5000, {1, 4},
+                                                                           cacheFilename);
+        UASSERTEEQUAL(nbBuilds, 1L);
+        UASSERTETRUE(blockSize >= 1);
+
+        // The second time the cache is used
+        const long int blockSizeFromCache = TbfBlockSizeFinder::Autotune<TreeClass>(particlePositions, configuration, builder,
+                                                                                    AlgorithmClass::GetName(), 5000, {1, 4},
+                                                                                    cacheFilename);
+        UASSERTEEQUAL(nbBuilds, 1L);
+        UASSERTEEQUAL(blockSizeFromCache, blockSize);
+
+        // Another key is not in the cache
+        TbfBlockSizeFinder::Autotune<TreeClass>(particlePositions, configuration, builder, "Other", 5000, {1, 4}, cacheFilename);
+        UASSERTEEQUAL(nbBuilds, 2L);
+
+        // Neither another box
+        const TbfSpacialConfiguration<RealType, Dim> otherConfiguration(5, {{2, 2, 2}}, {{1, 1, 1}});
+        TbfBlockSizeFinder::Autotune<TreeClass>(particlePositions, otherConfiguration, builder,
+                                                AlgorithmClass::GetName(), 5000, {1, 4}, cacheFilename);
+        UASSERTEEQUAL(nbBuilds, 3L);
+
+        // Nor another kernel (here with a different space index)
+        {
+            using SpaceIndexTypeHilbert = TbfHilbertSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim>>;
+            using TreeClassHilbert = TbfTree<RealType, RealType, Dim, long int, 1,
+                                             std::array<long int,1>, std::array<long int,1>, SpaceIndexTypeHilbert>;
+            using AlgorithmClassHilbert = TbfAlgorithm<RealType, TbfTestKernel<RealType, SpaceIndexTypeHilbert>, SpaceIndexTypeHilbert>;
+
+            auto builderHilbert = [&nbBuilds](const auto& inConfiguration){
+                nbBuilds += 1;
+                return std::unique_ptr<AlgorithmClassHilbert>(new AlgorithmClassHilbert(inConfiguration));
+            };
+            const long int blockSizeHilbert = TbfBlockSizeFinder::Autotune<TreeClassHilbert>(particlePositions, configuration, builderHilbert,
+                                                                                              AlgorithmClass::GetName(), 5000, {1, 4},
+                                                                                              cacheFilename);
+            UASSERTEEQUAL(nbBuilds, 4L);
+            UASSERTETRUE(blockSizeHilbert >= 1);
+        }
+
+        // Without a cache file the trials are always performed
+        TbfBlockSizeFinder::Autotune<TreeClass>(particlePositions, configuration, builder,
+                                                AlgorithmClass::GetName(), 5000, {1, 4}, "");
+        UASSERTEEQUAL(nbBuilds, 5L);
+
+        TreeClass tree(configuration, particlePositions, blockSize);
+        std::unique_ptr<AlgorithmClass> algorithm(builder(configuration));
+        algorithm->execute(tree);
+        tree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                  const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], static_cast<long int>(particlePositions.size())-1);
+            }
+        });
+
+        std::remove(cacheFilename.c_str());
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestBlockSizeFinder::TestDistinct, "Test distinct value estimator");
+        Parent::AddTest(&TestBlockSizeFinder::TestEstimate, "Test number of leaves estimation");
+        Parent::AddTest(&TestBlockSizeFinder::TestAutotune, "Test autotuning and cache");
+    }
+};
+
+// You must do this
+TestClass(TestBlockSizeFinder)
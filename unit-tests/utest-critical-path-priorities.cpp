@@ -0,0 +1,163 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/tbfcriticalpathpriorities.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithm.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithm.hpp"
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+#include <vector>
+#include <array>
+
+class TestCriticalPathPriorities : public UTester< TestCriticalPathPriorities > {
+    using Parent = UTester< TestCriticalPathPriorities >;
+
+    using RealType = double;
+    static const int Dim = 3;
+    static const long int NbParticles = 5000;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+
+    std::vector<std::array<RealType, Dim>> getParticles(const TbfSpacialConfiguration<RealType, Dim>& inConfiguration){
+        TbfRandom<RealType, Dim> randomGenerator(inConfiguration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+        // Half of the particles in a corner such that the costs of the groups are different
+        for(long int idxPart = 0 ; idxPart < NbParticles/2 ; ++idxPart){
+            for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                particlePositions[idxPart][idxDim] /= 8;
+            }
+        }
+        return particlePositions;
+    }
+
+    void TestPriorities(){
+        const long int TreeHeight = 5;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const long int stopUpperLevel = TbfDefaultLastLevel;
+        const long int leafLevel = TreeHeight-1;
+
+        TreeClass tree(configuration, getParticles(configuration), 30);
+        const auto& plan = tree.getInteractionPlan();
+
+        const TbfAlgorithmUtils::TbfOperationsPriorities defaultPriorities(TreeHeight);
+        TbfCriticalPathPriorities priorities(TreeHeight);
+        UASSERTEEQUAL(priorities.getNbPriorities(), defaultPriorities.getNbPriorities());
+
+        // Disabled, the fixed priorities are used
+        priorities.update(tree, stopUpperLevel, TbfAlgorithmUtils::TbfNearAndFarFields);
+        UASSERTEEQUAL(priorities.getP2MPriority(0), defaultPriorities.getP2MPriority());
+        UASSERTEEQUAL(priorities.getM2LPriority(leafLevel, 0), defaultPriorities.getM2LPriority(leafLevel));
+        UASSERTEEQUAL(priorities.getP2PPriority(0), defaultPriorities.getP2PPriority());
+
+        priorities.setEnabled(true);
+        priorities.update(tree, stopUpperLevel, TbfAlgorithmUtils::TbfNearAndFarFields);
+
+        auto isValid = [&](const int inPriority){
+            return 0 <= inPriority && inPriority < priorities.getNbPriorities();
+        };
+
+        int maxPriority = 0;
+        const long int nbLeafGroups = static_cast<long int>(std::size(tree.getParticleGroups()));
+        for(long int idxGroup = 0 ; idxGroup < nbLeafGroups ; ++idxGroup){
+            UASSERTETRUE(isValid(priorities.getP2MPriority(idxGroup)));
+            UASSERTETRUE(isValid(priorities.getL2PPriority(idxGroup)));
+            UASSERTETRUE(isValid(priorities.getP2PPriority(idxGroup)));
+            maxPriority = std::max(maxPriority, std::max(priorities.getP2MPriority(idxGroup), priorities.getP2PPriority(idxGroup)));
+            // The M2L of a leaf group precede its L2P, and its P2M precedes its M2L
+            UASSERTETRUE(priorities.getL2PPriority(idxGroup) <= priorities.getM2LPriority(leafLevel, idxGroup));
+            if(plan.getM2LInteractionsInGroup(leafLevel, idxGroup).size()){
+                UASSERTETRUE(priorities.getM2LPriority(leafLevel, idxGroup) <= priorities.getP2MPriority(idxGroup));
+            }
+        }
+        for(long int idxLevel = stopUpperLevel ; idxLevel <= leafLevel ; ++idxLevel){
+            const long int nbGroups = static_cast<long int>(std::size(tree.getCellGroupsAtLevel(idxLevel)));
+            for(long int idxGroup = 0 ; idxGroup < nbGroups ; ++idxGroup){
+                UASSERTETRUE(isValid(priorities.getM2LPriority(idxLevel, idxGroup)));
+                if(idxLevel != leafLevel){
+                    UASSERTETRUE(isValid(priorities.getM2MPriority(idxLevel, idxGroup)));
+                }
+                if(idxLevel != stopUpperLevel){
+                    UASSERTETRUE(isValid(priorities.getL2LPriority(idxLevel-1, idxGroup)));
+                }
+                maxPriority = std::max(maxPriority, priorities.getM2LPriority(idxLevel, idxGroup));
+            }
+        }
+        // The task with the longest path has the highest priority
+        UASSERTEEQUAL(maxPriority, priorities.getNbPriorities()-1);
+
+        // The most expensive P2P has a higher priority than the P2P of the groups that have a few particles
+        long int idxMaxParticles = 0;
+        long int idxMinParticles = 0;
+        for(long int idxGroup = 0 ; idxGroup < nbLeafGroups ; ++idxGroup){
+            if(tree.getParticleGroups()[idxMaxParticles].getNbParticles() < tree.getParticleGroups()[idxGroup].getNbParticles()){
+                idxMaxParticles = idxGroup;
+            }
+            if(tree.getParticleGroups()[idxGroup].getNbParticles() < tree.getParticleGroups()[idxMinParticles].getNbParticles()){
+                idxMinParticles = idxGroup;
+            }
+        }
+        UASSERTETRUE(priorities.getP2PPriority(idxMinParticles) <= priorities.getP2PPriority(idxMaxParticles));
+    }
+
+    template <class AlgorithmClass>
+    void TestAlgorithm(){
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const auto particlePositions = getParticles(configuration);
+
+        for(long int blockSize : {1L, 30L, 1000L}){
+            TreeClass tree(configuration, particlePositions, blockSize);
+
+            AlgorithmClass algorithm(configuration);
+            algorithm.setUseCriticalPathPriorities(true);
+            UASSERTETRUE(algorithm.getUseCriticalPathPriorities());
+
+            // The next executions use the measured durations
+            for(bool useInteractionPlan : {false, true, true}){
+                algorithm.setUseInteractionPlan(useInteractionPlan);
+                algorithm.execute(tree);
+
+                tree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                          const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                    for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                        UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+                        particleRhsPtr[0][idxPart] = 0;
+                    }
+                });
+                tree.applyToAllCells([](const long int /*inLevel*/, auto&& /*cellHeader*/,
+                                        const std::optional<std::reference_wrapper<std::array<long int,1>>> cellMultipole,
+                                        const std::optional<std::reference_wrapper<std::array<long int,1>>> cellLocal){
+                    cellMultipole->get()[0] = 0;
+                    cellLocal->get()[0] = 0;
+                });
+            }
+        }
+    }
+
+    void TestOpenmpAlgorithm(){
+        TestAlgorithm<TbfOpenmpAlgorithm<RealType, TbfTestKernel<RealType>>>();
+    }
+
+    void TestThreadPoolAlgorithm(){
+        TestAlgorithm<TbfThreadPoolAlgorithm<RealType, TbfTestKernel<RealType>>>();
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestCriticalPathPriorities::TestPriorities, "Test the critical path priorities");
+        Parent::AddTest(&TestCriticalPathPriorities::TestOpenmpAlgorithm, "Test the OpenMP algorithm with the critical path priorities");
+        Parent::AddTest(&TestCriticalPathPriorities::TestThreadPoolAlgorithm, "Test the thread pool algorithm with the critical path priorities");
+    }
+};
+
+// You must do this
+TestClass(TestCriticalPathPriorities)
@@ -0,0 +1,146 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbfgroupsplitter.hpp"
+#include "core/tbfparticlesorter.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+
+class TestGroupSplitter : public UTester< TestGroupSplitter > {
+    using Parent = UTester< TestGroupSplitter >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+    // Half of the particles are in a small cluster
+    std::vector<std::array<RealType, Dim>> generateClusteredParticles(const TbfSpacialConfiguration<RealType, Dim>& inConfiguration,
+                                                                      const long int inNbParticles){
+        TbfRandom<RealType, Dim> randomGenerator(inConfiguration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(inNbParticles);
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+            if(idxPart%2 == 0){
+                for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    particlePositions[idxPart][idxDim] = RealType(0.3) + particlePositions[idxPart][idxDim] * RealType(0.05);
+                }
+            }
+        }
+        return particlePositions;
+    }
+
+    void checkIntervals(const std::vector<long int>& inIntervals, const long int inNbElements, const long int inNbGroups){
+        UASSERTEEQUAL(static_cast<long int>(inIntervals.size()), inNbGroups+1);
+        UASSERTEEQUAL(inIntervals.front(), 0L);
+        UASSERTEEQUAL(inIntervals.back(), inNbElements);
+        for(long int idxGroup = 0 ; idxGroup < inNbGroups ; ++idxGroup){
+            UASSERTETRUE(inIntervals[idxGroup] < inIntervals[idxGroup+1]);
+        }
+    }
+
+    void TestSplit() {
+        UASSERTETRUE(TbfGroupSplitter::SplitFixedSize(0, 10).empty());
+        UASSERTETRUE(TbfGroupSplitter::SplitBalancedCost(std::vector<double>(), 10).empty());
+
+        for(long int nbElements : {1L, 7L, 100L, 1000L}){
+            for(long int groupSize : {1L, 3L, 10L, 2000L}){
+                const long int nbGroups = (nbElements + groupSize - 1)/groupSize;
+
+                checkIntervals(TbfGroupSplitter::SplitFixedSize(nbElements, groupSize), nbElements, nbGroups);
+
+                // Same costs, the groups should be as for fixed size when it divides exactly
+                const auto sameCostIntervals = TbfGroupSplitter::SplitBalancedCost(std::vector<double>(nbElements, 1), groupSize);
+                checkIntervals(sameCostIntervals, nbElements, nbGroups);
+                if(nbElements % groupSize == 0){
+                    UASSERTETRUE(sameCostIntervals == TbfGroupSplitter::SplitFixedSize(nbElements, groupSize));
+                }
+
+                // The first elements are 100 times more costly
+                std::vector<double> costs(nbElements, 1);
+                std::fill(costs.begin(), costs.begin() + nbElements/4, 100);
+                checkIntervals(TbfGroupSplitter::SplitBalancedCost(costs, groupSize), nbElements, nbGroups);
+
+                // Zero costs
+                checkIntervals(TbfGroupSplitter::SplitBalancedCost(std::vector<double>(nbElements, 0), groupSize), nbElements, nbGroups);
+            }
+        }
+
+        // Costs 1 2 3 4 5 6 7 8 (sum 36) in 2 groups
+        const auto intervals = TbfGroupSplitter::SplitBalancedCost(std::vector<double>{1, 2, 3, 4, 5, 6, 7, 8}, 4);
+        UASSERTETRUE(intervals == std::vector<long int>({0, 6, 8}));
+    }
+
+    void TestTree() {
+        const long int NbParticles = 20000;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const TbfDefaultSpaceIndexType<RealType> spaceSystem(configuration);
+        const auto particlePositions = generateClusteredParticles(configuration, NbParticles);
+
+        const TbfParticleSorter<RealType> sorter(spaceSystem, particlePositions);
+        const auto leafCosts = sorter.computeLeafCosts(spaceSystem, TbfGroupCostModel());
+
+        for(long int blockSize : {10L, 100L}){
+            TreeClass fixedTree(configuration, particlePositions, blockSize, false, TbfGroupSplitStrategy::FixedSize);
+            TreeClass balancedTree(configuration, particlePositions, blockSize, false, TbfGroupSplitStrategy::BalancedCost);
+
+            UASSERTETRUE(balancedTree.getGroupSplitStrategy() == TbfGroupSplitStrategy::BalancedCost);
+
+            // Same number of groups at each level
+            UASSERTEEQUAL(fixedTree.getNbParticleGroups(), balancedTree.getNbParticleGroups());
+            for(long int idxLevel = 0 ; idxLevel < configuration.getTreeHeight() ; ++idxLevel){
+                UASSERTEEQUAL(fixedTree.getNbCellGroupsAtLevel(idxLevel), balancedTree.getNbCellGroupsAtLevel(idxLevel));
+            }
+
+            // The most costly group must be less costly
+            auto getMaxGroupCost = [&](const TreeClass& inTree){
+                double maxCost = 0;
+                long int idxFirstLeaf = 0;
+                for(const auto& particleGroup : inTree.getParticleGroups()){
+                    double groupCost = 0;
+                    for(long int idxLeaf = 0 ; idxLeaf < particleGroup.getNbLeaves() ; ++idxLeaf){
+                        groupCost += leafCosts[idxFirstLeaf + idxLeaf];
+                    }
+                    idxFirstLeaf += particleGroup.getNbLeaves();
+                    maxCost = std::max(maxCost, groupCost);
+                }
+                return maxCost;
+            };
+            UASSERTETRUE(getMaxGroupCost(balancedTree) < getMaxGroupCost(fixedTree));
+
+            // The result must be correct
+            AlgorithmClass algorithm(configuration);
+            algorithm.execute(balancedTree);
+
+            balancedTree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                              const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+                }
+            });
+
+            // The rebuild keeps the strategy
+            balancedTree.rebuild();
+            UASSERTEEQUAL(fixedTree.getNbParticleGroups(), balancedTree.getNbParticleGroups());
+            UASSERTETRUE(getMaxGroupCost(balancedTree) < getMaxGroupCost(fixedTree));
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestGroupSplitter::TestSplit, "Test split of the costs");
+        Parent::AddTest(&TestGroupSplitter::TestTree, "Test tree with balanced groups");
+    }
+};
+
+// You must do this
+TestClass(TestGroupSplitter)
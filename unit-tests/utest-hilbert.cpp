@@ -3,8 +3,128 @@
 #include "utils/tbfutils.hpp"
 #include "spacial/tbfhilbertspaceindex.hpp"
 #include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
 
 #include <set>
+#include <random>
+
+// Exposes the conversions as they were before being table-driven
+// (one triplet per step), to check that the indexes did not change
+template <class ConfigurationClass>
+class TbfHilbertSpaceIndexReference : public TbfHilbertSpaceIndex<3, ConfigurationClass> {
+    using Parent = TbfHilbertSpaceIndex<3, ConfigurationClass>;
+
+public:
+    using IndexType = typename Parent::IndexType;
+    static constexpr long int Dim = Parent::Dim;
+
+    explicit TbfHilbertSpaceIndexReference(const ConfigurationClass& inConfiguration)
+        : Parent(inConfiguration){
+    }
+
+    long int Hilbert2MortonReference(long int Hilbert_ind) const{
+      long int mask = 0x7LL;
+      long int h;
+      long int shift = 0;
+      long int current_state = 0;
+      long int Hilbert_triplet;
+      long int Morton_triplet;
+      long int res = 0x0LL;
+
+      shift = (this->configuration.getTreeHeight()-1) * Parent::CHILDREN_BITS_NUMBER;
+      mask <<= shift;
+
+      for (h=this->configuration.getTreeHeight(); h>0; --h){
+        Hilbert_triplet = (Hilbert_ind & mask) >> shift;
+
+        Morton_triplet = Parent::Hilbert2Morton_table[current_state][Hilbert_triplet].triplet;
+        current_state = Parent::Hilbert2Morton_table[current_state][Hilbert_triplet].next_state;
+
+        res |= (Morton_triplet << shift);
+
+        mask >>= Parent::CHILDREN_BITS_NUMBER;
+        shift -= Parent::CHILDREN_BITS_NUMBER;
+      }
+
+      return res;
+    }
+
+    long int Morton2HilbertReference(long int Morton_ind) const {
+      long int mask = 0x7LL;
+      long int h;
+      long int shift = 0;
+      long int current_state = 0;
+      long int  Hilbert_triplet;
+      long int Morton_triplet;
+      long int res = 0x0LL;
+
+      shift = (this->configuration.getTreeHeight()-1) * Parent::CHILDREN_BITS_NUMBER;
+      mask <<= shift;
+
+      for (h=this->configuration.getTreeHeight(); h>0; --h){
+        Morton_triplet = (Morton_ind & mask) >> shift;
+
+        Hilbert_triplet = Parent::Morton2Hilbert_table[current_state][Morton_triplet].triplet;
+        current_state = Parent::Morton2Hilbert_table[current_state][Morton_triplet].next_state;
+
+        res |= (Hilbert_triplet << shift);
+
+        mask >>= Parent::CHILDREN_BITS_NUMBER;
+        shift -= Parent::CHILDREN_BITS_NUMBER;
+      }
+
+      return res;
+    }
+
+    std::array<long int,Dim> getBoxPosFromIndexReference(IndexType inMindexHilbert) const{
+        IndexType inMindex = Hilbert2MortonReference(inMindexHilbert);
+        IndexType mask = 0x1LL;
+
+        std::array<long int,Dim> boxPos;
+
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            boxPos[idxDim] = 0;
+        }
+
+        while(inMindex >= mask) {
+            for(long int idxDim = Dim-1 ; idxDim > 0 ; --idxDim){
+                boxPos[idxDim] |= static_cast<long int>(inMindex & mask);
+                inMindex >>= 1;
+            }
+
+            boxPos[0] |= static_cast<long int>(inMindex & mask);
+
+            mask <<= 1;
+        }
+
+        return boxPos;
+    }
+
+    IndexType getIndexFromBoxPosReference(const std::array<long int,Dim>& inBoxPos) const{
+        IndexType index = 0x0LL;
+        IndexType mask = 0x1LL;
+
+        bool shouldContinue = false;
+
+        std::array<IndexType,Dim> mcoord;
+        for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+            mcoord[idxDim] = (inBoxPos[idxDim] << (Dim - idxDim - 1));
+            shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
+        }
+
+        while(shouldContinue){
+            shouldContinue = false;
+            for(long int idxDim = Dim-1 ; idxDim >= 0 ; --idxDim){
+                index |= (mcoord[idxDim] & mask);
+                mask <<= 1;
+                mcoord[idxDim] <<= (Dim-1);
+                shouldContinue |= ((mask << (Dim - idxDim - 1)) <= mcoord[idxDim]);
+            }
+        }
+
+        return Morton2HilbertReference(index);
+    }
+};
 
 class TestHilbert : public UTester< TestHilbert > {
     using Parent = UTester< TestHilbert >;
@@ -104,8 +224,84 @@ class TestHilbert : public UTester< TestHilbert > {
         }
     }
 
+    void TestPositions() {
+        const int Dim = 3;
+
+        using RealType = double;
+
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        for(long int TreeHeight = 2 ; TreeHeight < 9 ; ++TreeHeight){
+            const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+            const TbfHilbertSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim> > hilbert(configuration);
+
+            TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+            for(long int idxPart = 0 ; idxPart < 1000 ; ++idxPart){
+                const auto position = randomGenerator.getNewItem();
+                const auto index = hilbert.getIndexFromPosition(position);
+                UASSERTETRUE(index < hilbert.getUpperBoundAtLeafLevel());
+
+                const auto boxPos = hilbert.getBoxPosFromIndex(index);
+                for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    UASSERTEEQUAL(boxPos[idxDim], static_cast<long int>(position[idxDim]/configuration.getLeafWidths()[idxDim]));
+                }
+                UASSERTEEQUAL(hilbert.getIndexFromBoxPos(boxPos), index);
+            }
+
+            // Two consecutive leaves are neighbors
+            for(long int idxLeaf = 1 ; idxLeaf < hilbert.getUpperBoundAtLeafLevel() ; ++idxLeaf){
+                const auto boxPos = hilbert.getBoxPosFromIndex(idxLeaf);
+                const auto previousBoxPos = hilbert.getBoxPosFromIndex(idxLeaf-1);
+                long int distance = 0;
+                for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    distance += std::abs(boxPos[idxDim] - previousBoxPos[idxDim]);
+                }
+                UASSERTEEQUAL(distance, 1L);
+            }
+        }
+    }
+
+    void TestSameAsReference() {
+        const int Dim = 3;
+
+        using RealType = double;
+        using ConfigurationClass = TbfSpacialConfiguration<RealType, Dim>;
+        using IndexType = typename TbfHilbertSpaceIndex<Dim, ConfigurationClass>::IndexType;
+
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        std::mt19937_64 randomEngine(0);
+
+        // The bitwise encoding of the box positions overflows for taller trees
+        for(long int TreeHeight = 1 ; TreeHeight <= 19 ; ++TreeHeight){
+            const ConfigurationClass configuration(TreeHeight, BoxWidths, BoxCenter);
+            const TbfHilbertSpaceIndex<Dim, ConfigurationClass> hilbert(configuration);
+            const TbfHilbertSpaceIndexReference<ConfigurationClass> reference(configuration);
+
+            const IndexType upperBound = hilbert.getUpperBoundAtLeafLevel();
+            // All the indexes for the small trees, random ones otherwise
+            const bool testAll = (upperBound <= (1L << 18));
+            const long int nbTests = (testAll ? upperBound : 100000);
+            std::uniform_int_distribution<IndexType> indexDistribution(0, upperBound-1);
+
+            for(long int idxTest = 0 ; idxTest < nbTests ; ++idxTest){
+                const IndexType index = (testAll ? IndexType(idxTest) : indexDistribution(randomEngine));
+
+                const auto boxPos = hilbert.getBoxPosFromIndex(index);
+                UASSERTETRUE(boxPos == reference.getBoxPosFromIndexReference(index));
+                UASSERTEEQUAL(hilbert.getIndexFromBoxPos(boxPos), reference.getIndexFromBoxPosReference(boxPos));
+                UASSERTEEQUAL(hilbert.getIndexFromBoxPos(boxPos), index);
+            }
+        }
+    }
+
     void SetTests() {
         Parent::AddTest(&TestHilbert::TestBasic, "Basic test for Hilbert");
+        Parent::AddTest(&TestHilbert::TestPositions, "Test the Hilbert indexes of positions");
+        Parent::AddTest(&TestHilbert::TestSameAsReference, "Test the Hilbert conversions against the bitwise ones");
     }
 };
 
@@ -0,0 +1,198 @@
+#include "UTester.hpp"
+
+#include "utils/tbfindextype.hpp"
+#include "spacial/tbfmortoncoder.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfhilbertspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+
+#include <vector>
+#include <array>
+#include <random>
+
+class TestIndexType : public UTester< TestIndexType > {
+    using Parent = UTester< TestIndexType >;
+
+    template <long int Dim, class IndexType>
+    void TestCoder(){
+        using CoderType = TbfMortonCoder<Dim, IndexType>;
+        using NarrowCoderType = TbfMortonCoder<Dim, long int>;
+
+        // The loop version continues up to Dim-1 extra levels, it overflows if the last bits of the index are used
+        const long int NbBitsPerDim = std::min((TbfIndexTypeTraits<IndexType>::NbUsableBits - 4 - Dim*Dim)/Dim, 62L);
+        const long int NbNarrowBitsPerDim = (60 - Dim*Dim)/Dim;
+        std::mt19937_64 generator(Dim);
+
+        for(long int idxTest = 0 ; idxTest < 10000 ; ++idxTest){
+            const long int nbBits = 1 + (idxTest % NbBitsPerDim);
+            std::array<long int, Dim> boxPos;
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                boxPos[idxDim] = static_cast<long int>(generator() & ((1UL << nbBits) - 1));
+            }
+
+            const IndexType index = CoderType::EncodeLoop(boxPos);
+            UASSERTETRUE(CoderType::EncodeTable(boxPos) == index);
+            UASSERTETRUE(CoderType::Encode(boxPos) == index);
+            if(CoderType::HasBmi2()){
+                UASSERTETRUE(CoderType::EncodeBmi2(boxPos) == index);
+            }
+
+            UASSERTETRUE(CoderType::DecodeLoop(index) == boxPos);
+            UASSERTETRUE(CoderType::DecodeTable(index) == boxPos);
+            UASSERTETRUE(CoderType::Decode(index) == boxPos);
+            if(CoderType::HasBmi2()){
+                UASSERTETRUE(CoderType::DecodeBmi2(index) == boxPos);
+            }
+
+            // The small coordinates have the same index as with the default type
+            if(nbBits <= NbNarrowBitsPerDim){
+                UASSERTETRUE(index == static_cast<IndexType>(NarrowCoderType::Encode(boxPos)));
+            }
+        }
+    }
+
+    void TestAllCoders(){
+        TestCoder<2, unsigned long int>();
+        TestCoder<3, unsigned long int>();
+#if defined(TBF_USE_INT128)
+        TestCoder<1, TbfUInt128>();
+        TestCoder<2, TbfUInt128>();
+        TestCoder<3, TbfUInt128>();
+        TestCoder<4, TbfUInt128>();
+        TestCoder<5, TbfUInt128>();
+#endif
+    }
+
+    template <class SpaceIndexType, class NarrowSpaceIndexType>
+    void TestSpaceIndex(){
+        using RealType = double;
+        const int Dim = 3;
+        using IndexType = typename SpaceIndexType::IndexType;
+
+        // Same indexes as the default type if the tree is not too deep
+        {
+            const long int TreeHeight = NarrowSpaceIndexType::getMaxTreeHeight();
+            const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+            const SpaceIndexType spaceSystem(configuration);
+            const NarrowSpaceIndexType narrowSpaceSystem(configuration);
+
+            UASSERTETRUE(spaceSystem.getUpperBoundAtLeafLevel() == static_cast<IndexType>(narrowSpaceSystem.getUpperBoundAtLeafLevel()));
+
+            TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+            for(long int idxPos = 0 ; idxPos < 1000 ; ++idxPos){
+                const auto position = randomGenerator.getNewItem();
+                UASSERTETRUE(spaceSystem.getIndexFromPosition(position) == static_cast<IndexType>(narrowSpaceSystem.getIndexFromPosition(position)));
+            }
+        }
+        // Deeper than what the default type supports
+        {
+            const long int TreeHeight = SpaceIndexType::getMaxTreeHeight();
+            UASSERTETRUE(NarrowSpaceIndexType::getMaxTreeHeight() <= TreeHeight);
+
+            const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+            const SpaceIndexType spaceSystem(configuration);
+
+            TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+            for(long int idxPos = 0 ; idxPos < 1000 ; ++idxPos){
+                const auto position = randomGenerator.getNewItem();
+                const IndexType index = spaceSystem.getIndexFromPosition(position);
+                UASSERTETRUE(index < spaceSystem.getUpperBoundAtLeafLevel());
+
+                const auto boxPos = spaceSystem.getBoxPosFromIndex(index);
+                UASSERTETRUE(spaceSystem.getIndexFromBoxPos(boxPos) == index);
+                for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    UASSERTETRUE(std::abs(position[idxDim] - (RealType(boxPos[idxDim]) + 0.5)*configuration.getLeafWidths()[idxDim])
+                                 <= configuration.getLeafWidths()[idxDim]);
+                }
+
+                const IndexType parentIndex = spaceSystem.getParentIndex(index);
+                UASSERTETRUE(spaceSystem.getChildIndexFromParent(parentIndex, spaceSystem.childPositionFromParent(index)) == index);
+            }
+        }
+    }
+
+    void TestAllSpaceIndexes(){
+        using RealType = double;
+        const int Dim = 3;
+        using ConfigurationClass = TbfSpacialConfiguration<RealType, Dim>;
+
+        TestSpaceIndex<TbfMortonSpaceIndex<Dim, ConfigurationClass, false, unsigned long int>,
+                       TbfMortonSpaceIndex<Dim, ConfigurationClass, false>>();
+#if defined(TBF_USE_INT128)
+        using NarrowSpaceIndexType = TbfMortonSpaceIndex<Dim, ConfigurationClass, false>;
+        using WideSpaceIndexType = TbfMortonSpaceIndex<Dim, ConfigurationClass, false, TbfUInt128>;
+        UASSERTEEQUAL(NarrowSpaceIndexType::getMaxTreeHeight(), 21L);
+        UASSERTEEQUAL(WideSpaceIndexType::getMaxTreeHeight(), 43L);
+        TestSpaceIndex<TbfMortonSpaceIndex<Dim, ConfigurationClass, false, TbfUInt128>,
+                       TbfMortonSpaceIndex<Dim, ConfigurationClass, false>>();
+        TestSpaceIndex<TbfHilbertSpaceIndex<Dim, ConfigurationClass, false, TbfUInt128>,
+                       TbfHilbertSpaceIndex<Dim, ConfigurationClass, false>>();
+#endif
+    }
+
+    template <class SpaceIndexType>
+    void TestTree(const long int TreeHeight){
+        using RealType = double;
+        const int Dim = 3;
+        const long int NbParticles = 1000;
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+        // Some particles in the same or in neighbor leaves
+        for(long int idxPart = 0 ; idxPart < 10 ; ++idxPart){
+            particlePositions[idxPart] = std::array<RealType, Dim>{{0.5, 0.5, 0.5}};
+            particlePositions[idxPart][idxPart%Dim] += RealType(idxPart/Dim) * configuration.getLeafWidths()[0];
+        }
+
+        using MultipoleClass = std::array<long int,1>;
+        using LocalClass = std::array<long int,1>;
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1, MultipoleClass, LocalClass, SpaceIndexType>;
+        using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType, SpaceIndexType>, SpaceIndexType>;
+
+        TreeClass tree(configuration, particlePositions, 64, true);
+        UASSERTETRUE(tree.getNbParticles() == NbParticles);
+
+        AlgorithmClass algorithm(configuration);
+        algorithm.execute(tree);
+
+        tree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                              const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+            }
+        });
+    }
+
+    void TestAllTrees(){
+        using RealType = double;
+        const int Dim = 3;
+        using ConfigurationClass = TbfSpacialConfiguration<RealType, Dim>;
+
+        TestTree<TbfMortonSpaceIndex<Dim, ConfigurationClass, false, unsigned long int>>(8);
+#if defined(TBF_USE_INT128)
+        TestTree<TbfMortonSpaceIndex<Dim, ConfigurationClass, false, TbfUInt128>>(8);
+        TestTree<TbfMortonSpaceIndex<Dim, ConfigurationClass, false, TbfUInt128>>(30);
+        TestTree<TbfMortonSpaceIndex<Dim, ConfigurationClass, false, TbfUInt128>>(
+                    TbfMortonSpaceIndex<Dim, ConfigurationClass, false, TbfUInt128>::getMaxTreeHeight());
+        TestTree<TbfHilbertSpaceIndex<Dim, ConfigurationClass, false, TbfUInt128>>(30);
+#endif
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestIndexType::TestAllCoders, "Test the Morton coder with other index types");
+        Parent::AddTest(&TestIndexType::TestAllSpaceIndexes, "Test the space indexes with other index types");
+        Parent::AddTest(&TestIndexType::TestAllTrees, "Test the FMM with other index types");
+    }
+};
+
+// You must do this
+TestClass(TestIndexType)
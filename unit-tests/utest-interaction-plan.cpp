@@ -0,0 +1,126 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "kernels/counterkernels/tbfinteractioncounter.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+
+#include <vector>
+#include <array>
+#include <utility>
+
+class TestInteractionPlan : public UTester< TestInteractionPlan > {
+    using Parent = UTester< TestInteractionPlan >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+    using CounterAlgorithmClass = TbfAlgorithm<RealType, TbfInteractionCounter<TbfTestKernel<RealType>>>;
+
+    void checkResultAndReset(TreeClass& inTree, const long int inNbParticles){
+        inTree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                    const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], inNbParticles-1);
+                particleRhsPtr[0][idxPart] = 0;
+            }
+        });
+        inTree.applyToAllCells([](const long int /*inLevel*/, auto&& /*cellHeader*/,
+                                  const std::optional<std::reference_wrapper<std::array<long int,1>>> cellMultipole,
+                                  const std::optional<std::reference_wrapper<std::array<long int,1>>> cellLocal){
+            cellMultipole->get()[0] = 0;
+            cellLocal->get()[0] = 0;
+        });
+    }
+
+    void TestPlan() {
+        const long int NbParticles = 10000;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        for(long int blockSize : {1L, 30L, 1000L}){
+            TreeClass tree(configuration, particlePositions, blockSize);
+            UASSERTETRUE(!tree.hasInteractionPlan());
+
+            AlgorithmClass algorithm(configuration);
+            algorithm.setUseInteractionPlan(true);
+            UASSERTETRUE(algorithm.getUseInteractionPlan());
+
+            algorithm.execute(tree);
+            checkResultAndReset(tree, NbParticles);
+            UASSERTETRUE(tree.hasInteractionPlan());
+
+            // The plan is kept between the executions
+            const TbfInteractionPlan* interactionPlan = &tree.getInteractionPlan();
+            UASSERTEEQUAL(interactionPlan->getHeight(), configuration.getTreeHeight());
+            UASSERTETRUE(interactionPlan->getNbInteractions() > 0);
+            UASSERTETRUE(interactionPlan->getMemorySizeInByte() > 0);
+
+            algorithm.execute(tree);
+            checkResultAndReset(tree, NbParticles);
+            UASSERTETRUE(interactionPlan == &tree.getInteractionPlan());
+
+            // Same number of interactions with and without the plan
+            {
+                CounterAlgorithmClass counterAlgorithm(configuration);
+                counterAlgorithm.execute(tree);
+                checkResultAndReset(tree, NbParticles);
+
+                CounterAlgorithmClass counterAlgorithmPlan(configuration);
+                counterAlgorithmPlan.setUseInteractionPlan(true);
+                counterAlgorithmPlan.execute(tree);
+                checkResultAndReset(tree, NbParticles);
+
+                auto getCounters = [](const auto& inAlgorithm){
+                    typename TbfInteractionCounter<TbfTestKernel<RealType>>::Counters counters;
+                    inAlgorithm.applyToAllKernels([&](const auto& inKernel){
+                        counters = TbfInteractionCounter<TbfTestKernel<RealType>>::Counters::Reduce(counters, inKernel.getReduceData());
+                    });
+                    return counters;
+                };
+                const auto counters = getCounters(counterAlgorithm);
+                const auto countersPlan = getCounters(counterAlgorithmPlan);
+                UASSERTEEQUAL(countersPlan.M2L, counters.M2L);
+                UASSERTEEQUAL(countersPlan.P2P, counters.P2P);
+                UASSERTEEQUAL(countersPlan.P2PInner, counters.P2PInner);
+            }
+
+            // The plan is reset by a rebuild
+            tree.rebuild();
+            UASSERTETRUE(!tree.hasInteractionPlan());
+            algorithm.execute(tree);
+            checkResultAndReset(tree, NbParticles);
+
+            tree.rebuildIncremental();
+            UASSERTETRUE(!tree.hasInteractionPlan());
+            algorithm.execute(tree);
+            checkResultAndReset(tree, NbParticles);
+
+            // A moved tree rebuilds its plan
+            UASSERTETRUE(tree.hasInteractionPlan());
+            TreeClass movedTree(std::move(tree));
+            UASSERTETRUE(!movedTree.hasInteractionPlan());
+            algorithm.execute(movedTree);
+            checkResultAndReset(movedTree, NbParticles);
+            UASSERTETRUE(movedTree.hasInteractionPlan());
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestInteractionPlan::TestPlan, "Test interaction plan");
+    }
+};
+
+// You must do this
+TestClass(TestInteractionPlan)
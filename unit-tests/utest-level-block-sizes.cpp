@@ -0,0 +1,155 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbfparallel.hpp"
+#include "core/tbftree.hpp"
+#include "core/tbftreetsm.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+#include "algorithms/sequential/tbfalgorithmtsm.hpp"
+
+#include <vector>
+#include <array>
+
+class TestLevelBlockSizes : public UTester< TestLevelBlockSizes > {
+    using Parent = UTester< TestLevelBlockSizes >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+    using TreeClassTsm = TbfTreeTsm<RealType, RealType, Dim, long int, 1,
+                                    std::array<long int,1>, std::array<long int,1>>;
+    using AlgorithmClassTsm = TbfAlgorithmTsm<RealType, TbfTestKernel<RealType>>;
+
+    std::vector<std::array<RealType, Dim>> generateParticles(const TbfSpacialConfiguration<RealType, Dim>& inConfiguration,
+                                                             const long int inNbParticles){
+        TbfRandom<RealType, Dim> randomGenerator(inConfiguration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(inNbParticles);
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+        return particlePositions;
+    }
+
+    template <class GroupContainerClass>
+    long int countCells(const GroupContainerClass& inGroups){
+        long int nbCells = 0;
+        for(const auto& group : inGroups){
+            nbCells += group.getNbCells();
+        }
+        return nbCells;
+    }
+
+    template <class GroupContainerClass>
+    void checkGroupSizes(const GroupContainerClass& inGroups, const long int inBlockSize){
+        const long int nbCells = countCells(inGroups);
+        UASSERTEEQUAL(static_cast<long int>(inGroups.size()), (nbCells + inBlockSize - 1)/inBlockSize);
+        for(const auto& group : inGroups){
+            UASSERTETRUE(group.getNbCells() <= inBlockSize);
+        }
+    }
+
+    void checkResult(TreeClass& inTree, const long int inNbParticles){
+        AlgorithmClass algorithm(inTree.getSpacialConfiguration());
+        algorithm.execute(inTree);
+
+        inTree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                    const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], inNbParticles-1);
+            }
+        });
+    }
+
+    void TestPerLevel() {
+        const long int NbParticles = 10000;
+        const long int TreeHeight = 5;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const auto particlePositions = generateParticles(configuration, NbParticles);
+
+        {
+            const std::vector<long int> blockSizes{1, 2, 5, -1, 100};
+            TreeClass tree(configuration, particlePositions, blockSizes);
+
+            UASSERTEEQUAL(tree.getNbElementsPerGroup(), 100L);
+            UASSERTEEQUAL(tree.getNbElementsPerGroupAtLevel(2), 5L);
+            UASSERTEEQUAL(tree.getNbElementsPerGroupAtLevel(3), 100L);
+
+            for(long int idxLevel = 0 ; idxLevel < TreeHeight ; ++idxLevel){
+                checkGroupSizes(tree.getCellGroupsAtLevel(idxLevel), tree.getNbElementsPerGroupAtLevel(idxLevel));
+            }
+            checkResult(tree, NbParticles);
+
+            tree.rebuild();
+            for(long int idxLevel = 0 ; idxLevel < TreeHeight ; ++idxLevel){
+                checkGroupSizes(tree.getCellGroupsAtLevel(idxLevel), tree.getNbElementsPerGroupAtLevel(idxLevel));
+            }
+        }
+        {
+            // Same as a single block size
+            TreeClass tree(configuration, particlePositions, std::vector<long int>(TreeHeight, 50));
+            TreeClass treeRef(configuration, particlePositions, 50);
+            for(long int idxLevel = 0 ; idxLevel < TreeHeight ; ++idxLevel){
+                UASSERTEEQUAL(tree.getNbCellGroupsAtLevel(idxLevel), treeRef.getNbCellGroupsAtLevel(idxLevel));
+            }
+        }
+    }
+
+    void TestMinGroupsPerThread() {
+        const long int NbParticles = 10000;
+        const long int TreeHeight = 5;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const auto particlePositions = generateParticles(configuration, NbParticles);
+        const long int nbThreads = TbfParallel::GetNbThreads();
+
+        for(long int minGroupsPerThread : {1L, 4L}){
+            TreeClass tree(configuration, particlePositions, 1000000, false, TbfGroupSplitStrategy::FixedSize,
+                           TbfGroupCostModel(), minGroupsPerThread);
+            UASSERTEEQUAL(tree.getMinGroupsPerThread(), minGroupsPerThread);
+
+            for(long int idxLevel = 0 ; idxLevel < TreeHeight ; ++idxLevel){
+                const long int nbCells = countCells(tree.getCellGroupsAtLevel(idxLevel));
+                UASSERTETRUE(tree.getNbCellGroupsAtLevel(idxLevel) >= std::min(nbCells, minGroupsPerThread*nbThreads));
+            }
+            UASSERTEEQUAL(tree.getNbParticleGroups(), tree.getNbCellGroupsAtLevel(TreeHeight-1));
+
+            checkResult(tree, NbParticles);
+        }
+    }
+
+    void TestTsm() {
+        const long int NbParticles = 5000;
+        const long int TreeHeight = 4;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const auto sourcePositions = generateParticles(configuration, NbParticles);
+        const auto targetPositions = generateParticles(configuration, NbParticles);
+
+        TreeClassTsm tree(configuration, sourcePositions, targetPositions, std::vector<long int>{1, 3, 7, -1});
+
+        AlgorithmClassTsm algorithm(configuration);
+        algorithm.execute(tree);
+
+        tree.applyToAllLeavesTarget([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                        const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles);
+            }
+        });
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestLevelBlockSizes::TestPerLevel, "Test a block size per level");
+        Parent::AddTest(&TestLevelBlockSizes::TestMinGroupsPerThread, "Test minimum number of groups per thread");
+        Parent::AddTest(&TestLevelBlockSizes::TestTsm, "Test a block size per level with Tsm");
+    }
+};
+
+// You must do this
+TestClass(TestLevelBlockSizes)
@@ -0,0 +1,111 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortoncoder.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+
+#include <vector>
+#include <array>
+#include <random>
+
+class TestMortonCoder : public UTester< TestMortonCoder > {
+    using Parent = UTester< TestMortonCoder >;
+
+    template <long int Dim>
+    void TestCoder(){
+        using CoderType = TbfMortonCoder<Dim>;
+        using IndexType = typename CoderType::IndexType;
+
+        // The loop version continues up to Dim-1 extra levels, it overflows if the last bits of the index are used
+        const long int NbBitsPerDim = (60 - Dim*Dim)/Dim;
+        std::mt19937_64 generator(Dim);
+
+        std::vector<std::array<long int, Dim>> allBoxPos;
+        for(long int idxTest = 0 ; idxTest < 10000 ; ++idxTest){
+            // Coordinates of different sizes
+            const long int nbBits = 1 + (idxTest % NbBitsPerDim);
+            std::array<long int, Dim> boxPos;
+            for(long int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                boxPos[idxDim] = static_cast<long int>(generator() & ((1UL << nbBits) - 1));
+            }
+            allBoxPos.push_back(boxPos);
+        }
+
+        for(const auto& boxPos : allBoxPos){
+            const IndexType index = CoderType::EncodeLoop(boxPos);
+            UASSERTEEQUAL(CoderType::EncodeTable(boxPos), index);
+            UASSERTEEQUAL(CoderType::Encode(boxPos), index);
+            if(CoderType::HasBmi2()){
+                UASSERTEEQUAL(CoderType::EncodeBmi2(boxPos), index);
+            }
+
+            UASSERTETRUE(CoderType::DecodeLoop(index) == boxPos);
+            UASSERTETRUE(CoderType::DecodeTable(index) == boxPos);
+            UASSERTETRUE(CoderType::Decode(index) == boxPos);
+            if(CoderType::HasBmi2()){
+                UASSERTETRUE(CoderType::DecodeBmi2(index) == boxPos);
+            }
+        }
+
+        std::vector<IndexType> indexes(allBoxPos.size());
+        CoderType::EncodeArray(allBoxPos.data(), static_cast<long int>(allBoxPos.size()), indexes.data());
+        for(long int idxTest = 0 ; idxTest < static_cast<long int>(allBoxPos.size()) ; ++idxTest){
+            UASSERTEEQUAL(indexes[idxTest], CoderType::EncodeLoop(allBoxPos[idxTest]));
+        }
+    }
+
+    void TestAllDims(){
+        TestCoder<1>();
+        TestCoder<2>();
+        TestCoder<3>();
+        TestCoder<4>();
+        TestCoder<5>();
+    }
+
+    void TestBatchedPositions(){
+        using RealType = double;
+        const int Dim = 3;
+        const long int TreeHeight = 8;
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const TbfMortonSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim>, false> morton(configuration);
+        using IndexType = typename TbfMortonSpaceIndex<Dim, TbfSpacialConfiguration<RealType, Dim>, false>::IndexType;
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> positions(1000);
+        for(auto& position : positions){
+            position = randomGenerator.getNewItem();
+        }
+        // The borders of the box
+        positions[0] = std::array<RealType, Dim>{{0, 0, 0}};
+        positions[1] = std::array<RealType, Dim>{{1, 1, 1}};
+        positions[2] = std::array<RealType, Dim>{{1, 0, 0.5}};
+
+        const long int begin = 0;
+        const long int end = static_cast<long int>(positions.size());
+        std::vector<IndexType> indexes(end - begin);
+        morton.getIndexesFromPositions(positions, begin, end, indexes.data());
+        for(long int idxPos = begin ; idxPos < end ; ++idxPos){
+            UASSERTEEQUAL(indexes[idxPos - begin], morton.getIndexFromPosition(positions[idxPos]));
+            UASSERTETRUE(indexes[idxPos - begin] < morton.getUpperBoundAtLeafLevel());
+        }
+        UASSERTEEQUAL(indexes[0], IndexType(0));
+        UASSERTEEQUAL(indexes[1], morton.getUpperBoundAtLeafLevel()-1);
+
+        // Sub-interval
+        std::vector<IndexType> subIndexes(300);
+        morton.getIndexesFromPositions(positions, 500, 800, subIndexes.data());
+        for(long int idxPos = 0 ; idxPos < 300 ; ++idxPos){
+            UASSERTEEQUAL(subIndexes[idxPos], indexes[500 + idxPos]);
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestMortonCoder::TestAllDims, "Test the Morton encoding/decoding methods");
+        Parent::AddTest(&TestMortonCoder::TestBatchedPositions, "Test the batched computation of the indexes");
+    }
+};
+
+// You must do this
+TestClass(TestMortonCoder)
@@ -0,0 +1,125 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbfnuma.hpp"
+#include "containers/tbfnumaallocator.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+
+#include <vector>
+#include <array>
+#include <memory>
+
+class TestNuma : public UTester< TestNuma > {
+    using Parent = UTester< TestNuma >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+    void TestNodes() {
+        const int nbNodes = TbfNuma::GetNbNodes();
+        UASSERTETRUE(nbNodes >= 1);
+        UASSERTETRUE(0 <= TbfNuma::GetCurrentNode() && TbfNuma::GetCurrentNode() < nbNodes);
+        UASSERTEEQUAL(TbfNuma::GetNodeOfAddress(nullptr), -1);
+
+        UASSERTEEQUAL(TbfNuma::GetNodeOfPosition(0, 10, 2), 0);
+        UASSERTEEQUAL(TbfNuma::GetNodeOfPosition(4, 10, 2), 0);
+        UASSERTEEQUAL(TbfNuma::GetNodeOfPosition(5, 10, 2), 1);
+        UASSERTEEQUAL(TbfNuma::GetNodeOfPosition(9, 10, 2), 1);
+        UASSERTEEQUAL(TbfNuma::GetNodeOfPosition(0, 2, 4), 0);
+        UASSERTEEQUAL(TbfNuma::GetNodeOfPosition(1, 2, 4), 2);
+        UASSERTEEQUAL(TbfNuma::GetNodeOfPosition(3, 10, 1), 0);
+        UASSERTEEQUAL(TbfNuma::GetNodeOfPosition(0, 0, 2), 0);
+    }
+
+    void TestAllocatorForGroup() {
+        const int nbNodes = TbfNuma::GetNbNodes();
+        auto allocator = std::make_shared<TbfNumaAllocator>();
+        UASSERTEEQUAL(allocator->getNode(), -1);
+        UASSERTEEQUAL(allocator->getNbNodes(), nbNodes);
+
+        const long int NbGroups = 17;
+        for(long int idxGroup = 0 ; idxGroup < NbGroups ; ++idxGroup){
+            auto groupAllocator = std::dynamic_pointer_cast<TbfNumaAllocator>(allocator->getAllocatorForGroup(idxGroup, NbGroups));
+            UASSERTETRUE(groupAllocator != nullptr);
+            UASSERTEEQUAL(groupAllocator->getNode(), TbfNuma::GetNodeOfPosition(idxGroup, NbGroups, nbNodes));
+        }
+
+        // An allocator with a node uses it for all the groups
+        auto nodeAllocator = std::make_shared<TbfNumaAllocator>(nbNodes-1);
+        UASSERTEEQUAL(nodeAllocator->getNode(), nbNodes-1);
+        UASSERTETRUE(nodeAllocator->getAllocatorForGroup(0, NbGroups) == nodeAllocator);
+
+        auto memory = nodeAllocator->allocate(1000, 64);
+        UASSERTETRUE(memory.first != nullptr);
+        memory.first[0] = 1;
+        if(nodeAllocator->getNbAllocationsNotPlaced() == 0){
+            UASSERTEEQUAL(TbfNuma::GetNodeOfAddress(memory.first), nbNodes-1);
+        }
+        memory.second(memory.first);
+    }
+
+    void TestTree() {
+        const long int NbParticles = 10000;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        auto allocator = std::make_shared<TbfNumaAllocator>();
+        TreeClass tree(configuration, particlePositions, 50, false, TbfGroupSplitStrategy::FixedSize,
+                       TbfGroupCostModel(), 0, allocator);
+
+        // The groups are on the node of their position in the level (if the system accepted the placement)
+        const int nbNodes = TbfNuma::GetNbNodes();
+        const bool allPlaced = (allocator->getNbAllocationsNotPlaced() == 0);
+        const long int nbParticleGroups = tree.getNbParticleGroups();
+        for(long int idxGroup = 0 ; idxGroup < nbParticleGroups ; ++idxGroup){
+            const int groupNode = tree.getParticleGroups()[idxGroup].getNumaNode();
+            UASSERTETRUE(0 <= groupNode && groupNode < nbNodes);
+            if(allPlaced){
+                UASSERTEEQUAL(groupNode, TbfNuma::GetNodeOfPosition(idxGroup, nbParticleGroups, nbNodes));
+            }
+        }
+        for(long int idxLevel = 0 ; idxLevel < tree.getHeight() ; ++idxLevel){
+            const auto& cellGroups = tree.getCellGroupsAtLevel(idxLevel);
+            const long int nbCellGroups = static_cast<long int>(std::size(cellGroups));
+            for(long int idxGroup = 0 ; idxGroup < nbCellGroups ; ++idxGroup){
+                const int groupNode = cellGroups[idxGroup].getNumaNode();
+                UASSERTETRUE(0 <= groupNode && groupNode < nbNodes);
+                if(allPlaced){
+                    UASSERTEEQUAL(groupNode, TbfNuma::GetNodeOfPosition(idxGroup, nbCellGroups, nbNodes));
+                }
+            }
+        }
+
+        AlgorithmClass algorithm(configuration);
+        algorithm.execute(tree);
+
+        tree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                  const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+            }
+        });
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestNuma::TestNodes, "Test NUMA nodes");
+        Parent::AddTest(&TestNuma::TestAllocatorForGroup, "Test the node of the allocators of the groups");
+        Parent::AddTest(&TestNuma::TestTree, "Test tree with a NUMA allocator");
+    }
+};
+
+// You must do this
+TestClass(TestNuma)
@@ -0,0 +1,141 @@
+// The emulation is tested even if the compiler supports mutexinoutset
+#define TBF_OMP_EMULATE_COMMUTE
+
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/openmp/tbfopenmpcommute.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithm.hpp"
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+#include <vector>
+#include <array>
+#include <atomic>
+
+class TestOpenmpCommute : public UTester< TestOpenmpCommute > {
+    using Parent = UTester< TestOpenmpCommute >;
+
+    void TestEmulator(){
+        const long int NbTasks = 1000;
+
+        TbfOpenmpCommuteEmulator commuteEmulator;
+
+        for(long int idxExecution = 0 ; idxExecution < 3 ; ++idxExecution){
+            std::array<long int, 3> values{{0, 0, 0}};
+            std::array<std::atomic<int>, 3> nbInside;
+            for(auto& inside : nbInside){
+                inside = 0;
+            }
+            std::atomic<long int> nbConcurrentAccesses(0);
+            std::array<long int, 3> finalValues{{-1, -1, -1}};
+
+#pragma omp parallel num_threads(4)
+#pragma omp master
+{
+            // Each task commutes on two values
+            for(long int idxTask = 0 ; idxTask < NbTasks ; ++idxTask){
+                const long int idxFirst = idxTask%3;
+                const long int idxSecond = (idxTask+1+(idxTask/3)%2)%3;
+
+                const unsigned char* ptr_first = reinterpret_cast<const unsigned char*>(&values[idxFirst]);
+                const unsigned char* ptr_second = reinterpret_cast<const unsigned char*>(&values[idxSecond]);
+
+                TbfOpenmpCommuteEmulator::LockSet commuteLocks;
+                commuteEmulator.commuteAccess(commuteLocks, ptr_first);
+                commuteEmulator.commuteAccess(commuteLocks, ptr_second);
+
+#pragma omp task depend(commute:ptr_first[0], ptr_second[0]) default(shared) firstprivate(idxFirst, idxSecond, commuteLocks)
+                {
+                    commuteLocks.acquire();
+                    const int nbInsideFirst = nbInside[idxFirst]++;
+                    const int nbInsideSecond = nbInside[idxSecond]++;
+                    if(nbInsideFirst != 0 || nbInsideSecond != 0){
+                        nbConcurrentAccesses += 1;
+                    }
+                    values[idxFirst] += 1;
+                    values[idxSecond] += 1;
+                    nbInside[idxFirst] -= 1;
+                    nbInside[idxSecond] -= 1;
+                    commuteLocks.release();
+                }
+            }
+            // The reads must wait for all the commutative writes
+            for(long int idxValue = 0 ; idxValue < 3 ; ++idxValue){
+                const unsigned char* ptr_value = reinterpret_cast<const unsigned char*>(&values[idxValue]);
+                commuteEmulator.readAccess(ptr_value);
+
+#pragma omp task depend(in:ptr_value[0]) default(shared) firstprivate(idxValue)
+                {
+                    finalValues[idxValue] = values[idxValue];
+                }
+            }
+#pragma omp taskwait
+}
+            commuteEmulator.reset();
+
+            UASSERTEEQUAL(nbConcurrentAccesses.load(), 0L);
+            UASSERTEEQUAL(values[0] + values[1] + values[2], 2*NbTasks);
+            for(long int idxValue = 0 ; idxValue < 3 ; ++idxValue){
+                UASSERTEEQUAL(finalValues[idxValue], values[idxValue]);
+            }
+        }
+    }
+
+    void TestAlgorithm(){
+        using RealType = double;
+        const int Dim = 3;
+        const long int NbParticles = 5000;
+
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                                  std::array<long int,1>, std::array<long int,1>>;
+        using AlgorithmClass = TbfOpenmpAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        for(long int blockSize : {1L, 30L, 1000L}){
+            TreeClass tree(configuration, particlePositions, blockSize);
+
+            AlgorithmClass algorithm(configuration);
+
+            for(bool useInteractionPlan : {false, true}){
+                algorithm.setUseInteractionPlan(useInteractionPlan);
+                algorithm.execute(tree);
+
+                tree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                          const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                    for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                        UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+                        particleRhsPtr[0][idxPart] = 0;
+                    }
+                });
+                tree.applyToAllCells([](const long int /*inLevel*/, auto&& /*cellHeader*/,
+                                        const std::optional<std::reference_wrapper<std::array<long int,1>>> cellMultipole,
+                                        const std::optional<std::reference_wrapper<std::array<long int,1>>> cellLocal){
+                    cellMultipole->get()[0] = 0;
+                    cellLocal->get()[0] = 0;
+                });
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestOpenmpCommute::TestEmulator, "Test the emulation of the commutative accesses");
+        Parent::AddTest(&TestOpenmpCommute::TestAlgorithm, "Test the OpenMP algorithm with the emulated commutative accesses");
+    }
+};
+
+// You must do this
+TestClass(TestOpenmpCommute)
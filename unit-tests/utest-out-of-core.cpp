@@ -0,0 +1,210 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "containers/tbfmappedfileallocator.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+
+// Test kernel that looks at the number of resident pages of the allocator during the execution
+class TbfResidencyKernel : public TbfTestKernel<double> {
+    using Parent = TbfTestKernel<double>;
+
+    void sampleResidentPages() const{
+        nbCalls += 1;
+        if(allocator && nbCalls % 2048 == 0){
+            peakResidentPages = std::max(peakResidentPages, allocator->getNbResidentPages());
+        }
+    }
+
+public:
+    inline static std::shared_ptr<TbfMappedFileAllocator> allocator;
+    inline static long int nbCalls = 0;
+    inline static long int peakResidentPages = 0;
+
+    using Parent::Parent;
+
+    template <class ... Params>
+    void P2M(Params&& ... inParams) const {
+        Parent::P2M(std::forward<Params>(inParams)...);
+        sampleResidentPages();
+    }
+
+    template <class ... Params>
+    void M2L(Params&& ... inParams) const {
+        Parent::M2L(std::forward<Params>(inParams)...);
+        sampleResidentPages();
+    }
+
+    template <class ... Params>
+    void L2P(Params&& ... inParams) const {
+        Parent::L2P(std::forward<Params>(inParams)...);
+        sampleResidentPages();
+    }
+
+    template <class ... Params>
+    void P2P(Params&& ... inParams) const {
+        Parent::P2P(std::forward<Params>(inParams)...);
+        sampleResidentPages();
+    }
+};
+
+class TestOutOfCore : public UTester< TestOutOfCore > {
+    using Parent = UTester< TestOutOfCore >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+    void checkResult(TreeClass& inTree, const long int inNbParticles){
+        inTree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                    const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], inNbParticles-1);
+            }
+        });
+    }
+
+    void TestAllocator() {
+        auto allocator = std::make_shared<TbfMappedFileAllocator>();
+        UASSERTETRUE(allocator->isOpen());
+        UASSERTEEQUAL(allocator->getAllocatedSizeInByte(), 0L);
+
+        {
+            TbfMemoryBlock<TbfMemoryVector<long int>> block;
+            block.resetBlocksFromSizes(std::array<long int, 1>{{100}});
+            UASSERTETRUE(block.getPtr() != nullptr);
+            // The memory that comes from new[] is replaced
+            block.setAllocator(allocator);
+            block.resetBlocksFromSizes(std::array<long int, 1>{{100}});
+            UASSERTETRUE(allocator->getAllocatedSizeInByte() > 0);
+
+            auto viewer = block.getViewerForBlock<0>();
+            for(long int idx = 0 ; idx < 100 ; ++idx){
+                viewer.getItem(idx) = idx;
+            }
+            // The content must be kept
+            block.adviseDoNotNeed();
+            block.adviseWillNeed();
+            for(long int idx = 0 ; idx < 100 ; ++idx){
+                UASSERTEEQUAL(viewer.getItem(idx), idx);
+            }
+        }
+
+        UASSERTEEQUAL(allocator->getAllocatedSizeInByte(), 0L);
+    }
+
+    void TestTree() {
+        const long int NbParticles = 10000;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        auto allocator = std::make_shared<TbfMappedFileAllocator>();
+
+        {
+            TreeClass tree(configuration, particlePositions, 50, false, TbfGroupSplitStrategy::FixedSize,
+                           TbfGroupCostModel(), 0, allocator);
+            UASSERTETRUE(tree.getAllocator() == allocator);
+            UASSERTETRUE(allocator->getAllocatedSizeInByte() > 0);
+
+            for(long int window : {0L, 1L, 4L}){
+                AlgorithmClass algorithm(configuration);
+                algorithm.setOutOfCoreWindow(window);
+                UASSERTEEQUAL(algorithm.getOutOfCoreWindow(), window);
+                algorithm.execute(tree);
+                checkResult(tree, NbParticles);
+
+                // Reset the rhs
+                tree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                          const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                    for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                        particleRhsPtr[0][idxPart] = 0;
+                    }
+                });
+                tree.rebuild();
+            }
+        }
+
+        UASSERTEEQUAL(allocator->getAllocatedSizeInByte(), 0L);
+    }
+
+    // With a window, the pages of the groups that are not in the window must be evicted
+    void TestResidency() {
+        const long int NbParticles = 100000;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(6, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        auto allocator = std::make_shared<TbfMappedFileAllocator>();
+
+        {
+            TreeClass tree(configuration, particlePositions, 64, false, TbfGroupSplitStrategy::FixedSize,
+                           TbfGroupCostModel(), 0, allocator);
+
+            // Release everything that has been filled by the construction
+            for(long int idxLevel = 0 ; idxLevel < configuration.getTreeHeight() ; ++idxLevel){
+                for(auto& group : tree.getCellGroupsAtLevel(idxLevel)){
+                    group.adviseDoNotNeed();
+                }
+            }
+            for(auto& group : tree.getParticleGroups()){
+                group.adviseDoNotNeed();
+            }
+
+            const long int nbPages = allocator->getAllocatedSizeInByte()/allocator->getPageSize();
+            std::cout << "Resident pages after the release " << allocator->getNbResidentPages() << " / " << nbPages << std::endl;
+            if(allocator->getNbResidentPages() != 0){
+                std::cout << "The pages cannot be evicted from this file system, the test is skipped" << std::endl;
+                return;
+            }
+
+            TbfResidencyKernel::allocator = allocator;
+            TbfResidencyKernel::nbCalls = 0;
+            TbfResidencyKernel::peakResidentPages = 0;
+
+            TbfAlgorithm<RealType, TbfResidencyKernel> algorithm(configuration);
+            algorithm.setOutOfCoreWindow(2);
+            algorithm.execute(tree);
+
+            TbfResidencyKernel::allocator.reset();
+
+            std::cout << "Peak of resident pages " << TbfResidencyKernel::peakResidentPages << " / " << nbPages << std::endl;
+            UASSERTETRUE(TbfResidencyKernel::peakResidentPages > 0);
+            UASSERTETRUE(TbfResidencyKernel::peakResidentPages < nbPages/10);
+
+            checkResult(tree, NbParticles);
+        }
+
+        UASSERTEEQUAL(allocator->getAllocatedSizeInByte(), 0L);
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestOutOfCore::TestAllocator, "Test mapped file allocator");
+        Parent::AddTest(&TestOutOfCore::TestTree, "Test tree with an out-of-core allocator");
+        Parent::AddTest(&TestOutOfCore::TestResidency, "Test the resident pages with an out-of-core window");
+    }
+};
+
+// You must do this
+TestClass(TestOutOfCore)
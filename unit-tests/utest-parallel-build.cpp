@@ -0,0 +1,205 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbfparallel.hpp"
+#include "core/tbfparticlesorter.hpp"
+#include "core/tbftree.hpp"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+class TestParallelBuild : public UTester< TestParallelBuild > {
+    using Parent = UTester< TestParallelBuild >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+
+    std::vector<std::array<RealType, Dim>> generateParticles(const TbfSpacialConfiguration<RealType, Dim>& inConfiguration,
+                                                             const long int inNbParticles){
+        TbfRandom<RealType, Dim> randomGenerator(inConfiguration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(inNbParticles);
+        for(long int idxPart = 0 ; idxPart < inNbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+        // Duplicate some positions to have equal keys
+        for(long int idxPart = 1 ; idxPart < inNbParticles ; idxPart += 7){
+            particlePositions[idxPart] = particlePositions[idxPart-1];
+        }
+        return particlePositions;
+    }
+
+    void TestSort() {
+        TbfRandom<double, 1> randomGenerator(std::array<double, 1>{{100}});
+
+        for(long int nbElements : {0L, 1L, 10L, 5000L, 100000L}){
+            std::vector<std::pair<long int, long int>> values(nbElements);
+            for(long int idx = 0 ; idx < nbElements ; ++idx){
+                values[idx].first = static_cast<long int>(randomGenerator.getNewItem()[0]);
+                values[idx].second = idx;
+            }
+
+            auto reference = values;
+            std::sort(reference.begin(), reference.end());
+
+            for(int nbThreads : {1, 2, 3, 4, 7}){
+                auto sortedValues = values;
+                TbfParallel::Sort(sortedValues.begin(), sortedValues.end(), [](const auto& v1, const auto& v2){
+                    return v1 < v2;
+                }, nbThreads);
+                UASSERTETRUE(sortedValues == reference);
+            }
+        }
+    }
+
+    void TestRunConcurrently() {
+        std::atomic<long int> nbCalls{0};
+        TbfParallel::RunConcurrently([&](){ nbCalls += 1; }, [&](){ nbCalls += 10; });
+        UASSERTEEQUAL(nbCalls.load(), 11L);
+
+        // The thread is joined when one of the functions throws
+        for(const bool throwInBackground : {false, true}){
+            nbCalls = 0;
+            bool hasThrown = false;
+            try{
+                TbfParallel::RunConcurrently([&](){
+                    nbCalls += 1;
+                    if(throwInBackground){
+                        throw std::runtime_error("background");
+                    }
+                }, [&](){
+                    nbCalls += 10;
+                    if(!throwInBackground){
+                        throw std::runtime_error("foreground");
+                    }
+                });
+            }
+            catch(const std::runtime_error& exception){
+                hasThrown = true;
+                UASSERTETRUE(std::string(exception.what()) == (throwInBackground ? "background" : "foreground"));
+            }
+            UASSERTETRUE(hasThrown);
+            UASSERTEEQUAL(nbCalls.load(), 11L);
+        }
+    }
+
+    void TestSorter() {
+        const TbfSpacialConfiguration<RealType, Dim> configuration(6, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const TbfDefaultSpaceIndexType<RealType> spaceSystem(configuration);
+
+        const auto particlePositions = generateParticles(configuration, 50000);
+
+        const TbfParticleSorter<RealType> referenceSorter(spaceSystem, particlePositions, 1);
+
+        for(int nbThreads : {2, 3, 4}){
+            const TbfParticleSorter<RealType> sorter(spaceSystem, particlePositions, nbThreads);
+
+            UASSERTEEQUAL(sorter.getNbLeaves(), referenceSorter.getNbLeaves());
+            UASSERTEEQUAL(sorter.getNbParticles(), referenceSorter.getNbParticles());
+
+            for(long int idxLeaf = 0 ; idxLeaf < referenceSorter.getNbLeaves() ; ++idxLeaf){
+                UASSERTEEQUAL(sorter.getSpacialIndexForLeaf(idxLeaf), referenceSorter.getSpacialIndexForLeaf(idxLeaf));
+                UASSERTEEQUAL(sorter.getNbParticlesInLeaf(idxLeaf), referenceSorter.getNbParticlesInLeaf(idxLeaf));
+            }
+
+            for(long int idxPart = 0 ; idxPart < referenceSorter.getNbParticles() ; ++idxPart){
+                UASSERTEEQUAL(sorter.getParticleIndex(idxPart), referenceSorter.getParticleIndex(idxPart));
+            }
+
+            const auto groups = sorter.splitInGroups(100);
+            const auto referenceGroups = referenceSorter.splitInGroups(100);
+            UASSERTEEQUAL(groups.size(), referenceGroups.size());
+
+            long int nbParticlesInGroups = 0;
+            for(size_t idxGroup = 0 ; idxGroup < groups.size() ; ++idxGroup){
+                UASSERTEEQUAL(groups[idxGroup].getNbLeaves(), referenceGroups[idxGroup].getNbLeaves());
+                UASSERTEEQUAL(groups[idxGroup].getNbParticles(), referenceGroups[idxGroup].getNbParticles());
+                nbParticlesInGroups += groups[idxGroup].getNbParticles();
+            }
+            UASSERTEEQUAL(nbParticlesInGroups, sorter.getNbParticles());
+        }
+    }
+
+    void compareTrees(const TreeClass& inTree1, const TreeClass& inTree2){
+        UASSERTEEQUAL(inTree1.getNbParticleGroups(), inTree2.getNbParticleGroups());
+
+        for(long int idxGroup = 0 ; idxGroup < std::min(inTree1.getNbParticleGroups(), inTree2.getNbParticleGroups()) ; ++idxGroup){
+            const auto& group1 = inTree1.getParticleGroups()[idxGroup];
+            const auto& group2 = inTree2.getParticleGroups()[idxGroup];
+
+            UASSERTEEQUAL(group1.getNbLeaves(), group2.getNbLeaves());
+            UASSERTEEQUAL(group1.getNbParticles(), group2.getNbParticles());
+
+            for(long int idxLeaf = 0 ; idxLeaf < std::min(group1.getNbLeaves(), group2.getNbLeaves()) ; ++idxLeaf){
+                UASSERTEEQUAL(group1.getLeafSpacialIndex(idxLeaf), group2.getLeafSpacialIndex(idxLeaf));
+                UASSERTEEQUAL(group1.getNbParticlesInLeaf(idxLeaf), group2.getNbParticlesInLeaf(idxLeaf));
+
+                if(group1.getNbParticlesInLeaf(idxLeaf) == group2.getNbParticlesInLeaf(idxLeaf)){
+                    const long int* indexes1 = group1.getParticleIndexes(idxLeaf);
+                    const long int* indexes2 = group2.getParticleIndexes(idxLeaf);
+                    UASSERTETRUE(std::equal(indexes1, indexes1 + group1.getNbParticlesInLeaf(idxLeaf), indexes2));
+                }
+            }
+        }
+
+        for(long int idxLevel = 0 ; idxLevel < inTree1.getHeight() ; ++idxLevel){
+            UASSERTEEQUAL(inTree1.getNbCellGroupsAtLevel(idxLevel), inTree2.getNbCellGroupsAtLevel(idxLevel));
+
+            for(long int idxGroup = 0 ; idxGroup < std::min(inTree1.getNbCellGroupsAtLevel(idxLevel), inTree2.getNbCellGroupsAtLevel(idxLevel)) ; ++idxGroup){
+                const auto& group1 = inTree1.getCellGroupsAtLevel(idxLevel)[idxGroup];
+                const auto& group2 = inTree2.getCellGroupsAtLevel(idxLevel)[idxGroup];
+
+                UASSERTEEQUAL(group1.getNbCells(), group2.getNbCells());
+                for(long int idxCell = 0 ; idxCell < std::min(group1.getNbCells(), group2.getNbCells()) ; ++idxCell){
+                    UASSERTEEQUAL(group1.getCellSpacialIndex(idxCell), group2.getCellSpacialIndex(idxCell));
+                }
+            }
+        }
+    }
+
+    void TestTree() {
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const auto particlePositions = generateParticles(configuration, 20000);
+
+        for(bool oneGroupPerParent : {false, true}){
+            for(long int nbElementsPerBlock : {1L, 10L, 200L}){
+#ifdef _OPENMP
+                const int defaultNbThreads = omp_get_max_threads();
+                omp_set_num_threads(1);
+#endif
+                const TreeClass referenceTree(configuration, particlePositions, nbElementsPerBlock, oneGroupPerParent);
+#ifdef _OPENMP
+                omp_set_num_threads(4);
+#endif
+                const TreeClass tree(configuration, particlePositions, nbElementsPerBlock, oneGroupPerParent);
+#ifdef _OPENMP
+                omp_set_num_threads(defaultNbThreads);
+#endif
+                compareTrees(referenceTree, tree);
+
+                TreeClass rebuiltTree(configuration, particlePositions, nbElementsPerBlock, oneGroupPerParent);
+                rebuiltTree.rebuild();
+                compareTrees(referenceTree, rebuiltTree);
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestParallelBuild::TestSort, "Test parallel sort");
+        Parent::AddTest(&TestParallelBuild::TestRunConcurrently, "Test concurrent execution with exceptions");
+        Parent::AddTest(&TestParallelBuild::TestSorter, "Test particle sorter with several threads");
+        Parent::AddTest(&TestParallelBuild::TestTree, "Test tree built with several threads");
+    }
+};
+
+// You must do this
+TestClass(TestParallelBuild)
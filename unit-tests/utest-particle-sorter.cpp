@@ -0,0 +1,92 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "utils/tbfradixsort.hpp"
+#include "core/tbfparticlesorter.hpp"
+
+#include <vector>
+#include <array>
+#include <algorithm>
+
+class TestParticleSorter : public UTester< TestParticleSorter > {
+    using Parent = UTester< TestParticleSorter >;
+
+    using RealType = double;
+    static const int Dim = 3;
+    using SpaceIndexType = TbfDefaultSpaceIndexType<RealType>;
+    using IndexType = typename SpaceIndexType::IndexType;
+    using SorterClass = TbfParticleSorter<RealType, SpaceIndexType>;
+
+    void checkAllStrategies(const std::vector<std::pair<IndexType, long int>>& inKeys, const IndexType inUpperBound){
+        auto reference = inKeys;
+        std::sort(reference.begin(), reference.end());
+
+        for(auto strategy : {SorterClass::SortComparison, SorterClass::SortRadix, SorterClass::SortAdaptive}){
+            for(int nbThreads : {1, 3}){
+                auto keys = inKeys;
+                SorterClass::SortParticleIndexes(keys, inUpperBound, nbThreads, strategy);
+                UASSERTETRUE(keys == reference);
+            }
+        }
+    }
+
+    void TestRadix() {
+        UASSERTEEQUAL(TbfRadixSort::GetNbSignificantBits(1L), 0L);
+        UASSERTEEQUAL(TbfRadixSort::GetNbSignificantBits(2L), 1L);
+        UASSERTEEQUAL(TbfRadixSort::GetNbSignificantBits(8L), 3L);
+        UASSERTEEQUAL(TbfRadixSort::GetNbSignificantBits(9L), 4L);
+
+        TbfRandom<RealType, 1> randomGenerator(std::array<RealType, 1>{{1}});
+
+        for(long int upperBound : {1L, 8L, 1000L, 1L<<21, 1L<<40}){
+            for(long int nbElements : {0L, 1L, 100L, 50000L}){
+                std::vector<std::pair<IndexType, long int>> keys(nbElements);
+                for(long int idx = 0 ; idx < nbElements ; ++idx){
+                    keys[idx].first = std::min(upperBound-1, static_cast<IndexType>(randomGenerator.getNewItem()[0]*RealType(upperBound)));
+                    keys[idx].second = idx;
+                }
+                checkAllStrategies(keys, upperBound);
+            }
+        }
+    }
+
+    void TestPresorted() {
+        const TbfSpacialConfiguration<RealType, Dim> configuration(6, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const SpaceIndexType spaceSystem(configuration);
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        const long int nbElements = 100000;
+        std::vector<std::pair<IndexType, long int>> keys(nbElements);
+        for(long int idx = 0 ; idx < nbElements ; ++idx){
+            keys[idx].first = spaceSystem.getIndexFromPosition(randomGenerator.getNewItem());
+        }
+        std::sort(keys.begin(), keys.end());
+        for(long int idx = 0 ; idx < nbElements ; ++idx){
+            keys[idx].second = idx;
+        }
+
+        checkAllStrategies(keys, spaceSystem.getUpperBoundAtLeafLevel());
+
+        // Move few elements
+        for(long int idx = 0 ; idx < nbElements ; idx += 500){
+            keys[idx].first = spaceSystem.getIndexFromPosition(randomGenerator.getNewItem());
+        }
+        checkAllStrategies(keys, spaceSystem.getUpperBoundAtLeafLevel());
+
+        // Reverse order
+        for(long int idx = 0 ; idx < nbElements ; ++idx){
+            keys[idx].first = spaceSystem.getUpperBoundAtLeafLevel() - 1 - (idx % spaceSystem.getUpperBoundAtLeafLevel());
+        }
+        checkAllStrategies(keys, spaceSystem.getUpperBoundAtLeafLevel());
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestParticleSorter::TestRadix, "Test radix sort");
+        Parent::AddTest(&TestParticleSorter::TestPresorted, "Test sort of nearly sorted keys");
+    }
+};
+
+// You must do this
+TestClass(TestParticleSorter)
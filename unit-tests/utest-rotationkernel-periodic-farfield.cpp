@@ -0,0 +1,159 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/rotationkernel/FRotationKernel.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+#include "algorithms/periodic/tbfalgorithmperiodictoptree.hpp"
+#include "utils/tbfaccuracychecker.hpp"
+
+#include <vector>
+#include <array>
+#include <complex>
+#include <string>
+#include <cstdio>
+#include <filesystem>
+
+// The precomputed far-field operator must give the same result as the
+// iterative top tree (up to the rounding errors) with a real kernel
+class TestRotationKernelPeriodicFarField : public UTester< TestRotationKernelPeriodicFarField > {
+    using Parent = UTester< TestRotationKernelPeriodicFarField >;
+
+    using RealType = double;
+    static const int Dim = 3;
+    static const unsigned int P = 8;
+    static const long int NbDataValuesPerParticle = Dim+1;
+    static const long int NbRhsValuesPerParticle = 4;
+    static const long int VectorSize = ((P+2)*(P+1))/2;
+
+    using MultipoleClass = std::array<std::complex<RealType>, VectorSize>;
+    using LocalClass = std::array<std::complex<RealType>, VectorSize>;
+
+    using SpacialSystemPeriodic = TbfDefaultSpaceIndexTypePeriodic<RealType>;
+    using KernelClass = FRotationKernel<RealType, P, SpacialSystemPeriodic>;
+    using AlgorithmClass = TbfAlgorithm<RealType, KernelClass, SpacialSystemPeriodic>;
+    using TopPeriodicAlgorithmClass = TbfAlgorithmPeriodicTopTree<RealType, KernelClass, MultipoleClass, LocalClass, SpacialSystemPeriodic>;
+    using TreeClass = TbfTree<RealType,
+                              RealType,
+                              NbDataValuesPerParticle,
+                              RealType,
+                              NbRhsValuesPerParticle,
+                              MultipoleClass,
+                              LocalClass,
+                              SpacialSystemPeriodic>;
+
+    // Runs the periodic FMM and returns the rhs of the particles (sorted by their original indexes)
+    std::vector<std::array<RealType, NbRhsValuesPerParticle>> ExecuteFmm(const TbfSpacialConfiguration<RealType, Dim>& inConfiguration,
+                                                                        const std::vector<std::array<RealType, Dim+1>>& inParticlePositions,
+                                                                        TopPeriodicAlgorithmClass& inTopAlgorithm,
+                                                                        TreeClass& inTree){
+        AlgorithmClass algorithm(inConfiguration, TbfDefaultLastLevelPeriodic);
+
+        algorithm.execute(inTree, TbfAlgorithmUtils::TbfBottomToTopStages);
+        inTopAlgorithm.execute(inTree);
+        algorithm.execute(inTree, TbfAlgorithmUtils::TbfTransferStages);
+        algorithm.execute(inTree, TbfAlgorithmUtils::TbfTopToBottomStages);
+
+        std::vector<std::array<RealType, NbRhsValuesPerParticle>> particlesRhs(inParticlePositions.size());
+        inTree.applyToAllLeaves([&particlesRhs](auto&& leafHeader, const long int* particleIndexes,
+                                const std::array<RealType*, NbDataValuesPerParticle> /*particleDataPtr*/,
+                                const std::array<RealType*, NbRhsValuesPerParticle> particleRhsPtr){
+            for(int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                    particlesRhs[particleIndexes[idxPart]][idxValue] = particleRhsPtr[idxValue][idxPart];
+                }
+            }
+        });
+        return particlesRhs;
+    }
+
+    void CheckSameRhs(const std::vector<std::array<RealType, NbRhsValuesPerParticle>>& inGoodRhs,
+                      const std::vector<std::array<RealType, NbRhsValuesPerParticle>>& inTestRhs){
+        UASSERTEEQUAL(inGoodRhs.size(), inTestRhs.size());
+
+        std::array<TbfAccuracyChecker<RealType>, NbRhsValuesPerParticle> partcilesRhsAccuracy;
+        for(long int idxPart = 0 ; idxPart < static_cast<long int>(inGoodRhs.size()) ; ++idxPart){
+            for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+                partcilesRhsAccuracy[idxValue].addValues(inGoodRhs[idxPart][idxValue], inTestRhs[idxPart][idxValue]);
+            }
+        }
+
+        for(int idxValue = 0 ; idxValue < NbRhsValuesPerParticle ; ++idxValue){
+            std::cout << " - Rhs " << idxValue << " = " << partcilesRhsAccuracy[idxValue] << std::endl;
+            UASSERTETRUE(partcilesRhsAccuracy[idxValue].getRelativeL2Norm() < 1e-12);
+        }
+    }
+
+    void CorePart(const long int NbParticles, const long int TreeHeight, const long int NbLevelsAbove0){
+        const std::array<RealType, Dim> BoxWidths{{1, 1, 1}};
+        const std::array<RealType, Dim> BoxCenter{{0.5, 0.5, 0.5}};
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, BoxWidths, BoxCenter);
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim+1>> particlePositions(NbParticles);
+
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            auto pos = randomGenerator.getNewItem();
+            particlePositions[idxPart][0] = pos[0];
+            particlePositions[idxPart][1] = pos[1];
+            particlePositions[idxPart][2] = pos[2];
+            // Such that the sum of the charges is zero
+            particlePositions[idxPart][3] = (idxPart%2 ? RealType(0.01) : RealType(-0.01));
+        }
+
+        /////////////////////////////////////////////////////////////////////////////////////////
+
+        const std::string filename = (std::filesystem::temp_directory_path()
+                                      / "utest-rotationkernel-periodic-farfield.tbffarf").string();
+        std::remove(filename.c_str());
+
+        // Iterative top tree
+        TreeClass treeIterative(configuration, TbfUtils::make_const(particlePositions), 100, true);
+        TopPeriodicAlgorithmClass topAlgorithmIterative(configuration, NbLevelsAbove0);
+        const auto rhsIterative = ExecuteFmm(configuration, particlePositions, topAlgorithmIterative, treeIterative);
+
+        // Operator computed from the top tree
+        TreeClass treeOperator(configuration, TbfUtils::make_const(particlePositions), 100, true);
+        TopPeriodicAlgorithmClass topAlgorithmOperator(configuration, NbLevelsAbove0);
+        UASSERTETRUE(topAlgorithmOperator.loadOrComputeFarFieldOperator(treeOperator, filename));
+        UASSERTETRUE(topAlgorithmOperator.hasFarFieldOperator());
+        const auto rhsOperator = ExecuteFmm(configuration, particlePositions, topAlgorithmOperator, treeOperator);
+
+        // Operator loaded from the file
+        TreeClass treeLoaded(configuration, TbfUtils::make_const(particlePositions), 100, true);
+        TopPeriodicAlgorithmClass topAlgorithmLoaded(configuration, NbLevelsAbove0);
+        UASSERTETRUE(topAlgorithmLoaded.loadFarFieldOperator(filename));
+        const auto rhsLoaded = ExecuteFmm(configuration, particlePositions, topAlgorithmLoaded, treeLoaded);
+
+        std::remove(filename.c_str());
+
+        std::cout << "Relative differences (NbParticles " << NbParticles << ", TreeHeight " << TreeHeight
+                  << ", NbLevelsAbove0 " << NbLevelsAbove0 << "):" << std::endl;
+        std::cout << "Between the iterative top tree and the computed operator" << std::endl;
+        CheckSameRhs(rhsIterative, rhsOperator);
+        std::cout << "Between the iterative top tree and the loaded operator" << std::endl;
+        CheckSameRhs(rhsIterative, rhsLoaded);
+    }
+
+    void TestFarFieldOperator() {
+        for(long int idxTreeHeight = 3 ; idxTreeHeight < 5 ; ++idxTreeHeight){
+            for(long int idxNbLevelsAbove0 = 0 ; idxNbLevelsAbove0 < 3 ; ++idxNbLevelsAbove0){
+                CorePart(1000, idxTreeHeight, idxNbLevelsAbove0);
+            }
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestRotationKernelPeriodicFarField::TestFarFieldOperator, "Compare the periodic far field operator to the top tree with the rotation kernel");
+    }
+};
+
+// You must do this
+TestClass(TestRotationKernelPeriodicFarField)
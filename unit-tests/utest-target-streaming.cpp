@@ -0,0 +1,158 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftreetsm.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/tbftargetstreaming.hpp"
+#include "algorithms/sequential/tbfalgorithmtsm.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithmtsm.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithmtsm.hpp"
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+#include <vector>
+#include <array>
+#include <stdexcept>
+
+class TestTargetStreaming : public UTester< TestTargetStreaming > {
+    using Parent = UTester< TestTargetStreaming >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTreeTsm<RealType, RealType, Dim, long int, 1,
+                                 std::array<long int,1>, std::array<long int,1>>;
+    using KernelClass = TbfTestKernel<RealType>;
+
+    template <class AlgorithmClass>
+    void CorePart(const long int NbSources, const long int NbTargetsPerBatch, const long int NbBatches,
+                  const long int TreeHeight, const long int NbElementsPerBlock){
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositionsSource(NbSources);
+        for(long int idxPart = 0 ; idxPart < NbSources ; ++idxPart){
+            particlePositionsSource[idxPart] = randomGenerator.getNewItem();
+        }
+
+        std::vector<std::vector<std::array<RealType, Dim>>> particlePositionsTarget(NbBatches);
+        for(auto& batch : particlePositionsTarget){
+            batch.resize(NbTargetsPerBatch);
+            for(auto& position : batch){
+                position = randomGenerator.getNewItem();
+            }
+        }
+
+        // The tree is created without targets
+        TreeClass tree(configuration, particlePositionsSource, std::vector<std::array<RealType, Dim>>(), NbElementsPerBlock);
+        UASSERTEEQUAL(tree.getNbParticleGroupsTarget(), 0L);
+
+        AlgorithmClass algorithm(configuration);
+
+        std::vector<long int> nbTargetsPerBatch(NbBatches, 0);
+
+        TbfTargetStreaming::Execute(algorithm, tree, NbBatches,
+                                    [&](const long int inIdxBatch) -> const std::vector<std::array<RealType, Dim>>& {
+            return particlePositionsTarget[inIdxBatch];
+        },
+                                    [&](const long int inIdxBatch, TreeClass& inTree){
+            inTree.applyToAllLeavesTarget([&](auto&& leafHeader, const long int* particleIndexes,
+                                          const std::array<RealType*, Dim> particleDataPtr, const std::array<long int*, 1> particleRhsPtr){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    // Each target interacts with all the sources
+                    UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbSources);
+                    // The tree contains the targets of the current batch
+                    for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                        UASSERTEEQUAL(particleDataPtr[idxDim][idxPart], particlePositionsTarget[inIdxBatch][particleIndexes[idxPart]][idxDim]);
+                    }
+                }
+                nbTargetsPerBatch[inIdxBatch] += leafHeader.nbParticles;
+            });
+        });
+
+        for(long int idxBatch = 0 ; idxBatch < NbBatches ; ++idxBatch){
+            UASSERTEEQUAL(nbTargetsPerBatch[idxBatch], NbTargetsPerBatch);
+        }
+
+        // The upward pass is done only once (the P2M of the test kernel accumulates)
+        tree.applyToAllLeavesSource([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                    const std::array<RealType*, Dim> /*particleDataPtr*/, auto&& /*particleRhsPtr*/){
+            auto groupForCell = tree.findGroupWithCellSource(TreeHeight-1, leafHeader.spaceIndex);
+            UASSERTETRUE(static_cast<bool>(groupForCell));
+            UASSERTEEQUAL((*groupForCell).first.get().getCellMultipole((*groupForCell).second)[0], leafHeader.nbParticles);
+        });
+    }
+
+    template <class AlgorithmClass>
+    void TestAlgorithm(){
+        for(const long int idxTreeHeight : std::vector<long int>{{3, 5}}){
+            for(const long int idxNbElementsPerBlock : std::vector<long int>{{1, 50, 10000}}){
+                CorePart<AlgorithmClass>(1000, 200, 4, idxTreeHeight, idxNbElementsPerBlock);
+                CorePart<AlgorithmClass>(1000, 1, 3, idxTreeHeight, idxNbElementsPerBlock);
+                CorePart<AlgorithmClass>(1, 500, 2, idxTreeHeight, idxNbElementsPerBlock);
+            }
+        }
+    }
+
+    // An exception thrown while a batch is computed is propagated
+    // after the builder of the next batch has been joined
+    void TestException(){
+        const TbfSpacialConfiguration<RealType, Dim> configuration(4, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+        std::vector<std::array<RealType, Dim>> particlePositions(1000);
+        for(auto& position : particlePositions){
+            position = randomGenerator.getNewItem();
+        }
+
+        TreeClass tree(configuration, particlePositions, std::vector<std::array<RealType, Dim>>(), 50);
+        TbfAlgorithmTsm<RealType, KernelClass> algorithm(configuration);
+
+        long int nbProcessedBatches = 0;
+        bool hasThrown = false;
+        try{
+            TbfTargetStreaming::Execute(algorithm, tree, 4,
+                                        [&](const long int /*inIdxBatch*/) -> const std::vector<std::array<RealType, Dim>>& {
+                return particlePositions;
+            },
+                                        [&](const long int inIdxBatch, TreeClass& /*inTree*/){
+                nbProcessedBatches += 1;
+                if(inIdxBatch == 1){
+                    throw std::runtime_error("batch");
+                }
+            });
+        }
+        catch(const std::runtime_error&){
+            hasThrown = true;
+        }
+        UASSERTETRUE(hasThrown);
+        UASSERTEEQUAL(nbProcessedBatches, 2L);
+    }
+
+    void TestSequential(){
+        TestAlgorithm<TbfAlgorithmTsm<RealType, KernelClass>>();
+    }
+
+    void TestOpenmp(){
+        TestAlgorithm<TbfOpenmpAlgorithmTsm<RealType, KernelClass>>();
+    }
+
+    void TestThreadpool(){
+        TestAlgorithm<TbfThreadPoolAlgorithmTsm<RealType, KernelClass>>();
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestTargetStreaming::TestException, "Test the target streaming with an exception");
+        Parent::AddTest(&TestTargetStreaming::TestSequential, "Test the target streaming with the sequential algorithm");
+        Parent::AddTest(&TestTargetStreaming::TestOpenmp, "Test the target streaming with the OpenMP algorithm");
+        Parent::AddTest(&TestTargetStreaming::TestThreadpool, "Test the target streaming with the thread pool algorithm");
+    }
+};
+
+// You must do this
+TestClass(TestTargetStreaming)
@@ -0,0 +1,403 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "core/tbftreetsm.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/tbftaskgraph.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithm.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithm.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithmtsm.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithmtsm.hpp"
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+#include <vector>
+#include <array>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+class TestTaskGraph : public UTester< TestTaskGraph > {
+    using Parent = UTester< TestTaskGraph >;
+
+    using RealType = double;
+    static const int Dim = 3;
+    static const long int NbParticles = 3000;
+    static const long int TreeHeight = 5;
+
+    std::vector<long int> getPredecessors(const TbfTaskGraph& inGraph, const long int inIdxNode){
+        std::vector<long int> predecessors = inGraph.getNode(inIdxNode).predecessors;
+        std::sort(predecessors.begin(), predecessors.end());
+        return predecessors;
+    }
+
+    void TestDependencies(){
+        TbfTaskGraph graph;
+        int data1 = 0;
+        int data2 = 0;
+
+        UASSERTETRUE(graph.addTask(TbfTaskTracer::OperationP2M, 0, 0, 0, 1, 1, 0, 0, {TbfTaskGraph::Write(data1)}) == nullptr);
+        UASSERTEEQUAL(graph.getNbNodes(), 0L);
+
+        graph.setEnabled(true);
+        graph.addTask(TbfTaskTracer::OperationP2M, 0, 0, 0, 1, 1, 0, 0, {TbfTaskGraph::Write(data1)});
+        graph.addTask(TbfTaskTracer::OperationM2M, 0, 0, 0, 1, 1, 0, 0, {TbfTaskGraph::Read(data1)});
+        graph.addTask(TbfTaskTracer::OperationM2M, 0, 0, 0, 1, 1, 0, 0, {TbfTaskGraph::Read(data1), TbfTaskGraph::Write(data2)});
+        graph.addTask(TbfTaskTracer::OperationM2L, 0, 0, 0, 1, 1, 0, 0, {TbfTaskGraph::CommuteWrite(data1)});
+        graph.addTask(TbfTaskTracer::OperationM2L, 0, 0, 0, 1, 1, 0, 0, {TbfTaskGraph::Read(data2), TbfTaskGraph::CommuteWrite(data1)});
+        graph.addTask(TbfTaskTracer::OperationL2P, 0, 0, 0, 1, 1, 0, 0, {TbfTaskGraph::Read(data1)});
+        graph.addTask(TbfTaskTracer::OperationP2P, 0, 0, 0, 1, 1, 0, 0, {TbfTaskGraph::Write(data1)});
+
+        UASSERTEEQUAL(graph.getNbNodes(), 7L);
+        UASSERTETRUE(getPredecessors(graph, 0) == std::vector<long int>());
+        UASSERTETRUE(getPredecessors(graph, 1) == std::vector<long int>({0}));
+        UASSERTETRUE(getPredecessors(graph, 2) == std::vector<long int>({0}));
+        // The commutative writes are after the reads, but not ordered between them
+        UASSERTETRUE(getPredecessors(graph, 3) == std::vector<long int>({1, 2}));
+        UASSERTETRUE(getPredecessors(graph, 4) == std::vector<long int>({1, 2}));
+        UASSERTETRUE(getPredecessors(graph, 5) == std::vector<long int>({3, 4}));
+        UASSERTETRUE(getPredecessors(graph, 6) == std::vector<long int>({5}));
+        UASSERTEEQUAL(graph.getNbEdges(), 9L);
+
+        UASSERTEEQUAL(graph.getNbCommuteData(), 1L);
+        UASSERTETRUE(graph.getNode(3).commuteData == std::vector<long int>({0}));
+        UASSERTETRUE(graph.getNode(4).commuteData == std::vector<long int>({0}));
+        UASSERTETRUE(graph.getNode(5).commuteData.empty());
+
+        graph.clear();
+        UASSERTEEQUAL(graph.getNbNodes(), 0L);
+        UASSERTEEQUAL(graph.getNbCommuteData(), 0L);
+        // The data are new after a clear
+        graph.addTask(TbfTaskTracer::OperationL2P, 0, 0, 0, 1, 1, 0, 0, {TbfTaskGraph::Read(data1)});
+        UASSERTETRUE(getPredecessors(graph, 0) == std::vector<long int>());
+    }
+
+    void TestSimulation(){
+        TbfTaskGraph graph;
+        graph.setEnabled(true);
+        std::array<int, 5> data = {};
+
+        // Three independent tasks and a chain
+        graph.addTask(TbfTaskTracer::OperationP2M, 0, 0, 0, 0, 0, 0, 0, {TbfTaskGraph::Write(data[0])});
+        graph.addTask(TbfTaskTracer::OperationP2M, 0, 0, 0, 0, 0, 0, 0, {TbfTaskGraph::Write(data[1])});
+        graph.addTask(TbfTaskTracer::OperationP2M, 0, 0, 0, 0, 0, 0, 0, {TbfTaskGraph::Write(data[2])});
+        graph.addTask(TbfTaskTracer::OperationP2M, 0, 0, 0, 0, 0, 0, 0, {TbfTaskGraph::Write(data[3])});
+        graph.addTask(TbfTaskTracer::OperationL2P, 0, 0, 0, 0, 0, 0, 1, {TbfTaskGraph::Read(data[3])});
+        const std::vector<double> costs = {1, 1, 1, 1, 3};
+
+        {
+            const auto result = graph.simulate(1, TbfTaskGraph::PolicyFifo, costs);
+            UASSERTEEQUAL(result.makespan, 7.);
+            UASSERTEEQUAL(result.totalCost, 7.);
+            UASSERTEEQUAL(result.criticalPath, 4.);
+            UASSERTEEQUAL(result.efficiency, 1.);
+        }
+        {
+            // The chain starts at the second step
+            const auto result = graph.simulate(2, TbfTaskGraph::PolicyFifo, costs);
+            UASSERTEEQUAL(result.makespan, 5.);
+        }
+        {
+            // The priority of the chain is only given to its last task
+            const auto result = graph.simulate(2, TbfTaskGraph::PolicyPriority, costs);
+            UASSERTEEQUAL(result.makespan, 5.);
+        }
+        {
+            const auto result = graph.simulate(2, TbfTaskGraph::PolicyCriticalPath, costs);
+            UASSERTEEQUAL(result.makespan, 4.);
+        }
+        {
+            const auto result = graph.simulate(100, TbfTaskGraph::PolicyFifo, costs);
+            UASSERTEEQUAL(result.makespan, 4.);
+        }
+
+        // The commutative writes cannot be executed at the same time
+        TbfTaskGraph commuteGraph;
+        commuteGraph.setEnabled(true);
+        commuteGraph.addTask(TbfTaskTracer::OperationM2L, 0, 0, 0, 0, 0, 0, 0, {TbfTaskGraph::CommuteWrite(data[0])});
+        commuteGraph.addTask(TbfTaskTracer::OperationM2L, 0, 0, 0, 0, 0, 0, 0, {TbfTaskGraph::CommuteWrite(data[0]), TbfTaskGraph::CommuteWrite(data[1])});
+        commuteGraph.addTask(TbfTaskTracer::OperationM2L, 0, 0, 0, 0, 0, 0, 0, {TbfTaskGraph::CommuteWrite(data[2])});
+        UASSERTEEQUAL(commuteGraph.getNbEdges(), 0L);
+        {
+            const auto result = commuteGraph.simulate(3, TbfTaskGraph::PolicyFifo, {1, 1, 1});
+            UASSERTEEQUAL(result.makespan, 2.);
+            UASSERTEEQUAL(result.criticalPath, 1.);
+        }
+    }
+
+    void TestCosts(){
+        TbfTaskGraph graph;
+        graph.setEnabled(true);
+        int data = 0;
+
+        TbfTaskGraph::CostModel costModel;
+        costModel.p2mPerParticle = 2;
+        costModel.m2lPerInteraction = 3;
+        graph.setCostModel(costModel);
+
+        TbfTaskGraph::Node* nodeP2M = graph.addTask(TbfTaskTracer::OperationP2M, 0, 0, 0, 10, 1, 0, 0, {TbfTaskGraph::Write(data)});
+        graph.addTask(TbfTaskTracer::OperationM2L, 0, 0, 0, 1, 1, 5, 0, {TbfTaskGraph::Read(data)});
+
+        UASSERTEEQUAL(graph.getEstimatedCost(graph.getNode(0)), 20.);
+        UASSERTEEQUAL(graph.getEstimatedCost(graph.getNode(1)), 15.);
+        UASSERTETRUE(graph.getNode(0).measuredCost < 0);
+        UASSERTETRUE(graph.getCosts() == std::vector<double>({20., 15.}));
+
+        {
+            const auto graphTimer = TbfTaskGraph::Measure(nodeP2M);
+        }
+        UASSERTETRUE(graph.getNode(0).measuredCost >= 0);
+
+        // The estimated costs are converted with the ratio of the measured ones
+        nodeP2M->measuredCost = 4;
+        UASSERTETRUE(graph.getCosts() == std::vector<double>({4., 3.}));
+
+        const std::vector<double> bottomLevels = graph.getBottomLevels(graph.getCosts());
+        UASSERTETRUE(bottomLevels == std::vector<double>({7., 3.}));
+    }
+
+    void TestSaveLoad(){
+        TbfTaskGraph graph;
+        graph.setEnabled(true);
+        std::array<int, 3> data = {};
+        graph.addTask(TbfTaskTracer::OperationP2M, 4, 1, 2, 10, 11, 0, 3, {TbfTaskGraph::Write(data[0])});
+        TbfTaskGraph::Node* nodeM2L = graph.addTask(TbfTaskTracer::OperationM2L, 3, 2, 1, 12, 13, 14, 5, {TbfTaskGraph::Read(data[0]), TbfTaskGraph::CommuteWrite(data[1])});
+        graph.addTask(TbfTaskTracer::OperationP2P, 4, 0, 0, 15, 16, 17, 7, {TbfTaskGraph::CommuteWrite(data[1]), TbfTaskGraph::CommuteWrite(data[2])});
+        graph.addTask(TbfTaskTracer::OperationL2P, 4, 0, 0, 15, 16, 0, 7, {TbfTaskGraph::Read(data[1])});
+        nodeM2L->measuredCost = 0.125;
+
+        const std::string filename = "tbfmm-utest-task-graph.txt";
+        UASSERTETRUE(graph.save(filename));
+
+        const auto loadedGraph = TbfTaskGraph::Load(filename);
+        UASSERTETRUE(loadedGraph != nullptr);
+        if(loadedGraph){
+            UASSERTEEQUAL(loadedGraph->getNbNodes(), graph.getNbNodes());
+            UASSERTEEQUAL(loadedGraph->getNbEdges(), graph.getNbEdges());
+            UASSERTEEQUAL(loadedGraph->getNbCommuteData(), graph.getNbCommuteData());
+            for(long int idxNode = 0 ; idxNode < graph.getNbNodes() ; ++idxNode){
+                const auto& node = graph.getNode(idxNode);
+                const auto& loadedNode = loadedGraph->getNode(idxNode);
+                UASSERTEEQUAL(loadedNode.operation, node.operation);
+                UASSERTEEQUAL(loadedNode.level, node.level);
+                UASSERTEEQUAL(loadedNode.idxSrcGroup, node.idxSrcGroup);
+                UASSERTEEQUAL(loadedNode.idxTargetGroup, node.idxTargetGroup);
+                UASSERTEEQUAL(loadedNode.nbSrcItems, node.nbSrcItems);
+                UASSERTEEQUAL(loadedNode.nbTargetItems, node.nbTargetItems);
+                UASSERTEEQUAL(loadedNode.nbInteractions, node.nbInteractions);
+                UASSERTEEQUAL(loadedNode.priority, node.priority);
+                UASSERTEEQUAL(loadedNode.measuredCost, node.measuredCost);
+                UASSERTETRUE(loadedNode.predecessors == node.predecessors);
+                UASSERTETRUE(loadedNode.commuteData == node.commuteData);
+            }
+            UASSERTETRUE(loadedGraph->getCosts() == graph.getCosts());
+        }
+
+        {
+            std::ofstream file(filename, std::ios::trunc);
+            file << "TbfTaskGraph 2 0\nP2M 0 0 0 1 1 0 0 1 -1 0 1 1\n";
+        }
+        // A predecessor must be inserted before the node
+        UASSERTETRUE(TbfTaskGraph::Load(filename) == nullptr);
+        UASSERTETRUE(TbfTaskGraph::Load("tbfmm-utest-task-graph-does-not-exist.txt") == nullptr);
+
+        UASSERTETRUE(graph.exportDot(filename));
+
+        std::remove(filename.c_str());
+    }
+
+    template <class AlgorithmClass>
+    void CheckAlgorithm(const long int inBlockSize, const bool inUseInteractionPlan, long int* outNbNodes, long int* outNbEdges){
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                                  std::array<long int,1>, std::array<long int,1>>;
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        TreeClass tree(configuration, particlePositions, inBlockSize);
+
+        AlgorithmClass algorithm(configuration);
+        algorithm.setUseInteractionPlan(inUseInteractionPlan);
+        algorithm.getTaskGraph().setEnabled(true);
+        algorithm.getTaskTracer().setEnabled(true);
+
+        // The graph is the one of the last execution
+        for(long int idxLoop = 0 ; idxLoop < 2 ; ++idxLoop){
+            algorithm.getTaskTracer().clear();
+            algorithm.execute(tree);
+
+            tree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                      const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+                    particleRhsPtr[0][idxPart] = 0;
+                }
+            });
+            tree.applyToAllCells([](const long int /*inLevel*/, auto&& /*cellHeader*/,
+                                    const std::optional<std::reference_wrapper<std::array<long int,1>>> cellMultipole,
+                                    const std::optional<std::reference_wrapper<std::array<long int,1>>> cellLocal){
+                cellMultipole->get()[0] = 0;
+                cellLocal->get()[0] = 0;
+            });
+        }
+
+        const TbfTaskGraph& graph = algorithm.getTaskGraph();
+        UASSERTEEQUAL(graph.getNbNodes(), static_cast<long int>(algorithm.getTaskTracer().getRecords().size()));
+
+        const long int nbLeafGroups = static_cast<long int>(std::size(tree.getParticleGroups()));
+        std::array<long int, TbfTaskTracer::NbOperations> nbNodesPerOperation = {};
+        long int nbP2PInteractions = 0;
+        for(long int idxNode = 0 ; idxNode < graph.getNbNodes() ; ++idxNode){
+            const auto& node = graph.getNode(idxNode);
+            nbNodesPerOperation[node.operation] += 1;
+            UASSERTETRUE(node.measuredCost >= 0);
+            for(const long int idxPredecessor : node.predecessors){
+                UASSERTETRUE(0 <= idxPredecessor && idxPredecessor < idxNode);
+            }
+            // The P2M have no predecessor, the L2P have at least the P2P of their group
+            if(node.operation == TbfTaskTracer::OperationP2M){
+                UASSERTETRUE(node.predecessors.empty());
+            }
+            if(node.operation == TbfTaskTracer::OperationL2P){
+                UASSERTETRUE(node.predecessors.size() >= 1);
+            }
+            if(node.operation == TbfTaskTracer::OperationP2P){
+                nbP2PInteractions += node.nbInteractions;
+            }
+        }
+        UASSERTEEQUAL(nbNodesPerOperation[TbfTaskTracer::OperationP2M], nbLeafGroups);
+        UASSERTEEQUAL(nbNodesPerOperation[TbfTaskTracer::OperationL2P], nbLeafGroups);
+
+        // Each interaction between two leaves is computed once (plus the inner interactions of the leaves)
+        long int nbLeaves = 0;
+        for(const auto& particleGroup : tree.getParticleGroups()){
+            nbLeaves += particleGroup.getNbLeaves();
+        }
+        UASSERTETRUE(nbP2PInteractions > nbLeaves);
+
+        const auto sequentialResult = graph.simulate(1, TbfTaskGraph::PolicyFifo);
+        UASSERTETRUE(std::abs(sequentialResult.makespan - sequentialResult.totalCost) <= 1e-9 * sequentialResult.totalCost);
+        for(int idxPolicy = 0 ; idxPolicy < TbfTaskGraph::NbPolicies ; ++idxPolicy){
+            const auto result = graph.simulate(64, static_cast<TbfTaskGraph::SchedulingPolicy>(idxPolicy));
+            UASSERTETRUE(result.makespan >= result.criticalPath * (1 - 1e-9));
+            UASSERTETRUE(result.makespan * 64 >= result.totalCost * (1 - 1e-9));
+            UASSERTETRUE(result.makespan <= sequentialResult.makespan * (1 + 1e-9));
+        }
+
+        *outNbNodes = graph.getNbNodes();
+        *outNbEdges = graph.getNbEdges();
+    }
+
+    void TestAlgorithms(){
+        for(long int blockSize : {30L, 1000L}){
+            for(bool useInteractionPlan : {false, true}){
+                long int nbNodesOpenmp = 0;
+                long int nbEdgesOpenmp = 0;
+                CheckAlgorithm<TbfOpenmpAlgorithm<RealType, TbfTestKernel<RealType>>>(blockSize, useInteractionPlan, &nbNodesOpenmp, &nbEdgesOpenmp);
+
+                long int nbNodesThreadPool = 0;
+                long int nbEdgesThreadPool = 0;
+                CheckAlgorithm<TbfThreadPoolAlgorithm<RealType, TbfTestKernel<RealType>>>(blockSize, useInteractionPlan, &nbNodesThreadPool, &nbEdgesThreadPool);
+
+                // The two algorithms insert the same tasks
+                UASSERTEEQUAL(nbNodesOpenmp, nbNodesThreadPool);
+                UASSERTEEQUAL(nbEdgesOpenmp, nbEdgesThreadPool);
+            }
+        }
+    }
+
+    template <class AlgorithmClass>
+    void CheckAlgorithmTsm(const long int inBlockSize, long int* outNbNodes, long int* outNbEdges){
+        using TreeClass = TbfTreeTsm<RealType, RealType, Dim, long int, 1,
+                                     std::array<long int,1>, std::array<long int,1>>;
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositionsSource(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositionsSource[idxPart] = randomGenerator.getNewItem();
+        }
+        std::vector<std::array<RealType, Dim>> particlePositionsTarget(NbParticles/2);
+        for(auto& position : particlePositionsTarget){
+            position = randomGenerator.getNewItem();
+        }
+
+        TreeClass tree(configuration, particlePositionsSource, particlePositionsTarget, inBlockSize);
+
+        AlgorithmClass algorithm(configuration);
+        algorithm.getTaskGraph().setEnabled(true);
+        algorithm.getTaskTracer().setEnabled(true);
+        algorithm.execute(tree);
+
+        tree.applyToAllLeavesTarget([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                        const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles);
+            }
+        });
+
+        const TbfTaskGraph& graph = algorithm.getTaskGraph();
+        UASSERTEEQUAL(graph.getNbNodes(), static_cast<long int>(algorithm.getTaskTracer().getRecords().size()));
+
+        std::array<long int, TbfTaskTracer::NbOperations> nbNodesPerOperation = {};
+        for(long int idxNode = 0 ; idxNode < graph.getNbNodes() ; ++idxNode){
+            const auto& node = graph.getNode(idxNode);
+            nbNodesPerOperation[node.operation] += 1;
+            UASSERTETRUE(node.measuredCost >= 0);
+            for(const long int idxPredecessor : node.predecessors){
+                UASSERTETRUE(0 <= idxPredecessor && idxPredecessor < idxNode);
+            }
+            if(node.operation == TbfTaskTracer::OperationP2M){
+                UASSERTETRUE(node.predecessors.empty());
+            }
+        }
+        UASSERTEEQUAL(nbNodesPerOperation[TbfTaskTracer::OperationP2M], tree.getNbParticleGroupsSource());
+        UASSERTEEQUAL(nbNodesPerOperation[TbfTaskTracer::OperationL2P], tree.getNbParticleGroupsTarget());
+
+        const auto sequentialResult = graph.simulate(1, TbfTaskGraph::PolicyFifo);
+        UASSERTETRUE(std::abs(sequentialResult.makespan - sequentialResult.totalCost) <= 1e-9 * sequentialResult.totalCost);
+
+        *outNbNodes = graph.getNbNodes();
+        *outNbEdges = graph.getNbEdges();
+    }
+
+    void TestAlgorithmsTsm(){
+        for(long int blockSize : {30L, 1000L}){
+            long int nbNodesOpenmp = 0;
+            long int nbEdgesOpenmp = 0;
+            CheckAlgorithmTsm<TbfOpenmpAlgorithmTsm<RealType, TbfTestKernel<RealType>>>(blockSize, &nbNodesOpenmp, &nbEdgesOpenmp);
+
+            long int nbNodesThreadPool = 0;
+            long int nbEdgesThreadPool = 0;
+            CheckAlgorithmTsm<TbfThreadPoolAlgorithmTsm<RealType, TbfTestKernel<RealType>>>(blockSize, &nbNodesThreadPool, &nbEdgesThreadPool);
+
+            UASSERTEEQUAL(nbNodesOpenmp, nbNodesThreadPool);
+            UASSERTEEQUAL(nbEdgesOpenmp, nbEdgesThreadPool);
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestTaskGraph::TestDependencies, "Test the dependencies of the task graph");
+        Parent::AddTest(&TestTaskGraph::TestSimulation, "Test the simulation of the task graph");
+        Parent::AddTest(&TestTaskGraph::TestCosts, "Test the costs of the task graph");
+        Parent::AddTest(&TestTaskGraph::TestSaveLoad, "Test saving and loading the task graph");
+        Parent::AddTest(&TestTaskGraph::TestAlgorithms, "Test the task graph of the algorithms");
+        Parent::AddTest(&TestTaskGraph::TestAlgorithmsTsm, "Test the task graph of the TSM algorithms");
+    }
+};
+
+// You must do this
+TestClass(TestTaskGraph)
@@ -0,0 +1,204 @@
+#include "UTester.hpp"
+
+#include "algorithms/threadpool/tbftaskruntime.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithm.hpp"
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+
+#include <vector>
+#include <array>
+#include <atomic>
+
+class TestTaskRuntime : public UTester< TestTaskRuntime > {
+    using Parent = UTester< TestTaskRuntime >;
+
+    void TestDependencies(){
+        const long int NbLoops = 100;
+        const long int NbReaders = 5;
+
+        for(int nbThreads : {1, 2, 4}){
+            TbfTaskRuntime runtime(nbThreads, 3);
+            UASSERTEEQUAL(runtime.getNbThreads(), nbThreads);
+
+            // The same runtime can be used for several executions
+            for(long int idxExecution = 0 ; idxExecution < 3 ; ++idxExecution){
+                long int value = 0;
+                std::vector<long int> readValues(NbLoops*NbReaders, -1);
+                std::atomic<long int> nbBadWorkerIds(0);
+
+                for(long int idxLoop = 0 ; idxLoop < NbLoops ; ++idxLoop){
+                    runtime.task(int(idxLoop%3), {TbfTaskRuntime::Write(value)}, [&value, &nbBadWorkerIds, nbThreads](){
+                        value += 1;
+                        if(TbfTaskRuntime::GetWorkerId() < 0 || nbThreads <= TbfTaskRuntime::GetWorkerId()){
+                            nbBadWorkerIds += 1;
+                        }
+                    });
+                    for(long int idxReader = 0 ; idxReader < NbReaders ; ++idxReader){
+                        runtime.task(int(idxReader%3), {TbfTaskRuntime::Read(value)}, [&value, &readValues, idxLoop, idxReader](){
+                            readValues[idxLoop*NbReaders + idxReader] = value;
+                        });
+                    }
+                }
+                runtime.waitAllTasks();
+
+                UASSERTEEQUAL(value, NbLoops);
+                UASSERTEEQUAL(nbBadWorkerIds.load(), 0L);
+                for(long int idxLoop = 0 ; idxLoop < NbLoops ; ++idxLoop){
+                    for(long int idxReader = 0 ; idxReader < NbReaders ; ++idxReader){
+                        UASSERTEEQUAL(readValues[idxLoop*NbReaders + idxReader], idxLoop+1);
+                    }
+                }
+            }
+        }
+    }
+
+    void TestCommute(){
+        const long int NbTasks = 1000;
+
+        for(int nbThreads : {1, 2, 4}){
+            TbfTaskRuntime runtime(nbThreads);
+
+            std::array<long int, 3> values{{0, 0, 0}};
+            std::array<std::atomic<int>, 3> nbInside;
+            for(auto& inside : nbInside){
+                inside = 0;
+            }
+            std::atomic<long int> nbConcurrentAccesses(0);
+            std::array<long int, 3> finalValues{{-1, -1, -1}};
+
+            // Each task commutes on two values (in different orders)
+            for(long int idxTask = 0 ; idxTask < NbTasks ; ++idxTask){
+                const long int idxFirst = idxTask%3;
+                const long int idxSecond = (idxTask+1+(idxTask/3)%2)%3;
+                runtime.task(0, {TbfTaskRuntime::CommuteWrite(values[idxFirst]), TbfTaskRuntime::CommuteWrite(values[idxSecond])},
+                             [&, idxFirst, idxSecond](){
+                    const int nbInsideFirst = nbInside[idxFirst]++;
+                    const int nbInsideSecond = nbInside[idxSecond]++;
+                    if(nbInsideFirst != 0 || nbInsideSecond != 0){
+                        nbConcurrentAccesses += 1;
+                    }
+                    values[idxFirst] += 1;
+                    values[idxSecond] += 1;
+                    nbInside[idxFirst] -= 1;
+                    nbInside[idxSecond] -= 1;
+                });
+            }
+            for(long int idxValue = 0 ; idxValue < 3 ; ++idxValue){
+                runtime.task(0, {TbfTaskRuntime::Read(values[idxValue])}, [&, idxValue](){
+                    finalValues[idxValue] = values[idxValue];
+                });
+            }
+            runtime.waitAllTasks();
+
+            UASSERTEEQUAL(nbConcurrentAccesses.load(), 0L);
+            UASSERTEEQUAL(values[0] + values[1] + values[2], 2*NbTasks);
+            for(long int idxValue = 0 ; idxValue < 3 ; ++idxValue){
+                UASSERTEEQUAL(finalValues[idxValue], values[idxValue]);
+            }
+        }
+    }
+
+    void TestHomeNodes(){
+        const long int NbTasks = 2000;
+        const int NbNodes = 2;
+
+        for(int nbThreads : {1, 2, 4}){
+            TbfTaskRuntime runtime(nbThreads, 2, NbNodes);
+            UASSERTEEQUAL(runtime.getNbNodes(), NbNodes);
+            for(int idxWorker = 0 ; idxWorker < nbThreads ; ++idxWorker){
+                UASSERTEEQUAL(runtime.getWorkerNode(idxWorker), TbfNuma::GetNodeOfPosition(idxWorker, nbThreads, NbNodes));
+            }
+
+            // The home nodes must not change the dependencies
+            std::array<long int, 4> values{{0, 0, 0, 0}};
+            std::vector<long int> readValues(NbTasks, -1);
+            std::array<std::atomic<long int>, NbNodes> nbExecutedOnHomeNode;
+            for(auto& nbExecuted : nbExecutedOnHomeNode){
+                nbExecuted = 0;
+            }
+
+            for(long int idxTask = 0 ; idxTask < NbTasks ; ++idxTask){
+                const long int idxValue = idxTask%4;
+                const int homeNode = int(idxValue%NbNodes);
+                runtime.task(int(idxTask%2), homeNode, {TbfTaskRuntime::Write(values[idxValue])},
+                             [&, idxTask, idxValue, homeNode](){
+                    readValues[idxTask] = values[idxValue];
+                    values[idxValue] += 1;
+                    if(runtime.getWorkerNode(TbfTaskRuntime::GetWorkerId()) == homeNode){
+                        nbExecutedOnHomeNode[homeNode] += 1;
+                    }
+                });
+            }
+            runtime.waitAllTasks();
+
+            for(long int idxValue = 0 ; idxValue < 4 ; ++idxValue){
+                UASSERTEEQUAL(values[idxValue], NbTasks/4);
+            }
+            for(long int idxTask = 0 ; idxTask < NbTasks ; ++idxTask){
+                UASSERTEEQUAL(readValues[idxTask], idxTask/4);
+            }
+            // The tasks are executed elsewhere only if the workers of the node are busy
+            std::cout << "Threads " << nbThreads << ", tasks executed on their home node: "
+                      << nbExecutedOnHomeNode[0] + nbExecutedOnHomeNode[1] << "/" << NbTasks << std::endl;
+        }
+    }
+
+    void TestAlgorithmWithPlan(){
+        using RealType = double;
+        const int Dim = 3;
+        const long int NbParticles = 5000;
+
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                                  std::array<long int,1>, std::array<long int,1>>;
+        using AlgorithmClass = TbfThreadPoolAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        TreeClass tree(configuration, particlePositions, 30);
+
+        AlgorithmClass algorithm(configuration);
+        algorithm.setUseInteractionPlan(true);
+
+        for(long int idxExecution = 0 ; idxExecution < 3 ; ++idxExecution){
+            // The last execution distributes the tasks on two nodes
+            if(idxExecution == 2){
+                algorithm.setNbNumaNodes(2);
+                UASSERTEEQUAL(algorithm.getNbNumaNodes(), 2);
+            }
+            algorithm.execute(tree);
+
+            tree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                      const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                    UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+                    particleRhsPtr[0][idxPart] = 0;
+                }
+            });
+            tree.applyToAllCells([](const long int /*inLevel*/, auto&& /*cellHeader*/,
+                                    const std::optional<std::reference_wrapper<std::array<long int,1>>> cellMultipole,
+                                    const std::optional<std::reference_wrapper<std::array<long int,1>>> cellLocal){
+                cellMultipole->get()[0] = 0;
+                cellLocal->get()[0] = 0;
+            });
+        }
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestTaskRuntime::TestDependencies, "Test the dependencies of the task runtime");
+        Parent::AddTest(&TestTaskRuntime::TestCommute, "Test the commutative writes of the task runtime");
+        Parent::AddTest(&TestTaskRuntime::TestHomeNodes, "Test the home nodes of the task runtime");
+        Parent::AddTest(&TestTaskRuntime::TestAlgorithmWithPlan, "Test the thread pool algorithm with the interaction plan");
+    }
+};
+
+// You must do this
+TestClass(TestTaskRuntime)
@@ -0,0 +1,292 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "core/tbftreetsm.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/tbftasktracer.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithm.hpp"
+#include "algorithms/openmp/tbfopenmpalgorithmtsm.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithm.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithmtsm.hpp"
+
+// -- DOT NOT REMOVE AS LONG AS LIBS ARE USED --
+// @TBF_USE_OPENMP
+// -- END --
+
+#include <vector>
+#include <array>
+#include <thread>
+#include <fstream>
+#include <string>
+#include <cstdio>
+
+class TestTaskTracer : public UTester< TestTaskTracer > {
+    using Parent = UTester< TestTaskTracer >;
+
+    using RealType = double;
+    static const int Dim = 3;
+    static const long int NbParticles = 3000;
+    static const long int TreeHeight = 5;
+
+    std::vector<std::array<RealType, Dim>> getParticles(const TbfSpacialConfiguration<RealType, Dim>& inConfiguration){
+        TbfRandom<RealType, Dim> randomGenerator(inConfiguration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+        return particlePositions;
+    }
+
+    static std::string ReadFile(const std::string& inFilename){
+        std::ifstream file(inFilename);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void TestRecords(){
+        const long int capacity = 10;
+        TbfTaskTracer tracer(capacity);
+        UASSERTETRUE(tracer.getEnabled() == false);
+
+        // Disabled, nothing is recorded
+        {
+            const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2M, 1, 2, 3, 4, 5, tracer.now());
+        }
+        UASSERTEEQUAL(long(tracer.getRecords().size()), 0L);
+        UASSERTEEQUAL(tracer.getNbThreads(), 0L);
+
+        tracer.setEnabled(true);
+
+        const int nbThreads = 3;
+        const long int nbTasksPerThread = 7;
+        std::vector<std::thread> threads;
+        for(int idxThread = 0 ; idxThread < nbThreads ; ++idxThread){
+            threads.emplace_back([&, idxThread](){
+                for(long int idxTask = 0 ; idxTask < nbTasksPerThread ; ++idxTask){
+                    const long int submitTime = tracer.now();
+                    const auto traceGuard = tracer.trace(TbfTaskTracer::OperationM2L, idxThread, idxTask, idxTask+1, 10, 20, submitTime);
+                }
+            });
+        }
+        for(auto& thread : threads){
+            thread.join();
+        }
+
+        UASSERTEEQUAL(tracer.getNbThreads(), long(nbThreads));
+        UASSERTEEQUAL(tracer.getNbLostRecords(), 0L);
+
+        const auto records = tracer.getRecords();
+        UASSERTEEQUAL(long(records.size()), nbThreads*nbTasksPerThread);
+
+        std::vector<long int> nbRecordsPerSlot(nbThreads, 0);
+        std::vector<long int> slotOfThread(nbThreads, -1);
+        for(long int idxRecord = 0 ; idxRecord < long(records.size()) ; ++idxRecord){
+            const auto& record = records[idxRecord];
+            UASSERTEEQUAL(record.operation, TbfTaskTracer::OperationM2L);
+            UASSERTEEQUAL(record.idxTargetGroup, record.idxSrcGroup+1);
+            UASSERTEEQUAL(record.nbSrcItems, 10L);
+            UASSERTEEQUAL(record.nbTargetItems, 20L);
+            UASSERTETRUE(record.submitTime <= record.startTime && record.startTime <= record.endTime);
+            if(idxRecord){
+                UASSERTETRUE(records[idxRecord-1].startTime <= record.startTime);
+            }
+            UASSERTETRUE(0 <= record.idxThread && record.idxThread < nbThreads);
+            nbRecordsPerSlot[record.idxThread] += 1;
+            // All the tasks of a thread are in the same slot
+            if(slotOfThread[record.level] == -1){
+                slotOfThread[record.level] = record.idxThread;
+            }
+            UASSERTEEQUAL(slotOfThread[record.level], record.idxThread);
+        }
+        for(int idxThread = 0 ; idxThread < nbThreads ; ++idxThread){
+            UASSERTEEQUAL(nbRecordsPerSlot[idxThread], nbTasksPerThread);
+        }
+
+        // The buffer of a thread is a ring, the oldest records are overwritten
+        for(long int idxTask = 0 ; idxTask < capacity + 5 ; ++idxTask){
+            const auto traceGuard = tracer.trace(TbfTaskTracer::OperationP2P, 0, idxTask, idxTask, 1, 1, tracer.now());
+        }
+        UASSERTEEQUAL(tracer.getNbThreads(), long(nbThreads+1));
+        UASSERTEEQUAL(tracer.getNbLostRecords(), 5L);
+        long int nbP2P = 0;
+        for(const auto& record : tracer.getRecords()){
+            if(record.operation == TbfTaskTracer::OperationP2P){
+                UASSERTETRUE(record.idxSrcGroup >= 5);
+                nbP2P += 1;
+            }
+        }
+        UASSERTEEQUAL(nbP2P, capacity);
+
+        tracer.clear();
+        UASSERTEEQUAL(long(tracer.getRecords().size()), 0L);
+        UASSERTEEQUAL(tracer.getNbLostRecords(), 0L);
+    }
+
+    void CheckExports(const TbfTaskTracer& inTracer){
+        const std::string chromeFilename = "tbfmm-utest-task-tracer.json";
+        const std::string pajeFilename = "tbfmm-utest-task-tracer.paje";
+
+        UASSERTETRUE(inTracer.exportChromeTrace(chromeFilename));
+        UASSERTETRUE(inTracer.exportPaje(pajeFilename));
+
+        const long int nbRecords = static_cast<long int>(inTracer.getRecords().size());
+
+        const std::string chromeTrace = ReadFile(chromeFilename);
+        UASSERTETRUE(chromeTrace.size() && chromeTrace.front() == '{');
+        long int nbCompleteEvents = 0;
+        for(auto pos = chromeTrace.find("\"ph\":\"X\"") ; pos != std::string::npos ; pos = chromeTrace.find("\"ph\":\"X\"", pos+1)){
+            nbCompleteEvents += 1;
+        }
+        UASSERTEEQUAL(nbCompleteEvents, nbRecords);
+        UASSERTETRUE(chromeTrace.find(",\n]") == std::string::npos);
+
+        const std::string pajeTrace = ReadFile(pajeFilename);
+        long int nbSetStates = 0;
+        for(auto pos = pajeTrace.find("\n5 ") ; pos != std::string::npos ; pos = pajeTrace.find("\n5 ", pos+1)){
+            nbSetStates += 1;
+        }
+        // A start and an end per task, plus the initial state of each thread
+        UASSERTEEQUAL(nbSetStates, 2*nbRecords + inTracer.getNbThreads());
+
+        std::remove(chromeFilename.c_str());
+        std::remove(pajeFilename.c_str());
+    }
+
+    template <class AlgorithmClass>
+    void TestAlgorithm(){
+        using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                                  std::array<long int,1>, std::array<long int,1>>;
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const auto particlePositions = getParticles(configuration);
+
+        for(long int blockSize : {30L, 1000L}){
+            TreeClass tree(configuration, particlePositions, blockSize);
+
+            AlgorithmClass algorithm(configuration);
+            algorithm.getTaskTracer().setEnabled(true);
+
+            for(bool useInteractionPlan : {false, true}){
+                algorithm.setUseInteractionPlan(useInteractionPlan);
+                algorithm.getTaskTracer().clear();
+                algorithm.execute(tree);
+
+                tree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                          const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                    for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                        UASSERTEEQUAL(particleRhsPtr[0][idxPart], NbParticles-1);
+                        particleRhsPtr[0][idxPart] = 0;
+                    }
+                });
+                tree.applyToAllCells([](const long int /*inLevel*/, auto&& /*cellHeader*/,
+                                        const std::optional<std::reference_wrapper<std::array<long int,1>>> cellMultipole,
+                                        const std::optional<std::reference_wrapper<std::array<long int,1>>> cellLocal){
+                    cellMultipole->get()[0] = 0;
+                    cellLocal->get()[0] = 0;
+                });
+
+                const auto& tracer = algorithm.getTaskTracer();
+                UASSERTEEQUAL(tracer.getNbLostRecords(), 0L);
+                UASSERTETRUE(tracer.getNbThreads() >= 1);
+
+                const long int nbLeafGroups = static_cast<long int>(std::size(tree.getParticleGroups()));
+                std::array<long int, TbfTaskTracer::NbOperations> nbRecordsPerOperation = {};
+                long int nbParticlesP2M = 0;
+                for(const auto& record : tracer.getRecords()){
+                    nbRecordsPerOperation[record.operation] += 1;
+                    UASSERTETRUE(record.submitTime <= record.startTime && record.startTime <= record.endTime);
+                    UASSERTETRUE(0 <= record.level && record.level < TreeHeight);
+                    const long int nbGroupsAtLevel = static_cast<long int>(std::size(tree.getCellGroupsAtLevel(record.level)));
+                    const long int nbGroupsSrc = (record.operation == TbfTaskTracer::OperationM2M ?
+                                                      static_cast<long int>(std::size(tree.getCellGroupsAtLevel(record.level+1))) : nbGroupsAtLevel);
+                    const long int nbGroupsTarget = (record.operation == TbfTaskTracer::OperationL2L ?
+                                                      static_cast<long int>(std::size(tree.getCellGroupsAtLevel(record.level+1))) : nbGroupsAtLevel);
+                    UASSERTETRUE(0 <= record.idxSrcGroup && record.idxSrcGroup < nbGroupsSrc);
+                    UASSERTETRUE(0 <= record.idxTargetGroup && record.idxTargetGroup < nbGroupsTarget);
+                    if(record.operation == TbfTaskTracer::OperationP2M){
+                        UASSERTEEQUAL(record.nbSrcItems, tree.getParticleGroups()[record.idxSrcGroup].getNbParticles());
+                        UASSERTEEQUAL(record.nbTargetItems, tree.getLeafGroups()[record.idxTargetGroup].getNbCells());
+                        nbParticlesP2M += record.nbSrcItems;
+                    }
+                }
+                UASSERTEEQUAL(nbRecordsPerOperation[TbfTaskTracer::OperationP2M], nbLeafGroups);
+                UASSERTEEQUAL(nbRecordsPerOperation[TbfTaskTracer::OperationL2P], nbLeafGroups);
+                UASSERTEEQUAL(nbParticlesP2M, NbParticles);
+                UASSERTETRUE(nbRecordsPerOperation[TbfTaskTracer::OperationM2M] >= 1);
+                UASSERTETRUE(nbRecordsPerOperation[TbfTaskTracer::OperationM2L] >= 1);
+                UASSERTETRUE(nbRecordsPerOperation[TbfTaskTracer::OperationL2L] >= 1);
+                UASSERTETRUE(nbRecordsPerOperation[TbfTaskTracer::OperationP2P] >= nbLeafGroups);
+
+                CheckExports(tracer);
+            }
+
+            // Disabled, the next executions are not recorded
+            algorithm.getTaskTracer().setEnabled(false);
+            algorithm.getTaskTracer().clear();
+            algorithm.execute(tree);
+            UASSERTEEQUAL(long(algorithm.getTaskTracer().getRecords().size()), 0L);
+        }
+    }
+
+    template <class AlgorithmClass>
+    void TestAlgorithmTsm(){
+        using TreeClass = TbfTreeTsm<RealType, RealType, Dim, long int, 1,
+                                     std::array<long int,1>, std::array<long int,1>>;
+
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const auto particlePositionsSource = getParticles(configuration);
+        const auto particlePositionsTarget = getParticles(configuration);
+
+        TreeClass tree(configuration, particlePositionsSource, particlePositionsTarget, 30);
+
+        AlgorithmClass algorithm(configuration);
+        algorithm.getTaskTracer().setEnabled(true);
+        algorithm.execute(tree);
+
+        const auto& tracer = algorithm.getTaskTracer();
+        std::array<long int, TbfTaskTracer::NbOperations> nbRecordsPerOperation = {};
+        for(const auto& record : tracer.getRecords()){
+            nbRecordsPerOperation[record.operation] += 1;
+            UASSERTETRUE(record.submitTime <= record.startTime && record.startTime <= record.endTime);
+            if(record.operation == TbfTaskTracer::OperationP2P){
+                UASSERTEEQUAL(record.nbSrcItems, tree.getParticleGroupsSource()[record.idxSrcGroup].getNbParticles());
+                UASSERTEEQUAL(record.nbTargetItems, tree.getParticleGroupsTarget()[record.idxTargetGroup].getNbParticles());
+            }
+        }
+        UASSERTEEQUAL(nbRecordsPerOperation[TbfTaskTracer::OperationP2M], static_cast<long int>(std::size(tree.getLeafGroupsSource())));
+        UASSERTEEQUAL(nbRecordsPerOperation[TbfTaskTracer::OperationL2P], static_cast<long int>(std::size(tree.getLeafGroupsTarget())));
+        UASSERTETRUE(nbRecordsPerOperation[TbfTaskTracer::OperationM2L] >= 1);
+        UASSERTETRUE(nbRecordsPerOperation[TbfTaskTracer::OperationP2P] >= 1);
+
+        CheckExports(tracer);
+    }
+
+    void TestOpenmpAlgorithm(){
+        TestAlgorithm<TbfOpenmpAlgorithm<RealType, TbfTestKernel<RealType>>>();
+    }
+
+    void TestThreadPoolAlgorithm(){
+        TestAlgorithm<TbfThreadPoolAlgorithm<RealType, TbfTestKernel<RealType>>>();
+    }
+
+    void TestOpenmpAlgorithmTsm(){
+        TestAlgorithmTsm<TbfOpenmpAlgorithmTsm<RealType, TbfTestKernel<RealType>>>();
+    }
+
+    void TestThreadPoolAlgorithmTsm(){
+        TestAlgorithmTsm<TbfThreadPoolAlgorithmTsm<RealType, TbfTestKernel<RealType>>>();
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestTaskTracer::TestRecords, "Test the records of the task tracer");
+        Parent::AddTest(&TestTaskTracer::TestOpenmpAlgorithm, "Test the OpenMP algorithm with the task tracer");
+        Parent::AddTest(&TestTaskTracer::TestThreadPoolAlgorithm, "Test the thread pool algorithm with the task tracer");
+        Parent::AddTest(&TestTaskTracer::TestOpenmpAlgorithmTsm, "Test the OpenMP tsm algorithm with the task tracer");
+        Parent::AddTest(&TestTaskTracer::TestThreadPoolAlgorithmTsm, "Test the thread pool tsm algorithm with the task tracer");
+    }
+};
+
+// You must do this
+TestClass(TestTaskTracer)
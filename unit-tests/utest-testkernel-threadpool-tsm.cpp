@@ -0,0 +1,6 @@
+#include "testkernel-core-tsm.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithmtsm.hpp"
+
+// You must do this
+using AlgoTestClass = TestTestKernelTsm<TbfThreadPoolAlgorithmTsm<double, TbfTestKernel<double>>>;
+TestClass(AlgoTestClass)
@@ -0,0 +1,6 @@
+#include "testkernel-core.hpp"
+#include "algorithms/threadpool/tbfthreadpoolalgorithm.hpp"
+
+// You must do this
+using AlgoTestClass = TestTestKernel<TbfThreadPoolAlgorithm<double, TbfTestKernel<double>>>;
+TestClass(AlgoTestClass)
@@ -0,0 +1,162 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdio>
+
+class TestTreeCheckpoint : public UTester< TestTreeCheckpoint > {
+    using Parent = UTester< TestTreeCheckpoint >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+    using OtherTreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                                   std::array<long int,2>, std::array<long int,1>>;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+    template <class TreeClassType>
+    void checkSameStructure(const TreeClassType& inTree1, const TreeClassType& inTree2){
+        UASSERTETRUE(inTree1.getSpacialConfiguration() == inTree2.getSpacialConfiguration());
+        UASSERTEEQUAL(inTree1.getNbParticles(), inTree2.getNbParticles());
+        UASSERTEEQUAL(inTree1.getNbElementsPerGroup(), inTree2.getNbElementsPerGroup());
+        UASSERTEEQUAL(inTree1.getMinGroupsPerThread(), inTree2.getMinGroupsPerThread());
+        UASSERTETRUE(inTree1.getGroupSplitStrategy() == inTree2.getGroupSplitStrategy());
+
+        for(long int idxLevel = 0 ; idxLevel < inTree1.getHeight() ; ++idxLevel){
+            UASSERTEEQUAL(inTree1.getNbElementsPerGroupAtLevel(idxLevel), inTree2.getNbElementsPerGroupAtLevel(idxLevel));
+            UASSERTEEQUAL(inTree1.getNbCellGroupsAtLevel(idxLevel), inTree2.getNbCellGroupsAtLevel(idxLevel));
+            if(inTree1.getNbCellGroupsAtLevel(idxLevel) != inTree2.getNbCellGroupsAtLevel(idxLevel)){
+                return;
+            }
+            for(long int idxGroup = 0 ; idxGroup < inTree1.getNbCellGroupsAtLevel(idxLevel) ; ++idxGroup){
+                const auto& group1 = inTree1.getCellGroupsAtLevel(idxLevel)[idxGroup];
+                const auto& group2 = inTree2.getCellGroupsAtLevel(idxLevel)[idxGroup];
+                UASSERTEEQUAL(group1.getNbCells(), group2.getNbCells());
+                for(long int idxCell = 0 ; idxCell < std::min(group1.getNbCells(), group2.getNbCells()) ; ++idxCell){
+                    UASSERTEEQUAL(group1.getCellSpacialIndex(idxCell), group2.getCellSpacialIndex(idxCell));
+                    UASSERTETRUE(group1.getCellMultipole(idxCell) == group2.getCellMultipole(idxCell));
+                    UASSERTETRUE(group1.getCellLocal(idxCell) == group2.getCellLocal(idxCell));
+                }
+            }
+        }
+
+        UASSERTEEQUAL(inTree1.getNbParticleGroups(), inTree2.getNbParticleGroups());
+        if(inTree1.getNbParticleGroups() != inTree2.getNbParticleGroups()){
+            return;
+        }
+        for(long int idxGroup = 0 ; idxGroup < inTree1.getNbParticleGroups() ; ++idxGroup){
+            const auto& group1 = inTree1.getParticleGroups()[idxGroup];
+            const auto& group2 = inTree2.getParticleGroups()[idxGroup];
+            UASSERTEEQUAL(group1.getNbLeaves(), group2.getNbLeaves());
+            UASSERTEEQUAL(group1.getNbParticles(), group2.getNbParticles());
+        }
+
+        const auto data1 = const_cast<TreeClassType&>(inTree1).getAllParticlesData();
+        const auto data2 = const_cast<TreeClassType&>(inTree2).getAllParticlesData();
+        const auto rhs1 = const_cast<TreeClassType&>(inTree1).getAllParticlesRhs();
+        const auto rhs2 = const_cast<TreeClassType&>(inTree2).getAllParticlesRhs();
+        for(long int idxPart = 0 ; idxPart < inTree1.getNbParticles() ; ++idxPart){
+            UASSERTETRUE(data1[idxPart] == data2[idxPart]);
+            UASSERTETRUE(rhs1[idxPart] == rhs2[idxPart]);
+        }
+    }
+
+    void checkResult(TreeClass& inTree, const long int inNbParticles){
+        inTree.applyToAllLeaves([&](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                    const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(particleRhsPtr[0][idxPart], inNbParticles-1);
+            }
+        });
+    }
+
+    void TestSaveLoad() {
+        const long int NbParticles = 10000;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(5, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const std::string filename = "utest-tree-checkpoint.tbftree";
+
+        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+            particlePositions[idxPart] = randomGenerator.getNewItem();
+        }
+
+        TreeClass tree(configuration, particlePositions, std::vector<long int>{1, 3, -1, 20, 50}, false,
+                       TbfGroupSplitStrategy::BalancedCost, TbfGroupCostModel(), 2);
+
+        // Before the FMM
+        {
+            UASSERTETRUE(tree.save(filename));
+            std::unique_ptr<TreeClass> loadedTree = TreeClass::Load(filename);
+            UASSERTETRUE(loadedTree != nullptr);
+            if(loadedTree){
+                checkSameStructure(tree, *loadedTree);
+
+                AlgorithmClass algorithm(configuration);
+                algorithm.execute(*loadedTree);
+                checkResult(*loadedTree, NbParticles);
+            }
+        }
+        // The file must not have been modified by the FMM
+        {
+            std::unique_ptr<TreeClass> loadedTree = TreeClass::Load(filename);
+            UASSERTETRUE(loadedTree != nullptr);
+            if(loadedTree){
+                checkSameStructure(tree, *loadedTree);
+            }
+        }
+        // After the FMM, the results are kept (also after a rebuild)
+        {
+            AlgorithmClass algorithm(configuration);
+            algorithm.execute(tree);
+            checkResult(tree, NbParticles);
+
+            UASSERTETRUE(tree.save(filename));
+            std::unique_ptr<TreeClass> loadedTree = TreeClass::Load(filename);
+            UASSERTETRUE(loadedTree != nullptr);
+            if(loadedTree){
+                checkSameStructure(tree, *loadedTree);
+                checkResult(*loadedTree, NbParticles);
+
+                loadedTree->rebuild();
+                checkResult(*loadedTree, NbParticles);
+            }
+        }
+        // Different types
+        UASSERTETRUE(OtherTreeClass::Load(filename) == nullptr);
+        std::remove(filename.c_str());
+        UASSERTETRUE(TreeClass::Load(filename) == nullptr);
+    }
+
+    void TestEmpty() {
+        const TbfSpacialConfiguration<RealType, Dim> configuration(4, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+        const std::string filename = "utest-tree-checkpoint-empty.tbftree";
+
+        TreeClass tree(configuration, std::vector<std::array<RealType, Dim>>(), 10);
+        UASSERTETRUE(tree.save(filename));
+        std::unique_ptr<TreeClass> loadedTree = TreeClass::Load(filename);
+        UASSERTETRUE(loadedTree != nullptr);
+        if(loadedTree){
+            checkSameStructure(tree, *loadedTree);
+        }
+        std::remove(filename.c_str());
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestTreeCheckpoint::TestSaveLoad, "Test save and load of a tree");
+        Parent::AddTest(&TestTreeCheckpoint::TestEmpty, "Test save and load of an empty tree");
+    }
+};
+
+// You must do this
+TestClass(TestTreeCheckpoint)
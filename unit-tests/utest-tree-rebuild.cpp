@@ -0,0 +1,185 @@
+#include "UTester.hpp"
+
+#include "spacial/tbfmortonspaceindex.hpp"
+#include "spacial/tbfspacialconfiguration.hpp"
+#include "utils/tbfrandom.hpp"
+#include "core/tbftree.hpp"
+#include "kernels/testkernel/tbftestkernel.hpp"
+#include "algorithms/sequential/tbfalgorithm.hpp"
+#include "algorithms/tbfalgorithmutils.hpp"
+
+#include <vector>
+#include <array>
+
+class TestTreeRebuild : public UTester< TestTreeRebuild > {
+    using Parent = UTester< TestTreeRebuild >;
+
+    using RealType = double;
+    static const int Dim = 3;
+
+    using TreeClass = TbfTree<RealType, RealType, Dim, long int, 1,
+                              std::array<long int,1>, std::array<long int,1>>;
+    using AlgorithmClass = TbfAlgorithm<RealType, TbfTestKernel<RealType>>;
+
+    void checkLeaves(const TreeClass& inTree, const std::vector<std::array<RealType, Dim>>& inPositions,
+                     const TbfSpacialConfiguration<RealType, Dim>& inConfiguration){
+        const TbfDefaultSpaceIndexType<RealType> spaceSystem(inConfiguration);
+        long int nbParticles = 0;
+
+        inTree.applyToAllLeaves([&](auto&& leafHeader, const long int* particleIndexes,
+                                    const std::array<const RealType*, Dim> particleDataPtr, const std::array<const long int*, 1> /*particleRhsPtr*/){
+            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                UASSERTEEQUAL(spaceSystem.getIndexFromPosition(inPositions[particleIndexes[idxPart]]), leafHeader.spaceIndex);
+                for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                    UASSERTEEQUAL(particleDataPtr[idxDim][idxPart], inPositions[particleIndexes[idxPart]][idxDim]);
+                }
+            }
+            nbParticles += leafHeader.nbParticles;
+        });
+
+        UASSERTEEQUAL(nbParticles, static_cast<long int>(inPositions.size()));
+    }
+
+    // The groups must respect the block size of each level, and be aligned
+    // with the groups of the lower level if there is one group per parent
+    void checkGroups(TreeClass& inTree, const long int inTreeHeight, const bool inOneGroupPerParent){
+        const TbfDefaultSpaceIndexType<RealType> spaceSystem(inTree.getSpacialConfiguration());
+
+        for(const auto& particleGroup : inTree.getParticleGroups()){
+            UASSERTETRUE(particleGroup.getNbLeaves() <= inTree.getNbElementsPerGroupAtLevel(inTreeHeight-1));
+        }
+
+        for(long int idxLevel = inTreeHeight-2 ; idxLevel >= 0 ; --idxLevel){
+            const auto& cellGroups = inTree.getCellGroupsAtLevel(idxLevel);
+            const auto& lowerCellGroups = inTree.getCellGroupsAtLevel(idxLevel+1);
+
+            if(inOneGroupPerParent){
+                long int idxGroup = 0;
+                long int lastParentIndex = -1;
+                for(const auto& lowerCellGroup : lowerCellGroups){
+                    std::vector<long int> parentIndexes;
+                    for(long int idxCell = 0 ; idxCell < lowerCellGroup.getNbCells() ; ++idxCell){
+                        const long int parentIndex = spaceSystem.getParentIndex(lowerCellGroup.getCellSpacialIndex(idxCell));
+                        if(parentIndex > lastParentIndex && (parentIndexes.empty() || parentIndexes.back() != parentIndex)){
+                            parentIndexes.push_back(parentIndex);
+                        }
+                    }
+                    if(parentIndexes.size()){
+                        UASSERTETRUE(idxGroup < static_cast<long int>(std::size(cellGroups)));
+                        if(idxGroup < static_cast<long int>(std::size(cellGroups))){
+                            UASSERTEEQUAL(cellGroups[idxGroup].getNbCells(), static_cast<long int>(parentIndexes.size()));
+                            for(long int idxCell = 0 ; idxCell < cellGroups[idxGroup].getNbCells() ; ++idxCell){
+                                UASSERTEEQUAL(cellGroups[idxGroup].getCellSpacialIndex(idxCell), parentIndexes[idxCell]);
+                            }
+                        }
+                        lastParentIndex = parentIndexes.back();
+                        idxGroup += 1;
+                    }
+                }
+                UASSERTEEQUAL(idxGroup, static_cast<long int>(std::size(cellGroups)));
+            }
+            else{
+                for(const auto& cellGroup : cellGroups){
+                    UASSERTETRUE(cellGroup.getNbCells() <= inTree.getNbElementsPerGroupAtLevel(idxLevel));
+                }
+            }
+        }
+    }
+
+    void CorePart(const long int TreeHeight) {
+        const long int NbParticles = 5000;
+        const TbfSpacialConfiguration<RealType, Dim> configuration(TreeHeight, {{1, 1, 1}}, {{0.5, 0.5, 0.5}});
+
+        for(bool oneGroupPerParent : {false, true}){
+            for(long int nbElementsPerBlock : {1L, 10L, 200L}){
+                for(bool useBlockSizePerLevel : {false, true}){
+                    // The block sizes of the upper levels can only be given without one group per parent
+                    if(useBlockSizePerLevel && oneGroupPerParent){
+                        continue;
+                    }
+                    std::vector<long int> blockSizes(TreeHeight, -1);
+                    for(long int idxLevel = 0 ; useBlockSizePerLevel && idxLevel < TreeHeight-1 ; ++idxLevel){
+                        blockSizes[idxLevel] = idxLevel+1;
+                    }
+                    blockSizes.back() = nbElementsPerBlock;
+
+                    for(long int moveStep : {NbParticles+1, 97L, 3L}){
+                        TbfRandom<RealType, Dim> randomGenerator(configuration.getBoxWidths());
+
+                        std::vector<std::array<RealType, Dim>> particlePositions(NbParticles);
+                        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                            particlePositions[idxPart] = randomGenerator.getNewItem();
+                        }
+
+                        TreeClass tree(configuration, particlePositions, blockSizes, oneGroupPerParent);
+
+                        AlgorithmClass algorithm(configuration);
+                        algorithm.execute(tree);
+
+                        for(long int idxPart = moveStep-1 ; idxPart < NbParticles ; idxPart += moveStep){
+                            particlePositions[idxPart] = randomGenerator.getNewItem();
+                        }
+
+                        tree.applyToAllLeaves([&](auto&& leafHeader, const long int* particleIndexes,
+                                                  const std::array<RealType*, Dim> particleDataPtr, const std::array<long int*, 1> particleRhsPtr){
+                            for(long int idxPart = 0 ; idxPart < leafHeader.nbParticles ; ++idxPart){
+                                for(int idxDim = 0 ; idxDim < Dim ; ++idxDim){
+                                    particleDataPtr[idxDim][idxPart] = particlePositions[particleIndexes[idxPart]][idxDim];
+                                }
+                                // The rhs must follow the particles
+                                particleRhsPtr[0][idxPart] = -particleIndexes[idxPart];
+                            }
+                        });
+
+                        const long int nbMoved = tree.rebuildIncremental();
+                        if(moveStep > NbParticles){
+                            UASSERTEEQUAL(nbMoved, 0L);
+                        }
+                        UASSERTETRUE(nbMoved <= NbParticles/moveStep);
+
+                        checkLeaves(tree, particlePositions, configuration);
+                        checkGroups(tree, TreeHeight, oneGroupPerParent);
+
+                        const auto rhs = tree.getAllParticlesRhs();
+                        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                            UASSERTEEQUAL(rhs[idxPart][0], -idxPart);
+                        }
+
+                        tree.applyToAllLeaves([](auto&& leafHeader, const long int* /*particleIndexes*/,
+                                                 const std::array<RealType*, Dim> /*particleDataPtr*/, const std::array<long int*, 1> particleRhsPtr){
+                            std::fill(particleRhsPtr[0], particleRhsPtr[0] + leafHeader.nbParticles, 0);
+                        });
+
+                        // The multipoles and locals must have been reset
+                        algorithm.execute(tree);
+
+                        TreeClass referenceTree(configuration, particlePositions, blockSizes, oneGroupPerParent);
+                        algorithm.execute(referenceTree);
+
+                        UASSERTEEQUAL(tree.getNbParticles(), referenceTree.getNbParticles());
+
+                        const auto newRhs = tree.getAllParticlesRhs();
+                        const auto referenceRhs = referenceTree.getAllParticlesRhs();
+                        for(long int idxPart = 0 ; idxPart < NbParticles ; ++idxPart){
+                            UASSERTEEQUAL(newRhs[idxPart][0], referenceRhs[idxPart][0]);
+                            UASSERTEEQUAL(newRhs[idxPart][0], NbParticles-1);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void TestIncremental() {
+        CorePart(4);
+        // There are empty leaves, and the groups can receive new leaves
+        CorePart(5);
+    }
+
+    void SetTests() {
+        Parent::AddTest(&TestTreeRebuild::TestIncremental, "Test incremental rebuild");
+    }
+};
+
+// You must do this
+TestClass(TestTreeRebuild)